@@ -0,0 +1,101 @@
+#ifndef _FLAT_CONTAINER_BITS_HPP_
+#define _FLAT_CONTAINER_BITS_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+#include <hadoken/parallel/algorithm.hpp>
+
+namespace hadoken{
+
+namespace containers{
+
+
+///
+/// \brief tag for the constructors of flat_map and flat_set whose input
+/// is already sorted and without duplicates: no sort, no check
+///
+struct sorted_unique_t{};
+
+constexpr sorted_unique_t sorted_unique = sorted_unique_t();
+
+
+namespace details{
+
+// under this number of elements, the bulk construction sorts sequentially
+constexpr std::size_t flat_parallel_sort_threshold = 1 << 14;
+
+
+// lower bound without unpredictable branch: the loop runs log2(n) times
+// whatever the key, the comparison result selects the next half with a conditional move
+template<typename Key, typename K, typename Compare>
+inline const Key* flat_lower_bound(const Key* first, std::size_t n, const K & key, const Compare & comp){
+    if(n == 0){
+        return first;
+    }
+
+    while(n > 1){
+        const std::size_t half = n / 2;
+        first = comp(first[half], key) ? first + half : first;
+        n -= half;
+    }
+    return first + (comp(*first, key) ? 1 : 0);
+}
+
+template<typename Key, typename K, typename Compare>
+inline const Key* flat_upper_bound(const Key* first, std::size_t n, const K & key, const Compare & comp){
+    if(n == 0){
+        return first;
+    }
+
+    while(n > 1){
+        const std::size_t half = n / 2;
+        first = comp(key, first[half]) ? first : first + half;
+        n -= half;
+    }
+    return first + (comp(key, *first) ? 0 : 1);
+}
+
+
+// sort [first, last), in parallel for large inputs
+template<typename RandomIt, typename Compare>
+inline void flat_sort(RandomIt first, RandomIt last, Compare comp){
+    if(static_cast<std::size_t>(std::distance(first, last)) >= flat_parallel_sort_threshold){
+        parallel::sort(parallel::par, first, last, comp);
+    } else {
+        std::sort(first, last, comp);
+    }
+}
+
+
+// permutation which sorts keys, equivalent keys stay in their input order
+template<typename Key, typename Compare>
+inline std::vector<std::size_t> flat_sort_permutation(const std::vector<Key> & keys, const Compare & comp){
+    std::vector<std::size_t> order(keys.size());
+    for(std::size_t i = 0; i < order.size(); ++i){
+        order[i] = i;
+    }
+
+    // ties broken by position: a strict total order, an unstable sort is enough
+    flat_sort(order.begin(), order.end(), [&keys, &comp](std::size_t a, std::size_t b){
+        if(comp(keys[a], keys[b])){
+            return true;
+        }
+        if(comp(keys[b], keys[a])){
+            return false;
+        }
+        return a < b;
+    });
+    return order;
+}
+
+
+} // details
+
+} // containers
+
+} // hadoken
+
+#endif // _FLAT_CONTAINER_BITS_HPP_
@@ -0,0 +1,146 @@
+#ifndef _FLAT_HASH_GROUP_BITS_HPP_
+#define _FLAT_HASH_GROUP_BITS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) && !defined(HADOKEN_FLAT_HASH_NO_SIMD)
+#define HADOKEN_FLAT_HASH_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace hadoken{
+
+namespace containers{
+
+namespace details{
+
+// control byte of a flat_hash_map slot: the 7 low bits of the hash for a full slot,
+// a negative value for an empty or a deleted slot
+typedef signed char hash_ctrl;
+
+constexpr hash_ctrl hash_ctrl_empty = -128;     // 0b10000000
+constexpr hash_ctrl hash_ctrl_deleted = -2;     // 0b11111110
+
+inline bool hash_ctrl_is_full(hash_ctrl c){
+    return c >= 0;
+}
+
+
+// set of slots of a group, Shift is log2 of the number of bits per slot in the mask
+template<unsigned int Shift, unsigned int Width>
+class hash_bit_mask{
+public:
+    inline explicit hash_bit_mask(std::uint64_t mask) : _mask(mask) {}
+
+    inline explicit operator bool() const{
+        return _mask != 0;
+    }
+
+    // index in the group of the first slot of the set
+    inline unsigned int lowest() const{
+        return static_cast<unsigned int>(__builtin_ctzll(_mask)) >> Shift;
+    }
+
+    inline void clear_lowest(){
+        _mask &= (_mask -1);
+    }
+
+    // number of slots before the first slot of the set
+    inline unsigned int trailing_zeros() const{
+        return (_mask == 0) ? Width : lowest();
+    }
+
+    // number of slots after the last slot of the set
+    inline unsigned int leading_zeros() const{
+        const unsigned int total_bits = Width << Shift;
+        return (_mask == 0) ? Width : static_cast<unsigned int>(__builtin_clzll(_mask) - (64 - total_bits)) >> Shift;
+    }
+
+private:
+    std::uint64_t _mask;
+};
+
+
+#ifdef HADOKEN_FLAT_HASH_SSE2
+
+// group of 16 control bytes, compared in parallel with SSE2
+class hash_group{
+public:
+    static constexpr std::size_t width = 16;
+
+    typedef hash_bit_mask<0, 16> mask_type;
+
+    inline explicit hash_group(const hash_ctrl* ctrl) : _ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl))) {}
+
+    inline mask_type match(hash_ctrl h2) const{
+        return mask_type(_to_mask(_mm_cmpeq_epi8(_mm_set1_epi8(h2), _ctrl)));
+    }
+
+    inline mask_type match_empty() const{
+        return mask_type(_to_mask(_mm_cmpeq_epi8(_mm_set1_epi8(hash_ctrl_empty), _ctrl)));
+    }
+
+    // the sign bit is set for the empty and deleted slots only
+    inline mask_type match_empty_or_deleted() const{
+        return mask_type(_to_mask(_ctrl));
+    }
+
+private:
+    static inline std::uint64_t _to_mask(__m128i v){
+        return static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm_movemask_epi8(v)));
+    }
+
+    __m128i _ctrl;
+};
+
+#else
+
+// group of 8 control bytes, compared in parallel in a 64 bits word (SWAR)
+class hash_group{
+public:
+    static constexpr std::size_t width = 8;
+
+    typedef hash_bit_mask<3, 8> mask_type;
+
+    inline explicit hash_group(const hash_ctrl* ctrl){
+        std::memcpy(&_ctrl, ctrl, sizeof(_ctrl));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        _ctrl = __builtin_bswap64(_ctrl);
+#endif
+    }
+
+    // can report a false positive after a true match, always on a full slot:
+    // the keys are compared anyway
+    inline mask_type match(hash_ctrl h2) const{
+        const std::uint64_t x = _ctrl ^ (lsbs * static_cast<unsigned char>(h2));
+        return mask_type((x - lsbs) & ~x & msbs);
+    }
+
+    // 0b10000000 only has the bit 7 set and the bit 1 unset
+    inline mask_type match_empty() const{
+        return mask_type(_ctrl & ~(_ctrl << 6) & msbs);
+    }
+
+    inline mask_type match_empty_or_deleted() const{
+        return mask_type(_ctrl & msbs);
+    }
+
+private:
+    static constexpr std::uint64_t lsbs = 0x0101010101010101ULL;
+    static constexpr std::uint64_t msbs = 0x8080808080808080ULL;
+
+    std::uint64_t _ctrl;
+};
+
+#endif
+
+
+} // details
+
+} // containers
+
+} // hadoken
+
+#endif // _FLAT_HASH_GROUP_BITS_HPP_
@@ -0,0 +1,47 @@
+#ifndef _HASH_BITS_HPP_
+#define _HASH_BITS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+namespace hadoken{
+
+namespace containers{
+
+namespace details{
+
+// finalizer of murmur3: std::hash is the identity for integers
+// in most implementations, spread the bits before masking
+inline std::size_t mix_hash(std::size_t h){
+    std::uint64_t x = static_cast<std::uint64_t>(h);
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return static_cast<std::size_t>(x);
+}
+
+inline std::size_t next_power_of_two(std::size_t n){
+    // the largest power of two of size_t: beyond it, the shift wraps to 0
+    const std::size_t max_power = ~(std::numeric_limits<std::size_t>::max() >> 1);
+    if(n > max_power){
+        throw std::length_error("next_power_of_two: no power of two larger than n");
+    }
+
+    std::size_t res = 1;
+    while(res < n){
+        res <<= 1;
+    }
+    return res;
+}
+
+} // details
+
+} // containers
+
+} // hadoken
+
+#endif // _HASH_BITS_HPP_
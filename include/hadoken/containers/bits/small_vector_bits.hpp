@@ -4,7 +4,9 @@
 #include <stdexcept>
 #include <limits>
 #include <cassert>
+#include <cstring>
 #include <algorithm>
+#include <new>
 
 #include  "../small_vector.hpp"
 
@@ -12,237 +14,787 @@ namespace hadoken{
 
 namespace containers{
 
-namespace {
+namespace details{
 
 
 // boundary check
-template<typename Iterator>
-void _range_check(Iterator it1, Iterator it2, std::size_t pos){
-    if( pos >= static_cast<std::size_t>(it2 - it1) ){
+inline void small_vector_range_check(std::size_t pos, std::size_t size){
+    if( pos >= size ){
         throw std::out_of_range("out of range in small_vector");
     }
 }
 
-// untyped deallocator
-void inline _deallocate(void * ptr){
-    ::operator delete(ptr);
+// destroy objects without deallocate, no-op for trivially destructible types
+template<typename T>
+inline void destroy_range(T* first, T* last, std::true_type){
+    (void) first;
+    (void) last;
 }
 
-// destroy object without deallocate
-// specialize for improved efficiency with POD types
-template<typename Iterator, typename ObType, typename Extra = void>
-struct destroyer_func{
-    inline void operator()(Iterator it){
-        static_assert(std::is_pod<ObType>::value, "invalid pod type");
-        (void) it;
+template<typename T>
+inline void destroy_range(T* first, T* last, std::false_type){
+    for(; first < last; ++first){
+        first->~T();
     }
-};
+}
+
+template<typename T>
+inline void destroy_range(T* first, T* last){
+    destroy_range(first, last, std::integral_constant<bool, std::is_trivially_destructible<T>::value>());
+}
+
+
+// move objects to an area of uninitialized memory, which does not overlap,
+// then destroy the old copies
+//
+// a single memcpy for the trivially relocatable types
+template<typename T>
+inline void relocate_range(T* first, T* last, T* output, std::true_type){
+    if(first != last){
+        std::memcpy(static_cast<void*>(output), static_cast<const void*>(first), static_cast<std::size_t>(last - first) * sizeof(T));
+    }
+}
 
-template<typename Iterator, typename ObType >
-struct destroyer_func<Iterator,ObType, typename std::enable_if<std::is_pod<ObType>::value == false>::type>{
-    inline void operator()(Iterator it){
-        static_assert(std::is_pod<ObType>::value == false, "should be pod type");
-        it->~ObType();
+template<typename T>
+inline void relocate_range(T* first, T* last, T* output, std::false_type){
+    T* out = output;
+    try{
+        for(T* it = first; it < last; ++it, ++out){
+            new (out) T(std::move_if_noexcept(*it));
+        }
+    }catch(...){
+        destroy_range(output, out);
+        throw;
     }
-};
+    destroy_range(first, last);
+}
+
+template<typename T>
+inline void relocate_range(T* first, T* last, T* output){
+    relocate_range(first, last, output, std::integral_constant<bool, is_trivially_relocatable<T>::value>());
+}
+
+
+} // details
+
 
-// move object to an area of unitialized memory
-// then destroy the old copy
-template<typename Iterator, typename ObType, typename Extra = void >
-struct unitialize_move_func{
+template<typename T, std::size_t N, typename Allocator>
+small_vector<T,N,Allocator>::small_vector() noexcept(noexcept(Allocator())) :
+       allocator_base(),
+       _begin(_internal_array()),
+       _end(_begin),
+       _end_memory(_begin + N) {}
 
-    inline void operator()(Iterator begin, Iterator end, Iterator output){
-        static_assert(std::is_pod<ObType>::value == false, "invalid pod type");
 
-        destroyer_func<Iterator, ObType> _destroyer;
+template<typename T, std::size_t N, typename Allocator>
+small_vector<T,N,Allocator>::small_vector(const Allocator & alloc) noexcept :
+       allocator_base(alloc),
+       _begin(_internal_array()),
+       _end(_begin),
+       _end_memory(_begin + N) {}
+
+
+template<typename T, std::size_t N, typename Allocator>
+small_vector<T,N,Allocator>::small_vector(size_type n, const Allocator & alloc) : small_vector(alloc){
+    resize(n);
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+small_vector<T,N,Allocator>::small_vector(size_type n, const_reference value, const Allocator & alloc) : small_vector(alloc){
+    assign(n, value);
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+template<typename InputIterator, typename>
+small_vector<T,N,Allocator>::small_vector(InputIterator first, InputIterator last, const Allocator & alloc) : small_vector(alloc){
+    assign(first, last);
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+small_vector<T,N,Allocator>::small_vector(std::initializer_list<value_type> values, const Allocator & alloc) : small_vector(alloc){
+    assign(values.begin(), values.end());
+}
+
 
-        for(; begin < end; begin++, output++){
-            output = new (output) ObType(std::move(*begin));
-            _destroyer(begin);
+template<typename T, std::size_t N, typename Allocator>
+small_vector<T,N,Allocator>::small_vector(const small_vector & other) :
+    small_vector(other, allocator_traits::select_on_container_copy_construction(other._get_alloc())){
+
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+small_vector<T,N,Allocator>::small_vector(const small_vector & other, const Allocator & alloc) : small_vector(alloc){
+    reserve(other.size());
+    _end = std::uninitialized_copy(other._begin, other._end, _begin);
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+small_vector<T,N,Allocator>::small_vector(small_vector && other) noexcept(std::is_nothrow_move_constructible<T>::value) :
+    allocator_base(std::move(other._get_alloc())),
+    _begin(_internal_array()),
+    _end(_begin),
+    _end_memory(_begin + N){
+    _take_content(other);
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+small_vector<T,N,Allocator>::small_vector(small_vector && other, const Allocator & alloc) : small_vector(alloc){
+    if(this->_get_alloc() == other._get_alloc()){
+        _take_content(other);
+    } else {
+        _relocate_content(other);
+    }
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+small_vector<T,N,Allocator>::~small_vector(){
+    _destroy_all_and_release();
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+small_vector<T,N,Allocator> & small_vector<T,N,Allocator>::operator=(const small_vector & other){
+    if(this != &other){
+        if(allocator_traits::propagate_on_container_copy_assignment::value
+                && this->_get_alloc() != other._get_alloc()){
+            // the buffer must be released by the allocator which owns it
+            _destroy_all_and_release();
+            this->_get_alloc() = other._get_alloc();
         }
+        assign(other._begin, other._end);
     }
-};
+    return *this;
+}
 
-template<typename Iterator, typename ObType >
-struct unitialize_move_func<Iterator, ObType, typename std::enable_if<std::is_pod<ObType>::value == true>::type>{
 
-    inline void operator()(Iterator begin, Iterator end, Iterator output){
-        std::uninitialized_copy(begin, end, output);
+template<typename T, std::size_t N, typename Allocator>
+small_vector<T,N,Allocator> & small_vector<T,N,Allocator>::operator=(small_vector && other)
+        noexcept(std::is_nothrow_move_constructible<T>::value
+                 && std::allocator_traits<Allocator>::propagate_on_container_move_assignment::value){
+    if(this != &other){
+        if(allocator_traits::propagate_on_container_move_assignment::value){
+            _destroy_all_and_release();
+            this->_get_alloc() = std::move(other._get_alloc());
+            _take_content(other);
+        } else if(this->_get_alloc() == other._get_alloc()){
+            clear();
+            _take_content(other);
+        } else {
+            clear();
+            _relocate_content(other);
+        }
     }
-};
+    return *this;
+}
 
+
+template<typename T, std::size_t N, typename Allocator>
+small_vector<T,N,Allocator> & small_vector<T,N,Allocator>::operator=(std::initializer_list<value_type> values){
+    assign(values.begin(), values.end());
+    return *this;
 }
 
-template<typename T, std::size_t N>
-small_vector<T,N>::small_vector() :
-       _begin(_internal_array),
-       _end(_internal_array),
-       _end_memory(_begin),
-       _internal_array() {}
 
+template<typename T, std::size_t N, typename Allocator>
+void small_vector<T,N,Allocator>::assign(size_type n, const_reference value){
+    // value can be an element of the vector
+    const value_type copy(value);
+    clear();
+    reserve(n);
+    _end = std::uninitialized_fill_n(_begin, n, copy);
+}
 
-template<typename T, std::size_t N>
-small_vector<T,N>::~small_vector(){
-    if(_begin != _end_memory){
 
-        // destroy object if not simple layout
-        for(auto it = _begin; it < _end; ++it){
-            destroyer_func<pointer,T> _destroyer;
-            _destroyer(it);
-        }
-        _deallocate(_begin);
+template<typename T, std::size_t N, typename Allocator>
+template<typename InputIterator, typename>
+void small_vector<T,N,Allocator>::assign(InputIterator first, InputIterator last){
+    clear();
+    _insert_range(0, first, last, typename std::iterator_traits<InputIterator>::iterator_category());
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+void small_vector<T,N,Allocator>::assign(std::initializer_list<value_type> values){
+    assign(values.begin(), values.end());
+}
+
+
+
+template<typename T, std::size_t N, typename Allocator>
+typename small_vector<T,N,Allocator>::size_type
+small_vector<T,N,Allocator>::max_size() const noexcept{
+        return std::numeric_limits<std::size_t>::max() / sizeof(T);
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+std::size_t small_vector<T,N,Allocator>::capacity() const noexcept{
+    return static_cast<std::size_t>(_end_memory - _begin);
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+bool small_vector<T,N,Allocator>::empty() const noexcept{
+    return _begin == _end;
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+void small_vector<T,N,Allocator>::reserve(size_type n){
+    if(n > capacity()){
+        _reallocate(n);
     }
 }
 
 
+template<typename T, std::size_t N, typename Allocator>
+void small_vector<T,N,Allocator>::shrink_to_fit(){
+    if(_is_static() || size() == capacity()){
+        return;
+    }
+
+    const std::size_t n_elems = size();
+
+    if(n_elems <= N){
+        // back to the inline storage
+        pointer old_data = _begin;
+        const std::size_t old_capacity = capacity();
+
+        details::relocate_range(_begin, _end, _internal_array());
+
+        _begin = _internal_array();
+        _end = _begin + n_elems;
+        _end_memory = _begin + N;
+        _deallocate(old_data, old_capacity);
+        return;
+    }
 
-template<typename T, std::size_t N>
-typename small_vector<T,N>::size_type
-small_vector<T,N>::max_size() const noexcept{
-        return std::numeric_limits<std::size_t>::max();
+    _reallocate(n_elems);
 }
 
 
-template<typename T, std::size_t N>
-void small_vector<T,N>::push_back(const_reference v){
-    const std::size_t pos = (_end - _begin);
-    if(  pos >= std::max<std::size_t>(N, _end_memory - _begin)){
-        _resize_to_fit(pos+1);
+template<typename T, std::size_t N, typename Allocator>
+void small_vector<T,N,Allocator>::resize(size_type n){
+    if(n <= size()){
+        erase(_begin + n, _end);
+        return;
     }
 
-    _end = new (_end) T(v);
-    _end++;
+    reserve(n);
+    while(size() < n){
+        new (_end) T();
+        ++_end;
+    }
 }
 
 
-template<typename T, std::size_t N>
-void small_vector<T,N>::emplace_back(value_type && v){
-    const std::size_t pos = (_end - _begin);
-    if( pos >= std::max<std::size_t>(N, _end_memory - _begin)){
-        _resize_to_fit(pos+1);
+template<typename T, std::size_t N, typename Allocator>
+void small_vector<T,N,Allocator>::resize(size_type n, const_reference value){
+    if(n <= size()){
+        erase(_begin + n, _end);
+        return;
     }
 
-    _end = new (_end) T(std::move(v));
-    _end++;
+    const value_type copy(value);
+    reserve(n);
+    while(size() < n){
+        new (_end) T(copy);
+        ++_end;
+    }
 }
 
 
-template<typename T, std::size_t N>
-typename small_vector<T,N>::reference small_vector<T,N>::front(){
-   assert((_end - _begin) >= 1);
-   return *_begin;
+template<typename T, std::size_t N, typename Allocator>
+void small_vector<T,N,Allocator>::push_back(const_reference v){
+    if(_end == _end_memory){
+        _emplace_back_realloc(v);
+        return;
+    }
+
+    new (_end) T(v);
+    ++_end;
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+void small_vector<T,N,Allocator>::push_back(value_type && v){
+    emplace_back(std::move(v));
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+template<typename... Args>
+typename small_vector<T,N,Allocator>::reference small_vector<T,N,Allocator>::emplace_back(Args &&... args){
+    if(_end == _end_memory){
+        _emplace_back_realloc(std::forward<Args>(args)...);
+    } else {
+        new (_end) T(std::forward<Args>(args)...);
+        ++_end;
+    }
+    return *(_end -1);
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+void small_vector<T,N,Allocator>::pop_back(){
+    assert(_end > _begin);
+    --_end;
+    details::destroy_range(_end, _end +1);
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+typename small_vector<T,N,Allocator>::iterator small_vector<T,N,Allocator>::insert(const_iterator pos, const_reference value){
+    return emplace(pos, value);
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+typename small_vector<T,N,Allocator>::iterator small_vector<T,N,Allocator>::insert(const_iterator pos, value_type && value){
+    return emplace(pos, std::move(value));
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+typename small_vector<T,N,Allocator>::iterator small_vector<T,N,Allocator>::insert(const_iterator pos, size_type n, const_reference value){
+    const value_type copy(value);
+    return _insert_n(static_cast<std::size_t>(pos - _begin), n, [&copy](pointer dest, std::size_t){
+        new (dest) T(copy);
+    });
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+template<typename InputIterator, typename>
+typename small_vector<T,N,Allocator>::iterator small_vector<T,N,Allocator>::insert(const_iterator pos, InputIterator first, InputIterator last){
+    return _insert_range(static_cast<std::size_t>(pos - _begin), first, last,
+                         typename std::iterator_traits<InputIterator>::iterator_category());
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+typename small_vector<T,N,Allocator>::iterator small_vector<T,N,Allocator>::insert(const_iterator pos, std::initializer_list<value_type> values){
+    return insert(pos, values.begin(), values.end());
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+template<typename... Args>
+typename small_vector<T,N,Allocator>::iterator small_vector<T,N,Allocator>::emplace(const_iterator pos, Args &&... args){
+    const std::size_t index = static_cast<std::size_t>(pos - _begin);
+    if(pos == _end){
+        emplace_back(std::forward<Args>(args)...);
+        return _begin + index;
+    }
+
+    // args can reference an element of the vector
+    value_type elem(std::forward<Args>(args)...);
+    return _insert_n(index, 1, [&elem](pointer dest, std::size_t){
+        new (dest) T(std::move(elem));
+    });
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+typename small_vector<T,N,Allocator>::iterator small_vector<T,N,Allocator>::erase(const_iterator pos){
+    assert(pos < _end);
+    return erase(pos, pos +1);
 }
 
 
+template<typename T, std::size_t N, typename Allocator>
+typename small_vector<T,N,Allocator>::iterator small_vector<T,N,Allocator>::erase(const_iterator first, const_iterator last){
+    pointer pfirst = _begin + (first - _begin);
+    pointer plast = _begin + (last - _begin);
+    if(pfirst == plast){
+        return pfirst;
+    }
+
+    if(is_trivially_relocatable<T>::value){
+        details::destroy_range(pfirst, plast);
+        std::memmove(static_cast<void*>(pfirst), static_cast<const void*>(plast), static_cast<std::size_t>(_end - plast) * sizeof(T));
+        _end -= (plast - pfirst);
+    } else {
+        pointer new_end = std::move(plast, _end, pfirst);
+        details::destroy_range(new_end, _end);
+        _end = new_end;
+    }
+    return pfirst;
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+void small_vector<T,N,Allocator>::clear() noexcept{
+    details::destroy_range(_begin, _end);
+    _end = _begin;
+}
 
-template<typename T, std::size_t N>
-typename small_vector<T,N>::const_reference small_vector<T,N>::front() const noexcept{
+
+template<typename T, std::size_t N, typename Allocator>
+typename small_vector<T,N,Allocator>::reference small_vector<T,N,Allocator>::front(){
    assert((_end - _begin) >= 1);
    return *_begin;
 }
 
 
-template<typename T, std::size_t N>
-typename small_vector<T,N>::reference small_vector<T,N>::back(){
+template<typename T, std::size_t N, typename Allocator>
+typename small_vector<T,N,Allocator>::const_reference small_vector<T,N,Allocator>::front() const noexcept{
    assert((_end - _begin) >= 1);
-   return *(_begin + std::min<std::size_t>(size(), 1) -1);
+   return *_begin;
 }
 
-template<typename T, std::size_t N>
-typename small_vector<T,N>::pointer
-small_vector<T,N>::data() noexcept{
-    return &(*_begin);
+
+template<typename T, std::size_t N, typename Allocator>
+typename small_vector<T,N,Allocator>::reference small_vector<T,N,Allocator>::back(){
+   assert((_end - _begin) >= 1);
+   return *(_end -1);
 }
 
 
+template<typename T, std::size_t N, typename Allocator>
+typename small_vector<T,N,Allocator>::const_reference small_vector<T,N,Allocator>::back() const noexcept{
+   assert((_end - _begin) >= 1);
+   return *(_end -1);
+}
+
 
-template<typename T, std::size_t N>
-bool small_vector<T,N>::empty() const noexcept{
-    return size() == 0;
+template<typename T, std::size_t N, typename Allocator>
+typename small_vector<T,N,Allocator>::pointer
+small_vector<T,N,Allocator>::data() noexcept{
+    return _begin;
 }
 
-template<typename T, std::size_t N>
-std::size_t small_vector<T,N>::capacity() const noexcept{
-    return static_cast<std::size_t>(_end_memory - _begin);
+
+template<typename T, std::size_t N, typename Allocator>
+typename small_vector<T,N,Allocator>::const_pointer
+small_vector<T,N,Allocator>::data() const noexcept{
+    return _begin;
 }
 
 
-template<typename T, std::size_t N>
-typename small_vector<T,N>::reference
-small_vector<T,N>::operator[] (std::size_t pos) noexcept{
+template<typename T, std::size_t N, typename Allocator>
+typename small_vector<T,N,Allocator>::reference
+small_vector<T,N,Allocator>::operator[] (std::size_t pos) noexcept{
     assert(std::ptrdiff_t(pos) < (_end - _begin));
     return *( _begin + static_cast<std::ptrdiff_t>(pos)) ;
 }
 
 
-template<typename T, std::size_t N>
-typename small_vector<T,N>::const_reference
-small_vector<T,N>::operator[] (std::size_t pos) const noexcept{
+template<typename T, std::size_t N, typename Allocator>
+typename small_vector<T,N,Allocator>::const_reference
+small_vector<T,N,Allocator>::operator[] (std::size_t pos) const noexcept{
     assert(std::ptrdiff_t(pos) < (_end - _begin));
-    return  _begin + static_cast<std::ptrdiff_t>(pos);
+    return *( _begin + static_cast<std::ptrdiff_t>(pos));
 }
 
 
-template<typename T, std::size_t N>
-typename small_vector<T,N>::reference
-small_vector<T,N>::at (std::size_t pos){
-    _range_check(_begin, _end, pos);
+template<typename T, std::size_t N, typename Allocator>
+typename small_vector<T,N,Allocator>::reference
+small_vector<T,N,Allocator>::at (std::size_t pos){
+    details::small_vector_range_check(pos, size());
     return (*this)[pos];
 }
 
 
-template<typename T, std::size_t N>
-typename small_vector<T,N>::const_reference
-small_vector<T,N>::at (std::size_t pos) const{
-    _range_check(_begin, _end, pos);
+template<typename T, std::size_t N, typename Allocator>
+typename small_vector<T,N,Allocator>::const_reference
+small_vector<T,N,Allocator>::at (std::size_t pos) const{
+    details::small_vector_range_check(pos, size());
     return (*this)[pos];
 }
 
-template<typename T, std::size_t N>
-void small_vector<T,N>::swap(small_vector<T,N> & other){
-    using namespace std;
 
-    if(_is_static()){
-        for(std::size_t i =0; i < N; ++i){
-            swap(_internal_array[i], other._internal_array[i]);
+template<typename T, std::size_t N, typename Allocator>
+void small_vector<T,N,Allocator>::swap(small_vector<T,N,Allocator> & other){
+    if(this == &other){
+        return;
+    }
+
+    if(_is_static() == false && other._is_static() == false){
+        if(allocator_traits::propagate_on_container_swap::value){
+            using std::swap;
+            swap(this->_get_alloc(), other._get_alloc());
         }
+        std::swap(_begin, other._begin);
+        std::swap(_end, other._end);
+        std::swap(_end_memory, other._end_memory);
+        return;
     }
 
-    swap(_begin, other._begin);
-    swap(_end, other._end);
-    swap(_end_memory, other._end_memory);
+    small_vector tmp(std::move(other));
+    other = std::move(*this);
+    *this = std::move(tmp);
 }
 
 
 
-template<typename T, std::size_t N>
-void small_vector<T,N>::_resize_to_fit(std::size_t s){
-    const std::size_t size_alloc = static_cast<std::size_t>(_end_memory - _begin);
-
-    const std::size_t n_elems = static_cast<std::size_t>(_end - _begin);
-    const std::size_t required_size= std::max((size_alloc << 1), std::max(s, N*2));
+template<typename T, std::size_t N, typename Allocator>
+bool small_vector<T,N,Allocator>::_is_static() const noexcept{
+    return static_cast<const void*>(_begin) == static_cast<const void*>(_internal_storage);
+}
 
-    // first reallocation from short buffer to extensible buffer needed
-    pointer pdata_old = ( _is_static() ) ? nullptr : _begin;
-    pointer pdata = static_cast<pointer>(static_cast<void*>(::operator new(required_size * sizeof(T))));
 
-    unitialize_move_func<T*, T> _mover;
+template<typename T, std::size_t N, typename Allocator>
+void small_vector<T,N,Allocator>::_reallocate(std::size_t s){
+    const std::size_t n_elems = size();
+    assert(s >= n_elems);
 
-    _mover(_begin, _end, pdata);
+    pointer pdata = _allocate(s);
+    try{
+        details::relocate_range(_begin, _end, pdata);
+    }catch(...){
+        _deallocate(pdata, s);
+        throw;
+    }
 
-    _deallocate(pdata_old);
+    _release_buffer();
 
     _begin = pdata;
     _end = _begin + n_elems;
-    _end_memory = _begin + required_size;
+    _end_memory = _begin + s;
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+void small_vector<T,N,Allocator>::_resize_to_fit(std::size_t s){
+    _reallocate(std::max(capacity() * 2, s));
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+template<typename... Args>
+void small_vector<T,N,Allocator>::_emplace_back_realloc(Args &&... args){
+    const std::size_t n_elems = size();
+    const std::size_t new_capacity = std::max<std::size_t>(capacity() * 2, 1);
+
+    pointer pdata = _allocate(new_capacity);
+
+    // construct the new element first: args can reference an element of the vector
+    try{
+        new (pdata + n_elems) T(std::forward<Args>(args)...);
+    }catch(...){
+        _deallocate(pdata, new_capacity);
+        throw;
+    }
+
+    try{
+        details::relocate_range(_begin, _end, pdata);
+    }catch(...){
+        details::destroy_range(pdata + n_elems, pdata + n_elems +1);
+        _deallocate(pdata, new_capacity);
+        throw;
+    }
+
+    _release_buffer();
 
+    _begin = pdata;
+    _end = _begin + n_elems +1;
+    _end_memory = _begin + new_capacity;
 }
 
-template<typename T, std::size_t N>
-bool small_vector<T,N>::_is_static() const noexcept{
-    return (_end_memory == _begin);
+
+template<typename T, std::size_t N, typename Allocator>
+typename small_vector<T,N,Allocator>::pointer small_vector<T,N,Allocator>::_open_gap(std::size_t pos, std::size_t n){
+    assert(is_trivially_relocatable<T>::value);
+
+    const std::size_t n_elems = size();
+
+    if(n_elems + n > capacity()){
+        // relocate around the gap, the tail is moved only once
+        const std::size_t new_capacity = std::max(capacity() * 2, n_elems + n);
+        pointer pdata = _allocate(new_capacity);
+
+        details::relocate_range(_begin, _begin + pos, pdata);
+        details::relocate_range(_begin + pos, _end, pdata + pos + n);
+
+        _release_buffer();
+
+        _begin = pdata;
+        _end_memory = _begin + new_capacity;
+    } else {
+        std::memmove(static_cast<void*>(_begin + pos + n), static_cast<const void*>(_begin + pos), (n_elems - pos) * sizeof(T));
+    }
+
+    _end = _begin + n_elems + n;
+    return _begin + pos;
 }
 
+
+template<typename T, std::size_t N, typename Allocator>
+template<typename Construct>
+typename small_vector<T,N,Allocator>::iterator small_vector<T,N,Allocator>::_insert_n(std::size_t pos, std::size_t n, Construct construct){
+    if(n == 0){
+        return _begin + pos;
+    }
+
+    if(is_trivially_relocatable<T>::value){
+        // memmove the tail, construct in place
+        pointer gap = _open_gap(pos, n);
+        std::size_t i = 0;
+        try{
+            for(; i < n; ++i){
+                construct(gap + i, i);
+            }
+        }catch(...){
+            // close the gap
+            details::destroy_range(gap, gap + i);
+            std::memmove(static_cast<void*>(gap), static_cast<const void*>(gap + n), static_cast<std::size_t>(_end - (gap + n)) * sizeof(T));
+            _end -= n;
+            throw;
+        }
+        return gap;
+    }
+
+    // construct at the end, then rotate in place
+    const std::size_t n_elems = size();
+    if(n_elems + n > capacity()){
+        _resize_to_fit(n_elems + n);
+    }
+
+    try{
+        for(std::size_t i = 0; i < n; ++i){
+            construct(_end, i);
+            ++_end;
+        }
+    }catch(...){
+        details::destroy_range(_begin + n_elems, _end);
+        _end = _begin + n_elems;
+        throw;
+    }
+
+    std::rotate(_begin + pos, _begin + n_elems, _end);
+    return _begin + pos;
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+template<typename InputIterator>
+typename small_vector<T,N,Allocator>::iterator small_vector<T,N,Allocator>::_insert_range(std::size_t pos, InputIterator first, InputIterator last,
+                                                                       std::input_iterator_tag){
+    // single pass: append, then rotate in place
+    const std::size_t n_elems = size();
+    try{
+        for(; first != last; ++first){
+            emplace_back(*first);
+        }
+    }catch(...){
+        erase(_begin + n_elems, _end);
+        throw;
+    }
+
+    std::rotate(_begin + pos, _begin + n_elems, _end);
+    return _begin + pos;
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+template<typename ForwardIterator>
+typename small_vector<T,N,Allocator>::iterator small_vector<T,N,Allocator>::_insert_range(std::size_t pos, ForwardIterator first, ForwardIterator last,
+                                                                       std::forward_iterator_tag){
+    const std::size_t n = static_cast<std::size_t>(std::distance(first, last));
+    if(pos == size()){
+        // append: copy directly to the end, memcpy for trivially copyable types
+        if(size() + n > capacity()){
+            _resize_to_fit(size() + n);
+        }
+        _end = std::uninitialized_copy(first, last, _end);
+        return _begin + pos;
+    }
+
+    return _insert_n(pos, n, [&first](pointer dest, std::size_t){
+        new (dest) T(*first);
+        ++first;
+    });
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+void small_vector<T,N,Allocator>::_take_content(small_vector & other){
+    assert(empty());
+
+    if(other._is_static() == false){
+        _release_buffer();
+        _begin = other._begin;
+        _end = other._end;
+        _end_memory = other._end_memory;
+
+        other._begin = other._internal_array();
+        other._end = other._begin;
+        other._end_memory = other._begin + N;
+        return;
+    }
+
+    // other.size() <= N <= capacity()
+    details::relocate_range(other._begin, other._end, _begin);
+    _end = _begin + other.size();
+    other._end = other._begin;
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+void small_vector<T,N,Allocator>::_relocate_content(small_vector & other){
+    assert(empty());
+
+    reserve(other.size());
+    details::relocate_range(other._begin, other._end, _begin);
+    _end = _begin + other.size();
+    other._end = other._begin;
+}
+
+
+template<typename T, std::size_t N, typename Allocator>
+void small_vector<T,N,Allocator>::_destroy_all_and_release() noexcept{
+    details::destroy_range(_begin, _end);
+    _release_buffer();
+    _begin = _end = _internal_array();
+    _end_memory = _begin + N;
+}
+
+
+
+template<typename T, std::size_t N, typename Allocator>
+bool operator==(const small_vector<T, N, Allocator> & a, const small_vector<T, N, Allocator> & b){
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+template<typename T, std::size_t N, typename Allocator>
+bool operator!=(const small_vector<T, N, Allocator> & a, const small_vector<T, N, Allocator> & b){
+    return !(a == b);
+}
+
+template<typename T, std::size_t N, typename Allocator>
+bool operator<(const small_vector<T, N, Allocator> & a, const small_vector<T, N, Allocator> & b){
+    return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+}
+
+template<typename T, std::size_t N, typename Allocator>
+bool operator<=(const small_vector<T, N, Allocator> & a, const small_vector<T, N, Allocator> & b){
+    return !(b < a);
+}
+
+template<typename T, std::size_t N, typename Allocator>
+bool operator>(const small_vector<T, N, Allocator> & a, const small_vector<T, N, Allocator> & b){
+    return b < a;
+}
+
+template<typename T, std::size_t N, typename Allocator>
+bool operator>=(const small_vector<T, N, Allocator> & a, const small_vector<T, N, Allocator> & b){
+    return !(a < b);
+}
+
+template<typename T, std::size_t N, typename Allocator>
+void swap(small_vector<T, N, Allocator> & a, small_vector<T, N, Allocator> & b){
+    a.swap(b);
+}
+
+
 } //containers
 
 
@@ -0,0 +1,583 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_CONCURRENT_HASH_MAP_HPP_
+#define _HADOKEN_CONCURRENT_HASH_MAP_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include <hadoken/parallel/algorithm.hpp>
+#include <hadoken/thread/cache_line.hpp>
+#include <hadoken/thread/epoch.hpp>
+#include <hadoken/thread/spinlock.hpp>
+
+#include "bits/hash_bits.hpp"
+
+namespace hadoken {
+
+namespace containers {
+
+
+///
+/// \brief concurrent hash map with lock-free lookups
+///
+/// chained hash table, the buckets are protected by a fixed set of striped locks
+/// for the writers. The readers never lock: they traverse the chains inside an
+/// epoch critical section ( see thread::epoch_domain )
+///
+/// a node is never modified once published: insert_or_assign and update
+/// replace the node, erase unlinks it, and the old node is retired to the epoch domain.
+/// A reader consequently always sees a consistent ( key, value ) pair.
+///
+/// The table grows when a stripe exceeds the max load factor,
+/// the resize copies the nodes with all the stripes locked and does not block the readers.
+///
+/// find() returns a copy of the value: there is no reference to an element
+/// that could be invalidated by a concurrent writer
+///
+template<typename Key, typename T, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key> >
+class concurrent_hash_map{
+public:
+    typedef Key                                             key_type;
+    typedef T                                               mapped_type;
+    typedef std::pair<const Key, T>                         value_type;
+    typedef Hash                                            hasher;
+    typedef KeyEqual                                        key_equal;
+    typedef std::size_t                                     size_type;
+
+    ///
+    /// \brief concurrent_hash_map
+    /// \param bucket_count initial number of buckets
+    /// \param concurrency expected number of concurrent writers, define the number of lock stripes
+    ///
+    inline explicit concurrent_hash_map(size_type bucket_count = 64,
+                                        size_type concurrency = std::thread::hardware_concurrency(),
+                                        const hasher & hash = hasher(), const key_equal & equal = key_equal());
+
+    inline ~concurrent_hash_map();
+
+    ///
+    /// \brief find
+    /// \return true and copy the value associated with key into value if key exists
+    ///
+    inline bool find(const key_type & key, mapped_type & value) const;
+
+    /// true if the key exists
+    inline bool contains(const key_type & key) const;
+
+    /// 1 if the key exists, 0 otherwise
+    inline size_type count(const key_type & key) const;
+
+    ///
+    /// \brief visit
+    ///
+    /// call fun(const mapped_type &) on the value associated with key, without copy.
+    /// fun executes inside an epoch critical section: it should be short
+    /// and must not keep a reference to the value
+    ///
+    /// \return true if the key exists
+    ///
+    template<typename Function>
+    inline bool visit(const key_type & key, Function fun) const;
+
+    ///
+    /// \brief insert a new element
+    /// \return true if inserted, false if the key already exists ( value not modified )
+    ///
+    inline bool insert(const key_type & key, const mapped_type & value);
+
+    inline bool insert(const value_type & elem);
+
+    ///
+    /// \brief insert a new element or replace the value of an existing key
+    /// \return true if inserted, false if assigned
+    ///
+    inline bool insert_or_assign(const key_type & key, const mapped_type & value);
+
+    ///
+    /// \brief update an existing element atomically
+    ///
+    /// fun(mapped_type &) is called on a copy of the current value, under the
+    /// lock of its bucket, then the copy replaces the current value
+    ///
+    /// \return false if the key does not exist
+    ///
+    template<typename Function>
+    inline bool update(const key_type & key, Function fun);
+
+    ///
+    /// \brief erase
+    /// \return number of element erased, 0 or 1
+    ///
+    inline size_type erase(const key_type & key);
+
+    ///
+    /// \brief insert the range [first, last) of value_type
+    ///
+    /// reserve the table size once, then insert in parallel using
+    /// hadoken::parallel::for_each with the execution policy policy.
+    /// The elements with a key already present are ignored
+    ///
+    template<typename ExecPolicy, typename Iterator>
+    inline void bulk_insert(ExecPolicy && policy, Iterator first, Iterator last);
+
+    ///
+    /// \brief call fun(const key_type &, const mapped_type &) on each element
+    ///
+    /// weakly consistent: the concurrent modifications may or may not be visible
+    ///
+    template<typename Function>
+    inline void for_each(Function fun) const;
+
+    /// grow the table to hold at least n elements without resize
+    inline void reserve(size_type n);
+
+    /// remove all elements
+    inline void clear();
+
+    /// number of elements, exact if no concurrent modification
+    inline size_type size() const;
+
+    inline bool empty() const;
+
+    inline size_type bucket_count() const;
+
+    inline float max_load_factor() const{
+        return 1.0f;
+    }
+
+private:
+    concurrent_hash_map(const concurrent_hash_map &) = delete;
+    concurrent_hash_map & operator=(const concurrent_hash_map &) = delete;
+
+    struct node{
+        inline node(std::size_t h, const key_type & k, const mapped_type & v, node* n) :
+            hash(h), elem(k, v), next(n) {}
+
+        std::size_t hash;
+        value_type elem;
+        std::atomic<node*> next;
+    };
+
+    struct table{
+        inline explicit table(size_type n) : mask(n -1), buckets(new std::atomic<node*>[n]){
+            for(size_type i = 0; i < n; ++i){
+                buckets[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+
+        inline size_type size() const{
+            return mask +1;
+        }
+
+        inline std::atomic<node*> & bucket(std::size_t h){
+            return buckets[h & mask];
+        }
+
+        size_type mask;
+        std::unique_ptr<std::atomic<node*>[]> buckets;
+    };
+
+    // writer lock and element counter of a set of buckets, one per cache line
+    struct stripe{
+        inline stripe() : lock(), count(0) {}
+
+        thread::backoff_spin_lock lock;
+        size_type count;
+        char _pad[thread::cache_line_size];
+    };
+
+    struct locate_result{
+        std::atomic<node*>* link;
+        node* current;
+    };
+
+    inline std::size_t _hash(const key_type & key) const{
+        return details::mix_hash(_hasher(key));
+    }
+
+    inline stripe & _stripe(std::size_t h){
+        return _stripes[h & _stripe_mask];
+    }
+
+    // find the link pointing to key in its bucket, caller owns the stripe lock
+    inline locate_result _locate(table* tab, std::size_t h, const key_type & key){
+        std::atomic<node*>* link = &(tab->bucket(h));
+        node* current = link->load(std::memory_order_relaxed);
+        while(current != nullptr){
+            if(current->hash == h && _equal(current->elem.first, key)){
+                break;
+            }
+            link = &(current->next);
+            current = link->load(std::memory_order_relaxed);
+        }
+        locate_result res = { link, current };
+        return res;
+    }
+
+    inline const node* _find_node(std::size_t h, const key_type & key) const{
+        const table* tab = _table.load(std::memory_order_acquire);
+        const node* current = tab->buckets[h & tab->mask].load(std::memory_order_acquire);
+        while(current != nullptr){
+            if(current->hash == h && _equal(current->elem.first, key)){
+                return current;
+            }
+            current = current->next.load(std::memory_order_acquire);
+        }
+        return nullptr;
+    }
+
+    template<typename Insert, typename Assign>
+    inline bool _insert_or(const key_type & key, Insert make_value, Assign on_existing);
+
+    inline void _grow(size_type min_buckets);
+
+    inline static void _delete_chains(table* tab);
+
+    inline static void _delete_table(void* tab);
+
+    hasher _hasher;
+    key_equal _equal;
+
+    size_type _stripe_mask;
+    std::unique_ptr<stripe[]> _stripes;
+
+    std::atomic<table*> _table;
+};
+
+
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+concurrent_hash_map<Key, T, Hash, KeyEqual>::concurrent_hash_map(size_type bucket_count, size_type concurrency,
+                                                                 const hasher & hash, const key_equal & equal) :
+    _hasher(hash),
+    _equal(equal),
+    _stripe_mask(0),
+    _stripes(),
+    _table(nullptr){
+
+    // 4 stripes per writer keeps the probability of lock collision low
+    const size_type n_stripes = details::next_power_of_two(std::max<size_type>(4 * concurrency, 16));
+    _stripe_mask = n_stripes -1;
+    _stripes.reset(new stripe[n_stripes]);
+
+    _table.store(new table(details::next_power_of_two(std::max(bucket_count, n_stripes))), std::memory_order_release);
+}
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+concurrent_hash_map<Key, T, Hash, KeyEqual>::~concurrent_hash_map(){
+    table* tab = _table.load(std::memory_order_acquire);
+    _delete_chains(tab);
+    delete tab;
+}
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+bool concurrent_hash_map<Key, T, Hash, KeyEqual>::find(const key_type & key, mapped_type & value) const{
+    return visit(key, [&value](const mapped_type & v){
+        value = v;
+    });
+}
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+bool concurrent_hash_map<Key, T, Hash, KeyEqual>::contains(const key_type & key) const{
+    const std::size_t h = _hash(key);
+    auto guard = thread::epoch_domain::global_domain().pin();
+    return _find_node(h, key) != nullptr;
+}
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+typename concurrent_hash_map<Key, T, Hash, KeyEqual>::size_type
+concurrent_hash_map<Key, T, Hash, KeyEqual>::count(const key_type & key) const{
+    return (contains(key) ? 1 : 0);
+}
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+template<typename Function>
+bool concurrent_hash_map<Key, T, Hash, KeyEqual>::visit(const key_type & key, Function fun) const{
+    const std::size_t h = _hash(key);
+    auto guard = thread::epoch_domain::global_domain().pin();
+    const node* n = _find_node(h, key);
+    if(n == nullptr){
+        return false;
+    }
+    fun(n->elem.second);
+    return true;
+}
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+template<typename Insert, typename Assign>
+bool concurrent_hash_map<Key, T, Hash, KeyEqual>::_insert_or(const key_type & key, Insert make_value, Assign on_existing){
+    const std::size_t h = _hash(key);
+    stripe & s = _stripe(h);
+    size_type grow_from = 0;
+    bool inserted = false;
+    {
+        std::lock_guard<thread::backoff_spin_lock> l(s.lock);
+
+        // a resize locks all the stripes: the table is stable while we hold one
+        table* tab = _table.load(std::memory_order_relaxed);
+        locate_result pos = _locate(tab, h, key);
+
+        if(pos.current == nullptr){
+            std::atomic<node*> & head = tab->bucket(h);
+            node* n = new node(h, key, make_value(), head.load(std::memory_order_relaxed));
+            head.store(n, std::memory_order_release);
+            s.count += 1;
+            inserted = true;
+            if(s.count > (tab->size() / (_stripe_mask +1))){
+                grow_from = tab->size();
+            }
+        } else {
+            node* replacement = on_existing(pos.current);
+            if(replacement == nullptr){
+                return false;
+            }
+            pos.link->store(replacement, std::memory_order_release);
+            thread::epoch_domain::global_domain().retire(pos.current);
+        }
+    }
+
+    if(grow_from != 0){
+        _grow(grow_from * 2);
+    }
+    return inserted;
+}
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+bool concurrent_hash_map<Key, T, Hash, KeyEqual>::insert(const key_type & key, const mapped_type & value){
+    return _insert_or(key, [&value]() -> const mapped_type & { return value; },
+                           [](node*) -> node* { return nullptr; });
+}
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+bool concurrent_hash_map<Key, T, Hash, KeyEqual>::insert(const value_type & elem){
+    return insert(elem.first, elem.second);
+}
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+bool concurrent_hash_map<Key, T, Hash, KeyEqual>::insert_or_assign(const key_type & key, const mapped_type & value){
+    return _insert_or(key, [&value]() -> const mapped_type & { return value; },
+                           [&value](node* existing) -> node* {
+        return new node(existing->hash, existing->elem.first, value, existing->next.load(std::memory_order_relaxed));
+    });
+}
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+template<typename Function>
+bool concurrent_hash_map<Key, T, Hash, KeyEqual>::update(const key_type & key, Function fun){
+    const std::size_t h = _hash(key);
+    stripe & s = _stripe(h);
+
+    std::lock_guard<thread::backoff_spin_lock> l(s.lock);
+    locate_result pos = _locate(_table.load(std::memory_order_relaxed), h, key);
+    if(pos.current == nullptr){
+        return false;
+    }
+
+    std::unique_ptr<node> replacement(new node(h, pos.current->elem.first, pos.current->elem.second,
+                                               pos.current->next.load(std::memory_order_relaxed)));
+    fun(replacement->elem.second);
+    pos.link->store(replacement.release(), std::memory_order_release);
+    thread::epoch_domain::global_domain().retire(pos.current);
+    return true;
+}
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+typename concurrent_hash_map<Key, T, Hash, KeyEqual>::size_type
+concurrent_hash_map<Key, T, Hash, KeyEqual>::erase(const key_type & key){
+    const std::size_t h = _hash(key);
+    stripe & s = _stripe(h);
+
+    std::lock_guard<thread::backoff_spin_lock> l(s.lock);
+    locate_result pos = _locate(_table.load(std::memory_order_relaxed), h, key);
+    if(pos.current == nullptr){
+        return 0;
+    }
+
+    // the erased node keeps its next pointer: a reader standing on it can continue
+    pos.link->store(pos.current->next.load(std::memory_order_relaxed), std::memory_order_release);
+    s.count -= 1;
+    thread::epoch_domain::global_domain().retire(pos.current);
+    return 1;
+}
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+template<typename ExecPolicy, typename Iterator>
+void concurrent_hash_map<Key, T, Hash, KeyEqual>::bulk_insert(ExecPolicy && policy, Iterator first, Iterator last){
+    reserve(size() + static_cast<size_type>(std::distance(first, last)));
+
+    typedef typename std::iterator_traits<Iterator>::value_type elem_type;
+    parallel::for_each(std::forward<ExecPolicy>(policy), first, last, [this](const elem_type & elem){
+        insert(elem.first, elem.second);
+    });
+}
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+template<typename Function>
+void concurrent_hash_map<Key, T, Hash, KeyEqual>::for_each(Function fun) const{
+    auto guard = thread::epoch_domain::global_domain().pin();
+    const table* tab = _table.load(std::memory_order_acquire);
+    for(size_type i = 0; i < tab->size(); ++i){
+        const node* current = tab->buckets[i].load(std::memory_order_acquire);
+        while(current != nullptr){
+            fun(current->elem.first, current->elem.second);
+            current = current->next.load(std::memory_order_acquire);
+        }
+    }
+}
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+void concurrent_hash_map<Key, T, Hash, KeyEqual>::reserve(size_type n){
+    const size_type needed = static_cast<size_type>(static_cast<float>(n) / max_load_factor()) +1;
+    if(needed > bucket_count()){
+        _grow(needed);
+    }
+}
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+void concurrent_hash_map<Key, T, Hash, KeyEqual>::_grow(size_type min_buckets){
+    const size_type n_buckets = details::next_power_of_two(min_buckets);
+
+    for(size_type i = 0; i <= _stripe_mask; ++i){
+        _stripes[i].lock.lock();
+    }
+
+    table* old_tab = _table.load(std::memory_order_relaxed);
+    if(old_tab->size() < n_buckets){
+        // the readers can still traverse the old chains: copy the nodes instead of relinking them
+        std::unique_ptr<table> new_tab(new table(n_buckets));
+        for(size_type i = 0; i < old_tab->size(); ++i){
+            for(node* current = old_tab->buckets[i].load(std::memory_order_relaxed); current != nullptr;
+                current = current->next.load(std::memory_order_relaxed)){
+                std::atomic<node*> & head = new_tab->bucket(current->hash);
+                head.store(new node(current->hash, current->elem.first, current->elem.second,
+                                    head.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+            }
+        }
+        _table.store(new_tab.release(), std::memory_order_release);
+        thread::epoch_domain::global_domain().retire(old_tab, &_delete_table);
+    }
+
+    for(size_type i = _stripe_mask +1; i > 0; --i){
+        _stripes[i-1].lock.unlock();
+    }
+}
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+void concurrent_hash_map<Key, T, Hash, KeyEqual>::clear(){
+    for(size_type i = 0; i <= _stripe_mask; ++i){
+        _stripes[i].lock.lock();
+    }
+
+    table* old_tab = _table.load(std::memory_order_relaxed);
+    _table.store(new table(old_tab->size()), std::memory_order_release);
+    thread::epoch_domain::global_domain().retire(old_tab, &_delete_table);
+
+    for(size_type i = _stripe_mask +1; i > 0; --i){
+        _stripes[i-1].count = 0;
+        _stripes[i-1].lock.unlock();
+    }
+}
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+typename concurrent_hash_map<Key, T, Hash, KeyEqual>::size_type
+concurrent_hash_map<Key, T, Hash, KeyEqual>::size() const{
+    size_type res = 0;
+    for(size_type i = 0; i <= _stripe_mask; ++i){
+        std::lock_guard<thread::backoff_spin_lock> l(_stripes[i].lock);
+        res += _stripes[i].count;
+    }
+    return res;
+}
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+bool concurrent_hash_map<Key, T, Hash, KeyEqual>::empty() const{
+    return size() == 0;
+}
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+typename concurrent_hash_map<Key, T, Hash, KeyEqual>::size_type
+concurrent_hash_map<Key, T, Hash, KeyEqual>::bucket_count() const{
+    return _table.load(std::memory_order_acquire)->size();
+}
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+void concurrent_hash_map<Key, T, Hash, KeyEqual>::_delete_chains(table* tab){
+    for(size_type i = 0; i < tab->size(); ++i){
+        node* current = tab->buckets[i].load(std::memory_order_relaxed);
+        while(current != nullptr){
+            node* next = current->next.load(std::memory_order_relaxed);
+            delete current;
+            current = next;
+        }
+    }
+}
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+void concurrent_hash_map<Key, T, Hash, KeyEqual>::_delete_table(void* tab){
+    table* t = static_cast<table*>(tab);
+    _delete_chains(t);
+    delete t;
+}
+
+
+} // containers
+
+} // hadoken
+
+#endif // _HADOKEN_CONCURRENT_HASH_MAP_HPP_
@@ -0,0 +1,827 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_FLAT_HASH_MAP_HPP_
+#define _HADOKEN_FLAT_HASH_MAP_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <hadoken/containers/small_vector.hpp>
+
+#include "bits/hash_bits.hpp"
+#include "bits/flat_hash_group_bits.hpp"
+
+namespace hadoken {
+
+namespace containers {
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+class flat_hash_map;
+
+
+namespace details{
+
+template<typename T>
+struct void_type{
+    typedef void type;
+};
+
+// true if T declares is_transparent, as std::less<void>
+template<typename T, typename = void>
+struct is_transparent : public std::false_type {};
+
+template<typename T>
+struct is_transparent<T, typename void_type<typename T::is_transparent>::type> : public std::true_type {};
+
+
+template<typename Value, bool Const>
+class flat_hash_iterator{
+public:
+    typedef std::forward_iterator_tag                                           iterator_category;
+    typedef typename std::remove_const<Value>::type                             value_type;
+    typedef typename std::conditional<Const, const Value &, Value &>::type      reference;
+    typedef typename std::conditional<Const, const Value *, Value *>::type      pointer;
+    typedef std::ptrdiff_t                                                      difference_type;
+
+    inline flat_hash_iterator() : _ctrl(nullptr), _slot(nullptr), _end(nullptr) {}
+
+    inline flat_hash_iterator(const hash_ctrl* ctrl, pointer slot, const hash_ctrl* end) :
+        _ctrl(ctrl), _slot(slot), _end(end){
+        _skip_free();
+    }
+
+    // iterator to const_iterator
+    template<bool OtherConst, typename = typename std::enable_if<Const && !OtherConst>::type>
+    inline flat_hash_iterator(const flat_hash_iterator<Value, OtherConst> & other) :
+        _ctrl(other._ctrl), _slot(other._slot), _end(other._end) {}
+
+    inline reference operator*() const{
+        return *_slot;
+    }
+
+    inline pointer operator->() const{
+        return _slot;
+    }
+
+    inline flat_hash_iterator & operator++(){
+        ++_ctrl;
+        ++_slot;
+        _skip_free();
+        return *this;
+    }
+
+    inline flat_hash_iterator operator++(int){
+        flat_hash_iterator tmp(*this);
+        ++(*this);
+        return tmp;
+    }
+
+    inline bool operator==(const flat_hash_iterator & other) const{
+        return _ctrl == other._ctrl;
+    }
+
+    inline bool operator!=(const flat_hash_iterator & other) const{
+        return _ctrl != other._ctrl;
+    }
+
+private:
+    template<typename V, bool C>
+    friend class flat_hash_iterator;
+
+    template<typename K, typename T, typename H, typename E>
+    friend class containers::flat_hash_map;
+
+    inline void _skip_free(){
+        while(_ctrl < _end && hash_ctrl_is_full(*_ctrl) == false){
+            ++_ctrl;
+            ++_slot;
+        }
+    }
+
+    const hash_ctrl* _ctrl;
+    pointer _slot;
+    const hash_ctrl* _end;
+};
+
+} // details
+
+
+///
+/// \brief flat_hash_map
+///
+/// single threaded open addressing hash map, Swiss table design: the elements are
+/// stored in place in one array of slots, without per element allocation, next to an array
+/// of one control byte per slot, which holds 7 bits of the hash of the element.
+/// A lookup compares a group of control bytes at once, 16 with SSE2 or 8 with
+/// a portable SWAR fallback ( define HADOKEN_FLAT_HASH_NO_SIMD to force it ),
+/// and compares the keys only for the slots whose control byte matches: most lookups touch
+/// one line of control bytes and one slot.
+///
+/// - the capacity is a power of two, the maximum load factor 7/8
+/// - an erase leaves a tombstone, unless no probe could have passed the slot. When the
+///   table is full of tombstones, it is rehashed in place instead of growing
+/// - reserve(n) allocates once for n elements, clear() keeps the memory
+/// - heterogeneous lookup with find, count, contains and erase when Hash and KeyEqual
+///   both declare is_transparent
+/// - the hash is mixed with a murmur3 finalizer: std::hash identity for integers is fine
+///
+/// any insertion can invalidate the iterators and references, an erase does not
+///
+template<typename Key, typename T, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key> >
+class flat_hash_map{
+public:
+    typedef Key                                                 key_type;
+    typedef T                                                   mapped_type;
+    typedef std::pair<const Key, T>                             value_type;
+    typedef Hash                                                hasher;
+    typedef KeyEqual                                            key_equal;
+    typedef value_type &                                        reference;
+    typedef const value_type &                                  const_reference;
+    typedef details::flat_hash_iterator<value_type, false>      iterator;
+    typedef details::flat_hash_iterator<value_type, true>       const_iterator;
+    typedef std::size_t                                         size_type;
+    typedef std::ptrdiff_t                                      difference_type;
+
+    ///
+    /// \brief empty map, allocates for bucket_count elements at least if not zero
+    ///
+    inline explicit flat_hash_map(size_type bucket_count = 0, const Hash & hash = Hash(), const KeyEqual & equal = KeyEqual()) :
+        _ctrl(nullptr), _slots(nullptr), _capacity(0), _size(0), _growth_left(0), _hash(hash), _equal(equal){
+        if(bucket_count > 0){
+            rehash(bucket_count);
+        }
+    }
+
+    template<typename InputIterator>
+    inline flat_hash_map(InputIterator first, InputIterator last, size_type bucket_count = 0,
+                         const Hash & hash = Hash(), const KeyEqual & equal = KeyEqual()) :
+        flat_hash_map(bucket_count, hash, equal){
+        insert(first, last);
+    }
+
+    inline flat_hash_map(std::initializer_list<value_type> values, size_type bucket_count = 0,
+                         const Hash & hash = Hash(), const KeyEqual & equal = KeyEqual()) :
+        flat_hash_map(values.begin(), values.end(), bucket_count, hash, equal) {}
+
+    inline flat_hash_map(const flat_hash_map & other) :
+        flat_hash_map(0, other._hash, other._equal){
+        reserve(other.size());
+        for(const value_type & v : other){
+            _insert_unique(_hash_of(v.first), v);
+        }
+    }
+
+    inline flat_hash_map(flat_hash_map && other) noexcept :
+        _ctrl(other._ctrl), _slots(other._slots), _capacity(other._capacity), _size(other._size),
+        _growth_left(other._growth_left), _hash(std::move(other._hash)), _equal(std::move(other._equal)){
+        other._reset_empty();
+    }
+
+    inline ~flat_hash_map(){
+        _destroy_and_release();
+    }
+
+    inline flat_hash_map & operator=(const flat_hash_map & other){
+        if(this != &other){
+            flat_hash_map tmp(other);
+            swap(tmp);
+        }
+        return *this;
+    }
+
+    inline flat_hash_map & operator=(flat_hash_map && other) noexcept{
+        if(this != &other){
+            _destroy_and_release();
+            _ctrl = other._ctrl;
+            _slots = other._slots;
+            _capacity = other._capacity;
+            _size = other._size;
+            _growth_left = other._growth_left;
+            _hash = std::move(other._hash);
+            _equal = std::move(other._equal);
+            other._reset_empty();
+        }
+        return *this;
+    }
+
+    inline iterator begin() noexcept{
+        return iterator(_ctrl, _slots, _ctrl + _capacity);
+    }
+
+    inline const_iterator begin() const noexcept{
+        return const_iterator(_ctrl, _slots, _ctrl + _capacity);
+    }
+
+    inline iterator end() noexcept{
+        return iterator(_ctrl + _capacity, _slots + _capacity, _ctrl + _capacity);
+    }
+
+    inline const_iterator end() const noexcept{
+        return const_iterator(_ctrl + _capacity, _slots + _capacity, _ctrl + _capacity);
+    }
+
+    inline const_iterator cbegin() const noexcept{
+        return begin();
+    }
+
+    inline const_iterator cend() const noexcept{
+        return end();
+    }
+
+    inline bool empty() const noexcept{
+        return _size == 0;
+    }
+
+    inline size_type size() const noexcept{
+        return _size;
+    }
+
+    inline size_type max_size() const noexcept{
+        return _max_size();
+    }
+
+    ///
+    /// \brief number of slots
+    ///
+    inline size_type bucket_count() const noexcept{
+        return _capacity;
+    }
+
+    inline float load_factor() const noexcept{
+        return (_capacity == 0) ? 0.0f : static_cast<float>(_size) / static_cast<float>(_capacity);
+    }
+
+    inline float max_load_factor() const noexcept{
+        return 7.0f / 8.0f;
+    }
+
+    inline hasher hash_function() const{
+        return _hash;
+    }
+
+    inline key_equal key_eq() const{
+        return _equal;
+    }
+
+    ///
+    /// \brief allocate for n elements, no rehash until size() exceeds n
+    ///
+    inline void reserve(size_type n){
+        if(n > _max_size()){
+            throw std::length_error("flat_hash_map::reserve: n > max_size()");
+        }
+        if(n > _size + _growth_left){
+            rehash(_capacity_for(n));
+        }
+    }
+
+    ///
+    /// \brief rehash to n slots at least, and enough for size()
+    ///
+    inline void rehash(size_type n){
+        if(n > _max_size()){
+            throw std::length_error("flat_hash_map::rehash: n > max_size()");
+        }
+        size_type capacity = details::next_power_of_two(n);
+        if(capacity < _capacity_for(_size)){
+            capacity = _capacity_for(_size);
+        }
+        if(capacity < details::hash_group::width){
+            capacity = details::hash_group::width;
+        }
+        if(capacity != _capacity || _size + _growth_left != _max_load(_capacity)){
+            _resize(capacity);
+        }
+    }
+
+    ///
+    /// \brief destroy all the elements, the memory is kept
+    ///
+    inline void clear() noexcept{
+        _destroy_elements();
+        if(_capacity > 0){
+            std::memset(_ctrl, static_cast<unsigned char>(details::hash_ctrl_empty), _capacity + details::hash_group::width);
+        }
+        _size = 0;
+        _growth_left = _max_load(_capacity);
+    }
+
+    inline iterator find(const key_type & key){
+        return _iterator_at(_find_index(key, _hash_of(key)));
+    }
+
+    inline const_iterator find(const key_type & key) const{
+        return _iterator_at(_find_index(key, _hash_of(key)));
+    }
+
+    template<typename K, typename H = Hash, typename E = KeyEqual, typename = typename std::enable_if<
+                 details::is_transparent<H>::value && details::is_transparent<E>::value>::type>
+    inline iterator find(const K & key){
+        return _iterator_at(_find_index(key, _hash_of(key)));
+    }
+
+    template<typename K, typename H = Hash, typename E = KeyEqual, typename = typename std::enable_if<
+                 details::is_transparent<H>::value && details::is_transparent<E>::value>::type>
+    inline const_iterator find(const K & key) const{
+        return _iterator_at(_find_index(key, _hash_of(key)));
+    }
+
+    inline size_type count(const key_type & key) const{
+        return (_find_index(key, _hash_of(key)) != npos) ? 1 : 0;
+    }
+
+    template<typename K, typename H = Hash, typename E = KeyEqual, typename = typename std::enable_if<
+                 details::is_transparent<H>::value && details::is_transparent<E>::value>::type>
+    inline size_type count(const K & key) const{
+        return (_find_index(key, _hash_of(key)) != npos) ? 1 : 0;
+    }
+
+    inline bool contains(const key_type & key) const{
+        return _find_index(key, _hash_of(key)) != npos;
+    }
+
+    template<typename K, typename H = Hash, typename E = KeyEqual, typename = typename std::enable_if<
+                 details::is_transparent<H>::value && details::is_transparent<E>::value>::type>
+    inline bool contains(const K & key) const{
+        return _find_index(key, _hash_of(key)) != npos;
+    }
+
+    ///
+    /// \brief mapped value of key, throw std::out_of_range if key is not in the map
+    ///
+    inline T & at(const key_type & key){
+        const size_type pos = _find_index(key, _hash_of(key));
+        if(pos == npos){
+            throw std::out_of_range("flat_hash_map: key not found");
+        }
+        return _slots[pos].second;
+    }
+
+    inline const T & at(const key_type & key) const{
+        const size_type pos = _find_index(key, _hash_of(key));
+        if(pos == npos){
+            throw std::out_of_range("flat_hash_map: key not found");
+        }
+        return _slots[pos].second;
+    }
+
+    ///
+    /// \brief mapped value of key, value-initialized and inserted if key is not in the map
+    ///
+    inline T & operator[](const key_type & key){
+        return try_emplace(key).first->second;
+    }
+
+    inline T & operator[](key_type && key){
+        return try_emplace(std::move(key)).first->second;
+    }
+
+    ///
+    /// \brief insert value if its key is not in the map
+    /// \return iterator to the element with the key of value, true if inserted
+    ///
+    inline std::pair<iterator, bool> insert(const value_type & value){
+        return _emplace_key(value.first, value);
+    }
+
+    inline std::pair<iterator, bool> insert(value_type && value){
+        return _emplace_key(value.first, std::move(value));
+    }
+
+    template<typename InputIterator>
+    inline void insert(InputIterator first, InputIterator last){
+        for(; first != last; ++first){
+            insert(*first);
+        }
+    }
+
+    inline void insert(std::initializer_list<value_type> values){
+        insert(values.begin(), values.end());
+    }
+
+    ///
+    /// \brief construct an element from args if its key is not in the map
+    ///
+    template<typename... Args>
+    inline std::pair<iterator, bool> emplace(Args &&... args){
+        // the key is needed before the slot is known, build the element aside
+        value_type value(std::forward<Args>(args)...);
+        return _emplace_key(value.first, std::move(value));
+    }
+
+    ///
+    /// \brief construct the mapped value from args if key is not in the map,
+    /// args are not used otherwise
+    ///
+    template<typename... Args>
+    inline std::pair<iterator, bool> try_emplace(const key_type & key, Args &&... args){
+        return _emplace_key(key, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+
+    template<typename... Args>
+    inline std::pair<iterator, bool> try_emplace(key_type && key, Args &&... args){
+        return _emplace_key(key, std::piecewise_construct, std::forward_as_tuple(std::move(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+
+    ///
+    /// \brief insert or replace the mapped value of key
+    /// \return iterator to the element, true if inserted
+    ///
+    template<typename M>
+    inline std::pair<iterator, bool> insert_or_assign(const key_type & key, M && obj){
+        std::pair<iterator, bool> res = try_emplace(key, std::forward<M>(obj));
+        if(res.second == false){
+            res.first->second = std::forward<M>(obj);
+        }
+        return res;
+    }
+
+    ///
+    /// \brief erase the element at pos
+    /// \return iterator following the erased element
+    ///
+    inline iterator erase(const_iterator pos){
+        const size_type index = static_cast<size_type>(pos._ctrl - _ctrl);
+        _erase_at(index);
+        return iterator(_ctrl + index, _slots + index, _ctrl + _capacity);
+    }
+
+    inline iterator erase(iterator pos){
+        return erase(const_iterator(pos));
+    }
+
+    ///
+    /// \brief erase the element with key
+    /// \return number of elements erased, 0 or 1
+    ///
+    inline size_type erase(const key_type & key){
+        return _erase_key(key);
+    }
+
+    template<typename K, typename H = Hash, typename E = KeyEqual, typename = typename std::enable_if<
+                 details::is_transparent<H>::value && details::is_transparent<E>::value
+                 && std::is_convertible<const K &, const_iterator>::value == false>::type>
+    inline size_type erase(const K & key){
+        return _erase_key(key);
+    }
+
+    inline void swap(flat_hash_map & other) noexcept{
+        using std::swap;
+        swap(_ctrl, other._ctrl);
+        swap(_slots, other._slots);
+        swap(_capacity, other._capacity);
+        swap(_size, other._size);
+        swap(_growth_left, other._growth_left);
+        swap(_hash, other._hash);
+        swap(_equal, other._equal);
+    }
+
+private:
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+    static_assert(alignof(value_type) <= alignof(std::max_align_t), "flat_hash_map: over-aligned types are not supported");
+
+    // relocation of the slots during a rehash by memcpy
+    typedef std::integral_constant<bool, is_trivially_relocatable<Key>::value
+                                            && is_trivially_relocatable<T>::value> relocatable;
+
+    // the capacity for max_size() elements is below 4 * max_size(): the block size
+    // of _allocate() can not overflow
+    static inline size_type _max_size() noexcept{
+        return std::numeric_limits<size_type>::max() / (sizeof(value_type) + 1) / 4;
+    }
+
+    static inline size_type _max_load(size_type capacity){
+        return capacity - capacity / 8;
+    }
+
+    // smallest capacity with n elements under the maximum load factor
+    static inline size_type _capacity_for(size_type n){
+        if(n == 0){
+            return 0;
+        }
+        size_type capacity = details::next_power_of_two(n + n / 7);
+        while(_max_load(capacity) < n){
+            capacity *= 2;
+        }
+        return (capacity < details::hash_group::width) ? details::hash_group::width : capacity;
+    }
+
+    template<typename K>
+    inline size_type _hash_of(const K & key) const{
+        return details::mix_hash(_hash(key));
+    }
+
+    static inline details::hash_ctrl _h2(size_type hash){
+        return static_cast<details::hash_ctrl>(hash & 0x7f);
+    }
+
+    inline void _set_ctrl(size_type index, details::hash_ctrl c){
+        _ctrl[index] = c;
+        // mirror of the first group after the end, a group load never wraps
+        if(index < details::hash_group::width){
+            _ctrl[_capacity + index] = c;
+        }
+    }
+
+    inline iterator _iterator_at(size_type index){
+        return (index == npos) ? end() : iterator(_ctrl + index, _slots + index, _ctrl + _capacity);
+    }
+
+    inline const_iterator _iterator_at(size_type index) const{
+        return (index == npos) ? end() : const_iterator(_ctrl + index, _slots + index, _ctrl + _capacity);
+    }
+
+    // triangular probing by groups: visits every group once when the capacity is a power of two
+    template<typename K>
+    inline size_type _find_index(const K & key, size_type hash) const{
+        if(_capacity == 0){
+            return npos;
+        }
+
+        const size_type mask = _capacity -1;
+        const details::hash_ctrl h2 = _h2(hash);
+        size_type pos = (hash >> 7) & mask;
+        size_type step = 0;
+
+        while(true){
+            const details::hash_group group(_ctrl + pos);
+            for(details::hash_group::mask_type m = group.match(h2); m; m.clear_lowest()){
+                const size_type index = (pos + m.lowest()) & mask;
+                if(_equal(_slots[index].first, key)){
+                    return index;
+                }
+            }
+            if(group.match_empty()){
+                return npos;
+            }
+            step += details::hash_group::width;
+            pos = (pos + step) & mask;
+        }
+    }
+
+    // first empty or deleted slot of the probe sequence of hash
+    inline size_type _find_free(size_type hash) const{
+        const size_type mask = _capacity -1;
+        size_type pos = (hash >> 7) & mask;
+        size_type step = 0;
+
+        while(true){
+            const details::hash_group group(_ctrl + pos);
+            details::hash_group::mask_type m = group.match_empty_or_deleted();
+            if(m){
+                return (pos + m.lowest()) & mask;
+            }
+            step += details::hash_group::width;
+            pos = (pos + step) & mask;
+        }
+    }
+
+    // find key, or construct an element from args in a free slot of its probe sequence
+    template<typename K, typename... Args>
+    inline std::pair<iterator, bool> _emplace_key(const K & key, Args &&... args){
+        const size_type hash = _hash_of(key);
+        const size_type found = _find_index(key, hash);
+        if(found != npos){
+            return std::make_pair(_iterator_at(found), false);
+        }
+        return std::make_pair(_iterator_at(_insert_unique(hash, std::forward<Args>(args)...)), true);
+    }
+
+    // construct a new element, its key is not in the map
+    template<typename... Args>
+    inline size_type _insert_unique(size_type hash, Args &&... args){
+        size_type index = (_capacity > 0) ? _find_free(hash) : npos;
+        if(index == npos || (_growth_left == 0 && _ctrl[index] != details::hash_ctrl_deleted)){
+            _grow();
+            index = _find_free(hash);
+        }
+
+        new (static_cast<void*>(_slots + index)) value_type(std::forward<Args>(args)...);
+
+        _growth_left -= (_ctrl[index] == details::hash_ctrl_empty) ? 1 : 0;
+        _set_ctrl(index, _h2(hash));
+        _size += 1;
+        return index;
+    }
+
+    template<typename K>
+    inline size_type _erase_key(const K & key){
+        const size_type index = _find_index(key, _hash_of(key));
+        if(index == npos){
+            return 0;
+        }
+        _erase_at(index);
+        return 1;
+    }
+
+    inline void _erase_at(size_type index){
+        assert(details::hash_ctrl_is_full(_ctrl[index]));
+        _slots[index].~value_type();
+        _size -= 1;
+
+        // a tombstone is needed only if a probe could have passed this slot: if all the
+        // groups around it are full. Otherwise the slot becomes empty again
+        const size_type index_before = (index - details::hash_group::width) & (_capacity -1);
+        const details::hash_group::mask_type empty_after = details::hash_group(_ctrl + index).match_empty();
+        const details::hash_group::mask_type empty_before = details::hash_group(_ctrl + index_before).match_empty();
+        const bool was_never_full = empty_before && empty_after
+                && (empty_after.trailing_zeros() + empty_before.leading_zeros()) < details::hash_group::width;
+
+        _set_ctrl(index, was_never_full ? details::hash_ctrl_empty : details::hash_ctrl_deleted);
+        _growth_left += was_never_full ? 1 : 0;
+    }
+
+    inline void _grow(){
+        if(_capacity == 0){
+            _resize(details::hash_group::width);
+        } else if(_size <= _max_load(_capacity) / 2){
+            // mostly tombstones: rehash in place, without growing
+            _resize(_capacity);
+        } else {
+            _resize(_capacity * 2);
+        }
+    }
+
+    inline void _resize(size_type new_capacity){
+        assert(new_capacity >= details::hash_group::width && (new_capacity & (new_capacity -1)) == 0);
+
+        details::hash_ctrl* old_ctrl = _ctrl;
+        value_type* old_slots = _slots;
+        const size_type old_capacity = _capacity, old_size = _size, old_growth_left = _growth_left;
+
+        _allocate(new_capacity);
+
+        try{
+            _move_slots(old_ctrl, old_slots, old_capacity, relocatable());
+        }catch(...){
+            // the old table is intact: the relocated slots are only bytes copies, the others copies
+            if(relocatable::value == false){
+                _destroy_elements();
+            }
+            _deallocate(_slots, _capacity);
+            _ctrl = old_ctrl;
+            _slots = old_slots;
+            _capacity = old_capacity;
+            _size = old_size;
+            _growth_left = old_growth_left;
+            throw;
+        }
+
+        _deallocate(reinterpret_cast<char*>(old_slots), old_capacity);
+    }
+
+    // memcpy for trivially relocatable elements, the old slots are not destroyed
+    inline void _move_slots(const details::hash_ctrl* old_ctrl, value_type* old_slots, size_type old_capacity, std::true_type){
+        for(size_type i = 0; i < old_capacity; ++i){
+            if(details::hash_ctrl_is_full(old_ctrl[i])){
+                const size_type hash = _hash_of(old_slots[i].first);
+                const size_type index = _find_free(hash);
+                std::memcpy(static_cast<void*>(_slots + index), static_cast<const void*>(old_slots + i), sizeof(value_type));
+                _set_ctrl(index, _h2(hash));
+                _size += 1;
+                _growth_left -= 1;
+            }
+        }
+    }
+
+    // move if noexcept, copy otherwise: the old table is intact if a copy throws
+    inline void _move_slots(const details::hash_ctrl* old_ctrl, value_type* old_slots, size_type old_capacity, std::false_type){
+        for(size_type i = 0; i < old_capacity; ++i){
+            if(details::hash_ctrl_is_full(old_ctrl[i])){
+                const size_type hash = _hash_of(old_slots[i].first);
+                const size_type index = _find_free(hash);
+                new (static_cast<void*>(_slots + index)) value_type(std::move_if_noexcept(old_slots[i]));
+                _set_ctrl(index, _h2(hash));
+                _size += 1;
+                _growth_left -= 1;
+            }
+        }
+
+        for(size_type i = 0; i < old_capacity; ++i){
+            if(details::hash_ctrl_is_full(old_ctrl[i])){
+                old_slots[i].~value_type();
+            }
+        }
+    }
+
+    // one block: the slots, then the control bytes with the mirror of the first group
+    inline void _allocate(size_type capacity){
+        char* block = static_cast<char*>(::operator new(capacity * sizeof(value_type) + capacity + details::hash_group::width));
+        _slots = reinterpret_cast<value_type*>(block);
+        _ctrl = reinterpret_cast<details::hash_ctrl*>(block + capacity * sizeof(value_type));
+        std::memset(_ctrl, static_cast<unsigned char>(details::hash_ctrl_empty), capacity + details::hash_group::width);
+        _capacity = capacity;
+        _size = 0;
+        _growth_left = _max_load(capacity);
+    }
+
+    static inline void _deallocate(void* block, size_type capacity){
+        (void) capacity;
+        ::operator delete(block);
+    }
+
+    inline void _destroy_elements() noexcept{
+        if(std::is_trivially_destructible<value_type>::value == false){
+            for(size_type i = 0; i < _capacity; ++i){
+                if(details::hash_ctrl_is_full(_ctrl[i])){
+                    _slots[i].~value_type();
+                }
+            }
+        }
+    }
+
+    inline void _destroy_and_release() noexcept{
+        if(_capacity > 0){
+            _destroy_elements();
+            _deallocate(_slots, _capacity);
+        }
+        _reset_empty();
+    }
+
+    inline void _reset_empty() noexcept{
+        _ctrl = nullptr;
+        _slots = nullptr;
+        _capacity = 0;
+        _size = 0;
+        _growth_left = 0;
+    }
+
+    details::hash_ctrl* _ctrl;
+    value_type* _slots;
+    size_type _capacity;
+    size_type _size;
+    size_type _growth_left;
+
+    Hash _hash;
+    KeyEqual _equal;
+};
+
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+inline bool operator==(const flat_hash_map<Key, T, Hash, KeyEqual> & a, const flat_hash_map<Key, T, Hash, KeyEqual> & b){
+    if(a.size() != b.size()){
+        return false;
+    }
+    for(const auto & v : a){
+        auto it = b.find(v.first);
+        if(it == b.end() || !(it->second == v.second)){
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+inline bool operator!=(const flat_hash_map<Key, T, Hash, KeyEqual> & a, const flat_hash_map<Key, T, Hash, KeyEqual> & b){
+    return !(a == b);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+inline void swap(flat_hash_map<Key, T, Hash, KeyEqual> & a, flat_hash_map<Key, T, Hash, KeyEqual> & b) noexcept{
+    a.swap(b);
+}
+
+
+} // containers
+
+} // hadoken
+
+#endif // _HADOKEN_FLAT_HASH_MAP_HPP_
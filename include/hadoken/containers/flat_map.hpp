@@ -0,0 +1,633 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_FLAT_MAP_HPP_
+#define _HADOKEN_FLAT_MAP_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "bits/flat_container_bits.hpp"
+
+namespace hadoken {
+
+namespace containers {
+
+
+namespace details{
+
+// operator-> of an iterator whose reference is a proxy
+template<typename Reference>
+struct flat_arrow_proxy{
+    Reference ref;
+
+    inline Reference* operator->(){
+        return &ref;
+    }
+};
+
+
+// iterator on the parallel key and mapped arrays of a flat_map
+template<typename Key, typename T, bool Const>
+class flat_map_iterator{
+public:
+    typedef typename std::conditional<Const, const T, T>::type     mapped_qualified;
+
+    typedef std::random_access_iterator_tag                         iterator_category;
+    typedef std::pair<Key, T>                                       value_type;
+    typedef std::pair<const Key &, mapped_qualified &>              reference;
+    typedef flat_arrow_proxy<reference>                             pointer;
+    typedef std::ptrdiff_t                                          difference_type;
+
+    inline flat_map_iterator() : _key(nullptr), _mapped(nullptr) {}
+
+    inline flat_map_iterator(const Key* key, mapped_qualified* mapped) : _key(key), _mapped(mapped) {}
+
+    // iterator to const_iterator
+    template<bool OtherConst, typename = typename std::enable_if<Const && !OtherConst>::type>
+    inline flat_map_iterator(const flat_map_iterator<Key, T, OtherConst> & other) : _key(other._key), _mapped(other._mapped) {}
+
+    inline reference operator*() const{
+        return reference(*_key, *_mapped);
+    }
+
+    inline pointer operator->() const{
+        pointer p = { **this };
+        return p;
+    }
+
+    inline reference operator[](difference_type n) const{
+        return reference(_key[n], _mapped[n]);
+    }
+
+    inline flat_map_iterator & operator++(){
+        ++_key;
+        ++_mapped;
+        return *this;
+    }
+
+    inline flat_map_iterator operator++(int){
+        flat_map_iterator tmp(*this);
+        ++(*this);
+        return tmp;
+    }
+
+    inline flat_map_iterator & operator--(){
+        --_key;
+        --_mapped;
+        return *this;
+    }
+
+    inline flat_map_iterator operator--(int){
+        flat_map_iterator tmp(*this);
+        --(*this);
+        return tmp;
+    }
+
+    inline flat_map_iterator & operator+=(difference_type n){
+        _key += n;
+        _mapped += n;
+        return *this;
+    }
+
+    inline flat_map_iterator & operator-=(difference_type n){
+        _key -= n;
+        _mapped -= n;
+        return *this;
+    }
+
+    inline flat_map_iterator operator+(difference_type n) const{
+        return flat_map_iterator(_key + n, _mapped + n);
+    }
+
+    inline flat_map_iterator operator-(difference_type n) const{
+        return flat_map_iterator(_key - n, _mapped - n);
+    }
+
+    inline difference_type operator-(const flat_map_iterator & other) const{
+        return _key - other._key;
+    }
+
+    inline bool operator==(const flat_map_iterator & other) const{
+        return _key == other._key;
+    }
+
+    inline bool operator!=(const flat_map_iterator & other) const{
+        return _key != other._key;
+    }
+
+    inline bool operator<(const flat_map_iterator & other) const{
+        return _key < other._key;
+    }
+
+    inline bool operator>(const flat_map_iterator & other) const{
+        return _key > other._key;
+    }
+
+    inline bool operator<=(const flat_map_iterator & other) const{
+        return _key <= other._key;
+    }
+
+    inline bool operator>=(const flat_map_iterator & other) const{
+        return _key >= other._key;
+    }
+
+private:
+    template<typename K, typename V, bool C>
+    friend class flat_map_iterator;
+
+    const Key* _key;
+    mapped_qualified* _mapped;
+};
+
+} // details
+
+
+///
+/// \brief flat_map
+///
+/// ordered map stored as two sorted parallel arrays, one for the keys and one
+/// for the mapped values: a lookup is a binary search on a dense array of keys,
+/// without the pointer chasing of std::map nodes nor the mapped values in the cache lines
+///
+/// suited for maps built once, or rarely modified, and queried often:
+/// an insertion or an erase in the middle is O(n). Build them from a range,
+/// which sorts once, parallel::sort for large inputs
+///
+/// the iterators dereference to a std::pair<const Key &, T &> proxy,
+/// invalidated, as the references, by any insertion or erase
+///
+template<typename Key, typename T, typename Compare = std::less<Key> >
+class flat_map{
+public:
+    typedef Key                                                 key_type;
+    typedef T                                                   mapped_type;
+    typedef std::pair<Key, T>                                   value_type;
+    typedef Compare                                             key_compare;
+    typedef std::vector<Key>                                    key_container_type;
+    typedef std::vector<T>                                      mapped_container_type;
+    typedef details::flat_map_iterator<Key, T, false>           iterator;
+    typedef details::flat_map_iterator<Key, T, true>            const_iterator;
+    typedef typename iterator::reference                        reference;
+    typedef typename const_iterator::reference                  const_reference;
+    typedef std::reverse_iterator<iterator>                     reverse_iterator;
+    typedef std::reverse_iterator<const_iterator>               const_reverse_iterator;
+    typedef std::size_t                                         size_type;
+    typedef std::ptrdiff_t                                      difference_type;
+
+    inline flat_map() : _comp(), _keys(), _values() {}
+
+    inline explicit flat_map(const Compare & comp) : _comp(comp), _keys(), _values() {}
+
+    ///
+    /// \brief map of the pairs of [first, last), sorted once
+    ///
+    /// the first of the pairs with equivalent keys is kept, as for successive insertions
+    ///
+    template<typename InputIterator>
+    inline flat_map(InputIterator first, InputIterator last, const Compare & comp = Compare()) :
+        _comp(comp), _keys(), _values(){
+        insert(first, last);
+    }
+
+    inline flat_map(std::initializer_list<value_type> values, const Compare & comp = Compare()) :
+        flat_map(values.begin(), values.end(), comp) {}
+
+    ///
+    /// \brief map of the pairs of [first, last), already sorted and with unique keys
+    ///
+    template<typename InputIterator>
+    inline flat_map(sorted_unique_t, InputIterator first, InputIterator last, const Compare & comp = Compare()) :
+        _comp(comp), _keys(), _values(){
+        for(; first != last; ++first){
+            _keys.push_back(first->first);
+            _values.push_back(first->second);
+        }
+        assert(_is_sorted_unique());
+    }
+
+    ///
+    /// \brief map which takes the content of a key and a mapped arrays of the same size,
+    /// keys[i] is associated with values[i], sorted once
+    ///
+    inline flat_map(key_container_type && keys, mapped_container_type && values, const Compare & comp = Compare()) :
+        _comp(comp), _keys(), _values(){
+        if(keys.size() != values.size()){
+            throw std::invalid_argument("flat_map: keys and values of different sizes");
+        }
+        _merge_unsorted(keys, values);
+    }
+
+    inline iterator begin() noexcept{
+        return iterator(_keys.data(), _values.data());
+    }
+
+    inline const_iterator begin() const noexcept{
+        return const_iterator(_keys.data(), _values.data());
+    }
+
+    inline iterator end() noexcept{
+        return begin() + static_cast<difference_type>(size());
+    }
+
+    inline const_iterator end() const noexcept{
+        return begin() + static_cast<difference_type>(size());
+    }
+
+    inline const_iterator cbegin() const noexcept{
+        return begin();
+    }
+
+    inline const_iterator cend() const noexcept{
+        return end();
+    }
+
+    inline reverse_iterator rbegin() noexcept{
+        return reverse_iterator(end());
+    }
+
+    inline const_reverse_iterator rbegin() const noexcept{
+        return const_reverse_iterator(end());
+    }
+
+    inline reverse_iterator rend() noexcept{
+        return reverse_iterator(begin());
+    }
+
+    inline const_reverse_iterator rend() const noexcept{
+        return const_reverse_iterator(begin());
+    }
+
+    inline bool empty() const noexcept{
+        return _keys.empty();
+    }
+
+    inline size_type size() const noexcept{
+        return _keys.size();
+    }
+
+    inline size_type max_size() const noexcept{
+        return std::min(_keys.max_size(), _values.max_size());
+    }
+
+    inline void reserve(size_type n){
+        _keys.reserve(n);
+        _values.reserve(n);
+    }
+
+    inline void shrink_to_fit(){
+        _keys.shrink_to_fit();
+        _values.shrink_to_fit();
+    }
+
+    ///
+    /// \brief sorted keys, contiguous
+    ///
+    inline const key_container_type & keys() const noexcept{
+        return _keys;
+    }
+
+    ///
+    /// \brief mapped values, values()[i] is associated with keys()[i]
+    ///
+    inline const mapped_container_type & values() const noexcept{
+        return _values;
+    }
+
+    ///
+    /// \brief mapped value of key, throw std::out_of_range if key is not in the map
+    ///
+    inline T & at(const key_type & key){
+        const size_type pos = _find_index(key);
+        if(pos == size()){
+            throw std::out_of_range("flat_map: key not found");
+        }
+        return _values[pos];
+    }
+
+    inline const T & at(const key_type & key) const{
+        const size_type pos = _find_index(key);
+        if(pos == size()){
+            throw std::out_of_range("flat_map: key not found");
+        }
+        return _values[pos];
+    }
+
+    ///
+    /// \brief mapped value of key, value-initialized and inserted if key is not in the map
+    ///
+    inline T & operator[](const key_type & key){
+        return _values[_try_emplace_index(key).first];
+    }
+
+    inline T & operator[](key_type && key){
+        return _values[_try_emplace_index(std::move(key)).first];
+    }
+
+    inline iterator find(const key_type & key){
+        return begin() + static_cast<difference_type>(_find_index(key));
+    }
+
+    inline const_iterator find(const key_type & key) const{
+        return begin() + static_cast<difference_type>(_find_index(key));
+    }
+
+    inline size_type count(const key_type & key) const{
+        return (_find_index(key) != size()) ? 1 : 0;
+    }
+
+    inline bool contains(const key_type & key) const{
+        return _find_index(key) != size();
+    }
+
+    inline iterator lower_bound(const key_type & key){
+        return begin() + static_cast<difference_type>(_lower_index(key));
+    }
+
+    inline const_iterator lower_bound(const key_type & key) const{
+        return begin() + static_cast<difference_type>(_lower_index(key));
+    }
+
+    inline iterator upper_bound(const key_type & key){
+        return begin() + static_cast<difference_type>(_upper_index(key));
+    }
+
+    inline const_iterator upper_bound(const key_type & key) const{
+        return begin() + static_cast<difference_type>(_upper_index(key));
+    }
+
+    inline std::pair<iterator, iterator> equal_range(const key_type & key){
+        const size_type pos = _lower_index(key);
+        const size_type last = pos + ((pos != size() && _comp(key, _keys[pos]) == false) ? 1 : 0);
+        return std::make_pair(begin() + static_cast<difference_type>(pos), begin() + static_cast<difference_type>(last));
+    }
+
+    inline std::pair<const_iterator, const_iterator> equal_range(const key_type & key) const{
+        const size_type pos = _lower_index(key);
+        const size_type last = pos + ((pos != size() && _comp(key, _keys[pos]) == false) ? 1 : 0);
+        return std::make_pair(begin() + static_cast<difference_type>(pos), begin() + static_cast<difference_type>(last));
+    }
+
+    ///
+    /// \brief insert value if its key is not in the map
+    /// \return iterator to the element with the key of value, true if inserted
+    ///
+    inline std::pair<iterator, bool> insert(const value_type & value){
+        return _to_iterator(_try_emplace_index(value.first, value.second));
+    }
+
+    inline std::pair<iterator, bool> insert(value_type && value){
+        return _to_iterator(_try_emplace_index(std::move(value.first), std::move(value.second)));
+    }
+
+    ///
+    /// \brief insert the pairs of [first, last): sorted then merged,
+    /// O(n + m log m) instead of O(n * m) for one by one insertions
+    ///
+    /// the elements already in the map win over the new ones with an equivalent key
+    ///
+    template<typename InputIterator>
+    inline void insert(InputIterator first, InputIterator last){
+        key_container_type new_keys;
+        mapped_container_type new_values;
+        for(; first != last; ++first){
+            new_keys.push_back(first->first);
+            new_values.push_back(first->second);
+        }
+        _merge_unsorted(new_keys, new_values);
+    }
+
+    inline void insert(std::initializer_list<value_type> values){
+        insert(values.begin(), values.end());
+    }
+
+    template<typename... Args>
+    inline std::pair<iterator, bool> emplace(Args &&... args){
+        return insert(value_type(std::forward<Args>(args)...));
+    }
+
+    ///
+    /// \brief construct the mapped value from args if key is not in the map,
+    /// args are not used otherwise
+    ///
+    template<typename... Args>
+    inline std::pair<iterator, bool> try_emplace(const key_type & key, Args &&... args){
+        return _to_iterator(_try_emplace_index(key, std::forward<Args>(args)...));
+    }
+
+    template<typename... Args>
+    inline std::pair<iterator, bool> try_emplace(key_type && key, Args &&... args){
+        return _to_iterator(_try_emplace_index(std::move(key), std::forward<Args>(args)...));
+    }
+
+    ///
+    /// \brief insert or replace the mapped value of key
+    /// \return iterator to the element, true if inserted
+    ///
+    template<typename M>
+    inline std::pair<iterator, bool> insert_or_assign(const key_type & key, M && obj){
+        const std::pair<size_type, bool> res = _try_emplace_index(key, std::forward<M>(obj));
+        if(res.second == false){
+            _values[res.first] = std::forward<M>(obj);
+        }
+        return _to_iterator(res);
+    }
+
+    inline iterator erase(const_iterator pos){
+        return erase(pos, pos + 1);
+    }
+
+    inline iterator erase(const_iterator first, const_iterator last){
+        const difference_type pos = first - cbegin();
+        const difference_type pos_last = last - cbegin();
+        _keys.erase(_keys.begin() + pos, _keys.begin() + pos_last);
+        _values.erase(_values.begin() + pos, _values.begin() + pos_last);
+        return begin() + pos;
+    }
+
+    ///
+    /// \brief erase the element with key
+    /// \return number of elements erased, 0 or 1
+    ///
+    inline size_type erase(const key_type & key){
+        const size_type pos = _find_index(key);
+        if(pos == size()){
+            return 0;
+        }
+        _keys.erase(_keys.begin() + static_cast<difference_type>(pos));
+        _values.erase(_values.begin() + static_cast<difference_type>(pos));
+        return 1;
+    }
+
+    inline void clear() noexcept{
+        _keys.clear();
+        _values.clear();
+    }
+
+    inline void swap(flat_map & other){
+        using std::swap;
+        swap(_comp, other._comp);
+        _keys.swap(other._keys);
+        _values.swap(other._values);
+    }
+
+    inline key_compare key_comp() const{
+        return _comp;
+    }
+
+private:
+    inline size_type _lower_index(const key_type & key) const{
+        return static_cast<size_type>(details::flat_lower_bound(_keys.data(), _keys.size(), key, _comp) - _keys.data());
+    }
+
+    inline size_type _upper_index(const key_type & key) const{
+        return static_cast<size_type>(details::flat_upper_bound(_keys.data(), _keys.size(), key, _comp) - _keys.data());
+    }
+
+    // index of key, size() if not found
+    inline size_type _find_index(const key_type & key) const{
+        const size_type pos = _lower_index(key);
+        return (pos != size() && _comp(key, _keys[pos]) == false) ? pos : size();
+    }
+
+    inline std::pair<iterator, bool> _to_iterator(const std::pair<size_type, bool> & res){
+        return std::make_pair(begin() + static_cast<difference_type>(res.first), res.second);
+    }
+
+    // index of key, the mapped value is constructed from args and inserted if the key is not found
+    template<typename K, typename... Args>
+    inline std::pair<size_type, bool> _try_emplace_index(K && key, Args &&... args){
+        const size_type pos = _lower_index(key);
+        if(pos != size() && _comp(key, _keys[pos]) == false){
+            return std::make_pair(pos, false);
+        }
+
+        const difference_type offset = static_cast<difference_type>(pos);
+        _keys.insert(_keys.begin() + offset, std::forward<K>(key));
+        try{
+            _values.emplace(_values.begin() + offset, std::forward<Args>(args)...);
+        }catch(...){
+            _keys.erase(_keys.begin() + offset);
+            throw;
+        }
+        return std::make_pair(pos, true);
+    }
+
+    // merge unsorted new elements in the map, the existing elements and the first
+    // of the new equivalent ones are kept
+    inline void _merge_unsorted(key_container_type & new_keys, mapped_container_type & new_values){
+        assert(new_keys.size() == new_values.size());
+        if(new_keys.empty()){
+            return;
+        }
+
+        const std::vector<std::size_t> order = details::flat_sort_permutation(new_keys, _comp);
+
+        key_container_type keys;
+        mapped_container_type values;
+        keys.reserve(_keys.size() + new_keys.size());
+        values.reserve(_keys.size() + new_keys.size());
+
+        std::size_t i = 0, j = 0;
+        while(j < order.size()){
+            Key & new_key = new_keys[order[j]];
+
+            if(i < _keys.size() && _comp(new_key, _keys[i]) == false){
+                // existing element first, wins over an equivalent new one
+                if(_comp(_keys[i], new_key) == false){
+                    ++j;
+                    continue;
+                }
+                keys.push_back(std::move_if_noexcept(_keys[i]));
+                values.push_back(std::move_if_noexcept(_values[i]));
+                ++i;
+                continue;
+            }
+
+            // skip the duplicates of the new elements
+            if(keys.empty() || _comp(keys.back(), new_key)){
+                keys.push_back(std::move(new_key));
+                values.push_back(std::move(new_values[order[j]]));
+            }
+            ++j;
+        }
+
+        for(; i < _keys.size(); ++i){
+            keys.push_back(std::move_if_noexcept(_keys[i]));
+            values.push_back(std::move_if_noexcept(_values[i]));
+        }
+
+        _keys.swap(keys);
+        _values.swap(values);
+    }
+
+    inline bool _is_sorted_unique() const{
+        for(size_type i = 1; i < _keys.size(); ++i){
+            if(_comp(_keys[i-1], _keys[i]) == false){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Compare _comp;
+    key_container_type _keys;
+    mapped_container_type _values;
+};
+
+
+template<typename Key, typename T, typename Compare>
+inline bool operator==(const flat_map<Key, T, Compare> & a, const flat_map<Key, T, Compare> & b){
+    return a.keys() == b.keys() && a.values() == b.values();
+}
+
+template<typename Key, typename T, typename Compare>
+inline bool operator!=(const flat_map<Key, T, Compare> & a, const flat_map<Key, T, Compare> & b){
+    return !(a == b);
+}
+
+template<typename Key, typename T, typename Compare>
+inline void swap(flat_map<Key, T, Compare> & a, flat_map<Key, T, Compare> & b){
+    a.swap(b);
+}
+
+
+} // containers
+
+} // hadoken
+
+#endif // _HADOKEN_FLAT_MAP_HPP_
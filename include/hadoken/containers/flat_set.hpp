@@ -0,0 +1,339 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_FLAT_SET_HPP_
+#define _HADOKEN_FLAT_SET_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "bits/flat_container_bits.hpp"
+
+namespace hadoken {
+
+namespace containers {
+
+
+///
+/// \brief flat_set
+///
+/// ordered set stored as a sorted std::vector: a lookup is a binary search
+/// on contiguous memory, without the pointer chasing of std::set nodes
+///
+/// suited for sets built once, or rarely modified, and queried often:
+/// an insertion or an erase in the middle is O(n). Build them from a range,
+/// which sorts once, parallel::sort for large inputs
+///
+/// the iterators and references are invalidated by any modification,
+/// the elements are accessed through const iterators only
+///
+template<typename Key, typename Compare = std::less<Key> >
+class flat_set{
+public:
+    typedef Key                                                 key_type;
+    typedef Key                                                 value_type;
+    typedef Compare                                             key_compare;
+    typedef Compare                                             value_compare;
+    typedef std::vector<Key>                                    container_type;
+    typedef const value_type &                                  reference;
+    typedef const value_type &                                  const_reference;
+    typedef typename container_type::const_iterator             iterator;
+    typedef typename container_type::const_iterator             const_iterator;
+    typedef std::reverse_iterator<const_iterator>               reverse_iterator;
+    typedef std::reverse_iterator<const_iterator>               const_reverse_iterator;
+    typedef std::size_t                                         size_type;
+    typedef std::ptrdiff_t                                      difference_type;
+
+    inline flat_set() : _comp(), _data() {}
+
+    inline explicit flat_set(const Compare & comp) : _comp(comp), _data() {}
+
+    ///
+    /// \brief set of the elements of [first, last), sorted once
+    ///
+    /// only the first element of each group of equivalent elements is kept,
+    /// as for successive insertions
+    ///
+    template<typename InputIterator>
+    inline flat_set(InputIterator first, InputIterator last, const Compare & comp = Compare()) :
+        _comp(comp), _data(first, last){
+        _sort_unique(_data.begin());
+    }
+
+    inline flat_set(std::initializer_list<value_type> values, const Compare & comp = Compare()) :
+        flat_set(values.begin(), values.end(), comp) {}
+
+    ///
+    /// \brief set of the elements of [first, last), already sorted and unique
+    ///
+    template<typename InputIterator>
+    inline flat_set(sorted_unique_t, InputIterator first, InputIterator last, const Compare & comp = Compare()) :
+        _comp(comp), _data(first, last){
+        assert(_is_sorted_unique());
+    }
+
+    ///
+    /// \brief set which takes the content of a vector, sorted once
+    ///
+    inline explicit flat_set(container_type && values, const Compare & comp = Compare()) :
+        _comp(comp), _data(std::move(values)){
+        _sort_unique(_data.begin());
+    }
+
+    inline const_iterator begin() const noexcept{
+        return _data.begin();
+    }
+
+    inline const_iterator end() const noexcept{
+        return _data.end();
+    }
+
+    inline const_iterator cbegin() const noexcept{
+        return _data.begin();
+    }
+
+    inline const_iterator cend() const noexcept{
+        return _data.end();
+    }
+
+    inline const_reverse_iterator rbegin() const noexcept{
+        return const_reverse_iterator(end());
+    }
+
+    inline const_reverse_iterator rend() const noexcept{
+        return const_reverse_iterator(begin());
+    }
+
+    inline bool empty() const noexcept{
+        return _data.empty();
+    }
+
+    inline size_type size() const noexcept{
+        return _data.size();
+    }
+
+    inline size_type max_size() const noexcept{
+        return _data.max_size();
+    }
+
+    inline size_type capacity() const noexcept{
+        return _data.capacity();
+    }
+
+    inline void reserve(size_type n){
+        _data.reserve(n);
+    }
+
+    inline void shrink_to_fit(){
+        _data.shrink_to_fit();
+    }
+
+    ///
+    /// \brief sorted elements, contiguous
+    ///
+    inline const value_type* data() const noexcept{
+        return _data.data();
+    }
+
+    ///
+    /// \brief insert value if no equivalent element exists
+    /// \return iterator to the element equivalent to value, true if inserted
+    ///
+    inline std::pair<iterator, bool> insert(const value_type & value){
+        return _insert_unique(value);
+    }
+
+    inline std::pair<iterator, bool> insert(value_type && value){
+        return _insert_unique(std::move(value));
+    }
+
+    inline iterator insert(const_iterator hint, const value_type & value){
+        (void) hint;
+        return insert(value).first;
+    }
+
+    inline iterator insert(const_iterator hint, value_type && value){
+        (void) hint;
+        return insert(std::move(value)).first;
+    }
+
+    ///
+    /// \brief insert the elements of [first, last): appended, sorted then merged,
+    /// O(n + m log m) instead of O(n * m) for one by one insertions
+    ///
+    /// the elements already in the set win over the new equivalent elements
+    ///
+    template<typename InputIterator>
+    inline void insert(InputIterator first, InputIterator last){
+        const size_type old_size = _data.size();
+        _data.insert(_data.end(), first, last);
+        _sort_unique(_data.begin() + static_cast<difference_type>(old_size));
+    }
+
+    inline void insert(std::initializer_list<value_type> values){
+        insert(values.begin(), values.end());
+    }
+
+    template<typename... Args>
+    inline std::pair<iterator, bool> emplace(Args &&... args){
+        return _insert_unique(value_type(std::forward<Args>(args)...));
+    }
+
+    inline iterator erase(const_iterator pos){
+        return _data.erase(pos);
+    }
+
+    inline iterator erase(const_iterator first, const_iterator last){
+        return _data.erase(first, last);
+    }
+
+    ///
+    /// \brief erase the element equivalent to key
+    /// \return number of elements erased, 0 or 1
+    ///
+    inline size_type erase(const key_type & key){
+        const_iterator it = find(key);
+        if(it == end()){
+            return 0;
+        }
+        _data.erase(it);
+        return 1;
+    }
+
+    inline void clear() noexcept{
+        _data.clear();
+    }
+
+    inline void swap(flat_set & other){
+        using std::swap;
+        swap(_comp, other._comp);
+        _data.swap(other._data);
+    }
+
+    inline const_iterator lower_bound(const key_type & key) const{
+        return begin() + (details::flat_lower_bound(_data.data(), _data.size(), key, _comp) - _data.data());
+    }
+
+    inline const_iterator upper_bound(const key_type & key) const{
+        return begin() + (details::flat_upper_bound(_data.data(), _data.size(), key, _comp) - _data.data());
+    }
+
+    inline std::pair<const_iterator, const_iterator> equal_range(const key_type & key) const{
+        const_iterator it = lower_bound(key);
+        return std::make_pair(it, (it != end() && _comp(key, *it) == false) ? it + 1 : it);
+    }
+
+    inline const_iterator find(const key_type & key) const{
+        const_iterator it = lower_bound(key);
+        return (it != end() && _comp(key, *it) == false) ? it : end();
+    }
+
+    inline size_type count(const key_type & key) const{
+        return (find(key) != end()) ? 1 : 0;
+    }
+
+    inline bool contains(const key_type & key) const{
+        return find(key) != end();
+    }
+
+    inline key_compare key_comp() const{
+        return _comp;
+    }
+
+    inline value_compare value_comp() const{
+        return _comp;
+    }
+
+private:
+    template<typename V>
+    inline std::pair<iterator, bool> _insert_unique(V && value){
+        const_iterator it = lower_bound(value);
+        if(it != end() && _comp(value, *it) == false){
+            return std::make_pair(it, false);
+        }
+        return std::make_pair(_data.insert(it, std::forward<V>(value)), true);
+    }
+
+    // sort [middle, end), merge it with the sorted [begin, middle) and remove the duplicates,
+    // the first of equivalent elements is kept: the sort and the merge are both stable
+    inline void _sort_unique(typename container_type::iterator middle){
+        std::stable_sort(middle, _data.end(), _comp);
+        std::inplace_merge(_data.begin(), middle, _data.end(), _comp);
+
+        const Compare & comp = _comp;
+        _data.erase(std::unique(_data.begin(), _data.end(), [&comp](const value_type & a, const value_type & b){
+            return comp(a, b) == false;
+        }), _data.end());
+    }
+
+    inline bool _is_sorted_unique() const{
+        for(size_type i = 1; i < _data.size(); ++i){
+            if(_comp(_data[i-1], _data[i]) == false){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Compare _comp;
+    container_type _data;
+};
+
+
+template<typename Key, typename Compare>
+inline bool operator==(const flat_set<Key, Compare> & a, const flat_set<Key, Compare> & b){
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+template<typename Key, typename Compare>
+inline bool operator!=(const flat_set<Key, Compare> & a, const flat_set<Key, Compare> & b){
+    return !(a == b);
+}
+
+template<typename Key, typename Compare>
+inline bool operator<(const flat_set<Key, Compare> & a, const flat_set<Key, Compare> & b){
+    return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+}
+
+template<typename Key, typename Compare>
+inline void swap(flat_set<Key, Compare> & a, flat_set<Key, Compare> & b){
+    a.swap(b);
+}
+
+
+} // containers
+
+} // hadoken
+
+#endif // _HADOKEN_FLAT_SET_HPP_
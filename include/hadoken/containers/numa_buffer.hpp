@@ -0,0 +1,313 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_NUMA_BUFFER_HPP_
+#define _HADOKEN_NUMA_BUFFER_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <hadoken/parallel/algorithm.hpp>
+#include <hadoken/thread/topology.hpp>
+
+
+namespace hadoken {
+
+
+namespace containers {
+
+
+///
+/// \brief memory placement of a numa_buffer
+///
+/// - partitioned : each page is first-touched by the worker that processes it
+///                 in parallel::for_range, pages end up on the NUMA node of their worker
+/// - interleaved : pages are distributed round-robin on all the NUMA nodes with memory,
+///                 suited for data accessed without a predictable pattern
+///
+enum class numa_placement{
+    partitioned,
+    interleaved
+};
+
+
+namespace details{
+
+#ifdef __linux__
+
+// linux MPOL_INTERLEAVE, see linux/mempolicy.h
+constexpr int mpol_interleave = 3;
+
+inline void numa_interleave_memory(void* ptr, std::size_t size){
+    std::string mem_nodes;
+    if(thread::details::read_file_content("/sys/devices/system/node/has_memory", mem_nodes) == false){
+        return;
+    }
+
+    const std::size_t bits_per_word = sizeof(unsigned long) * 8;
+    std::vector<unsigned long> mask(1, 0);
+    for(int node : thread::details::parse_cpu_list(mem_nodes)){
+        const std::size_t word = static_cast<std::size_t>(node) / bits_per_word;
+        if(word >= mask.size()){
+            mask.resize(word +1, 0);
+        }
+        mask[word] |= (1UL << (static_cast<std::size_t>(node) % bits_per_word));
+    }
+
+#ifdef SYS_mbind
+    // best effort: ignore failure on non-NUMA kernels, memory is then first-touch allocated
+    (void) syscall(SYS_mbind, ptr, size, mpol_interleave, mask.data(), mask.size() * bits_per_word +1, 0);
+#else
+    (void) ptr;
+    (void) size;
+#endif
+}
+
+#endif
+
+// allocate pages without touching them
+inline void* numa_allocate(std::size_t size, numa_placement placement){
+#ifdef __linux__
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(ptr == MAP_FAILED){
+        throw std::bad_alloc();
+    }
+    if(placement == numa_placement::interleaved){
+        numa_interleave_memory(ptr, size);
+    }
+    return ptr;
+#else
+    (void) placement;
+    return ::operator new(size);
+#endif
+}
+
+inline void numa_deallocate(void* ptr, std::size_t size){
+#ifdef __linux__
+    munmap(ptr, size);
+#else
+    (void) size;
+    ::operator delete(ptr);
+#endif
+}
+
+} // details
+
+
+///
+/// \brief fixed size buffer with NUMA aware memory placement
+///
+/// The memory is allocated directly from the system, without being touched,
+/// then the elements are constructed in parallel with parallel::uninitialized_fill.
+///
+/// With numa_placement::partitioned and a parallel execution policy, each page ends
+/// up on the NUMA node of the worker that processes it in a later parallel::for_range
+/// over the whole buffer, which keeps bandwidth bound kernels on local memory.
+///
+template<typename T>
+class numa_buffer{
+public:
+    typedef T                                               value_type;
+    typedef T*                                              pointer;
+    typedef const T*                                        const_pointer;
+    typedef value_type &                                    reference;
+    typedef const value_type &                              const_reference;
+    typedef T*                                              iterator;
+    typedef const T*                                        const_iterator;
+    typedef std::size_t                                     size_type;
+    typedef std::ptrdiff_t                                  difference_type;
+
+    ///
+    /// \brief empty buffer
+    ///
+    numa_buffer() noexcept : _data(nullptr), _size(0), _placement(numa_placement::partitioned) {}
+
+    ///
+    /// \brief allocate and construct a buffer of n elements
+    /// \param policy : execution policy used for the initialization
+    /// \param n : number of elements
+    /// \param value : initial value of each element
+    /// \param placement : memory placement policy
+    ///
+    template<typename ExecPolicy>
+    numa_buffer(ExecPolicy && policy, size_type n, const T & value = T(),
+                numa_placement placement = numa_placement::partitioned) :
+        _data(nullptr), _size(n), _placement(placement){
+        if(n == 0){
+            return;
+        }
+
+        _data = static_cast<pointer>(details::numa_allocate(_allocated_bytes(), placement));
+
+        // the slices never throw: for_range always joins all of them before the
+        // memory is released, and the ones which succeeded are destroyed on error
+        std::mutex slices_lock;
+        std::vector<std::pair<pointer, pointer> > constructed;
+        std::exception_ptr error;
+
+        parallel::for_range(std::forward<ExecPolicy>(policy), _data, _data + _size, [&](pointer first, pointer last){
+            try{
+                std::uninitialized_fill(first, last, value);
+                try{
+                    std::lock_guard<std::mutex> lock(slices_lock);
+                    constructed.emplace_back(first, last);
+                }catch(...){
+                    _destroy(first, last);
+                    throw;
+                }
+            }catch(...){
+                std::lock_guard<std::mutex> lock(slices_lock);
+                if(error == nullptr){
+                    error = std::current_exception();
+                }
+            }
+        });
+
+        if(error != nullptr){
+            for(const std::pair<pointer, pointer> & slice : constructed){
+                _destroy(slice.first, slice.second);
+            }
+            details::numa_deallocate(_data, _allocated_bytes());
+            _data = nullptr;
+            _size = 0;
+            std::rethrow_exception(error);
+        }
+    }
+
+    numa_buffer(numa_buffer && other) noexcept : _data(other._data), _size(other._size), _placement(other._placement){
+        other._data = nullptr;
+        other._size = 0;
+    }
+
+    numa_buffer & operator=(numa_buffer && other) noexcept{
+        swap(other);
+        return *this;
+    }
+
+    ~numa_buffer(){
+        if(_data == nullptr){
+            return;
+        }
+        _destroy(_data, _data + _size);
+        details::numa_deallocate(_data, _allocated_bytes());
+    }
+
+    iterator begin() noexcept{
+        return _data;
+    }
+
+    const_iterator begin() const noexcept{
+        return _data;
+    }
+
+    iterator end() noexcept{
+        return _data + _size;
+    }
+
+    const_iterator end() const noexcept{
+        return _data + _size;
+    }
+
+    pointer data() noexcept{
+        return _data;
+    }
+
+    const_pointer data() const noexcept{
+        return _data;
+    }
+
+    size_type size() const noexcept{
+        return _size;
+    }
+
+    bool empty() const noexcept{
+        return _size == 0;
+    }
+
+    numa_placement placement() const noexcept{
+        return _placement;
+    }
+
+    reference operator[](size_type pos) noexcept{
+        assert(pos < _size);
+        return _data[pos];
+    }
+
+    const_reference operator[](size_type pos) const noexcept{
+        assert(pos < _size);
+        return _data[pos];
+    }
+
+    void swap(numa_buffer & other) noexcept{
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+        std::swap(_placement, other._placement);
+    }
+
+private:
+    numa_buffer(const numa_buffer &) = delete;
+    numa_buffer & operator=(const numa_buffer &) = delete;
+
+    std::size_t _allocated_bytes() const noexcept{
+        return _size * sizeof(T);
+    }
+
+    static void _destroy(pointer first, pointer last) noexcept{
+        if(std::is_trivially_destructible<T>::value == false){
+            for(; first < last; ++first){
+                first->~T();
+            }
+        }
+    }
+
+    pointer _data;
+    size_type _size;
+    numa_placement _placement;
+};
+
+
+} // containers
+
+
+} // hadoken
+
+#endif // _HADOKEN_NUMA_BUFFER_HPP_
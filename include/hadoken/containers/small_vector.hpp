@@ -31,73 +31,233 @@
 
 #include <memory>
 #include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
 
 
-#include <boost/type_traits.hpp>
-
-#include "ptr_iterator.hpp"
-
 namespace hadoken {
 
 
 namespace containers {
 
-template<typename T, std::size_t N>
-class small_vector{
+
+///
+/// \brief is_trivially_relocatable
+///
+/// true if moving an object to a new address and destroying the original
+/// is equivalent to a memcpy of its bytes. small_vector relocates such types with
+/// memcpy / memmove when it grows, inserts or erases.
+///
+/// true for trivially copyable types, can be specialized for types known to be
+/// relocatable, e.g. std::unique_ptr. Never for the types which keep a pointer to
+/// themselves, e.g. std::string with small string optimization
+///
+template<typename T>
+struct is_trivially_relocatable : public std::integral_constant<bool, std::is_trivially_copyable<T>::value> {};
+
+
+namespace details{
+
+// hold the allocator as a base class: no space used by stateless allocators
+template<typename Allocator>
+struct small_vector_allocator_base : public Allocator{
+    small_vector_allocator_base() : Allocator() {}
+
+    explicit small_vector_allocator_base(const Allocator & alloc) : Allocator(alloc) {}
+
+    explicit small_vector_allocator_base(Allocator && alloc) : Allocator(std::move(alloc)) {}
+
+    Allocator & _get_alloc() noexcept{
+        return *this;
+    }
+
+    const Allocator & _get_alloc() const noexcept{
+        return *this;
+    }
+};
+
+} // details
+
+
+///
+/// \brief small_vector
+///
+/// vector with inline storage for the first N elements: no allocation
+/// while size() <= N, a heap buffer when it grows beyond
+///
+/// same interface as std::vector, with two differences:
+/// - a move construction or move assignment from a small_vector using its inline storage
+///   moves the elements one by one, it does not steal the buffer
+/// - the references and iterators are invalidated by swap and move when the inline storage is used
+///
+/// Allocator is used only for the heap buffer, once the size grows beyond N.
+/// A stateful allocator, e.g. an arena or a pool, allows to take the spills out of the global heap
+///
+template<typename T, std::size_t N, typename Allocator = std::allocator<T> >
+class small_vector : private details::small_vector_allocator_base<Allocator>{
+    static_assert(std::is_same<typename std::allocator_traits<Allocator>::value_type, T>::value,
+                  "small_vector: Allocator::value_type must be T");
+
+    typedef details::small_vector_allocator_base<Allocator>  allocator_base;
+    typedef std::allocator_traits<Allocator>                 allocator_traits;
+
 public:
     typedef T                                               value_type;
+    typedef Allocator                                       allocator_type;
     typedef T*                                              pointer;
-    typedef const pointer                                   const_pointer;
+    typedef const T*                                        const_pointer;
     typedef value_type &                                    reference;
     typedef const value_type &                              const_reference;
-    typedef iterator_ptr<value_type>                        iterator;
-    typedef const iterator                                  const_iterator;
+    typedef T*                                              iterator;
+    typedef const T*                                        const_iterator;
+    typedef std::reverse_iterator<iterator>                 reverse_iterator;
+    typedef std::reverse_iterator<const_iterator>           const_reverse_iterator;
     typedef std::size_t                                     size_type;
     typedef std::ptrdiff_t                                  difference_type;
 
-// not implemented now
-//    typedef std::reverse_iterator<const_iterator>  const_reverse_iterator;
-//    typedef std::reverse_iterator<iterator>		 reverse_iterator;
-//    typedef _Alloc                        		 allocator_type;
-
     ///
     /// \brief default constructor, empty small_vector
     ///
-    small_vector();
+    small_vector() noexcept(noexcept(Allocator()));
+
+    ///
+    /// \brief empty small_vector, the heap buffer will be taken from alloc
+    ///
+    explicit small_vector(const Allocator & alloc) noexcept;
+
+    ///
+    /// \brief small_vector of n value-initialized elements
+    ///
+    explicit small_vector(size_type n, const Allocator & alloc = Allocator());
+
+    ///
+    /// \brief small_vector of n copies of value
+    ///
+    small_vector(size_type n, const_reference value, const Allocator & alloc = Allocator());
+
+    ///
+    /// \brief small_vector with a copy of the range [first, last)
+    ///
+    template<typename InputIterator, typename = typename std::enable_if<
+                 std::is_integral<InputIterator>::value == false>::type >
+    small_vector(InputIterator first, InputIterator last, const Allocator & alloc = Allocator());
+
+    small_vector(std::initializer_list<value_type> values, const Allocator & alloc = Allocator());
+
+    small_vector(const small_vector & other);
+
+    small_vector(const small_vector & other, const Allocator & alloc);
+
+    ///
+    /// \brief move constructor, steal the heap buffer of other if any
+    ///
+    /// other is empty after the move
+    ///
+    small_vector(small_vector && other) noexcept(std::is_nothrow_move_constructible<T>::value);
+
+    ///
+    /// \brief move constructor with a given allocator, the heap buffer of other
+    /// is stolen only if alloc == other.get_allocator()
+    ///
+    small_vector(small_vector && other, const Allocator & alloc);
 
     ~small_vector();
 
+    small_vector & operator=(const small_vector & other);
+
+    ///
+    /// \brief move assignment, steal the heap buffer of other if the allocator allows it
+    ///
+    small_vector & operator=(small_vector && other) noexcept(std::is_nothrow_move_constructible<T>::value
+                                                             && std::allocator_traits<Allocator>::propagate_on_container_move_assignment::value);
+
+    small_vector & operator=(std::initializer_list<value_type> values);
+
+    ///
+    /// \brief replace the content by n copies of value
+    ///
+    void assign(size_type n, const_reference value);
+
+    ///
+    /// \brief replace the content by a copy of [first, last)
+    ///
+    template<typename InputIterator, typename = typename std::enable_if<
+                 std::is_integral<InputIterator>::value == false>::type >
+    void assign(InputIterator first, InputIterator last);
+
+    void assign(std::initializer_list<value_type> values);
+
+    ///
+    /// \brief copy of the allocator used for the heap buffer
+    ///
+    allocator_type get_allocator() const noexcept{
+        return this->_get_alloc();
+    }
 
     ///
     /// \brief return iterator to first value of the small_vector
     ///
     iterator begin() noexcept{
-        return iterator(_begin);
+        return _begin;
     }
 
     ///
     /// \brief return const_iterator to first value of the small_vector
     ///
     const_iterator begin() const noexcept{
-        return const_iterator(_begin);
+        return _begin;
     }
+
     ///
-    /// \brief return iterator to first value of the small_vector
+    /// \brief return iterator to the end of the small_vector
     ///
     iterator end() noexcept{
-        return iterator(_end);
+        return _end;
     }
 
     ///
-    /// \brief return const_iterator to first value of the small_vector
+    /// \brief return const_iterator to the end of the small_vector
     ///
     const_iterator end() const noexcept{
-        return const_iterator(_end);
+        return _end;
+    }
+
+    const_iterator cbegin() const noexcept{
+        return _begin;
+    }
+
+    const_iterator cend() const noexcept{
+        return _end;
+    }
+
+    reverse_iterator rbegin() noexcept{
+        return reverse_iterator(end());
+    }
+
+    const_reverse_iterator rbegin() const noexcept{
+        return const_reverse_iterator(end());
+    }
+
+    reverse_iterator rend() noexcept{
+        return reverse_iterator(begin());
+    }
+
+    const_reverse_iterator rend() const noexcept{
+        return const_reverse_iterator(begin());
+    }
+
+    const_reverse_iterator crbegin() const noexcept{
+        return rbegin();
+    }
+
+    const_reverse_iterator crend() const noexcept{
+        return rend();
     }
 
 
     ///
-    /// \brief return const_iterator to first value of the small_vector
+    /// \brief number of elements
     ///
     size_type size() const noexcept{
         return static_cast<std::size_t>(_end - _begin);
@@ -108,6 +268,38 @@ public:
     ///
     size_type max_size() const noexcept;
 
+    ///
+    /// \brief number of elements that can be stored without allocation, N at least
+    ///
+    size_type capacity() const noexcept;
+
+    ///
+    /// \return true if small_vector contains no element
+    ///
+    bool empty() const noexcept;
+
+    ///
+    /// \brief increase the capacity to n at least
+    ///
+    void reserve(size_type n);
+
+    ///
+    /// \brief reduce the capacity to size()
+    ///
+    /// go back to the inline storage and free the heap buffer when size() <= N
+    ///
+    void shrink_to_fit();
+
+    ///
+    /// \brief resize to n elements, the new elements are value-initialized
+    ///
+    void resize(size_type n);
+
+    ///
+    /// \brief resize to n elements, the new elements are copies of value
+    ///
+    void resize(size_type n, const_reference value);
+
 
     ///
     /// \brief push_back
@@ -115,12 +307,67 @@ public:
     ///
     void push_back(const_reference elem);
 
+    void push_back(value_type && elem);
 
     ///
-    /// \brief emplace_back
-    /// \param v
+    /// \brief construct an element at the end from args
+    /// \return reference to the new element
+    ///
+    template<typename... Args>
+    reference emplace_back(Args &&... args);
+
+    ///
+    /// \brief remove the last element
+    ///
+    void pop_back();
+
+    ///
+    /// \brief insert value before pos
+    /// \return iterator to the inserted element
+    ///
+    iterator insert(const_iterator pos, const_reference value);
+
+    iterator insert(const_iterator pos, value_type && value);
+
+    ///
+    /// \brief insert n copies of value before pos
+    /// \return iterator to the first inserted element, or pos if n == 0
+    ///
+    iterator insert(const_iterator pos, size_type n, const_reference value);
+
+    ///
+    /// \brief insert a copy of [first, last) before pos
+    /// \return iterator to the first inserted element, or pos if the range is empty
+    ///
+    template<typename InputIterator, typename = typename std::enable_if<
+                 std::is_integral<InputIterator>::value == false>::type >
+    iterator insert(const_iterator pos, InputIterator first, InputIterator last);
+
+    iterator insert(const_iterator pos, std::initializer_list<value_type> values);
+
+    ///
+    /// \brief construct an element from args before pos
+    /// \return iterator to the new element
+    ///
+    template<typename... Args>
+    iterator emplace(const_iterator pos, Args &&... args);
+
+    ///
+    /// \brief erase the element at pos
+    /// \return iterator following the erased element
     ///
-    void emplace_back(value_type && elem);
+    iterator erase(const_iterator pos);
+
+    ///
+    /// \brief erase the elements of [first, last)
+    /// \return iterator following the last erased element
+    ///
+    iterator erase(const_iterator first, const_iterator last);
+
+    ///
+    /// \brief remove all elements, the capacity is unchanged
+    ///
+    void clear() noexcept;
 
 
     ///
@@ -135,22 +382,20 @@ public:
     ///
     const_reference front() const noexcept;
 
+    ///
+    /// \brief back
+    /// \return reference to the last element of the vector
+    ///
+    reference back();
 
-    reference & back();
+    const_reference back() const noexcept;
 
     ///
     /// \brief pointer to first element
     /// \return return a pointer to the first element
     pointer data() noexcept;
 
-
-    ///
-    /// \return true if small_vector contains no element
-    ///
-    bool empty() const noexcept;
-
-
-    std::size_t capacity() const noexcept;
+    const_pointer data() const noexcept;
 
     ///
     /// \brief access operator
@@ -188,16 +433,84 @@ public:
 private:
     pointer _begin, _end, _end_memory;
 
-    T _internal_array[N];
+    // inline storage, raw memory: the elements are constructed on demand
+    alignas(T) unsigned char _internal_storage[sizeof(T) * (N > 0 ? N : 1)];
 
-
-    void _resize_to_fit(std::size_t);
+    pointer _internal_array() noexcept{
+        return static_cast<pointer>(static_cast<void*>(_internal_storage));
+    }
 
     bool _is_static() const noexcept;
+
+    pointer _allocate(std::size_t n){
+        return allocator_traits::allocate(this->_get_alloc(), n);
+    }
+
+    void _deallocate(pointer p, std::size_t n) noexcept{
+        allocator_traits::deallocate(this->_get_alloc(), p, n);
+    }
+
+    // free the heap buffer, if any
+    void _release_buffer() noexcept{
+        if(_is_static() == false){
+            _deallocate(_begin, capacity());
+        }
+    }
+
+    // reallocate to a capacity of s, relocate the elements
+    void _reallocate(std::size_t s);
+
+    // grow to fit s elements at least, with geometric growth
+    void _resize_to_fit(std::size_t s);
+
+    // construct an element from args at the end of a full small_vector
+    template<typename... Args>
+    void _emplace_back_realloc(Args &&... args);
+
+    // open a gap of n uninitialized elements at index pos, for relocatable types
+    pointer _open_gap(std::size_t pos, std::size_t n);
+
+    // insert n elements at index pos, construct(pointer, i) builds the element i
+    template<typename Construct>
+    iterator _insert_n(std::size_t pos, std::size_t n, Construct construct);
+
+    template<typename InputIterator>
+    iterator _insert_range(std::size_t pos, InputIterator first, InputIterator last, std::input_iterator_tag);
+
+    template<typename ForwardIterator>
+    iterator _insert_range(std::size_t pos, ForwardIterator first, ForwardIterator last, std::forward_iterator_tag);
+
+    // steal the buffer of other, or relocate its inline elements, this must be empty
+    // the allocators must be equal, or the one of other propagated to this
+    void _take_content(small_vector & other);
+
+    // relocate the elements of other, never steal its buffer, this must be empty
+    void _relocate_content(small_vector & other);
+
+    void _destroy_all_and_release() noexcept;
 };
 
 
+template<typename T, std::size_t N, typename Allocator>
+bool operator==(const small_vector<T, N, Allocator> & a, const small_vector<T, N, Allocator> & b);
+
+template<typename T, std::size_t N, typename Allocator>
+bool operator!=(const small_vector<T, N, Allocator> & a, const small_vector<T, N, Allocator> & b);
+
+template<typename T, std::size_t N, typename Allocator>
+bool operator<(const small_vector<T, N, Allocator> & a, const small_vector<T, N, Allocator> & b);
+
+template<typename T, std::size_t N, typename Allocator>
+bool operator<=(const small_vector<T, N, Allocator> & a, const small_vector<T, N, Allocator> & b);
+
+template<typename T, std::size_t N, typename Allocator>
+bool operator>(const small_vector<T, N, Allocator> & a, const small_vector<T, N, Allocator> & b);
+
+template<typename T, std::size_t N, typename Allocator>
+bool operator>=(const small_vector<T, N, Allocator> & a, const small_vector<T, N, Allocator> & b);
 
+template<typename T, std::size_t N, typename Allocator>
+void swap(small_vector<T, N, Allocator> & a, small_vector<T, N, Allocator> & b);
 
 
 } // containers
@@ -0,0 +1,234 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef HADOKEN_EXECUTOR_STATISTICS_HPP
+#define HADOKEN_EXECUTOR_STATISTICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+
+namespace hadoken{
+
+
+///
+/// \brief activity counters of a thread_pool_executor worker
+///
+/// only collected when HADOKEN_EXECUTOR_STATS is defined at compile time,
+/// all values are 0 otherwise
+///
+struct worker_statistics{
+    static constexpr std::size_t n_latency_buckets = 32;
+
+    worker_statistics() :
+        tasks_executed(0),
+        tasks_stolen(0),
+        busy_time_ns(0),
+        idle_time_ns(0),
+        queue_depth_high_water(0),
+        latency_histogram(){
+        latency_histogram.fill(0);
+    }
+
+    /// number of tasks executed by the worker
+    std::uint64_t tasks_executed;
+
+    /// number of tasks taken from the queue of another worker
+    std::uint64_t tasks_stolen;
+
+    /// time spent executing tasks
+    std::uint64_t busy_time_ns;
+
+    /// time spent waiting for tasks
+    std::uint64_t idle_time_ns;
+
+    /// maximum number of tasks queued on the worker
+    std::uint64_t queue_depth_high_water;
+
+    /// enqueue to start latency, log2 buckets:
+    /// latency_histogram[i] counts the tasks started after [2^i, 2^(i+1)) ns, the last bucket is open
+    std::array<std::uint64_t, n_latency_buckets> latency_histogram;
+};
+
+
+///
+/// \brief snapshot of the activity counters of a thread_pool_executor
+///
+struct executor_statistics{
+    executor_statistics() : workers(), shared_queue_depth_high_water(0) {}
+
+    /// per-worker counters, indexed by worker id
+    std::vector<worker_statistics> workers;
+
+    /// maximum number of tasks queued in the shared high priority lane
+    std::uint64_t shared_queue_depth_high_water;
+};
+
+
+namespace details{
+
+
+#ifdef HADOKEN_EXECUTOR_STATS
+
+constexpr bool executor_statistics_enabled = true;
+
+typedef std::chrono::steady_clock stats_clock;
+typedef stats_clock::time_point task_timestamp;
+
+inline task_timestamp make_task_timestamp(){
+    return stats_clock::now();
+}
+
+inline std::uint64_t elapsed_ns(const task_timestamp & start, const task_timestamp & end){
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+}
+
+inline void update_high_water(std::atomic<std::uint64_t> & high_water, std::uint64_t value){
+    std::uint64_t current = high_water.load(std::memory_order_relaxed);
+    while(value > current && high_water.compare_exchange_weak(current, value, std::memory_order_relaxed) == false){}
+}
+
+
+// counters of a worker, relaxed atomics: updated by the pool threads, read by any thread
+class worker_counters{
+public:
+    inline worker_counters() : _tasks_executed(0), _tasks_stolen(0), _busy_ns(0), _idle_ns(0), _queue_high_water(0), _latency(){
+        for(auto & bucket : _latency){
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    inline void on_queue_depth(std::size_t depth){
+        update_high_water(_queue_high_water, depth);
+    }
+
+    inline void on_task_start(const task_timestamp & enqueued, const task_timestamp & now, bool stolen){
+        _tasks_executed.fetch_add(1, std::memory_order_relaxed);
+        if(stolen){
+            _tasks_stolen.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        const std::uint64_t latency = elapsed_ns(enqueued, now);
+        std::size_t bucket = 0;
+        while(bucket < worker_statistics::n_latency_buckets -1 && (latency >> (bucket +1)) > 0){
+            bucket += 1;
+        }
+        _latency[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    inline void on_idle(const task_timestamp & start, const task_timestamp & end){
+        _idle_ns.fetch_add(elapsed_ns(start, end), std::memory_order_relaxed);
+    }
+
+    inline void on_busy(const task_timestamp & start, const task_timestamp & end){
+        _busy_ns.fetch_add(elapsed_ns(start, end), std::memory_order_relaxed);
+    }
+
+    inline void snapshot(worker_statistics & stats) const{
+        stats.tasks_executed = _tasks_executed.load(std::memory_order_relaxed);
+        stats.tasks_stolen = _tasks_stolen.load(std::memory_order_relaxed);
+        stats.busy_time_ns = _busy_ns.load(std::memory_order_relaxed);
+        stats.idle_time_ns = _idle_ns.load(std::memory_order_relaxed);
+        stats.queue_depth_high_water = _queue_high_water.load(std::memory_order_relaxed);
+        for(std::size_t i = 0; i < worker_statistics::n_latency_buckets; ++i){
+            stats.latency_histogram[i] = _latency[i].load(std::memory_order_relaxed);
+        }
+    }
+
+private:
+    std::atomic<std::uint64_t> _tasks_executed;
+    std::atomic<std::uint64_t> _tasks_stolen;
+    std::atomic<std::uint64_t> _busy_ns;
+    std::atomic<std::uint64_t> _idle_ns;
+    std::atomic<std::uint64_t> _queue_high_water;
+    std::array<std::atomic<std::uint64_t>, worker_statistics::n_latency_buckets> _latency;
+};
+
+
+class queue_counters{
+public:
+    inline queue_counters() : _queue_high_water(0) {}
+
+    inline void on_queue_depth(std::size_t depth){
+        update_high_water(_queue_high_water, depth);
+    }
+
+    inline std::uint64_t queue_depth_high_water() const{
+        return _queue_high_water.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<std::uint64_t> _queue_high_water;
+};
+
+#else
+
+constexpr bool executor_statistics_enabled = false;
+
+// statistics disabled: empty types and no-op functions, optimized out
+
+struct task_timestamp{};
+
+inline task_timestamp make_task_timestamp(){
+    return task_timestamp();
+}
+
+class worker_counters{
+public:
+    inline void on_queue_depth(std::size_t){}
+
+    inline void on_task_start(const task_timestamp &, const task_timestamp &, bool){}
+
+    inline void on_idle(const task_timestamp &, const task_timestamp &){}
+
+    inline void on_busy(const task_timestamp &, const task_timestamp &){}
+
+    inline void snapshot(worker_statistics &) const{}
+};
+
+class queue_counters{
+public:
+    inline void on_queue_depth(std::size_t){}
+
+    inline std::uint64_t queue_depth_high_water() const{
+        return 0;
+    }
+};
+
+#endif
+
+
+} // details
+
+
+} // hadoken
+
+#endif // HADOKEN_EXECUTOR_STATISTICS_HPP
@@ -0,0 +1,294 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef HADOKEN_TIMING_WHEEL_HPP
+#define HADOKEN_TIMING_WHEEL_HPP
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+
+namespace hadoken{
+
+
+namespace details{
+
+
+///
+/// \brief intrusive node of a timing_wheel
+///
+struct timer_node{
+    typedef std::uint64_t tick_type;
+
+    inline timer_node() : prev(nullptr), next(nullptr), expiry(0), level(-1) {}
+
+    inline bool linked() const noexcept{
+        return (level >= 0);
+    }
+
+    timer_node* prev;
+    timer_node* next;
+    tick_type expiry;
+    int level;
+};
+
+
+///
+/// \brief hierarchical timing wheel
+///
+/// 4 levels of 256 slots, each slot is an intrusive doubly linked list of timers.
+/// A timer is placed in the level matching its distance to the current tick and
+/// is moved ( cascaded ) to the lower level when the wheel reaches its slot.
+///
+/// insert() and remove() are O(1), advance() is O(1) amortized per tick and per timer.
+/// Timers further than 2^32 ticks are parked in the last level and re-cascaded.
+///
+/// not thread-safe, synchronization is the responsibility of the owner
+///
+class timing_wheel{
+public:
+    typedef timer_node::tick_type tick_type;
+
+    static constexpr std::size_t slot_bits = 8;
+    static constexpr std::size_t n_slots = 1 << slot_bits;
+    static constexpr std::size_t n_levels = 4;
+
+    inline explicit timing_wheel(tick_type start_tick = 0) :
+        _current(start_tick),
+        _size(0),
+        _slots(n_levels * n_slots),
+        _level_size(){
+        for(auto & head : _slots){
+            head.prev = head.next = &head;
+        }
+        for(std::size_t level = 0; level < n_levels; ++level){
+            _level_size[level] = 0;
+        }
+    }
+
+    ///
+    /// \brief insert a timer, node->expiry must be set
+    ///        a timer already expired fires at the next tick
+    ///
+    inline void insert(timer_node* node){
+        assert(node->linked() == false);
+        _place(node);
+        _size += 1;
+    }
+
+    ///
+    /// \brief remove a linked timer
+    ///
+    inline void remove(timer_node* node){
+        assert(node->linked());
+        _unlink(node);
+        _size -= 1;
+    }
+
+    ///
+    /// \brief advance the wheel until the tick now included
+    /// \param now : target tick
+    /// \param expired : output, the expired timers are appended and unlinked
+    ///
+    inline void advance(tick_type now, std::vector<timer_node*> & expired){
+        while(_current < now){
+            if(_size == 0){
+                _current = now;
+                return;
+            }
+
+            if(_level_size[0] == 0){
+                // nothing to fire before the next cascade, skip the empty slots
+                const tick_type boundary = (_current | tick_type(n_slots -1)) +1;
+                if(boundary > now){
+                    _current = now;
+                    return;
+                }
+                _current = boundary;
+            }else{
+                _current += 1;
+            }
+
+            _cascade_all();
+            _expire_slot(expired);
+        }
+    }
+
+    ///
+    /// \brief remove all the timers
+    /// \param removed : output, the removed timers are appended and unlinked
+    ///
+    inline void clear(std::vector<timer_node*> & removed){
+        for(auto & head : _slots){
+            while(head.next != &head){
+                timer_node* node = head.next;
+                _unlink(node);
+                removed.push_back(node);
+            }
+        }
+        _size = 0;
+    }
+
+    ///
+    /// \brief current tick of the wheel
+    ///
+    inline tick_type current() const noexcept{
+        return _current;
+    }
+
+    ///
+    /// \brief number of timers in the wheel
+    ///
+    inline std::size_t size() const noexcept{
+        return _size;
+    }
+
+    ///
+    /// \brief next tick where the wheel needs to be advanced ( a timer fire or a cascade happen )
+    ///        max tick_type if the wheel is empty
+    ///
+    inline tick_type next_event() const noexcept{
+        if(_size == 0){
+            return std::numeric_limits<tick_type>::max();
+        }
+
+        const tick_type boundary = (_current | tick_type(n_slots -1)) +1;
+        if(_level_size[0] > 0){
+            for(tick_type t = _current +1; t < boundary; ++t){
+                if(_slot_empty(0, static_cast<std::size_t>(t & (n_slots -1))) == false){
+                    return t;
+                }
+            }
+        }
+        return boundary;
+    }
+
+private:
+    timing_wheel(const timing_wheel &) = delete;
+    timing_wheel & operator=(const timing_wheel &) = delete;
+
+    inline timer_node & _head(std::size_t level, std::size_t slot){
+        return _slots[level * n_slots + slot];
+    }
+
+    inline bool _slot_empty(std::size_t level, std::size_t slot) const{
+        const timer_node & head = _slots[level * n_slots + slot];
+        return (head.next == &head);
+    }
+
+    // an inserted timer already expired fires at the next tick. A cascaded timer which
+    // expires at the current tick stays in the current slot, expired right after the cascade
+    inline void _place(timer_node* node, bool cascading = false){
+        tick_type delta = (node->expiry > _current) ? (node->expiry - _current) : (cascading ? 0 : 1);
+        tick_type position = _current + delta;
+
+        std::size_t level = 0;
+        while(level < n_levels -1 && delta >= (tick_type(1) << (slot_bits * (level +1)))){
+            level += 1;
+        }
+
+        // too far in the future: park in the farthest slot of the last level
+        const tick_type max_delta = (tick_type(1) << (slot_bits * n_levels)) -1;
+        if(delta > max_delta){
+            position = _current + max_delta;
+        }
+
+        const std::size_t slot = static_cast<std::size_t>((position >> (slot_bits * level)) & (n_slots -1));
+        timer_node & head = _head(level, slot);
+
+        node->level = static_cast<int>(level);
+        node->prev = &head;
+        node->next = head.next;
+        head.next->prev = node;
+        head.next = node;
+
+        _level_size[level] += 1;
+    }
+
+    inline void _unlink(timer_node* node){
+        node->prev->next = node->next;
+        node->next->prev = node->prev;
+        _level_size[static_cast<std::size_t>(node->level)] -= 1;
+        node->prev = node->next = nullptr;
+        node->level = -1;
+    }
+
+    // move the timers of the slot reached by the current tick to the lower levels
+    inline void _cascade_all(){
+        for(std::size_t level = 1; level < n_levels; ++level){
+            // lower level index wrapped ?
+            if(((_current >> (slot_bits * (level -1))) & (n_slots -1)) != 0){
+                return;
+            }
+
+            const std::size_t slot = static_cast<std::size_t>((_current >> (slot_bits * level)) & (n_slots -1));
+            timer_node & head = _head(level, slot);
+
+            timer_node* node = head.next;
+            head.prev = head.next = &head;
+
+            while(node != &head){
+                timer_node* next = node->next;
+                _level_size[level] -= 1;
+                node->level = -1;
+                _place(node, true);
+                node = next;
+            }
+        }
+    }
+
+    inline void _expire_slot(std::vector<timer_node*> & expired){
+        timer_node & head = _head(0, static_cast<std::size_t>(_current & (n_slots -1)));
+
+        timer_node* node = head.next;
+        while(node != &head){
+            timer_node* next = node->next;
+            if(node->expiry <= _current){
+                _unlink(node);
+                _size -= 1;
+                expired.push_back(node);
+            }
+            node = next;
+        }
+    }
+
+    tick_type _current;
+    std::size_t _size;
+    std::vector<timer_node> _slots;
+    std::size_t _level_size[n_levels];
+};
+
+
+} // details
+
+
+} // hadoken
+
+#endif // HADOKEN_TIMING_WHEEL_HPP
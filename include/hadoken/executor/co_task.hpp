@@ -0,0 +1,548 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef HADOKEN_CO_TASK_HPP
+#define HADOKEN_CO_TASK_HPP
+
+// C++20 coroutines support, the content of this header is empty otherwise
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define HADOKEN_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifdef HADOKEN_HAS_COROUTINES
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <hadoken/executor/thread_pool_executor.hpp>
+#include <hadoken/executor/scheduled_executor.hpp>
+
+
+namespace hadoken{
+
+
+template<typename T>
+class co_task;
+
+
+namespace details{
+
+
+// resume the awaiting coroutine, if any, when a co_task completes
+struct co_task_final_awaiter{
+    bool await_ready() const noexcept{
+        return false;
+    }
+
+    template<typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept{
+        std::coroutine_handle<> next = handle.promise().continuation;
+        return (next) ? (next) : (std::noop_coroutine());
+    }
+
+    void await_resume() const noexcept{}
+};
+
+
+struct co_task_promise_base{
+    co_task_promise_base() : continuation(), exception() {}
+
+    // lazy start: the task runs when awaited
+    std::suspend_always initial_suspend() const noexcept{
+        return {};
+    }
+
+    co_task_final_awaiter final_suspend() const noexcept{
+        return {};
+    }
+
+    void unhandled_exception() noexcept{
+        exception = std::current_exception();
+    }
+
+    void rethrow_if_exception(){
+        if(exception){
+            std::rethrow_exception(exception);
+        }
+    }
+
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+};
+
+
+template<typename T>
+struct co_task_promise : public co_task_promise_base{
+    co_task<T> get_return_object() noexcept;
+
+    template<typename U>
+    void return_value(U && val){
+        value.emplace(std::forward<U>(val));
+    }
+
+    T result(){
+        rethrow_if_exception();
+        return std::move(*value);
+    }
+
+    std::optional<T> value;
+};
+
+
+template<>
+struct co_task_promise<void> : public co_task_promise_base{
+    co_task<void> get_return_object() noexcept;
+
+    void return_void() const noexcept{}
+
+    void result(){
+        rethrow_if_exception();
+    }
+};
+
+
+// fire and forget coroutine, destroys itself at completion
+struct detached_coroutine{
+    struct promise_type{
+        detached_coroutine get_return_object() const noexcept{
+            return {};
+        }
+
+        std::suspend_never initial_suspend() const noexcept{
+            return {};
+        }
+
+        std::suspend_never final_suspend() const noexcept{
+            return {};
+        }
+
+        void return_void() const noexcept{}
+
+        void unhandled_exception() const noexcept{
+            std::terminate();
+        }
+    };
+};
+
+
+} // details
+
+
+///
+/// \brief lazy coroutine task
+///
+/// a co_task starts when it is awaited ( co_await ) and resumes its awaiter
+/// when it completes, on the thread that completed it.
+/// A suspended co_task does not occupy any thread: use hadoken::schedule, hadoken::sleep_for,
+/// hadoken::async_latch or hadoken::async_invoke to resume it on an executor later.
+///
+/// The result, or the exception escaping the coroutine body, is forwarded to the awaiter.
+///
+/// \code
+///   hadoken::co_task<int> compute(hadoken::thread_pool_executor & pool){
+///       co_await hadoken::schedule(pool);
+///       co_return 42;
+///   }
+///
+///   int res = hadoken::sync_wait(compute(pool));
+/// \endcode
+///
+template<typename T = void>
+class co_task{
+public:
+    typedef details::co_task_promise<T> promise_type;
+    typedef std::coroutine_handle<promise_type> handle_type;
+
+    co_task() noexcept : _handle() {}
+
+    explicit co_task(handle_type handle) noexcept : _handle(handle) {}
+
+    co_task(co_task && other) noexcept : _handle(std::exchange(other._handle, nullptr)) {}
+
+    co_task & operator=(co_task && other) noexcept{
+        if(this != &other){
+            _destroy();
+            _handle = std::exchange(other._handle, nullptr);
+        }
+        return *this;
+    }
+
+    co_task(const co_task &) = delete;
+    co_task & operator=(const co_task &) = delete;
+
+    ~co_task(){
+        _destroy();
+    }
+
+    /// true if the task refers to a coroutine
+    bool valid() const noexcept{
+        return bool(_handle);
+    }
+
+    /// true if the coroutine has completed
+    bool done() const noexcept{
+        return (!_handle || _handle.done());
+    }
+
+    auto operator co_await() const noexcept{
+        struct awaiter{
+            bool await_ready() const noexcept{
+                return (!handle || handle.done());
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept{
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume(){
+                return handle.promise().result();
+            }
+
+            handle_type handle;
+        };
+
+        return awaiter{ _handle };
+    }
+
+private:
+    void _destroy() noexcept{
+        if(_handle){
+            _handle.destroy();
+            _handle = nullptr;
+        }
+    }
+
+    handle_type _handle;
+};
+
+
+namespace details{
+
+template<typename T>
+inline co_task<T> co_task_promise<T>::get_return_object() noexcept{
+    return co_task<T>(std::coroutine_handle<co_task_promise<T> >::from_promise(*this));
+}
+
+inline co_task<void> co_task_promise<void>::get_return_object() noexcept{
+    return co_task<void>(std::coroutine_handle<co_task_promise<void> >::from_promise(*this));
+}
+
+
+template<typename T>
+inline detached_coroutine sync_wait_coroutine(co_task<T> & task, std::promise<T> res){
+    try{
+        if constexpr (std::is_void_v<T>){
+            co_await task;
+            res.set_value();
+        }else{
+            res.set_value(co_await task);
+        }
+    }catch(...){
+        res.set_exception(std::current_exception());
+    }
+}
+
+
+template<typename Executor>
+inline detached_coroutine spawn_coroutine(Executor & executor, co_task<void> task);
+
+} // details
+
+
+
+///
+/// \brief awaitable resuming the awaiting coroutine on an executor
+///
+/// the executor needs an execute( std::function<void (void)> ) member
+///
+template<typename Executor>
+class schedule_awaiter{
+public:
+    explicit schedule_awaiter(Executor & executor) noexcept : _executor(&executor) {}
+
+    bool await_ready() const noexcept{
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle){
+        _executor->execute([handle](){ handle.resume(); });
+    }
+
+    void await_resume() const noexcept{}
+
+private:
+    Executor* _executor;
+};
+
+
+///
+/// \brief co_await schedule(executor) : continue the current coroutine on the executor
+///
+template<typename Executor>
+inline schedule_awaiter<Executor> schedule(Executor & executor) noexcept{
+    return schedule_awaiter<Executor>(executor);
+}
+
+
+///
+/// \brief awaitable resuming the awaiting coroutine after a delay
+///
+/// the coroutine is suspended on the timer wheel of a scheduled_executor, and resumed
+/// on the pool of this scheduled_executor
+///
+template<typename Rep, typename Period>
+class sleep_awaiter{
+public:
+    sleep_awaiter(scheduled_executor & scheduler, const std::chrono::duration<Rep, Period> & delay) noexcept :
+        _scheduler(&scheduler), _delay(delay) {}
+
+    bool await_ready() const noexcept{
+        return (_delay <= std::chrono::duration<Rep, Period>::zero());
+    }
+
+    void await_suspend(std::coroutine_handle<> handle){
+        _scheduler->execute_after(_delay, [handle](){ handle.resume(); });
+    }
+
+    void await_resume() const noexcept{}
+
+private:
+    scheduled_executor* _scheduler;
+    std::chrono::duration<Rep, Period> _delay;
+};
+
+
+///
+/// \brief co_await sleep_for(scheduler, delay) : suspend the current coroutine for delay
+///
+template<typename Rep, typename Period>
+inline sleep_awaiter<Rep, Period> sleep_for(scheduled_executor & scheduler, const std::chrono::duration<Rep, Period> & delay) noexcept{
+    return sleep_awaiter<Rep, Period>(scheduler, delay);
+}
+
+
+///
+/// \brief awaitable executing a function on an executor, and resuming the
+/// awaiting coroutine when the function returns
+///
+template<typename Executor, typename Function>
+class invoke_awaiter{
+public:
+    typedef std::invoke_result_t<Function> result_type;
+
+    invoke_awaiter(Executor & executor, Function && fun) : _executor(&executor), _fun(std::move(fun)), _result(), _exception() {}
+
+    bool await_ready() const noexcept{
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle){
+        // the awaiter lives in the suspended coroutine frame until resumption
+        _executor->execute([this, handle](){
+            try{
+                if constexpr (std::is_void_v<result_type>){
+                    _fun();
+                }else{
+                    _result.emplace(_fun());
+                }
+            }catch(...){
+                _exception = std::current_exception();
+            }
+            handle.resume();
+        });
+    }
+
+    result_type await_resume(){
+        if(_exception){
+            std::rethrow_exception(_exception);
+        }
+        if constexpr (!std::is_void_v<result_type>){
+            return std::move(*_result);
+        }
+    }
+
+private:
+    typedef std::conditional_t<std::is_void_v<result_type>, bool, result_type> storage_type;
+
+    Executor* _executor;
+    Function _fun;
+    std::optional<storage_type> _result;
+    std::exception_ptr _exception;
+};
+
+
+///
+/// \brief co_await async_invoke(executor, fun) : execute fun() on the executor and return its result
+///
+/// typically used to wait for a blocking parallel algorithm without blocking the current coroutine
+///
+/// \code
+///     co_await hadoken::async_invoke(pool, [&](){
+///         hadoken::parallel::for_each(hadoken::parallel::par, v.begin(), v.end(), fun);
+///     });
+/// \endcode
+///
+template<typename Executor, typename Function>
+inline invoke_awaiter<Executor, std::decay_t<Function> > async_invoke(Executor & executor, Function && fun){
+    return invoke_awaiter<Executor, std::decay_t<Function> >(executor, std::decay_t<Function>(std::forward<Function>(fun)));
+}
+
+
+
+///
+/// \brief latch for coroutines
+///
+/// same semantic than hadoken::thread::latch, but waiting coroutines are suspended
+/// instead of blocking their thread, and are resumed on an executor when the
+/// counter reaches 0
+///
+template<typename Executor = thread_pool_executor>
+class async_latch{
+public:
+    ///
+    /// \brief construct a new latch
+    /// \param value : the initial value of the counter, must be non negative
+    /// \param executor : executor resuming the waiting coroutines
+    ///
+    async_latch(std::ptrdiff_t value, Executor & executor) :
+        _counter(value),
+        _executor(&executor),
+        _lock(),
+        _waiters(){
+    }
+
+    async_latch(const async_latch &) = delete;
+    async_latch & operator=(const async_latch &) = delete;
+
+    /// decrement the counter, resume the waiting coroutines if it reaches 0
+    void count_down(std::ptrdiff_t n = 1){
+        std::vector<std::coroutine_handle<> > ready;
+        {
+            std::lock_guard<std::mutex> l(_lock);
+            const std::ptrdiff_t val = _counter.load(std::memory_order_relaxed) - n;
+            _counter.store(val, std::memory_order_release);
+            if(val <= 0){
+                ready.swap(_waiters);
+            }
+        }
+
+        for(std::coroutine_handle<> & handle : ready){
+            _executor->execute([handle](){ handle.resume(); });
+        }
+    }
+
+    /// true if the counter reached 0
+    bool try_wait() const noexcept{
+        return (_counter.load(std::memory_order_acquire) <= 0);
+    }
+
+    /// co_await latch.wait() : suspend the current coroutine until the counter reaches 0
+    auto wait() noexcept{
+        struct awaiter{
+            bool await_ready() const noexcept{
+                return latch->try_wait();
+            }
+
+            bool await_suspend(std::coroutine_handle<> handle){
+                std::lock_guard<std::mutex> l(latch->_lock);
+                if(latch->try_wait()){
+                    return false;
+                }
+                latch->_waiters.push_back(handle);
+                return true;
+            }
+
+            void await_resume() const noexcept{}
+
+            async_latch* latch;
+        };
+
+        return awaiter{ this };
+    }
+
+private:
+    std::atomic<std::ptrdiff_t> _counter;
+    Executor* _executor;
+    std::mutex _lock;
+    std::vector<std::coroutine_handle<> > _waiters;
+};
+
+
+
+///
+/// \brief execute a task on an executor without waiting for it
+///
+/// the task is owned by the executor until its completion,
+/// an exception escaping the task calls std::terminate, like for std::thread
+///
+template<typename Executor>
+inline void spawn(Executor & executor, co_task<void> task){
+    details::spawn_coroutine(executor, std::move(task));
+}
+
+
+///
+/// \brief block the calling thread until the completion of a task, and return its result
+///
+/// the task starts on the calling thread, up to its first suspension point
+///
+template<typename T>
+inline T sync_wait(co_task<T> task){
+    std::promise<T> res;
+    std::future<T> future = res.get_future();
+    details::sync_wait_coroutine(task, std::move(res));
+    return future.get();
+}
+
+
+namespace details{
+
+template<typename Executor>
+inline detached_coroutine spawn_coroutine(Executor & executor, co_task<void> task){
+    co_await schedule(executor);
+    co_await task;
+}
+
+} // details
+
+
+} // hadoken
+
+#endif // HADOKEN_HAS_COROUTINES
+
+#endif // HADOKEN_CO_TASK_HPP
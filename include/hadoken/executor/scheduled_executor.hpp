@@ -0,0 +1,324 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef HADOKEN_SCHEDULED_EXECUTOR_HPP
+#define HADOKEN_SCHEDULED_EXECUTOR_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <hadoken/executor/bits/timing_wheel.hpp>
+#include <hadoken/executor/system_executor.hpp>
+#include <hadoken/executor/thread_pool_executor.hpp>
+
+
+namespace hadoken{
+
+
+namespace details{
+
+struct scheduled_timer : public timer_node{
+    inline scheduled_timer(std::function<void (void)> && fun, tick_type timer_period) :
+        timer_node(),
+        task(std::make_shared<std::function<void (void)> >(std::move(fun))),
+        period(timer_period),
+        cancelled(false),
+        self(){}
+
+    // shared with the pool tasks of periodic timers
+    std::shared_ptr<std::function<void (void)> > task;
+    tick_type period;
+    bool cancelled;
+
+    // the wheel owns the timer while it is linked
+    std::shared_ptr<scheduled_timer> self;
+};
+
+} // details
+
+
+///
+/// \brief handle of a task scheduled on a scheduled_executor, used for cancellation
+///
+class timer_handle{
+public:
+    timer_handle() : _timer() {}
+
+    /// true if the handle refers to a scheduled task
+    bool valid() const noexcept{
+        return bool(_timer);
+    }
+
+private:
+    friend class scheduled_executor;
+
+    explicit timer_handle(const std::shared_ptr<details::scheduled_timer> & timer) : _timer(timer) {}
+
+    std::shared_ptr<details::scheduled_timer> _timer;
+};
+
+
+///
+/// \brief Executor for delayed and periodic tasks
+///
+/// timers are stored in a hierarchical timing wheel ( O(1) insertion and cancellation )
+/// driven by a single timer thread. Expired tasks are executed on a thread_pool_executor,
+/// the timer thread never runs user code.
+///
+/// the resolution of the timers is the tick of the wheel ( 1ms by default ),
+/// a task never runs before its deadline
+///
+class scheduled_executor{
+public:
+    typedef std::chrono::steady_clock clock_type;
+    typedef clock_type::time_point time_point;
+    typedef clock_type::duration duration;
+
+    ///
+    /// \brief scheduled executor using the system executor thread pool
+    ///
+    explicit scheduled_executor(duration resolution = std::chrono::milliseconds(1)) :
+        scheduled_executor(system_executor().pool(), resolution){}
+
+    ///
+    /// \brief scheduled executor using the given thread pool
+    /// \param pool : pool executing the expired tasks
+    /// \param resolution : duration of a tick of the timing wheel
+    ///
+    explicit scheduled_executor(thread_pool_executor & pool, duration resolution = std::chrono::milliseconds(1)) :
+        _pool(pool),
+        _resolution(std::max<duration>(resolution, duration(1))),
+        _start(clock_type::now()),
+        _mut(),
+        _cond(),
+        _wheel(0),
+        _next_wakeup(0),
+        _stopped(false),
+        _timer_thread(){
+        std::thread runner([this](){ _run(); });
+        _timer_thread.swap(runner);
+    }
+
+    ///
+    /// \brief stop the timer thread, pending timers are discarded
+    ///
+    ~scheduled_executor(){
+        {
+            std::lock_guard<std::mutex> l(_mut);
+            _stopped = true;
+        }
+        _cond.notify_all();
+        _timer_thread.join();
+
+        std::vector<details::timer_node*> remaining;
+        _wheel.clear(remaining);
+        for(details::timer_node* node : remaining){
+            static_cast<details::scheduled_timer*>(node)->self.reset();
+        }
+    }
+
+    ///
+    /// \brief execute a task immediately on the pool
+    ///
+    void execute(std::function<void (void)> task){
+        _pool.execute(std::move(task));
+    }
+
+    ///
+    /// \brief execute a task after a delay
+    ///
+    template<typename Rep, typename Period>
+    timer_handle execute_after(const std::chrono::duration<Rep, Period> & delay, std::function<void (void)> task){
+        return execute_at(clock_type::now() + std::chrono::duration_cast<duration>(delay), std::move(task));
+    }
+
+    ///
+    /// \brief execute a task at a given time point
+    ///
+    timer_handle execute_at(const time_point & deadline, std::function<void (void)> task){
+        return _schedule(_to_tick_ceil(deadline), 0, std::move(task));
+    }
+
+    ///
+    /// \brief execute a task periodically, the first execution happens after one period
+    ///
+    /// the schedule has a fixed rate, if the task takes longer than the period,
+    /// several executions can run concurrently on the pool
+    ///
+    template<typename Rep, typename Period>
+    timer_handle execute_every(const std::chrono::duration<Rep, Period> & period, std::function<void (void)> task){
+        const duration d = std::chrono::duration_cast<duration>(period);
+        const details::timer_node::tick_type period_ticks = std::max<details::timer_node::tick_type>(
+                    static_cast<details::timer_node::tick_type>((d + _resolution - duration(1)) / _resolution), 1);
+        return _schedule(_to_tick_ceil(clock_type::now() + d), period_ticks, std::move(task));
+    }
+
+    ///
+    /// \brief cancel a scheduled task
+    /// \return true if the task was pending and has been cancelled,
+    ///         false if it already ran or was already cancelled
+    ///
+    bool cancel(const timer_handle & handle){
+        if(handle.valid() == false){
+            return false;
+        }
+
+        std::shared_ptr<details::scheduled_timer> keep_alive;
+        std::lock_guard<std::mutex> l(_mut);
+        details::scheduled_timer* timer = handle._timer.get();
+        if(timer->cancelled){
+            return false;
+        }
+        timer->cancelled = true;
+
+        if(timer->linked() == false){
+            return false;
+        }
+
+        _wheel.remove(timer);
+        keep_alive.swap(timer->self);
+        return true;
+    }
+
+    ///
+    /// \brief number of pending timers
+    ///
+    std::size_t pending() const{
+        std::lock_guard<std::mutex> l(_mut);
+        return _wheel.size();
+    }
+
+private:
+    typedef details::timer_node::tick_type tick_type;
+
+    scheduled_executor(const scheduled_executor &) = delete;
+    scheduled_executor & operator=(const scheduled_executor &) = delete;
+
+    inline tick_type _to_tick_ceil(const time_point & tp) const{
+        if(tp <= _start){
+            return 0;
+        }
+        return static_cast<tick_type>(((tp - _start) + _resolution - duration(1)) / _resolution);
+    }
+
+    inline tick_type _to_tick_floor(const time_point & tp) const{
+        if(tp <= _start){
+            return 0;
+        }
+        return static_cast<tick_type>((tp - _start) / _resolution);
+    }
+
+    inline timer_handle _schedule(tick_type expiry, tick_type period, std::function<void (void)> && task){
+        std::shared_ptr<details::scheduled_timer> timer = std::make_shared<details::scheduled_timer>(std::move(task), period);
+        timer->expiry = expiry;
+
+        bool wakeup = false;
+        {
+            std::lock_guard<std::mutex> l(_mut);
+            timer->self = timer;
+            _wheel.insert(timer.get());
+            if(expiry < _next_wakeup){
+                _next_wakeup = expiry;
+                wakeup = true;
+            }
+        }
+
+        if(wakeup){
+            _cond.notify_one();
+        }
+        return timer_handle(timer);
+    }
+
+    inline void _run(){
+        std::vector<details::timer_node*> expired;
+        std::vector<std::shared_ptr<std::function<void (void)> > > ready;
+
+        std::unique_lock<std::mutex> l(_mut);
+
+        while(_stopped == false){
+            _wheel.advance(_to_tick_floor(clock_type::now()), expired);
+
+            for(details::timer_node* node : expired){
+                details::scheduled_timer* timer = static_cast<details::scheduled_timer*>(node);
+                ready.push_back(timer->task);
+
+                if(timer->period > 0 && timer->cancelled == false){
+                    timer->expiry += timer->period;
+                    _wheel.insert(timer);
+                }else{
+                    timer->cancelled = true;
+                    timer->self.reset();
+                }
+            }
+            expired.clear();
+
+            if(ready.empty() == false){
+                l.unlock();
+                for(auto & task : ready){
+                    _pool.execute([task](){ (*task)(); });
+                }
+                ready.clear();
+                l.lock();
+                continue;
+            }
+
+            _next_wakeup = _wheel.next_event();
+            if(_next_wakeup == std::numeric_limits<tick_type>::max()){
+                _cond.wait(l);
+            }else{
+                _cond.wait_until(l, _start + _resolution * _next_wakeup);
+            }
+        }
+    }
+
+    thread_pool_executor & _pool;
+    const duration _resolution;
+    const time_point _start;
+
+    mutable std::mutex _mut;
+    std::condition_variable _cond;
+    details::timing_wheel _wheel;
+    tick_type _next_wakeup;
+    bool _stopped;
+
+    std::thread _timer_thread;
+};
+
+
+}
+
+
+#endif // HADOKEN_SCHEDULED_EXECUTOR_HPP
@@ -0,0 +1,271 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef HADOKEN_STRAND_HPP
+#define HADOKEN_STRAND_HPP
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <thread>
+
+#include <hadoken/executor/system_executor.hpp>
+
+
+namespace hadoken{
+
+
+namespace details{
+
+// intrusive multi-producer / single-consumer lock-free queue ( D. Vyukov )
+// producers never block, the consumer can observe a transient empty
+// state while a producer is between its two steps
+class strand_queue{
+public:
+    struct node{
+        inline node() : next(nullptr), task() {}
+        inline explicit node(std::function<void (void)> && fun) : next(nullptr), task(std::move(fun)) {}
+
+        std::atomic<node*> next;
+        std::function<void (void)> task;
+    };
+
+    inline strand_queue() : _stub(), _head(&_stub), _tail(&_stub) {}
+
+    inline ~strand_queue(){
+        node* n;
+        while( (n = pop()) != nullptr){
+            delete n;
+        }
+    }
+
+    inline void push(node* n){
+        n->next.store(nullptr, std::memory_order_relaxed);
+        node* prev = _tail.exchange(n, std::memory_order_acq_rel);
+        prev->next.store(n, std::memory_order_release);
+    }
+
+    // single consumer only
+    inline node* pop(){
+        node* head = _head;
+        node* next = head->next.load(std::memory_order_acquire);
+
+        if(head == &_stub){
+            if(next == nullptr){
+                return nullptr;
+            }
+            _head = next;
+            head = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+
+        if(next != nullptr){
+            _head = next;
+            return head;
+        }
+
+        if(head != _tail.load(std::memory_order_acquire)){
+            // producer in progress
+            return nullptr;
+        }
+
+        push(&_stub);
+
+        next = head->next.load(std::memory_order_acquire);
+        if(next != nullptr){
+            _head = next;
+            return head;
+        }
+        return nullptr;
+    }
+
+private:
+    strand_queue(const strand_queue &) = delete;
+    strand_queue & operator=(const strand_queue &) = delete;
+
+    node _stub;
+    node* _head;
+    std::atomic<node*> _tail;
+};
+
+
+template<typename Executor>
+class strand_state : public std::enable_shared_from_this<strand_state<Executor> >{
+public:
+    // maximum number of tasks executed in a row before yielding the worker
+    static constexpr std::size_t batch_size = 64;
+
+    typedef std::function<void (std::exception_ptr)> error_handler;
+
+    inline strand_state(Executor & exec, error_handler on_error) :
+        _executor(exec), _queue(), _pending(0), _on_error(std::move(on_error)) {}
+
+    inline void post(std::function<void (void)> && task){
+        _queue.push(new strand_queue::node(std::move(task)));
+
+        // first pending task: the strand is idle, schedule it
+        if(_pending.fetch_add(1, std::memory_order_acq_rel) == 0){
+            _schedule();
+        }
+    }
+
+    inline bool running_in_this_thread() const noexcept{
+        return (current_strand() == this);
+    }
+
+private:
+    static inline const void* & current_strand(){
+        static thread_local const void* strand = nullptr;
+        return strand;
+    }
+
+    inline void _schedule(){
+        std::shared_ptr<strand_state> self(this->shared_from_this());
+        _executor.execute([self](){
+            self->_run();
+        });
+    }
+
+    inline void _run(){
+        const void* previous = current_strand();
+        current_strand() = this;
+
+        for(std::size_t n = 0; n < batch_size; ++n){
+            strand_queue::node* task_node;
+            while( (task_node = _queue.pop()) == nullptr){
+                // a producer has incremented the counter but not linked its node yet
+                std::this_thread::yield();
+            }
+
+            std::exception_ptr error;
+            try{
+                task_node->task();
+            }catch(...){
+                error = std::current_exception();
+            }
+            delete task_node;
+
+            if(error){
+                _handle_error(error, previous);
+            }
+
+            if(_pending.fetch_sub(1, std::memory_order_acq_rel) == 1){
+                current_strand() = previous;
+                return;
+            }
+        }
+
+        current_strand() = previous;
+
+        // still some work: give the worker back to the pool and re-schedule
+        _schedule();
+    }
+
+    // report the error of a task to the handler, the strand continues.
+    // Without handler, or if it throws, the error is rethrown to the executor
+    // once the strand is consistent and re-scheduled for the next tasks
+    inline void _handle_error(std::exception_ptr error, const void* previous){
+        if(_on_error){
+            try{
+                _on_error(error);
+                return;
+            }catch(...){
+                error = std::current_exception();
+            }
+        }
+
+        current_strand() = previous;
+        if(_pending.fetch_sub(1, std::memory_order_acq_rel) != 1){
+            _schedule();
+        }
+        std::rethrow_exception(error);
+    }
+
+    Executor & _executor;
+    strand_queue _queue;
+    std::atomic<std::size_t> _pending;
+    error_handler _on_error;
+};
+
+} // details
+
+
+///
+/// \brief strand, serializing executor adapter
+///
+/// tasks executed through a strand run one at a time, in FIFO order,
+/// on the underlying executor. No lock is held while a task runs:
+/// the strand is scheduled as a single task on the executor while it has
+/// pending work and occupies at most one worker at a time.
+///
+/// A strand is only a small queue, many strands can share the same thread pool.
+/// Tasks already posted keep the strand state alive after its destruction.
+///
+/// An exception thrown by a task is passed to the error handler of the strand,
+/// which then continues with the next task. Without handler it is rethrown to
+/// the executor: on a thread_pool_executor, this terminates the program
+/// like any task throwing on the pool.
+///
+template<typename Executor = system_executor>
+class strand{
+public:
+    typedef Executor executor_type;
+    typedef std::function<void (std::exception_ptr)> error_handler;
+
+    ///
+    /// \brief create a strand on top of an executor
+    /// \param exec : underlying executor
+    /// \param on_error : called, on the strand, with the exception thrown by a task
+    ///
+    explicit strand(Executor & exec, error_handler on_error = error_handler()) :
+        _state(std::make_shared<details::strand_state<Executor> >(exec, std::move(on_error))){}
+
+    ///
+    /// \brief execute a task, after all the tasks previously posted to this strand
+    ///
+    void execute(std::function<void (void)> task){
+        _state->post(std::move(task));
+    }
+
+    ///
+    /// \brief return true if the calling thread is currently executing a task of this strand
+    ///
+    bool running_in_this_thread() const noexcept{
+        return _state->running_in_this_thread();
+    }
+
+private:
+    std::shared_ptr<details::strand_state<Executor> > _state;
+};
+
+
+}
+
+
+#endif // HADOKEN_STRAND_HPP
@@ -49,8 +49,18 @@ public:
 
     }
 
-    void execute(std::function<void (void)> task){
-        singleton<thread_pool_executor>::instance().execute(std::move(task));
+    void execute(std::function<void (void)> task, task_priority priority = task_priority::normal){
+        singleton<thread_pool_executor>::instance().execute(std::move(task), priority);
+    }
+
+    /// execute a task on a specific worker of the system pool
+    void execute_on(std::size_t worker_id, std::function<void (void)> task, task_priority priority = task_priority::normal){
+        singleton<thread_pool_executor>::instance().execute_on(worker_id, std::move(task), priority);
+    }
+
+    /// underlying thread pool, exposes the worker to cpu mapping
+    thread_pool_executor & pool(){
+        return singleton<thread_pool_executor>::instance();
     }
 
 
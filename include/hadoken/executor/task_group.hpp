@@ -0,0 +1,225 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef HADOKEN_TASK_GROUP_HPP
+#define HADOKEN_TASK_GROUP_HPP
+
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <hadoken/executor/system_executor.hpp>
+#include <hadoken/executor/thread_pool_executor.hpp>
+#include <hadoken/thread/spinlock.hpp>
+
+
+namespace hadoken{
+
+
+namespace details{
+
+// shared state of a task group
+// owned by the group and by the pool tasks that reference it
+class task_group_state{
+public:
+    inline task_group_state() :
+        _lock(),
+        _pending(),
+        _unfinished(0),
+        _exception_lock(),
+        _exception(){}
+
+    inline void push(std::function<void (void)> && task){
+        std::lock_guard<thread::spin_lock> l(_lock);
+        _pending.emplace_back(std::move(task));
+        // counted only once queued: a failed allocation leaves no phantom task to wait for.
+        // Under the lock, before any thread can take the task and count it down
+        _unfinished.fetch_add(1);
+    }
+
+    // executed by the pool: take the oldest task, generally the biggest one
+    inline bool run_oldest(){
+        std::function<void (void)> task;
+        {
+            std::lock_guard<thread::spin_lock> l(_lock);
+            if(_pending.empty()){
+                return false;
+            }
+            task = std::move(_pending.front());
+            _pending.pop_front();
+        }
+        _execute(task);
+        return true;
+    }
+
+    // executed by the waiting thread: take the newest task, depth-first
+    inline bool run_newest(){
+        std::function<void (void)> task;
+        {
+            std::lock_guard<thread::spin_lock> l(_lock);
+            if(_pending.empty()){
+                return false;
+            }
+            task = std::move(_pending.back());
+            _pending.pop_back();
+        }
+        _execute(task);
+        return true;
+    }
+
+    inline bool finished() const{
+        return (_unfinished.load() == 0);
+    }
+
+    inline void rethrow_exception(){
+        std::exception_ptr e;
+        {
+            std::lock_guard<thread::spin_lock> l(_exception_lock);
+            std::swap(e, _exception);
+        }
+        if(e){
+            std::rethrow_exception(e);
+        }
+    }
+
+private:
+    inline void _execute(std::function<void (void)> & task){
+        try{
+            task();
+        }catch(...){
+            std::lock_guard<thread::spin_lock> l(_exception_lock);
+            if(!_exception){
+                _exception = std::current_exception();
+            }
+        }
+        _unfinished.fetch_sub(1);
+    }
+
+    thread::spin_lock _lock;
+    std::deque<std::function<void (void)> > _pending;
+    std::atomic<std::size_t> _unfinished;
+
+    thread::spin_lock _exception_lock;
+    std::exception_ptr _exception;
+};
+
+} // details
+
+
+///
+/// \brief fork-join group of tasks executed on a thread_pool_executor
+///
+/// run() submits a task to the group, wait() returns when all the tasks
+/// of the group are completed.
+///
+/// wait() never blocks a thread: the waiting thread executes the pending tasks
+/// of the group, then the pending tasks of the pool, until the group is done.
+/// task_group can consequently be nested inside pool tasks
+/// ( recursive divide-and-conquer ) without deadlock and without spawning threads.
+///
+/// The first exception raised by a task is re-thrown by wait()
+///
+class task_group{
+public:
+    ///
+    /// \brief task group executed on the system executor thread pool
+    ///
+    task_group() :
+        _pool(system_executor().pool()),
+        _state(std::make_shared<details::task_group_state>()){}
+
+    ///
+    /// \brief task group executed on the given thread pool
+    ///
+    explicit task_group(thread_pool_executor & pool) :
+        _pool(pool),
+        _state(std::make_shared<details::task_group_state>()){}
+
+    ///
+    /// \brief wait for all remaining tasks, exceptions are ignored
+    ///
+    ~task_group(){
+        try{
+            wait();
+        }catch(...){
+            // never throw from destructor
+        }
+    }
+
+    ///
+    /// \brief submit a task to the group
+    ///
+    template<typename Function>
+    void run(Function && fun){
+        _state->push(std::function<void (void)>(std::forward<Function>(fun)));
+
+        std::shared_ptr<details::task_group_state> state(_state);
+        _pool.execute([state](){
+            state->run_oldest();
+        });
+    }
+
+    ///
+    /// \brief wait for the completion of all the tasks of the group,
+    ///        executing pending tasks meanwhile
+    ///
+    void wait(){
+        while(_state->finished() == false){
+            if(_state->run_newest()){
+                continue;
+            }
+
+            if(_pool.run_pending_task()){
+                continue;
+            }
+
+#ifndef HADOKEN_SPIN_NO_YIELD
+            std::this_thread::yield();
+#endif
+        }
+
+        _state->rethrow_exception();
+    }
+
+private:
+    task_group(const task_group &) = delete;
+    task_group & operator=(const task_group &) = delete;
+
+    thread_pool_executor & _pool;
+    std::shared_ptr<details::task_group_state> _state;
+};
+
+
+}
+
+
+#endif // HADOKEN_TASK_GROUP_HPP
@@ -37,22 +37,120 @@
 #include <mutex>
 #include <future>
 #include <functional>
+#include <memory>
+#include <deque>
+#include <algorithm>
+
+#include <hadoken/thread/topology.hpp>
+#include <hadoken/executor/bits/executor_statistics.hpp>
 
 
 namespace hadoken{
 
 
+///
+/// \brief priority of a task submitted to a thread_pool_executor
+///
+enum class task_priority : int{
+    low = 0,
+    normal = 1,
+    high = 2
+};
+
+
 namespace details{
 
+typedef std::function<void (void)> pool_task;
+
+constexpr std::size_t n_task_priorities = 3;
+
+// queued task, with its enqueue time when statistics are enabled
+struct queued_task{
+    inline queued_task() : task(), enqueued() {}
+
+    inline explicit queued_task(pool_task && t) : task(std::move(t)), enqueued(make_task_timestamp()) {}
+
+    pool_task task;
+    task_timestamp enqueued;
+};
+
+// number of times a non-empty lower priority lane can be skipped
+// before being served, prevent starvation of bulk tasks
+constexpr std::size_t lane_starvation_limit = 8;
+
+// identity of the pool worker running on the current thread
+struct worker_identity{
+    const void* pool;
+    std::size_t id;
+};
+
+inline worker_identity & current_worker_identity(){
+    static thread_local worker_identity identity = { nullptr, 0 };
+    return identity;
+}
+
+
+// FIFO lane shared by all the workers of a pool
+// high priority tasks go there to be picked by the first available worker
+class shared_task_lane{
+public:
+    inline shared_task_lane() : mut(), queue(), queue_size(0), counters() {}
+
+    inline void push(pool_task && task){
+        std::lock_guard<std::mutex> l(mut);
+        queue.emplace_back(std::move(task));
+        queue_size.fetch_add(1);
+        counters.on_queue_depth(queue.size());
+    }
+
+    inline bool try_pop(queued_task & task){
+        if(queue_size.load(std::memory_order_relaxed) == 0){
+            return false;
+        }
+        std::lock_guard<std::mutex> l(mut);
+        if(queue.empty()){
+            return false;
+        }
+        task = std::move(queue.front());
+        queue.pop_front();
+        queue_size.fetch_sub(1);
+        return true;
+    }
+
+    inline bool empty() const{
+        return (queue_size.load() == 0);
+    }
+
+    inline std::uint64_t queue_depth_high_water() const{
+        return counters.queue_depth_high_water();
+    }
+
+private:
+    shared_task_lane(const shared_task_lane &) = delete;
+
+    std::mutex mut;
+    std::deque<queued_task> queue;
+    std::atomic<std::size_t> queue_size;
+    queue_counters counters;
+};
+
+
 class worker_thread{
 public:
-    inline worker_thread() :
+    inline worker_thread(const void* pool = nullptr, std::size_t id = 0, int cpu = -1, shared_task_lane* shared = nullptr) :
+                    pool_ptr(pool),
+                    worker_id(id),
+                    cpu_id(cpu),
+                    shared_lane(shared),
                     exec(),
                     event_cond(),
                     mut(),
-                    queue(),
+                    lanes(),
+                    skipped(),
+                    counters(),
                     finished(false) {
-        queue.reserve(16);
+        std::fill(skipped, skipped + n_task_priorities, 0);
+
         std::thread runner([this]() { run();});
 
         exec.swap(runner);
@@ -68,53 +166,153 @@ public:
 
 
     inline void run(){
+        if(cpu_id >= 0){
+            thread::pin_current_thread(cpu_id);
+        }
+        current_worker_identity().pool = pool_ptr;
+        current_worker_identity().id = worker_id;
+
+        task_timestamp idle_start = make_task_timestamp();
+
         while(!finished){
-            std::function<void (void)> task;
+            queued_task task;
+
+            if(pop(task)){
+                const task_timestamp start = make_task_timestamp();
+                counters.on_idle(idle_start, start);
+                counters.on_task_start(task.enqueued, start, false);
 
-            task = pop();
+                task.task();
 
-            if(task){
-                task();
+                idle_start = make_task_timestamp();
+                counters.on_busy(start, idle_start);
             }
 
         }
 
     }
 
-    inline std::function<void (void)> pop(){
-        std::function<void (void)> ret;
+    inline bool pop(queued_task & ret){
+        if(try_pop(ret)){
+            return true;
+        }
+
+        {
+            std::unique_lock<std::mutex> l(mut);
+            if(_local_empty()){
+                event_cond.wait_for(l, std::chrono::microseconds(10));
+            }
+        }
+
+        return try_pop(ret);
+    }
+
+    // non blocking pop, used by idle threads helping the pool
+    //
+    // serve the highest priority first, except if a non empty lower priority lane
+    // has been skipped lane_starvation_limit times in a row
+    inline bool try_pop(queued_task & task){
         std::unique_lock<std::mutex> l(mut);
 
-        if(queue.size() > 0){
-            ret = std::move(queue.back());
-            queue.pop_back();
-        }else{
-            event_cond.wait_for(l, std::chrono::microseconds(10));
-            if(queue.size() > 0){
-                ret = std::move(queue.back());
-                queue.pop_back();
+        int selected = -1;
+
+        for(int p = int(task_priority::high) -1; p >= int(task_priority::low); --p){
+            if(lanes[p].empty() == false && skipped[p] >= lane_starvation_limit){
+                selected = p;
+                break;
+            }
+        }
+
+        if(selected < 0){
+            for(int p = int(task_priority::high); p >= int(task_priority::low); --p){
+                if(lanes[p].empty() == false){
+                    selected = p;
+                    break;
+                }
+
+                if(p == int(task_priority::high) && shared_lane != nullptr && shared_lane->try_pop(task)){
+                    _update_skipped(p);
+                    return true;
+                }
             }
         }
-        return ret;
 
+        if(selected < 0){
+            return false;
+        }
+
+        task = std::move(lanes[selected].front());
+        lanes[selected].pop_front();
+        _update_skipped(selected);
+        return true;
     }
 
-    inline void push(std::function<void (void)> && task){
+    inline void push(pool_task && task, task_priority priority = task_priority::normal){
         {
             std::unique_lock<std::mutex> l(mut);
-            queue.emplace_back(std::move(task));
+            lanes[int(priority)].emplace_back(std::move(task));
+            if(executor_statistics_enabled){
+                counters.on_queue_depth(_local_size());
+            }
         }
         event_cond.notify_one();
     }
 
+    inline void notify(){
+        event_cond.notify_one();
+    }
+
+    inline worker_counters & statistics(){
+        return counters;
+    }
+
+    inline const worker_counters & statistics() const{
+        return counters;
+    }
+
 private:
     worker_thread(const worker_thread &) = delete;
 
+    inline bool _local_empty() const{
+        for(std::size_t p = 0; p < n_task_priorities; ++p){
+            if(lanes[p].empty() == false){
+                return false;
+            }
+        }
+        return (shared_lane == nullptr || shared_lane->empty());
+    }
+
+    inline std::size_t _local_size() const{
+        std::size_t res = 0;
+        for(std::size_t p = 0; p < n_task_priorities; ++p){
+            res += lanes[p].size();
+        }
+        return res;
+    }
+
+    inline void _update_skipped(int selected){
+        for(int p = int(task_priority::low); p < int(task_priority::high); ++p){
+            if(p == selected || lanes[p].empty()){
+                skipped[p] = 0;
+            }else if(p < selected){
+                skipped[p] += 1;
+            }
+        }
+    }
+
+    const void* pool_ptr;
+    std::size_t worker_id;
+    int cpu_id;
+    shared_task_lane* shared_lane;
+
     std::thread exec;
     std::condition_variable event_cond;
     std::mutex mut;
 
-    std::vector<std::function<void (void)> > queue;
+    std::deque<queued_task> lanes[n_task_priorities];
+    std::size_t skipped[n_task_priorities];
+
+    worker_counters counters;
 
     std::atomic<bool> finished;
 };
@@ -123,16 +321,49 @@ private:
 }
 
 ///
-/// \brief Executor implementation for a simple thread
+/// \brief Executor implementation for a pool of threads
+///
+/// workers can optionally be pinned to cpus, following the
+/// machine topology ( see hadoken::thread::affinity_policy ).
+/// By default, the policy is read from the HADOKEN_AFFINITY environment variable
+///
+/// tasks have a priority ( see hadoken::task_priority ), with one FIFO queue per priority.
+/// High priority tasks are queued in a lane shared by all the workers and are
+/// executed by the first available worker. Lower priority tasks are still served
+/// regularly under a continuous high priority load, they can not starve.
+///
+/// when compiled with HADOKEN_EXECUTOR_STATS defined, each worker records
+/// its activity ( see statistics() ), at the cost of two clock reads per task.
 ///
 class thread_pool_executor{
 public:
-    thread_pool_executor(std::size_t n_thread =0) :
+    ///
+    /// \brief create a thread pool
+    /// \param n_thread : number of workers, 0 for one worker per available cpu
+    /// \param policy : worker placement policy
+    ///
+    thread_pool_executor(std::size_t n_thread =0, thread::affinity_policy policy = thread::default_affinity_policy()) :
         _counter(0),
-        _executors(){
-        const std::size_t n_workers = (n_thread > 0) ? n_thread : (std::thread::hardware_concurrency());
+        _shared_lane(),
+        _executors(),
+        _placement(){
+
+        std::size_t n_workers = (n_thread > 0) ? n_thread : (std::thread::hardware_concurrency());
+
+        if(policy != thread::affinity_policy::none){
+            thread::cpu_topology topology;
+            // respect the process cpuset, do not oversubscribe the cpus allowed to us
+            if(n_thread == 0 && topology.cpus().empty() == false){
+                n_workers = topology.cpus().size();
+            }
+            _placement = topology.placement(policy, n_workers);
+        }
+
+        n_workers = std::max<std::size_t>(n_workers, 1);
+
         for(std::size_t i =0; i < n_workers; ++i){
-            _executors.emplace_back( new details::worker_thread());
+            const int cpu = (i < _placement.size()) ? (_placement[i].cpu_id) : (-1);
+            _executors.emplace_back( new details::worker_thread(this, i, cpu, &_shared_lane));
         }
     }
 
@@ -140,16 +371,122 @@ public:
 
     }
 
-    void execute(std::function<void (void)> task){
+    ///
+    /// \brief execute a task
+    /// \param task : task to execute
+    /// \param priority : priority of the task
+    ///
+    void execute(std::function<void (void)> task, task_priority priority = task_priority::normal){
         std::size_t pos = _counter.fetch_add(1);
         pos = pos % _executors.size();
-        _executors[pos]->push(std::move(task));
+
+        if(priority == task_priority::high){
+            _shared_lane.push(std::move(task));
+            _executors[pos]->notify();
+            return;
+        }
+        _executors[pos]->push(std::move(task), priority);
+    }
+
+    ///
+    /// \brief execute a task on a specific worker
+    /// \param worker_id : worker index, modulo size()
+    /// \param task : task to execute
+    /// \param priority : priority of the task
+    ///
+    void execute_on(std::size_t worker_id, std::function<void (void)> task, task_priority priority = task_priority::normal){
+        _executors[worker_id % _executors.size()]->push(std::move(task), priority);
+    }
+
+    ///
+    /// \brief execute one pending task of the pool in the calling thread, if any
+    ///
+    /// used by threads waiting for the completion of other tasks
+    /// ( see hadoken::task_group ) to help the pool instead of blocking
+    ///
+    /// \return true if a task has been executed
+    ///
+    bool run_pending_task(){
+        const std::ptrdiff_t current = current_worker_id();
+        const std::size_t first = (current >= 0) ? (static_cast<std::size_t>(current)) : (0);
+
+        for(std::size_t i = 0; i < _executors.size(); ++i){
+            const std::size_t victim = (first + i) % _executors.size();
+            details::queued_task task;
+            if(_executors[victim]->try_pop(task)){
+                // account the task to the helping worker, or to the owner of the queue
+                // if the helper is not part of the pool
+                const std::size_t runner = (current >= 0) ? (first) : (victim);
+                details::worker_counters & counters = _executors[runner]->statistics();
+                counters.on_task_start(task.enqueued, details::make_task_timestamp(), runner != victim);
+
+                task.task();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    ///
+    /// \brief true if the pool has been compiled with statistics support ( HADOKEN_EXECUTOR_STATS )
+    ///
+    static constexpr bool has_statistics() noexcept{
+        return details::executor_statistics_enabled;
+    }
+
+    ///
+    /// \brief snapshot of the activity counters of the workers
+    ///
+    /// counters are cumulative since the pool creation, poll it periodically
+    /// and diff the snapshots to get rates.
+    /// Without HADOKEN_EXECUTOR_STATS, only the worker list is filled and all the counters are 0
+    ///
+    executor_statistics statistics() const{
+        executor_statistics res;
+        res.workers.resize(_executors.size());
+        for(std::size_t i = 0; i < _executors.size(); ++i){
+            _executors[i]->statistics().snapshot(res.workers[i]);
+        }
+        res.shared_queue_depth_high_water = _shared_lane.queue_depth_high_water();
+        return res;
+    }
+
+    ///
+    /// \brief number of workers in the pool
+    ///
+    std::size_t size() const noexcept{
+        return _executors.size();
+    }
+
+    ///
+    /// \brief cpu on which a worker is pinned, -1 if not pinned
+    ///
+    int worker_cpu(std::size_t worker_id) const noexcept{
+        return (worker_id < _placement.size()) ? (_placement[worker_id].cpu_id) : (-1);
+    }
+
+    ///
+    /// \brief NUMA node on which a worker is pinned, -1 if not pinned
+    ///
+    int worker_numa_node(std::size_t worker_id) const noexcept{
+        return (worker_id < _placement.size()) ? (_placement[worker_id].numa_node) : (-1);
+    }
+
+    ///
+    /// \brief index of the worker of this pool running the calling thread
+    /// \return worker index, or -1 if the caller is not a worker of this pool
+    ///
+    std::ptrdiff_t current_worker_id() const noexcept{
+        const details::worker_identity & identity = details::current_worker_identity();
+        return (identity.pool == this) ? (static_cast<std::ptrdiff_t>(identity.id)) : (-1);
     }
 
 
 private:
     std::atomic<std::size_t> _counter;
+    details::shared_task_lane _shared_lane;
     std::vector<std::unique_ptr<details::worker_thread> > _executors;
+    std::vector<thread::cpu_info> _placement;
 };
 
 
@@ -0,0 +1,321 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_MONOTONIC_ARENA_HPP_
+#define _HADOKEN_MONOTONIC_ARENA_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <type_traits>
+
+
+namespace hadoken {
+
+
+namespace memory {
+
+
+namespace details{
+
+// header of each heap chunk of a monotonic_arena, the memory follows
+struct arena_chunk{
+    arena_chunk* next;
+    std::size_t size;
+
+    char* begin() noexcept{
+        return reinterpret_cast<char*>(this) + header_size();
+    }
+
+    char* end() noexcept{
+        return begin() + size;
+    }
+
+    static constexpr std::size_t header_size(){
+        return (sizeof(arena_chunk) + alignof(std::max_align_t) -1) & ~(alignof(std::max_align_t) -1);
+    }
+};
+
+constexpr std::size_t arena_default_chunk_size = 4096;
+
+// the chunk size stops to double beyond
+constexpr std::size_t arena_max_chunk_size = std::size_t(16) << 20;
+
+inline char* align_up(char* ptr, std::size_t alignment) noexcept{
+    const std::uintptr_t p = reinterpret_cast<std::uintptr_t>(ptr);
+    return ptr + (((p + alignment -1) & ~static_cast<std::uintptr_t>(alignment -1)) - p);
+}
+
+} // details
+
+
+///
+/// \brief monotonic_arena
+///
+/// bump pointer allocator for short-lived objects which die together:
+/// an allocation is a pointer increment, deallocate does nothing and the
+/// memory is given back all at once by reset() or release()
+///
+/// the memory comes from an optional initial buffer, e.g. on the stack,
+/// then from heap chunks of geometrically growing size chained together.
+/// reset() is O(1): the chunks are kept and reused by the next allocations
+///
+/// a monotonic_arena is not thread safe, see scratch_arena() for a per-thread arena
+///
+class monotonic_arena{
+public:
+    ///
+    /// \brief position of an arena, allocations done after a marker can be
+    /// rolled back with rewind()
+    ///
+    struct marker{
+        details::arena_chunk* chunk;
+        char* ptr;
+    };
+
+    ///
+    /// \brief arena without initial buffer, the first chunk is allocated on first use
+    ///
+    inline explicit monotonic_arena(std::size_t initial_chunk_size = details::arena_default_chunk_size) noexcept :
+        _buffer(nullptr), _buffer_size(0),
+        _first(nullptr), _current(nullptr),
+        _ptr(nullptr), _end(nullptr),
+        _next_chunk_size(initial_chunk_size > 0 ? initial_chunk_size : details::arena_default_chunk_size),
+        _capacity(0){}
+
+    ///
+    /// \brief arena which allocates first from buffer, not owned by the arena
+    ///
+    inline monotonic_arena(void* buffer, std::size_t buffer_size) noexcept :
+        _buffer(static_cast<char*>(buffer)), _buffer_size(buffer_size),
+        _first(nullptr), _current(nullptr),
+        _ptr(_buffer), _end(_buffer + buffer_size),
+        _next_chunk_size(buffer_size > details::arena_default_chunk_size ? buffer_size : details::arena_default_chunk_size),
+        _capacity(buffer_size){}
+
+    inline ~monotonic_arena(){
+        _free_chunks();
+    }
+
+    ///
+    /// \brief allocate size bytes aligned on alignment, a power of two
+    ///
+    /// throw std::bad_alloc if the memory can not be obtained
+    ///
+    inline void* allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t)){
+        assert(alignment > 0 && (alignment & (alignment -1)) == 0);
+
+        char* p = details::align_up(_ptr, alignment);
+        if(_ptr != nullptr && p <= _end && size <= static_cast<std::size_t>(_end - p)){
+            _ptr = p + size;
+            return p;
+        }
+        return _allocate_slow(size, alignment);
+    }
+
+    ///
+    /// \brief no-op, the memory is given back by reset() or release()
+    ///
+    inline void deallocate(void* ptr, std::size_t size, std::size_t alignment = alignof(std::max_align_t)) noexcept{
+        (void) ptr;
+        (void) size;
+        (void) alignment;
+    }
+
+    ///
+    /// \brief give back all the allocated memory in O(1), the chunks are kept for reuse
+    ///
+    inline void reset() noexcept{
+        _current = nullptr;
+        _ptr = _buffer;
+        _end = _buffer + _buffer_size;
+    }
+
+    ///
+    /// \brief give back all the allocated memory and free the chunks
+    ///
+    inline void release() noexcept{
+        _free_chunks();
+        _capacity = _buffer_size;
+        reset();
+    }
+
+    ///
+    /// \brief current position of the arena
+    ///
+    inline marker mark() const noexcept{
+        marker m = { _current, _ptr };
+        return m;
+    }
+
+    ///
+    /// \brief give back the memory allocated since m was taken
+    ///
+    inline void rewind(const marker & m) noexcept{
+        _current = m.chunk;
+        _ptr = m.ptr;
+        _end = (_current != nullptr) ? _current->end() : _buffer + _buffer_size;
+    }
+
+    ///
+    /// \brief number of bytes reserved by the arena, initial buffer included
+    ///
+    inline std::size_t capacity() const noexcept{
+        return _capacity;
+    }
+
+private:
+    monotonic_arena(const monotonic_arena &) = delete;
+    monotonic_arena & operator=(const monotonic_arena &) = delete;
+
+    void* _allocate_slow(std::size_t size, std::size_t alignment){
+        // worst case padding for alignments beyond the one of the chunk
+        const std::size_t padding = (alignment > alignof(std::max_align_t)) ? alignment : 0;
+        if(size > std::numeric_limits<std::size_t>::max() - padding - details::arena_chunk::header_size()){
+            throw std::bad_alloc();
+        }
+        const std::size_t needed = size + padding;
+
+        // reuse the next chunk if big enough, otherwise insert a new one before it
+        details::arena_chunk* next = (_current != nullptr) ? _current->next : _first;
+        if(next == nullptr || next->size < needed){
+            next = _new_chunk(needed, next);
+        }
+
+        _current = next;
+        _ptr = _current->begin();
+        _end = _current->end();
+
+        char* p = details::align_up(_ptr, alignment);
+        _ptr = p + size;
+        return p;
+    }
+
+    details::arena_chunk* _new_chunk(std::size_t needed, details::arena_chunk* next){
+        const std::size_t chunk_size = (_next_chunk_size > needed) ? _next_chunk_size : needed;
+
+        details::arena_chunk* chunk = static_cast<details::arena_chunk*>(
+                    ::operator new(details::arena_chunk::header_size() + chunk_size));
+        chunk->next = next;
+        chunk->size = chunk_size;
+
+        if(_current != nullptr){
+            _current->next = chunk;
+        } else {
+            _first = chunk;
+        }
+
+        _capacity += chunk_size;
+        if(_next_chunk_size < details::arena_max_chunk_size){
+            _next_chunk_size *= 2;
+        }
+        return chunk;
+    }
+
+    void _free_chunks() noexcept{
+        details::arena_chunk* chunk = _first;
+        while(chunk != nullptr){
+            details::arena_chunk* next = chunk->next;
+            ::operator delete(chunk);
+            chunk = next;
+        }
+        _first = nullptr;
+        _current = nullptr;
+    }
+
+    char* _buffer;
+    std::size_t _buffer_size;
+
+    details::arena_chunk* _first;
+    details::arena_chunk* _current;
+    char* _ptr;
+    char* _end;
+
+    std::size_t _next_chunk_size;
+    std::size_t _capacity;
+};
+
+
+///
+/// \brief arena_allocator
+///
+/// STL compatible allocator which takes its memory from a monotonic_arena,
+/// e.g. std::vector<int, arena_allocator<int> > v(arena_allocator<int>(arena));
+///
+/// deallocate is a no-op: the memory is given back when the arena is reset,
+/// the arena must outlive the containers which use it
+///
+template<typename T>
+class arena_allocator{
+public:
+    typedef T value_type;
+
+    inline explicit arena_allocator(monotonic_arena & arena) noexcept : _arena(&arena) {}
+
+    template<typename U>
+    inline arena_allocator(const arena_allocator<U> & other) noexcept : _arena(&other.arena()) {}
+
+    inline T* allocate(std::size_t n){
+        if(n > std::numeric_limits<std::size_t>::max() / sizeof(T)){
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    inline void deallocate(T* ptr, std::size_t n) noexcept{
+        _arena->deallocate(ptr, n * sizeof(T), alignof(T));
+    }
+
+    inline monotonic_arena & arena() const noexcept{
+        return *_arena;
+    }
+
+private:
+    monotonic_arena* _arena;
+};
+
+
+template<typename T, typename U>
+inline bool operator==(const arena_allocator<T> & a, const arena_allocator<U> & b) noexcept{
+    return &a.arena() == &b.arena();
+}
+
+template<typename T, typename U>
+inline bool operator!=(const arena_allocator<T> & a, const arena_allocator<U> & b) noexcept{
+    return !(a == b);
+}
+
+
+} // memory
+
+
+} // hadoken
+
+#endif // _HADOKEN_MONOTONIC_ARENA_HPP_
@@ -0,0 +1,357 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_OBJECT_POOL_HPP_
+#define _HADOKEN_OBJECT_POOL_HPP_
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <utility>
+
+#include <hadoken/thread/enumerable_thread_specific.hpp>
+
+
+namespace hadoken {
+
+
+namespace memory {
+
+
+namespace details{
+
+constexpr std::uint32_t pool_null_index = 0xffffffffu;
+
+// number of slabs of a pool, the slab k holds (slab_base << k) slots
+constexpr std::size_t pool_max_slabs = 32;
+
+// a free slot of an object_pool, placed in the storage of the object
+struct pool_free_slot{
+    // next slot of the same batch, or of the thread list
+    pool_free_slot* next;
+    // next batch of the depot, valid on the first slot of a batch
+    std::atomic<std::uint32_t> next_batch;
+};
+
+template<typename T>
+constexpr std::size_t pool_slot_alignment(){
+    return (alignof(T) > alignof(pool_free_slot)) ? alignof(T) : alignof(pool_free_slot);
+}
+
+template<typename T>
+constexpr std::size_t pool_slot_size(){
+    return (((sizeof(T) > sizeof(pool_free_slot)) ? sizeof(T) : sizeof(pool_free_slot))
+            + pool_slot_alignment<T>() -1) / pool_slot_alignment<T>() * pool_slot_alignment<T>();
+}
+
+// free slots owned by a thread
+struct pool_slot_list{
+    inline pool_slot_list() : head(nullptr), count(0) {}
+
+    inline void push(pool_free_slot* slot){
+        slot->next = head;
+        head = slot;
+        count += 1;
+    }
+
+    inline pool_free_slot* pop(){
+        pool_free_slot* slot = head;
+        head = slot->next;
+        count -= 1;
+        return slot;
+    }
+
+    pool_free_slot* head;
+    std::size_t count;
+};
+
+// per-thread cache: two lists of batch_size slots at most,
+// spare is empty or full and moves to the depot as a whole
+struct pool_thread_cache{
+    pool_slot_list active, spare;
+};
+
+inline unsigned int log2_floor(std::uint64_t v){
+    assert(v > 0);
+    return 63u - static_cast<unsigned int>(__builtin_clzll(v));
+}
+
+} // details
+
+
+///
+/// \brief object_pool
+///
+/// lock-free pool of fixed-size slots for objects of type T, suited for small
+/// objects allocated and freed at high rates by many threads: tasks, tree nodes, queue nodes
+///
+/// each thread allocates from and frees to its own cache, without synchronization.
+/// The caches exchange batches of batch_size free slots with a global depot,
+/// a lock-free stack: a thread which frees more than it allocates gives its
+/// surplus to the others, one batch at a time.
+/// New slots are carved from slabs of geometrically growing size, the slabs
+/// are given back to the system only at the destruction of the pool.
+///
+/// an object can be freed by any thread, not only the one which allocated it.
+/// The objects still alive at the destruction of the pool are not destroyed
+///
+/// \code
+///    hadoken::memory::object_pool<node> pool;
+///    node* n = pool.create(key, value);
+///    ...
+///    pool.destroy(n);
+/// \endcode
+///
+template<typename T>
+class object_pool{
+public:
+    typedef T value_type;
+
+    ///
+    /// \brief pool which moves the free slots by batches of batch_size between threads
+    ///
+    inline explicit object_pool(std::size_t batch_size = 32) :
+        _batch_size(batch_size > 0 ? batch_size : 1),
+        _slab_base(_batch_size * 16),
+        _depot(details::pool_null_index),
+        _fresh(0),
+        _caches(),
+        _grow_lock(){
+        for(std::size_t k = 0; k < details::pool_max_slabs; ++k){
+            _slabs[k].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    inline ~object_pool(){
+        for(std::size_t k = 0; k < details::pool_max_slabs; ++k){
+            ::operator delete(_slabs[k].load(std::memory_order_relaxed));
+        }
+    }
+
+    ///
+    /// \brief uninitialized storage for one T
+    ///
+    /// throw std::bad_alloc if the memory can not be obtained
+    ///
+    inline T* allocate(){
+        details::pool_thread_cache & cache = _caches.local();
+        details::pool_slot_list & active = cache.active;
+
+        if(active.head == nullptr){
+            if(cache.spare.head != nullptr){
+                std::swap(active, cache.spare);
+            } else {
+                details::pool_free_slot* batch = _pop_batch();
+                active.head = (batch != nullptr) ? batch : _carve_batch();
+                active.count = _batch_size;
+            }
+        }
+
+        return static_cast<T*>(static_cast<void*>(active.pop()));
+    }
+
+    ///
+    /// \brief give back the storage of ptr, allocated by this pool
+    ///
+    inline void deallocate(T* ptr){
+        if(ptr == nullptr){
+            return;
+        }
+
+        details::pool_thread_cache & cache = _caches.local();
+
+        if(cache.active.count >= _batch_size){
+            if(cache.spare.head != nullptr){
+                _push_batch(cache.spare.head);
+            }
+            cache.spare = cache.active;
+            cache.active = details::pool_slot_list();
+        }
+
+        cache.active.push(new (static_cast<void*>(ptr)) details::pool_free_slot);
+    }
+
+    ///
+    /// \brief allocate and construct a T from args
+    ///
+    template<typename... Args>
+    inline T* create(Args &&... args){
+        T* ptr = allocate();
+        try{
+            return new (static_cast<void*>(ptr)) T(std::forward<Args>(args)...);
+        }catch(...){
+            deallocate(ptr);
+            throw;
+        }
+    }
+
+    ///
+    /// \brief destroy and deallocate an object created by create()
+    ///
+    inline void destroy(T* ptr){
+        if(ptr == nullptr){
+            return;
+        }
+        ptr->~T();
+        deallocate(ptr);
+    }
+
+    ///
+    /// \brief number of slots carved from the slabs so far
+    ///
+    inline std::size_t capacity() const noexcept{
+        return static_cast<std::size_t>(_fresh.load(std::memory_order_relaxed));
+    }
+
+    inline std::size_t batch_size() const noexcept{
+        return _batch_size;
+    }
+
+private:
+    object_pool(const object_pool &) = delete;
+    object_pool & operator=(const object_pool &) = delete;
+
+    // index of the first slot of slab k
+    inline std::uint64_t _slab_first(unsigned int k) const noexcept{
+        return static_cast<std::uint64_t>(_slab_base) * ((std::uint64_t(1) << k) -1);
+    }
+
+    inline unsigned int _slab_of(std::uint64_t index) const noexcept{
+        return details::log2_floor(index / _slab_base +1);
+    }
+
+    inline details::pool_free_slot* _slot_at(std::uint32_t index) const noexcept{
+        const unsigned int k = _slab_of(index);
+        char* slab = _slabs[k].load(std::memory_order_acquire);
+        assert(slab != nullptr);
+        return reinterpret_cast<details::pool_free_slot*>(slab + (index - _slab_first(k)) * details::pool_slot_size<T>());
+    }
+
+    inline std::uint32_t _index_of(const details::pool_free_slot* slot) const noexcept{
+        const char* p = reinterpret_cast<const char*>(slot);
+        for(unsigned int k = 0; k < details::pool_max_slabs; ++k){
+            const char* slab = _slabs[k].load(std::memory_order_acquire);
+            const std::size_t slab_bytes = (_slab_base << k) * details::pool_slot_size<T>();
+            if(slab != nullptr && p >= slab && p < slab + slab_bytes){
+                return static_cast<std::uint32_t>(_slab_first(k) + static_cast<std::size_t>(p - slab) / details::pool_slot_size<T>());
+            }
+        }
+        assert(false && "object_pool: pointer not allocated by this pool");
+        return details::pool_null_index;
+    }
+
+    // depot head: version tag in the high 32 bits against ABA, index of the first slot of the top batch in the low bits
+    static inline std::uint64_t _make_head(std::uint64_t old_head, std::uint32_t index) noexcept{
+        return (((old_head >> 32) +1) << 32) | index;
+    }
+
+    inline void _push_batch(details::pool_free_slot* batch) noexcept{
+        const std::uint32_t index = _index_of(batch);
+        std::uint64_t head = _depot.load(std::memory_order_relaxed);
+        do{
+            batch->next_batch.store(static_cast<std::uint32_t>(head), std::memory_order_relaxed);
+        } while(_depot.compare_exchange_weak(head, _make_head(head, index), std::memory_order_release, std::memory_order_relaxed) == false);
+    }
+
+    inline details::pool_free_slot* _pop_batch() noexcept{
+        std::uint64_t head = _depot.load(std::memory_order_acquire);
+        while(true){
+            const std::uint32_t index = static_cast<std::uint32_t>(head);
+            if(index == details::pool_null_index){
+                return nullptr;
+            }
+
+            // the batch can be popped and reused concurrently: next is then garbage,
+            // but the tag has changed and the CAS fails
+            details::pool_free_slot* batch = _slot_at(index);
+            const std::uint32_t next = batch->next_batch.load(std::memory_order_relaxed);
+            if(_depot.compare_exchange_weak(head, _make_head(head, next), std::memory_order_acquire, std::memory_order_acquire)){
+                return batch;
+            }
+        }
+    }
+
+    // take batch_size new slots from the slabs, linked together
+    details::pool_free_slot* _carve_batch(){
+        const std::uint64_t first = _fresh.fetch_add(_batch_size, std::memory_order_relaxed);
+        if(first + _batch_size >= details::pool_null_index){
+            throw std::bad_alloc();
+        }
+
+        // _slab_base is a multiple of _batch_size: a batch never spans two slabs
+        const unsigned int k = _slab_of(first);
+        char* slab = _slabs[k].load(std::memory_order_acquire);
+        if(slab == nullptr){
+            slab = _allocate_slab(k);
+        }
+
+        const std::size_t slot_size = details::pool_slot_size<T>();
+        char* p = slab + (first - _slab_first(k)) * slot_size;
+        details::pool_free_slot* next = nullptr;
+        for(std::size_t i = _batch_size; i > 0; --i){
+            details::pool_free_slot* slot = new (static_cast<void*>(p + (i-1) * slot_size)) details::pool_free_slot;
+            slot->next = next;
+            next = slot;
+        }
+        return next;
+    }
+
+    char* _allocate_slab(unsigned int k){
+        std::lock_guard<std::mutex> lock(_grow_lock);
+        char* slab = _slabs[k].load(std::memory_order_relaxed);
+        if(slab == nullptr){
+            slab = static_cast<char*>(::operator new((_slab_base << k) * details::pool_slot_size<T>()));
+            _slabs[k].store(slab, std::memory_order_release);
+        }
+        return slab;
+    }
+
+    static_assert(alignof(T) <= alignof(std::max_align_t), "object_pool: over-aligned types are not supported");
+
+    const std::size_t _batch_size;
+    const std::size_t _slab_base;
+
+    std::atomic<std::uint64_t> _depot;
+    std::atomic<std::uint64_t> _fresh;
+    std::atomic<char*> _slabs[details::pool_max_slabs];
+
+    thread::enumerable_thread_specific<details::pool_thread_cache> _caches;
+
+    std::mutex _grow_lock;
+};
+
+
+} // memory
+
+
+} // hadoken
+
+#endif // _HADOKEN_OBJECT_POOL_HPP_
@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_SCRATCH_ARENA_HPP_
+#define _HADOKEN_SCRATCH_ARENA_HPP_
+
+#include <hadoken/memory/monotonic_arena.hpp>
+
+
+namespace hadoken {
+
+
+namespace memory {
+
+
+///
+/// \brief monotonic_arena of the calling thread, for temporary buffers
+///
+/// the chunks are kept for the lifetime of the thread: after warm-up,
+/// the temporaries of an algorithm called in a loop do not touch the heap.
+/// Use it through a scratch_scope, which gives the memory back at the end of the scope
+///
+inline monotonic_arena & scratch_arena(){
+    static thread_local monotonic_arena arena(16 * 1024);
+    return arena;
+}
+
+
+///
+/// \brief scratch_scope
+///
+/// RAII scope on the scratch arena of the calling thread: the memory allocated
+/// during the scope is given back at its destruction. Scopes can be nested.
+///
+/// the objects allocated in the scope must be destroyed before the scope, e.g.
+///
+///   memory::scratch_scope scope;
+///   std::vector<int, memory::arena_allocator<int> > tmp(scope.allocator<int>());
+///
+class scratch_scope{
+public:
+    inline scratch_scope() : _arena(scratch_arena()), _marker(_arena.mark()) {}
+
+    inline ~scratch_scope(){
+        _arena.rewind(_marker);
+    }
+
+    inline monotonic_arena & arena() noexcept{
+        return _arena;
+    }
+
+    ///
+    /// \brief allocator for the scratch arena of this scope
+    ///
+    template<typename T>
+    inline arena_allocator<T> allocator() noexcept{
+        return arena_allocator<T>(_arena);
+    }
+
+private:
+    scratch_scope(const scratch_scope &) = delete;
+    scratch_scope & operator=(const scratch_scope &) = delete;
+
+    monotonic_arena & _arena;
+    monotonic_arena::marker _marker;
+};
+
+
+} // memory
+
+
+} // hadoken
+
+#endif // _HADOKEN_SCRATCH_ARENA_HPP_
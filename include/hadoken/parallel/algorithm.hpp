@@ -134,13 +134,46 @@ OutputIt inclusive_scan( ExecutionPolicy&& policy,
                          
                          
 
+///
+/// memory
+/// parallel uninitialized_fill algorithm
+///
+/// construct copies of val in the uninitialized memory [first, last)
+/// the elements are constructed by the same partition of workers than for_range,
+/// each memory page is consequently first-touched on the NUMA node of the worker using it
+template< class ExecutionPolicy, class ForwardIterator, class T >
+void uninitialized_fill( ExecutionPolicy&& policy, ForwardIterator first, ForwardIterator last, const T& val);
+
+
+/// Extension: first_touch
+///
+/// touch each memory page of the uninitialized memory [first, last) from
+/// the worker that will process it in a for_range call with the same size.
+/// With a first-touch NUMA policy, pages are then allocated on the local node
+/// of their worker. Must only be called on memory where no object lives.
+template< class ExecutionPolicy, class T >
+void first_touch( ExecutionPolicy&& policy, T* first, T* last);
+
+
+
 /// Extension: for_range_ algorithm
 ///
 /// for_range is an extension to for_each where the function
 /// execute on a subrange, instead of a single element
+///
+/// the partition is static: for a given range size, the same subrange is
+/// always executed by the same worker
 template<typename ExecPolicy, typename Iterator, typename RangeFunction>
 inline void for_range(ExecPolicy && policy, Iterator begin_it, Iterator end_it, RangeFunction fun);
 
+
+namespace detail{
+
+/// number of subranges of a parallel for_range, defined by the backend
+inline std::size_t get_parallel_task();
+
+} // detail
+
 } // parallel
 
 
@@ -148,7 +181,12 @@ inline void for_range(ExecPolicy && policy, Iterator begin_it, Iterator end_it,
 } // hadoken
 
 
+// backend: OpenMP by default, the system thread pool with HADOKEN_PARALLEL_USE_CXX11_THREAD
+#ifdef HADOKEN_PARALLEL_USE_CXX11_THREAD
+#include <hadoken/parallel/bits/cxx11_thread_algorithm_impl.hpp>
+#else
 #include <hadoken/parallel/bits/omp_algorithm_impl.hpp>
+#endif
 
 
 
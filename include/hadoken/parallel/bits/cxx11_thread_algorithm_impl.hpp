@@ -43,10 +43,12 @@
 
 
 #include <hadoken/parallel/bits/parallel_algorithm_generics.hpp>
+#include <hadoken/parallel/bits/parallel_count_generics.hpp>
 #include <hadoken/parallel/bits/parallel_none_any_all_generic.hpp>
 #include <hadoken/parallel/bits/parallel_transform_generic.hpp>
 #include <hadoken/parallel/bits/parallel_sort_generic.hpp>
 #include <hadoken/parallel/bits/parallel_numeric_generic.hpp>
+#include <hadoken/parallel/bits/parallel_memory_generic.hpp>
 
 namespace hadoken{
 
@@ -63,12 +65,39 @@ class parallel_vector_execution_policy;
 namespace detail{
 
 
-std::size_t get_parallel_task(){
-    return std::thread::hardware_concurrency();
+inline std::size_t get_parallel_task(){
+    system_executor sexec;
+    return std::max<std::size_t>(sexec.pool().size(), 1);
+}
+
+
+/// wait for the completion of the slices of a for_range
+///
+/// a worker of the system pool can not block: its own slice is queued behind it
+/// and the pool has no stealing. It executes pending tasks while waiting instead,
+/// starting with its own queue. Other callers block, so that no slice leaves its worker
+inline void _wait_for_slices(thread_pool_executor & pool, thread::latch & latch_task){
+    if(pool.current_worker_id() < 0){
+        latch_task.wait();
+        return;
+    }
+
+    while(latch_task.is_ready() == false){
+        if(pool.run_pending_task()){
+            continue;
+        }
+
+#ifndef HADOKEN_SPIN_NO_YIELD
+        std::this_thread::yield();
+#endif
+    }
 }
 
 
 /// for_range algorithm
+///
+/// slice i is executed by the worker i of the system pool, the caller only waits or helps.
+/// The mapping is static in order to preserve the NUMA locality of the data
 template<typename Iterator, typename RangeFunction>
 inline void _simple_cxx11_for_range(Iterator begin_it, Iterator end_it, RangeFunction fun){
     const std::size_t n_task = get_parallel_task();
@@ -79,22 +108,16 @@ inline void _simple_cxx11_for_range(Iterator begin_it, Iterator end_it, RangeFun
 
     system_executor sexec;
 
-    // start task for tasks 1-N on separated executors
-    for(std::size_t i = 1; i < n_task; ++i){
-
-         sexec.execute([i, &latch_task, &global_range, &n_task, &fun](){
+    for(std::size_t i = 0; i < n_task; ++i){
+         sexec.execute_on(i, [i, &latch_task, &global_range, &n_task, &fun](){
             auto my_range = take_splice(global_range, i, n_task);
             fun(my_range.begin(), my_range.end());
             latch_task.count_down(1);
         });
     }
 
-    // execute the task 0 locally
-    auto my_range = take_splice(global_range, 0, n_task);
-    fun(my_range.begin(), my_range.end());
-
     // wait for the folks
-    latch_task.count_down_and_wait(1);
+    _wait_for_slices(sexec.pool(), latch_task);
 }
 
 
@@ -51,6 +51,7 @@
 #include <hadoken/parallel/bits/parallel_transform_generic.hpp>
 #include <hadoken/parallel/bits/parallel_sort_generic.hpp>
 #include <hadoken/parallel/bits/parallel_numeric_generic.hpp>
+#include <hadoken/parallel/bits/parallel_memory_generic.hpp>
 
 
 namespace hadoken{
@@ -76,26 +77,18 @@ inline int __get_number_executor(){
 #endif
 }
 
+inline std::size_t get_parallel_task(){
+    return static_cast<std::size_t>(std::max(__get_number_executor(), 1));
+}
+
 template<typename Function>
 inline void __execute_grid(int num_executor, Function fun){
 #ifndef __ALGORITHM_NO_OPENMP
-    //std::cout << "val " << num_executor << std::endl;
-    #pragma omp parallel
-    {
-
-       #pragma omp single
-       {
-
-           for(int id = 0; id < num_executor; ++id){
-
-               #pragma omp task firstprivate(id)
-               {
-                fun(id, num_executor);
-               }
-            }
-
-        }
-
+    // static schedule: executor id always maps to the same thread of the team
+    // required for NUMA first-touch consistency between algorithms
+    #pragma omp parallel for schedule(static, 1)
+    for(int id = 0; id < num_executor; ++id){
+        fun(id, num_executor);
     }
 #else
     for(int id =0 ; id < num_executor; ++id){
@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef PARALLEL_MEMORY_GENERIC_BITS_HPP
+#define PARALLEL_MEMORY_GENERIC_BITS_HPP
+
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+
+#if (defined __unix__) || (defined __APPLE__)
+#include <unistd.h>
+#endif
+
+#include <hadoken/parallel/algorithm.hpp>
+
+
+#include "parallel_generic_utils.hpp"
+
+
+namespace hadoken{
+
+
+namespace parallel{
+
+
+namespace detail{
+
+inline std::size_t get_page_size(){
+#if (defined __unix__) || (defined __APPLE__)
+    static const std::size_t page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    return page_size;
+#else
+    return 4096;
+#endif
+}
+
+// touch the first byte of each memory page in [first, last)
+inline void touch_pages(char* first, char* last){
+    const std::size_t page_size = get_page_size();
+    const std::uintptr_t first_page = (reinterpret_cast<std::uintptr_t>(first) + page_size -1) & ~(std::uintptr_t(page_size) -1);
+
+    volatile char* page = reinterpret_cast<char*>(first_page);
+    for(; page < last; page += page_size){
+        *page = 0;
+    }
+}
+
+} // detail
+
+
+// parallel uninitialized_fill algorithm
+template< class ExecutionPolicy, class ForwardIterator, class T >
+void uninitialized_fill( ExecutionPolicy&& policy, ForwardIterator first, ForwardIterator last, const T& val){
+    if(detail::is_parallel_policy(policy)){
+        ::hadoken::parallel::for_range(std::forward<ExecutionPolicy>(policy), first, last, [&val](ForwardIterator local_first, ForwardIterator local_last){
+            std::uninitialized_fill(local_first, local_last, val);
+        });
+        return;
+    }
+    std::uninitialized_fill(first, last, val);
+}
+
+
+// parallel first_touch
+template< class ExecutionPolicy, class T >
+void first_touch( ExecutionPolicy&& policy, T* first, T* last){
+    if(detail::is_parallel_policy(policy)){
+        ::hadoken::parallel::for_range(std::forward<ExecutionPolicy>(policy), first, last, [](T* local_first, T* local_last){
+            detail::touch_pages(reinterpret_cast<char*>(local_first), reinterpret_cast<char*>(local_last));
+        });
+        return;
+    }
+    detail::touch_pages(reinterpret_cast<char*>(first), reinterpret_cast<char*>(last));
+}
+
+
+} //parallel
+
+} // hadoken
+
+#endif // PARALLEL_MEMORY_GENERIC_BITS_HPP
@@ -30,11 +30,14 @@
 #define PARALLEL_NUMERIC_GENERIC_HPP
 
 #include <atomic>
+#include <cassert>
 #include <algorithm>
 #include <cmath>
 #include <mutex>
+#include <numeric>
 
 
+#include <hadoken/memory/scratch_arena.hpp>
 #include <hadoken/thread/spinlock.hpp>
 
 #include <hadoken/parallel/algorithm.hpp>
@@ -67,9 +70,13 @@ OutputIt _internal_inclusive_scan( ExecutionPolicy&& policy,
     }
 
         
-    std::vector<tuple_it_val> limits_vec;
-    hadoken::thread::spin_lock _limit_lock;
-    limits_vec.reserve(64);
+    // chunk limits in the scratch arena of the calling thread, no heap allocation
+    // after warm-up. Sized once by the caller: the workers only write their own
+    // entry and never allocate from an arena which is not theirs
+    memory::scratch_scope scratch;
+    std::vector<tuple_it_val, memory::arena_allocator<tuple_it_val> > limits_vec(get_parallel_task(), tuple_it_val(),
+                                                                                 scratch.allocator<tuple_it_val>());
+    std::atomic<std::size_t> n_limits(0);
 
     // first local inclusive scan 
     for_range(policy, first, last, [&](InputIt local_first, InputIt local_last){
@@ -86,11 +93,13 @@ OutputIt _internal_inclusive_scan( ExecutionPolicy&& policy,
         d_local_end = local_d_first;
         std::advance(d_local_end, 1);
         
-        {
-            std::lock_guard<hadoken::thread::spin_lock> _l(_limit_lock);
-            limits_vec.push_back(std::make_tuple(d_local_end, *local_d_first));
-        }
+        const std::size_t slice = n_limits.fetch_add(1, std::memory_order_relaxed);
+        assert(slice < limits_vec.size());
+        limits_vec[slice] = std::make_tuple(d_local_end, *local_d_first);
     });
+
+    // shrinking does not allocate
+    limits_vec.resize(n_limits.load(), tuple_it_val());
     
     std::sort(limits_vec.begin(), limits_vec.end(), [](const tuple_it_val & v1, const tuple_it_val & v2){
        return std::get<0>(v1) < std::get<0>(v2); 
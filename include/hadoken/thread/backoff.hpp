@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_BACKOFF_HPP_
+#define _HADOKEN_BACKOFF_HPP_
+
+#include <cstdint>
+#include <thread>
+
+#if (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+#include <immintrin.h>
+#endif
+
+namespace hadoken {
+
+namespace thread{
+
+///
+/// \brief hint the cpu that the current thread is in a spin-wait loop
+///
+/// pause on x86, yield on ARM, low thread priority on POWER ( BlueGene/Q ),
+/// no-op otherwise
+///
+inline void cpu_relax() noexcept{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield" ::: "memory");
+#elif defined(__powerpc__) || defined(__ppc__) || defined(__PPC__)
+    __asm__ __volatile__("or 27,27,27" ::: "memory");
+#endif
+}
+
+
+///
+/// \brief exponential backoff for spin-wait loops
+///
+/// each call to pause() spins twice as long as the previous one, up to max_spin
+/// cpu_relax() iterations. Once the limit is reached, the thread yields its cpu
+/// ( except if HADOKEN_SPIN_NO_YIELD is defined )
+///
+class exponential_backoff{
+public:
+    static constexpr std::uint32_t default_max_spin = 1024;
+
+    inline explicit exponential_backoff(std::uint32_t max_spin = default_max_spin) noexcept :
+        _current(1), _max(max_spin) {}
+
+    inline void pause() noexcept{
+        if(_current <= _max){
+            for(std::uint32_t i = 0; i < _current; ++i){
+                cpu_relax();
+            }
+            _current *= 2;
+        }else{
+#ifndef HADOKEN_SPIN_NO_YIELD
+            std::this_thread::yield();
+#else
+            for(std::uint32_t i = 0; i < _max; ++i){
+                cpu_relax();
+            }
+#endif
+        }
+    }
+
+    /// true once the spin limit is reached
+    inline bool saturated() const noexcept{
+        return (_current > _max);
+    }
+
+    inline void reset() noexcept{
+        _current = 1;
+    }
+
+private:
+    std::uint32_t _current;
+    std::uint32_t _max;
+};
+
+
+} // thread
+
+} // hadoken
+
+#endif // _HADOKEN_BACKOFF_HPP_
@@ -0,0 +1,190 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_BARRIER_HPP_
+#define _HADOKEN_BARRIER_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <assert.h>
+
+#include <hadoken/thread/futex.hpp>
+
+namespace hadoken {
+
+namespace thread{
+
+
+namespace details{
+
+struct barrier_noop_completion{
+    inline void operator()() const noexcept {}
+};
+
+} // details
+
+
+///
+/// \brief reusable barrier
+///
+/// barrier ( C++20 std::barrier implementation )
+///
+/// A barrier blocks a group of threads until all of them arrived, then
+/// run the completion function on the last arriving thread, release the threads
+/// and start a new phase. Unlike latch, the barrier can be reused for any number of phases.
+///
+/// Centralized sense-reversing implementation: the sense is a phase counter,
+/// waiters spin briefly on it then sleep on a futex
+///
+template<typename CompletionFunction = details::barrier_noop_completion>
+class barrier{
+public:
+    ///
+    /// \brief token returned by arrive(), identify the phase
+    ///
+    class arrival_token{
+    public:
+        arrival_token(arrival_token && other) noexcept : _phase(other._phase) {}
+
+        arrival_token & operator=(arrival_token && other) noexcept{
+            _phase = other._phase;
+            return *this;
+        }
+
+    private:
+        explicit arrival_token(std::int32_t phase) noexcept : _phase(phase) {}
+
+        friend class barrier;
+
+        std::int32_t _phase;
+    };
+
+    ///
+    /// \brief construct a new barrier
+    /// \param expected : number of threads participating, must be non negative
+    /// \param completion : function called by the last arriving thread at each phase end
+    ///
+    inline explicit barrier(std::ptrdiff_t expected, CompletionFunction completion = CompletionFunction()) :
+        _completion(std::move(completion)),
+        _expected(expected),
+        _counter(expected),
+        _dropped(0),
+        _phase(0),
+        _sleepers(0){
+        assert(expected >= 0);
+    }
+
+    ~barrier() = default;
+
+    ///
+    /// \brief arrive at the barrier, without waiting
+    /// \param n : number of arrivals
+    /// \return token to wait for the end of the current phase
+    ///
+    inline arrival_token arrive(std::ptrdiff_t n = 1){
+        const std::int32_t phase = _phase.load(std::memory_order_acquire);
+
+        if(_counter.fetch_sub(n, std::memory_order_acq_rel) == n){
+            _complete_phase(phase);
+        }
+        return arrival_token(phase);
+    }
+
+    ///
+    /// \brief wait for the end of the phase of an arrival token
+    ///
+    inline void wait(arrival_token && token) const{
+        const std::int32_t phase = token._phase;
+        if(details::spin_until([this, phase](){ return (_phase.load(std::memory_order_acquire) != phase); })){
+            return;
+        }
+
+        _sleepers.fetch_add(1);
+        while(_phase.load(std::memory_order_acquire) == phase){
+            futex_wait(&_phase, phase);
+        }
+        _sleepers.fetch_sub(1);
+    }
+
+    ///
+    /// \brief arrive at the barrier and wait for the end of the phase
+    ///
+    inline void arrive_and_wait(){
+        wait(arrive());
+    }
+
+    ///
+    /// \brief arrive at the barrier and leave the group of participating threads
+    /// for the next phases
+    ///
+    inline void arrive_and_drop(){
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        arrive();
+    }
+
+    ///
+    /// \brief maximum number of threads supported
+    ///
+    static constexpr std::ptrdiff_t max() noexcept{
+        return std::numeric_limits<std::ptrdiff_t>::max();
+    }
+
+private:
+    barrier(const barrier &) = delete;
+    barrier & operator=(const barrier &) = delete;
+
+    inline void _complete_phase(std::int32_t phase){
+        _completion();
+
+        // all the threads of the phase arrived, nobody touches the counter before the phase flip
+        _expected -= _dropped.exchange(0, std::memory_order_relaxed);
+        _counter.store(_expected, std::memory_order_relaxed);
+
+        // wrap around
+        _phase.store(static_cast<std::int32_t>(static_cast<std::uint32_t>(phase) + 1));
+        if(_sleepers.load() > 0){
+            futex_wake_all(&_phase);
+        }
+    }
+
+    CompletionFunction _completion;
+    std::ptrdiff_t _expected;
+    std::atomic<std::ptrdiff_t> _counter;
+    std::atomic<std::ptrdiff_t> _dropped;
+    mutable futex_word _phase;
+    mutable std::atomic<std::int32_t> _sleepers;
+};
+
+
+} // thread
+
+} // hadoken
+
+#endif // _HADOKEN_BARRIER_HPP_
@@ -0,0 +1,175 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_RECLAMATION_REGISTRY_HPP_
+#define _HADOKEN_RECLAMATION_REGISTRY_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace hadoken {
+
+namespace thread{
+
+namespace details{
+
+
+// object retired by a thread, waiting to be freed
+struct retired_ptr{
+    void* ptr;
+    void (*deleter)(void*);
+    std::uint64_t epoch;
+
+    inline void destroy(){
+        deleter(ptr);
+    }
+};
+
+template<typename T>
+inline void delete_retired(void* ptr){
+    delete static_cast<T*>(ptr);
+}
+
+
+// lock-free list of per-thread records, records are never unlinked
+// but reused by new threads after the release of the previous owner
+template<typename Record>
+class record_list{
+public:
+    inline record_list() : _head(nullptr) {}
+
+    inline ~record_list(){
+        Record* rec = _head.load();
+        while(rec != nullptr){
+            Record* next = rec->next;
+            delete rec;
+            rec = next;
+        }
+    }
+
+    template<typename Factory>
+    inline Record* acquire(Factory factory){
+        for(Record* rec = _head.load(std::memory_order_acquire); rec != nullptr; rec = rec->next){
+            bool expected = false;
+            if(rec->in_use.load(std::memory_order_relaxed) == false
+                && rec->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)){
+                return rec;
+            }
+        }
+
+        Record* rec = factory();
+        rec->in_use.store(true, std::memory_order_relaxed);
+        rec->next = _head.load(std::memory_order_relaxed);
+        while(_head.compare_exchange_weak(rec->next, rec, std::memory_order_release, std::memory_order_relaxed) == false){}
+        return rec;
+    }
+
+    inline void release(Record* rec){
+        rec->in_use.store(false, std::memory_order_release);
+    }
+
+    template<typename Function>
+    inline void for_each(Function fun) const{
+        for(Record* rec = _head.load(std::memory_order_acquire); rec != nullptr; rec = rec->next){
+            fun(*rec);
+        }
+    }
+
+private:
+    record_list(const record_list &) = delete;
+
+    std::atomic<Record*> _head;
+};
+
+
+// records of the current thread, for each domain of type State used by the thread
+//
+// the shared ownership keeps the domain state alive until all the threads
+// which used it have exited and given their record back
+template<typename State>
+class thread_records{
+public:
+    typedef typename State::record_type record_type;
+
+    inline thread_records() : _entries() {}
+
+    inline ~thread_records(){
+        for(auto & entry : _entries){
+            entry.first->release_record(entry.second);
+        }
+    }
+
+    inline record_type* get(const std::shared_ptr<State> & state){
+        // the last used domain is the common case
+        for(std::size_t i = _entries.size(); i > 0; --i){
+            if(_entries[i -1].first.get() == state.get()){
+                return _entries[i -1].second;
+            }
+        }
+
+        _release_closed();
+
+        record_type* rec = state->acquire_record();
+        _entries.emplace_back(state, rec);
+        return rec;
+    }
+
+    static inline thread_records & local(){
+        static thread_local thread_records records;
+        return records;
+    }
+
+private:
+    thread_records(const thread_records &) = delete;
+
+    // give back the records of the destroyed domains
+    inline void _release_closed(){
+        for(std::size_t i = 0; i < _entries.size();){
+            if(_entries[i].first->closed()){
+                _entries[i].first->release_record(_entries[i].second);
+                _entries.erase(_entries.begin() + i);
+            }else{
+                ++i;
+            }
+        }
+    }
+
+    std::vector<std::pair<std::shared_ptr<State>, record_type*> > _entries;
+};
+
+
+} // details
+
+} // thread
+
+} // hadoken
+
+#endif // _HADOKEN_RECLAMATION_REGISTRY_HPP_
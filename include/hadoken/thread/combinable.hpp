@@ -0,0 +1,104 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_COMBINABLE_HPP_
+#define _HADOKEN_COMBINABLE_HPP_
+
+#include <utility>
+
+#include <hadoken/thread/enumerable_thread_specific.hpp>
+
+namespace hadoken {
+
+namespace thread{
+
+
+///
+/// \brief per-thread partial results, merged at the end of a parallel section
+///
+/// each thread accumulates into its own local() instance, without synchronization
+/// and without false sharing, then combine() reduces all of them
+///
+/// \code
+///    hadoken::thread::combinable<std::size_t> count([]{ return std::size_t(0); });
+///    hadoken::parallel::for_each(hadoken::parallel::par, v.begin(), v.end(), [&](int i){
+///        count.local() += (i % 2);
+///    });
+///    std::size_t total = count.combine(std::plus<std::size_t>());
+/// \endcode
+///
+template<typename T>
+class combinable{
+public:
+    /// partial results are default constructed
+    inline combinable() : _instances() {}
+
+    /// partial results are constructed by the result of init()
+    template<typename Finit>
+    inline explicit combinable(Finit init) : _instances(std::move(init)) {}
+
+    /// partial result of the calling thread
+    inline T & local(){
+        return _instances.local();
+    }
+
+    /// partial result of the calling thread, exists is false if it has just been created
+    inline T & local(bool & exists){
+        return _instances.local(exists);
+    }
+
+    /// merge all the partial results with op(const T&, const T&) -> T
+    template<typename BinaryOp>
+    inline T combine(BinaryOp op) const{
+        return _instances.combine(op);
+    }
+
+    /// call fun(const T &) on each partial result
+    template<typename Function>
+    inline void combine_each(Function fun) const{
+        _instances.combine_each(fun);
+    }
+
+    /// destroy all the partial results
+    inline void clear(){
+        _instances.clear();
+    }
+
+private:
+    combinable(const combinable &) = delete;
+    combinable & operator=(const combinable &) = delete;
+
+    enumerable_thread_specific<T> _instances;
+};
+
+
+} // thread
+
+} // hadoken
+
+#endif // _HADOKEN_COMBINABLE_HPP_
@@ -0,0 +1,378 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_ENUMERABLE_THREAD_SPECIFIC_HPP_
+#define _HADOKEN_ENUMERABLE_THREAD_SPECIFIC_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+#include <hadoken/thread/cache_line.hpp>
+
+namespace hadoken {
+
+namespace thread{
+
+
+namespace details{
+
+// key of the calling thread: the address of a thread local
+// unique among the living threads, a new thread can reuse the key of an exited one
+inline std::uintptr_t current_thread_key(){
+    static thread_local char anchor = 0;
+    return reinterpret_cast<std::uintptr_t>(&anchor);
+}
+
+
+template<typename T>
+struct ets_element{
+    inline explicit ets_element(std::uintptr_t k) : value(), key(k), next(nullptr) {}
+
+    inline ets_element(std::uintptr_t k, T && v) : value(std::move(v)), key(k), next(nullptr) {}
+
+    // keep each instance on its own cache lines
+    char _pad_front[cache_line_size];
+    T value;
+    std::uintptr_t key;
+    ets_element* next;
+    char _pad_back[cache_line_size];
+};
+
+
+// open addressing table thread key -> element
+// filled under the lock of the owner, read without lock
+template<typename Element>
+struct ets_table{
+    struct slot{
+        std::atomic<std::uintptr_t> key;
+        std::atomic<Element*> value;
+    };
+
+    inline ets_table(unsigned int log2_size, ets_table* prev) :
+        bits(log2_size), slots(new slot[std::size_t(1) << log2_size]), previous(prev){
+        for(std::size_t i = 0; i < size(); ++i){
+            slots[i].key.store(0, std::memory_order_relaxed);
+            slots[i].value.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    inline std::size_t size() const{
+        return std::size_t(1) << bits;
+    }
+
+    inline std::size_t index(std::uintptr_t key) const{
+        // fibonacci hashing, the low bits of a thread local address are almost constant
+        return static_cast<std::size_t>((static_cast<std::uint64_t>(key) * 0x9E3779B97F4A7C15ULL) >> (64 - bits));
+    }
+
+    inline Element* find(std::uintptr_t key) const{
+        for(std::size_t i = index(key); ; i = (i + 1) & (size() -1)){
+            const std::uintptr_t k = slots[i].key.load(std::memory_order_acquire);
+            if(k == key){
+                return slots[i].value.load(std::memory_order_relaxed);
+            }
+            if(k == 0){
+                return nullptr;
+            }
+        }
+    }
+
+    inline void insert(std::uintptr_t key, Element* elem){
+        std::size_t i = index(key);
+        while(slots[i].key.load(std::memory_order_relaxed) != 0){
+            i = (i + 1) & (size() -1);
+        }
+        slots[i].value.store(elem, std::memory_order_relaxed);
+        slots[i].key.store(key, std::memory_order_release);
+    }
+
+    unsigned int bits;
+    std::unique_ptr<slot[]> slots;
+    ets_table* previous;
+};
+
+
+template<typename Element, typename Value>
+class ets_iterator{
+public:
+    typedef std::forward_iterator_tag   iterator_category;
+    typedef Value                       value_type;
+    typedef std::ptrdiff_t              difference_type;
+    typedef Value*                      pointer;
+    typedef Value&                      reference;
+
+    inline ets_iterator() : _elem(nullptr) {}
+
+    inline explicit ets_iterator(Element* elem) : _elem(elem) {}
+
+    // iterator to const_iterator
+    template<typename OtherValue>
+    inline ets_iterator(const ets_iterator<Element, OtherValue> & other) : _elem(other._elem) {}
+
+    inline reference operator*() const{
+        return _elem->value;
+    }
+
+    inline pointer operator->() const{
+        return &(_elem->value);
+    }
+
+    inline ets_iterator & operator++(){
+        _elem = _elem->next;
+        return *this;
+    }
+
+    inline ets_iterator operator++(int){
+        ets_iterator res(*this);
+        _elem = _elem->next;
+        return res;
+    }
+
+    inline bool operator==(const ets_iterator & other) const{
+        return _elem == other._elem;
+    }
+
+    inline bool operator!=(const ets_iterator & other) const{
+        return _elem != other._elem;
+    }
+
+private:
+    template<typename E, typename V>
+    friend class ets_iterator;
+
+    Element* _elem;
+};
+
+
+} // details
+
+
+///
+/// \brief per-thread instances of T, enumerable
+///
+/// local() returns the instance of the calling thread, created at the first call of
+/// each thread from the exemplar, the init function, or by default construction.
+/// The lookup does not lock: a probe of a small table keyed by thread.
+/// Each instance sits on its own cache lines, no false sharing between threads.
+///
+/// there is one instance per living thread: the instances are not destroyed
+/// when their thread exits, and a thread started later can inherit the instance
+/// of a thread which has exited, with its content. This bounds the number of
+/// instances by the peak number of concurrent threads, not by the total number
+/// of threads ever started
+///
+/// works with any kind of thread: OpenMP team, workers of a thread_pool_executor
+/// or the system_executor, std::thread
+///
+/// the instances can be enumerated with begin()/end() or merged with combine(),
+/// once the parallel section is over: the iteration is not safe
+/// against a concurrent creation of instance
+///
+/// \code
+///    hadoken::thread::enumerable_thread_specific<std::vector<int> > histograms(std::vector<int>(256, 0));
+///    hadoken::parallel::for_range(hadoken::parallel::par, data.begin(), data.end(), [&](It b, It e){
+///        std::vector<int> & histo = histograms.local();
+///        for(; b != e; ++b){ histo[*b] += 1; }
+///    });
+///    for(auto & histo : histograms){ ... }
+/// \endcode
+///
+template<typename T>
+class enumerable_thread_specific{
+    typedef details::ets_element<T> element;
+    typedef details::ets_table<element> table;
+
+public:
+    typedef T                                               value_type;
+    typedef T&                                              reference;
+    typedef const T&                                        const_reference;
+    typedef std::size_t                                     size_type;
+    typedef details::ets_iterator<element, T>               iterator;
+    typedef details::ets_iterator<element, const T>         const_iterator;
+
+    /// instances are default constructed
+    inline enumerable_thread_specific() : _init(), _head(nullptr), _size(0), _table(new table(4, nullptr)), _lock() {}
+
+    /// instances are copies of exemplar
+    inline explicit enumerable_thread_specific(const T & exemplar) :
+        enumerable_thread_specific(std::function<T ()>([exemplar]() -> T { return exemplar; })) {}
+
+    /// instances are constructed by the result of init()
+    template<typename Finit, typename = typename std::enable_if<
+                 std::is_convertible<decltype(std::declval<Finit&>()()), T>::value
+                 && (std::is_convertible<Finit, T>::value == false)>::type >
+    inline explicit enumerable_thread_specific(Finit init) :
+        _init(std::move(init)), _head(nullptr), _size(0), _table(new table(4, nullptr)), _lock() {}
+
+    inline ~enumerable_thread_specific(){
+        clear();
+        table* tab = _table.load(std::memory_order_relaxed);
+        while(tab != nullptr){
+            table* prev = tab->previous;
+            delete tab;
+            tab = prev;
+        }
+    }
+
+    /// instance of the calling thread, created if needed
+    inline reference local(){
+        bool exists;
+        return local(exists);
+    }
+
+    /// instance of the calling thread, exists is false if it has just been created
+    inline reference local(bool & exists){
+        const std::uintptr_t key = details::current_thread_key();
+        element* elem = _table.load(std::memory_order_acquire)->find(key);
+        exists = (elem != nullptr);
+        if(elem == nullptr){
+            elem = _create(key);
+        }
+        return elem->value;
+    }
+
+    /// number of instances
+    inline size_type size() const{
+        return _size.load(std::memory_order_acquire);
+    }
+
+    inline bool empty() const{
+        return size() == 0;
+    }
+
+    inline iterator begin(){
+        return iterator(_head.load(std::memory_order_acquire));
+    }
+
+    inline iterator end(){
+        return iterator();
+    }
+
+    inline const_iterator begin() const{
+        return const_iterator(_head.load(std::memory_order_acquire));
+    }
+
+    inline const_iterator end() const{
+        return const_iterator();
+    }
+
+    ///
+    /// \brief merge all the instances with op(const T&, const T&) -> T
+    /// \return the merged value, or a new instance if there is none
+    ///
+    template<typename BinaryOp>
+    inline T combine(BinaryOp op) const{
+        const_iterator it = begin();
+        if(it == end()){
+            return (_init ? _init() : T());
+        }
+        T res = *it;
+        for(++it; it != end(); ++it){
+            res = op(res, *it);
+        }
+        return res;
+    }
+
+    /// call fun(const T &) on each instance
+    template<typename Function>
+    inline void combine_each(Function fun) const{
+        for(const_iterator it = begin(); it != end(); ++it){
+            fun(*it);
+        }
+    }
+
+    /// destroy all the instances, must not be called concurrently with local()
+    inline void clear(){
+        std::lock_guard<std::mutex> l(_lock);
+        element* elem = _head.load(std::memory_order_relaxed);
+        while(elem != nullptr){
+            element* next = elem->next;
+            delete elem;
+            elem = next;
+        }
+        _head.store(nullptr, std::memory_order_relaxed);
+        _size.store(0, std::memory_order_relaxed);
+
+        table* tab = _table.load(std::memory_order_relaxed);
+        for(std::size_t i = 0; i < tab->size(); ++i){
+            tab->slots[i].key.store(0, std::memory_order_relaxed);
+            tab->slots[i].value.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    enumerable_thread_specific(const enumerable_thread_specific &) = delete;
+    enumerable_thread_specific & operator=(const enumerable_thread_specific &) = delete;
+
+    inline element* _create(std::uintptr_t key){
+        // construct outside of the lock, init can be long
+        std::unique_ptr<element> new_elem(_init ? new element(key, _init()) : new element(key));
+
+        std::lock_guard<std::mutex> l(_lock);
+        table* tab = _table.load(std::memory_order_relaxed);
+
+        const std::size_t n_elems = _size.load(std::memory_order_relaxed) + 1;
+        if(n_elems * 2 > tab->size()){
+            // the readers can still probe the previous tables, they are freed with the object
+            table* new_tab = new table(tab->bits + 1, tab);
+            for(element* elem = _head.load(std::memory_order_relaxed); elem != nullptr; elem = elem->next){
+                new_tab->insert(elem->key, elem);
+            }
+            _table.store(new_tab, std::memory_order_release);
+            tab = new_tab;
+        }
+
+        element* elem = new_elem.release();
+        elem->next = _head.load(std::memory_order_relaxed);
+        _head.store(elem, std::memory_order_release);
+        _size.store(n_elems, std::memory_order_release);
+        tab->insert(key, elem);
+        return elem;
+    }
+
+    std::function<T ()> _init;
+
+    std::atomic<element*> _head;
+    std::atomic<size_type> _size;
+    std::atomic<table*> _table;
+    std::mutex _lock;
+};
+
+
+} // thread
+
+} // hadoken
+
+#endif // _HADOKEN_ENUMERABLE_THREAD_SPECIFIC_HPP_
@@ -0,0 +1,315 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_EPOCH_HPP_
+#define _HADOKEN_EPOCH_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <hadoken/thread/spinlock.hpp>
+#include <hadoken/thread/bits/reclamation_registry.hpp>
+
+namespace hadoken {
+
+namespace thread{
+
+
+namespace details{
+
+struct epoch_record{
+    inline epoch_record() : next(nullptr), in_use(false), epoch(0), nesting(0), retired() {}
+
+    epoch_record* next;
+    std::atomic<bool> in_use;
+
+    // ( epoch << 1 ) | 1 while the thread is in a critical section, 0 otherwise
+    std::atomic<std::uint64_t> epoch;
+
+    // owner thread only
+    std::size_t nesting;
+    std::vector<retired_ptr> retired;
+};
+
+
+class epoch_state{
+public:
+    typedef epoch_record record_type;
+
+    // number of objects retired by a thread before trying to free them
+    static constexpr std::size_t collect_threshold = 64;
+
+    inline epoch_state() : _global_epoch(0), _records(), _orphans_lock(), _orphans(), _closed(false) {}
+
+    inline ~epoch_state(){
+        // no thread can access the domain anymore
+        _records.for_each([](epoch_record & rec){
+            for(retired_ptr & r : rec.retired){
+                r.destroy();
+            }
+        });
+        for(retired_ptr & r : _orphans){
+            r.destroy();
+        }
+    }
+
+    inline epoch_record* acquire_record(){
+        return _records.acquire([](){ return new epoch_record(); });
+    }
+
+    inline void release_record(epoch_record* rec){
+        if(rec->retired.empty() == false){
+            std::lock_guard<spin_lock> l(_orphans_lock);
+            _orphans.insert(_orphans.end(), rec->retired.begin(), rec->retired.end());
+            rec->retired.clear();
+        }
+        _records.release(rec);
+    }
+
+    inline void pin(epoch_record* rec){
+        if(rec->nesting++ == 0){
+            const std::uint64_t e = _global_epoch.load(std::memory_order_relaxed);
+            rec->epoch.store((e << 1) | 1, std::memory_order_relaxed);
+            // the announce has to be visible before any read of the shared data
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    inline void unpin(epoch_record* rec){
+        if(--rec->nesting == 0){
+            rec->epoch.store(0, std::memory_order_release);
+        }
+    }
+
+    inline void retire(epoch_record* rec, void* ptr, void (*deleter)(void*)){
+        const retired_ptr r = { ptr, deleter, _global_epoch.load(std::memory_order_acquire) };
+        rec->retired.push_back(r);
+
+        if(rec->retired.size() >= collect_threshold){
+            try_advance();
+            reclaim(rec->retired);
+        }
+    }
+
+    // move to the next epoch if all the threads in a critical section observed the current one
+    inline bool try_advance(){
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::uint64_t e = _global_epoch.load(std::memory_order_acquire);
+
+        bool all_observed = true;
+        _records.for_each([&](const epoch_record & rec){
+            const std::uint64_t v = rec.epoch.load(std::memory_order_acquire);
+            if((v & 1) && (v >> 1) != e){
+                all_observed = false;
+            }
+        });
+
+        return (all_observed && _global_epoch.compare_exchange_strong(e, e + 1, std::memory_order_acq_rel));
+    }
+
+    // free the objects retired at least two epochs ago: no thread can still see them
+    inline void reclaim(std::vector<retired_ptr> & retired){
+        const std::uint64_t e = _global_epoch.load(std::memory_order_acquire);
+
+        std::vector<retired_ptr>::iterator it = std::partition(retired.begin(), retired.end(), [e](const retired_ptr & r){
+            return (r.epoch + 2 > e);
+        });
+
+        // a deleter can retire other objects
+        std::vector<retired_ptr> ready(it, retired.end());
+        retired.erase(it, retired.end());
+        for(retired_ptr & r : ready){
+            r.destroy();
+        }
+    }
+
+    inline void collect(epoch_record* rec){
+        try_advance();
+        try_advance();
+        reclaim(rec->retired);
+
+        std::vector<retired_ptr> orphans;
+        {
+            std::lock_guard<spin_lock> l(_orphans_lock);
+            orphans.swap(_orphans);
+        }
+        reclaim(orphans);
+        if(orphans.empty() == false){
+            std::lock_guard<spin_lock> l(_orphans_lock);
+            _orphans.insert(_orphans.end(), orphans.begin(), orphans.end());
+        }
+    }
+
+    inline std::uint64_t epoch() const{
+        return _global_epoch.load(std::memory_order_acquire);
+    }
+
+    inline bool closed() const{
+        return _closed.load(std::memory_order_acquire);
+    }
+
+    inline void close(){
+        _closed.store(true, std::memory_order_release);
+    }
+
+private:
+    epoch_state(const epoch_state &) = delete;
+
+    std::atomic<std::uint64_t> _global_epoch;
+    record_list<epoch_record> _records;
+
+    spin_lock _orphans_lock;
+    std::vector<retired_ptr> _orphans;
+
+    std::atomic<bool> _closed;
+};
+
+} // details
+
+
+///
+/// \brief epoch-based memory reclamation domain
+///
+/// readers of a lock-free structure enter a critical section with pin(),
+/// a single store and a fence. Removed objects are retire()d instead of deleted,
+/// and freed by batch once all the threads in a critical section moved to a more recent epoch.
+///
+/// cheap reads, but a thread blocked in a critical section prevents all
+/// reclamation: keep critical sections short ( see hazard_domain for bounded garbage )
+///
+/// threads register on their first use of the domain, including the workers of a
+/// thread_pool_executor, and give their record back when they exit.
+/// The objects still retired when the domain is destroyed are freed after the exit of the
+/// last thread which used it
+///
+/// \code
+///    hadoken::thread::epoch_domain domain;
+///    {
+///        auto guard = domain.pin();
+///        node* n = head.load();       // n can not be freed while guard lives
+///        ...
+///    }
+///    domain.retire(old_node);          // delete old_node, later
+/// \endcode
+///
+class epoch_domain{
+public:
+    ///
+    /// \brief critical section of the calling thread, RAII
+    ///
+    class guard{
+    public:
+        inline guard(guard && other) noexcept : _state(other._state), _record(other._record){
+            other._record = nullptr;
+        }
+
+        inline ~guard(){
+            if(_record != nullptr){
+                _state->unpin(_record);
+            }
+        }
+
+    private:
+        inline guard(details::epoch_state* state, details::epoch_record* record) : _state(state), _record(record){
+            _state->pin(_record);
+        }
+
+        guard(const guard &) = delete;
+        guard & operator=(const guard &) = delete;
+
+        friend class epoch_domain;
+
+        details::epoch_state* _state;
+        details::epoch_record* _record;
+    };
+
+    inline epoch_domain() : _state(std::make_shared<details::epoch_state>()) {}
+
+    inline ~epoch_domain(){
+        _state->close();
+    }
+
+    /// enter a critical section, can be nested
+    inline guard pin(){
+        return guard(_state.get(), _local_record());
+    }
+
+    /// delete ptr once no thread can access it anymore
+    template<typename T>
+    inline void retire(T* ptr){
+        retire(static_cast<void*>(ptr), &details::delete_retired<T>);
+    }
+
+    /// call deleter(ptr) once no thread can access ptr anymore
+    inline void retire(void* ptr, void (*deleter)(void*)){
+        _state->retire(_local_record(), ptr, deleter);
+    }
+
+    /// try to advance the epoch and free the retired objects of the calling thread
+    /// and of the exited threads
+    inline void collect(){
+        _state->collect(_local_record());
+    }
+
+    /// register the calling thread now, instead of at its first use of the domain
+    inline void register_current_thread(){
+        _local_record();
+    }
+
+    /// current global epoch
+    inline std::uint64_t epoch() const{
+        return _state->epoch();
+    }
+
+    /// domain shared by all the users of the process
+    static inline epoch_domain & global_domain(){
+        static epoch_domain domain;
+        return domain;
+    }
+
+private:
+    epoch_domain(const epoch_domain &) = delete;
+    epoch_domain & operator=(const epoch_domain &) = delete;
+
+    inline details::epoch_record* _local_record(){
+        return details::thread_records<details::epoch_state>::local().get(_state);
+    }
+
+    std::shared_ptr<details::epoch_state> _state;
+};
+
+
+} // thread
+
+} // hadoken
+
+#endif // _HADOKEN_EPOCH_HPP_
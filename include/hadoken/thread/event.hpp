@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_EVENT_HPP_
+#define _HADOKEN_EVENT_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <hadoken/thread/futex.hpp>
+
+namespace hadoken {
+
+namespace thread{
+
+
+///
+/// \brief auto-reset event
+///
+/// set() signals the event: it wakes up one waiting thread, or the next thread calling wait()
+/// if none is waiting. The signal is consumed by the thread it wakes up.
+/// Several set() without wait() in between are equivalent to a single one
+///
+class auto_reset_event{
+public:
+    inline explicit auto_reset_event(bool signaled = false) :
+        _state(signaled ? 1 : 0),
+        _waiters(0){}
+
+    ~auto_reset_event() = default;
+
+    /// signal the event
+    inline void set(){
+        if(_state.exchange(1) == 0 && _waiters.load() > 0){
+            futex_wake(&_state, 1);
+        }
+    }
+
+    /// consume the signal if the event is signaled, without blocking
+    inline bool try_wait() noexcept{
+        return (_state.load(std::memory_order_relaxed) == 1 && _state.exchange(0, std::memory_order_acquire) == 1);
+    }
+
+    /// block until the event is signaled, and consume the signal
+    inline void wait(){
+        if(details::spin_until([this](){ return try_wait(); })){
+            return;
+        }
+
+        _waiters.fetch_add(1);
+        while(try_wait() == false){
+            futex_wait(&_state, 0);
+        }
+        _waiters.fetch_sub(1);
+    }
+
+    /// block until the event is signaled or the timeout expires
+    /// \return true if the signal has been consumed
+    template<typename Rep, typename Period>
+    inline bool wait_for(const std::chrono::duration<Rep, Period> & timeout){
+        const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now()
+                + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+
+        if(details::spin_until([this](){ return try_wait(); })){
+            return true;
+        }
+
+        bool res = false;
+        _waiters.fetch_add(1);
+        while( (res = try_wait()) == false){
+            const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if(now >= deadline){
+                break;
+            }
+            futex_wait(&_state, 0, std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now));
+        }
+        _waiters.fetch_sub(1);
+        return res;
+    }
+
+private:
+    auto_reset_event(const auto_reset_event &) = delete;
+    auto_reset_event & operator=(const auto_reset_event &) = delete;
+
+    futex_word _state;
+    std::atomic<std::int32_t> _waiters;
+};
+
+
+} // thread
+
+} // hadoken
+
+#endif // _HADOKEN_EVENT_HPP_
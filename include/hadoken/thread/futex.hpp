@@ -0,0 +1,178 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_FUTEX_HPP_
+#define _HADOKEN_FUTEX_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+#ifdef __linux__
+#include <cerrno>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define HADOKEN_HAS_FUTEX 1
+#endif
+
+#include <hadoken/thread/backoff.hpp>
+
+namespace hadoken {
+
+namespace thread{
+
+
+///
+/// \brief 32 bits word usable with futex_wait / futex_wake
+///
+typedef std::atomic<std::int32_t> futex_word;
+
+
+namespace details{
+
+#ifndef HADOKEN_HAS_FUTEX
+
+// portable emulation: waiters are parked on a condition variable
+// selected by the address of the futex word
+struct futex_bucket{
+    std::mutex mut;
+    std::condition_variable cond;
+};
+
+inline futex_bucket & get_futex_bucket(const futex_word* addr){
+    static futex_bucket buckets[64];
+    return buckets[(reinterpret_cast<std::uintptr_t>(addr) >> 2) % 64];
+}
+
+#endif
+
+} // details
+
+
+///
+/// \brief block the calling thread while *addr == expected
+///
+/// may return spuriously, the caller has to check its condition again
+///
+/// \param timeout : maximum waiting time, or negative for no timeout
+/// \return false if the timeout expired
+///
+inline bool futex_wait(futex_word* addr, std::int32_t expected, std::chrono::nanoseconds timeout = std::chrono::nanoseconds(-1)){
+#ifdef HADOKEN_HAS_FUTEX
+    static_assert(sizeof(futex_word) == sizeof(std::int32_t), "futex word needs to be 32 bits");
+
+    struct timespec ts;
+    struct timespec* ts_ptr = nullptr;
+    if(timeout.count() >= 0){
+        ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+        ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+        ts_ptr = &ts;
+    }
+
+    const long res = syscall(SYS_futex, reinterpret_cast<std::int32_t*>(addr), FUTEX_WAIT_PRIVATE, expected, ts_ptr, nullptr, 0);
+    return !(res != 0 && errno == ETIMEDOUT);
+#else
+    details::futex_bucket & bucket = details::get_futex_bucket(addr);
+    std::unique_lock<std::mutex> l(bucket.mut);
+    if(addr->load() != expected){
+        return true;
+    }
+    if(timeout.count() < 0){
+        bucket.cond.wait(l);
+        return true;
+    }
+    return (bucket.cond.wait_for(l, timeout) == std::cv_status::no_timeout);
+#endif
+}
+
+
+///
+/// \brief wake up to n threads blocked in futex_wait on addr
+///
+inline void futex_wake(futex_word* addr, std::int32_t n){
+#ifdef HADOKEN_HAS_FUTEX
+    syscall(SYS_futex, reinterpret_cast<std::int32_t*>(addr), FUTEX_WAKE_PRIVATE, n, nullptr, nullptr, 0);
+#else
+    details::futex_bucket & bucket = details::get_futex_bucket(addr);
+    {
+        // serialize with the check done by the waiters
+        std::lock_guard<std::mutex> l(bucket.mut);
+    }
+    // buckets are shared between addresses: wake everyone
+    (void) n;
+    bucket.cond.notify_all();
+#endif
+}
+
+
+///
+/// \brief wake all the threads blocked in futex_wait on addr
+///
+inline void futex_wake_all(futex_word* addr){
+    futex_wake(addr, std::numeric_limits<std::int32_t>::max());
+}
+
+
+namespace details{
+
+// number of cpu_relax() iterations before going to sleep in the futex
+constexpr std::size_t futex_spin_count = 256;
+
+inline bool is_uniprocessor(){
+    static const bool uniprocessor = (std::thread::hardware_concurrency() == 1);
+    return uniprocessor;
+}
+
+// spin briefly until pred() is true, spinning is useless on a single cpu
+// return false if the spin limit has been reached
+template<typename Predicate>
+inline bool spin_until(Predicate pred){
+    const std::size_t n_spin = (is_uniprocessor()) ? (0) : (futex_spin_count);
+    for(std::size_t i = 0; i < n_spin; ++i){
+        if(pred()){
+            return true;
+        }
+        cpu_relax();
+    }
+    return pred();
+}
+
+} // details
+
+
+} // thread
+
+} // hadoken
+
+#endif // _HADOKEN_FUTEX_HPP_
@@ -0,0 +1,333 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_HAZARD_POINTER_HPP_
+#define _HADOKEN_HAZARD_POINTER_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include <hadoken/thread/spinlock.hpp>
+#include <hadoken/thread/bits/reclamation_registry.hpp>
+
+namespace hadoken {
+
+namespace thread{
+
+
+namespace details{
+
+struct hazard_record{
+    inline explicit hazard_record(std::size_t n_slots) :
+        next(nullptr), in_use(false), slots(new std::atomic<void*>[n_slots]), slot_used(n_slots, false), retired(){
+        for(std::size_t i = 0; i < n_slots; ++i){
+            slots[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    hazard_record* next;
+    std::atomic<bool> in_use;
+
+    // hazards published by the owner thread, read by the scanning threads
+    std::unique_ptr<std::atomic<void*>[]> slots;
+
+    // owner thread only
+    std::vector<bool> slot_used;
+    std::vector<retired_ptr> retired;
+};
+
+
+class hazard_state{
+public:
+    typedef hazard_record record_type;
+
+    inline explicit hazard_state(std::size_t slots_per_thread) :
+        _slots_per_thread(slots_per_thread), _n_records(0), _records(), _orphans_lock(), _orphans(), _closed(false) {}
+
+    inline ~hazard_state(){
+        _records.for_each([](hazard_record & rec){
+            for(retired_ptr & r : rec.retired){
+                r.destroy();
+            }
+        });
+        for(retired_ptr & r : _orphans){
+            r.destroy();
+        }
+    }
+
+    inline hazard_record* acquire_record(){
+        return _records.acquire([this](){
+            _n_records.fetch_add(1, std::memory_order_relaxed);
+            return new hazard_record(_slots_per_thread);
+        });
+    }
+
+    inline void release_record(hazard_record* rec){
+        for(std::size_t i = 0; i < _slots_per_thread; ++i){
+            rec->slots[i].store(nullptr, std::memory_order_release);
+            rec->slot_used[i] = false;
+        }
+        if(rec->retired.empty() == false){
+            std::lock_guard<spin_lock> l(_orphans_lock);
+            _orphans.insert(_orphans.end(), rec->retired.begin(), rec->retired.end());
+            rec->retired.clear();
+        }
+        _records.release(rec);
+    }
+
+    inline std::size_t slots_per_thread() const{
+        return _slots_per_thread;
+    }
+
+    // scan when the number of retired objects is twice the number of hazards:
+    // amortized O(1) per retire, and at most this number of objects waiting per thread
+    inline std::size_t scan_threshold() const{
+        return std::max<std::size_t>(2 * _slots_per_thread * _n_records.load(std::memory_order_relaxed), 64);
+    }
+
+    inline void retire(hazard_record* rec, void* ptr, void (*deleter)(void*)){
+        const retired_ptr r = { ptr, deleter, 0 };
+        rec->retired.push_back(r);
+
+        if(rec->retired.size() >= scan_threshold()){
+            scan(rec->retired);
+        }
+    }
+
+    // free the retired objects not protected by any hazard pointer
+    inline void scan(std::vector<retired_ptr> & retired){
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        std::vector<void*> hazards;
+        _records.for_each([&](const hazard_record & rec){
+            for(std::size_t i = 0; i < _slots_per_thread; ++i){
+                void* p = rec.slots[i].load(std::memory_order_acquire);
+                if(p != nullptr){
+                    hazards.push_back(p);
+                }
+            }
+        });
+        std::sort(hazards.begin(), hazards.end());
+
+        std::vector<retired_ptr>::iterator it = std::partition(retired.begin(), retired.end(), [&hazards](const retired_ptr & r){
+            return std::binary_search(hazards.begin(), hazards.end(), r.ptr);
+        });
+
+        // a deleter can retire other objects
+        std::vector<retired_ptr> ready(it, retired.end());
+        retired.erase(it, retired.end());
+        for(retired_ptr & r : ready){
+            r.destroy();
+        }
+    }
+
+    inline void collect(hazard_record* rec){
+        scan(rec->retired);
+
+        std::vector<retired_ptr> orphans;
+        {
+            std::lock_guard<spin_lock> l(_orphans_lock);
+            orphans.swap(_orphans);
+        }
+        scan(orphans);
+        if(orphans.empty() == false){
+            std::lock_guard<spin_lock> l(_orphans_lock);
+            _orphans.insert(_orphans.end(), orphans.begin(), orphans.end());
+        }
+    }
+
+    inline bool closed() const{
+        return _closed.load(std::memory_order_acquire);
+    }
+
+    inline void close(){
+        _closed.store(true, std::memory_order_release);
+    }
+
+private:
+    hazard_state(const hazard_state &) = delete;
+
+    const std::size_t _slots_per_thread;
+    std::atomic<std::size_t> _n_records;
+    record_list<hazard_record> _records;
+
+    spin_lock _orphans_lock;
+    std::vector<retired_ptr> _orphans;
+
+    std::atomic<bool> _closed;
+};
+
+} // details
+
+
+///
+/// \brief hazard pointer memory reclamation domain
+///
+/// a reader publishes the pointer it is about to dereference in one of
+/// the hazard slots of its thread ( protect() ). Removed objects are retire()d, and freed
+/// by the retiring thread once no hazard slot points to them anymore.
+///
+/// a protection costs a store and a fence per pointer, more than an epoch_domain pin,
+/// but the number of objects waiting to be freed stays bounded even if a reader is blocked.
+///
+/// threads register on their first use of the domain, including the workers of a
+/// thread_pool_executor, and give their record back when they exit.
+///
+/// \code
+///    hadoken::thread::hazard_domain domain;
+///    auto hp = domain.make_hazard_pointer();
+///    node* n = hp.protect(head);      // n can not be freed until hp is reset
+///    ...
+///    domain.retire(old_node);         // delete old_node, later
+/// \endcode
+///
+class hazard_domain{
+public:
+    ///
+    /// \brief hazard slot owned by the calling thread, RAII
+    ///
+    class hazard_pointer{
+    public:
+        inline hazard_pointer(hazard_pointer && other) noexcept : _record(other._record), _index(other._index){
+            other._record = nullptr;
+        }
+
+        inline ~hazard_pointer(){
+            if(_record != nullptr){
+                reset();
+                _record->slot_used[_index] = false;
+            }
+        }
+
+        ///
+        /// \brief load src and protect the loaded pointer
+        /// \return a pointer that stays valid until reset() or the next protect()
+        ///
+        template<typename T>
+        inline T* protect(const std::atomic<T*> & src){
+            T* ptr = src.load(std::memory_order_relaxed);
+            while(1){
+                _record->slots[_index].store(ptr, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                // still reachable after the publication: can not have been retired before it
+                T* current = src.load(std::memory_order_acquire);
+                if(current == ptr){
+                    return ptr;
+                }
+                ptr = current;
+            }
+        }
+
+        /// release the protection
+        inline void reset(){
+            _record->slots[_index].store(nullptr, std::memory_order_release);
+        }
+
+    private:
+        inline hazard_pointer(details::hazard_record* record, std::size_t index) : _record(record), _index(index) {}
+
+        hazard_pointer(const hazard_pointer &) = delete;
+        hazard_pointer & operator=(const hazard_pointer &) = delete;
+
+        friend class hazard_domain;
+
+        details::hazard_record* _record;
+        std::size_t _index;
+    };
+
+    ///
+    /// \brief create a domain
+    /// \param slots_per_thread : maximum number of hazard pointers alive at the same time in a thread
+    ///
+    inline explicit hazard_domain(std::size_t slots_per_thread = 4) :
+        _state(std::make_shared<details::hazard_state>(slots_per_thread)) {}
+
+    inline ~hazard_domain(){
+        _state->close();
+    }
+
+    ///
+    /// \brief take a free hazard slot of the calling thread
+    /// \throw std::length_error if all the slots of the thread are in use
+    ///
+    inline hazard_pointer make_hazard_pointer(){
+        details::hazard_record* rec = _local_record();
+        for(std::size_t i = 0; i < _state->slots_per_thread(); ++i){
+            if(rec->slot_used[i] == false){
+                rec->slot_used[i] = true;
+                return hazard_pointer(rec, i);
+            }
+        }
+        throw std::length_error("hazard_domain: no hazard pointer slot left for this thread");
+    }
+
+    /// delete ptr once no hazard pointer protects it
+    template<typename T>
+    inline void retire(T* ptr){
+        retire(static_cast<void*>(ptr), &details::delete_retired<T>);
+    }
+
+    /// call deleter(ptr) once no hazard pointer protects ptr
+    inline void retire(void* ptr, void (*deleter)(void*)){
+        _state->retire(_local_record(), ptr, deleter);
+    }
+
+    /// free the retired objects of the calling thread and of the exited threads
+    /// which are not protected anymore
+    inline void collect(){
+        _state->collect(_local_record());
+    }
+
+    /// register the calling thread now, instead of at its first use of the domain
+    inline void register_current_thread(){
+        _local_record();
+    }
+
+private:
+    hazard_domain(const hazard_domain &) = delete;
+    hazard_domain & operator=(const hazard_domain &) = delete;
+
+    inline details::hazard_record* _local_record(){
+        return details::thread_records<details::hazard_state>::local().get(_state);
+    }
+
+    std::shared_ptr<details::hazard_state> _state;
+};
+
+
+} // thread
+
+} // hadoken
+
+#endif // _HADOKEN_HAZARD_POINTER_HPP_
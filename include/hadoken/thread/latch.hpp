@@ -30,9 +30,10 @@
 #define _HADOKEN_LATCH_HPP_
 
 #include <atomic>
-#include <thread>
+#include <cstdint>
 #include <assert.h>
-#include <condition_variable>
+
+#include <hadoken/thread/futex.hpp>
 
 
 namespace hadoken {
@@ -49,6 +50,7 @@ namespace thread{
 /// Threads may block on the latch until the counter is decremented to zero.
 /// There is no possibility to increase or reset the counter, which makes the latch a single-use barrier.
 ///
+/// waiters spin briefly, then sleep on a futex and are woken up as soon as the counter reaches 0
 ///
 class latch{
 public:
@@ -57,10 +59,12 @@ public:
     /// \param value : the initial value of the counter, must be non negative
     ///
     inline latch(std::ptrdiff_t value) :
-        _counter((value !=0)?(value):(unlocked)),
-        _cond(),
-        _latch_lock(){
+        _counter(value),
+        _state(pending){
         assert(value >= 0);
+        if(value == 0){
+            _state.store(ready);
+        }
     }
 
     /// default destructor
@@ -73,7 +77,12 @@ public:
     ///
     inline void count_down(std::ptrdiff_t n = 1){
         const std::ptrdiff_t previous_val = _counter.fetch_sub(n);
-        __check_and_notify(previous_val - n);
+        if(previous_val > 0 && previous_val - n <= 0){
+            // wake up only if someone sleeps
+            if(_state.exchange(ready) == pending_with_waiters){
+                futex_wake_all(&_state);
+            }
+        }
     }
 
 
@@ -89,50 +98,40 @@ public:
     /// \brief return  true if the counter reached 0
     ///
     inline bool is_ready() const{
-        return (_counter.load() <= unlocked);
+        return (_state.load(std::memory_order_acquire) == ready);
     }
 
     ///
     /// \brief wait untile the counter reach 0
     ///
     inline void wait(){
-        // lightweight optimistic two phases unlock
-        // avoid race condition on condition variable/mutex destruction
-        // if the lifetime of the latch is the same that one of the waiting thread
-        while(_counter.load() > unlocked){
-            if(_counter.load() > 0){
-                std::unique_lock<std::mutex> _l(_latch_lock);
-                _cond.wait_for(_l, std::chrono::milliseconds(1));
-            }else{
-#ifndef HADOKEN_SPIN_NO_YIELD
-                std::this_thread::yield();
-#else
-                // dummy implementation for platforms without sched_yield() support 
-                usleep(1);
-#endif
-            }
+        if(details::spin_until([this](){ return is_ready(); })){
+            return;
         }
-    }
 
-
-private:
-    static constexpr std::ptrdiff_t unlocked = -2048;
-
-    inline void __check_and_notify(std::ptrdiff_t v){
-        if(v <= 0){
-            _cond.notify_all();
-            _counter.store(unlocked);
+        while(1){
+            std::int32_t state = _state.load();
+            if(state == ready){
+                return;
+            }
+            if(state == pending && _state.compare_exchange_strong(state, pending_with_waiters) == false){
+                continue;
+            }
+            futex_wait(&_state, pending_with_waiters);
         }
     }
 
 
+private:
+    static constexpr std::int32_t pending = 0;
+    static constexpr std::int32_t pending_with_waiters = 1;
+    static constexpr std::int32_t ready = 2;
 
     latch(const latch &) = delete;
     latch & operator=(const latch&) = delete;
 
     std::atomic<std::ptrdiff_t> _counter;
-    std::condition_variable _cond;
-    std::mutex _latch_lock;
+    futex_word _state;
 };
 
 
@@ -0,0 +1,180 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_MCS_LOCK_HPP_
+#define _HADOKEN_MCS_LOCK_HPP_
+
+#include <atomic>
+#include <vector>
+
+#include <hadoken/thread/backoff.hpp>
+#include <hadoken/thread/cache_line.hpp>
+
+namespace hadoken {
+
+namespace thread{
+
+
+namespace details{
+
+struct mcs_node{
+    inline mcs_node() : next(nullptr), locked(false) {}
+
+    std::atomic<mcs_node*> next;
+    std::atomic<bool> locked;
+    // one node per cache line, waiters spin on their own line
+    char _pad[cache_line_size - sizeof(std::atomic<mcs_node*>) - sizeof(std::atomic<bool>)];
+};
+
+
+// per-thread cache of queue nodes, one node is in use per lock held by the thread
+class mcs_node_cache{
+public:
+    inline mcs_node_cache() : _nodes() {}
+
+    inline ~mcs_node_cache(){
+        for(mcs_node* node : _nodes){
+            delete node;
+        }
+    }
+
+    inline mcs_node* acquire(){
+        if(_nodes.empty()){
+            return new mcs_node();
+        }
+        mcs_node* node = _nodes.back();
+        _nodes.pop_back();
+        return node;
+    }
+
+    inline void release(mcs_node* node){
+        _nodes.push_back(node);
+    }
+
+private:
+    mcs_node_cache(const mcs_node_cache &) = delete;
+
+    std::vector<mcs_node*> _nodes;
+};
+
+
+inline mcs_node_cache & local_mcs_nodes(){
+    static thread_local mcs_node_cache cache;
+    return cache;
+}
+
+} // details
+
+
+///
+/// \brief MCS queue lock ( Mellor-Crummey and Scott )
+///
+/// FIFO lock where each waiter spins on its own queue node, the lock
+/// hand-off touches a single remote cache line. Fair and scalable under high
+/// contention, but slower than a test and test-and-set lock when uncontended.
+///
+/// queue nodes are taken from a thread local cache, so that the lock is BasicLockable
+/// and can be used with std::lock_guard. The lock must be released by the thread which acquired it.
+///
+class mcs_lock{
+public:
+    inline mcs_lock() : _tail(nullptr), _owner(nullptr) {}
+
+    inline void lock(){
+        details::mcs_node* node = details::local_mcs_nodes().acquire();
+        node->next.store(nullptr, std::memory_order_relaxed);
+        node->locked.store(true, std::memory_order_relaxed);
+
+        details::mcs_node* pred = _tail.exchange(node, std::memory_order_acq_rel);
+        if(pred != nullptr){
+            pred->next.store(node, std::memory_order_release);
+
+            exponential_backoff backoff;
+            while(node->locked.load(std::memory_order_acquire)){
+                backoff.pause();
+            }
+        }
+
+        _owner = node;
+    }
+
+    inline bool try_lock(){
+        if(_tail.load(std::memory_order_relaxed) != nullptr){
+            return false;
+        }
+
+        details::mcs_node* node = details::local_mcs_nodes().acquire();
+        node->next.store(nullptr, std::memory_order_relaxed);
+
+        details::mcs_node* expected = nullptr;
+        if(_tail.compare_exchange_strong(expected, node, std::memory_order_acquire, std::memory_order_relaxed)){
+            _owner = node;
+            return true;
+        }
+
+        details::local_mcs_nodes().release(node);
+        return false;
+    }
+
+    inline void unlock(){
+        details::mcs_node* node = _owner;
+        details::mcs_node* next = node->next.load(std::memory_order_acquire);
+
+        if(next == nullptr){
+            details::mcs_node* expected = node;
+            if(_tail.compare_exchange_strong(expected, nullptr, std::memory_order_release, std::memory_order_relaxed)){
+                details::local_mcs_nodes().release(node);
+                return;
+            }
+
+            // a successor is enqueued, wait for it to link itself
+            exponential_backoff backoff;
+            while( (next = node->next.load(std::memory_order_acquire)) == nullptr){
+                backoff.pause();
+            }
+        }
+
+        next->locked.store(false, std::memory_order_release);
+        details::local_mcs_nodes().release(node);
+    }
+
+private:
+    mcs_lock(const mcs_lock &) = delete;
+    mcs_lock & operator=(const mcs_lock&) = delete;
+
+    std::atomic<details::mcs_node*> _tail;
+    // only accessed by the lock owner
+    details::mcs_node* _owner;
+};
+
+
+} // thread
+
+} // hadoken
+
+#endif // _HADOKEN_MCS_LOCK_HPP_
@@ -0,0 +1,303 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_MPMC_QUEUE_HPP_
+#define _HADOKEN_MPMC_QUEUE_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include <hadoken/thread/backoff.hpp>
+#include <hadoken/thread/cache_line.hpp>
+#include <hadoken/thread/futex.hpp>
+
+namespace hadoken {
+
+namespace thread{
+
+
+namespace details{
+
+// sleeping threads of a blocking queue operation, woken up by the opposite operation
+// ( event count: waiters read the epoch, check their condition, then sleep on the epoch )
+//
+// the waiting flag is cleared by the first notification: the notifications following it
+// do not pay for a syscall until a thread goes back to sleep
+class queue_waiters{
+public:
+    inline queue_waiters() : _epoch(0), _waiting(0) {}
+
+    inline std::int32_t prepare_wait(){
+        const std::int32_t epoch = _epoch.load(std::memory_order_acquire);
+        _waiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return epoch;
+    }
+
+    inline void wait(std::int32_t epoch){
+        futex_wait(&_epoch, epoch);
+    }
+
+    inline void notify_all(){
+        // order the publication of the queue update with the read of the flag
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(_waiting.load(std::memory_order_relaxed) != 0 && _waiting.exchange(0) != 0){
+            _epoch.fetch_add(1);
+            futex_wake_all(&_epoch);
+        }
+    }
+
+private:
+    futex_word _epoch;
+    std::atomic<std::int32_t> _waiting;
+};
+
+} // details
+
+
+///
+/// \brief bounded lock-free multi-producer / multi-consumer queue
+///
+/// ring buffer of sequence-numbered slots ( D. Vyukov ): producers and consumers
+/// claim a position with a single CAS on the tail ( resp. head ) counter, then wait for the
+/// sequence number of the slot. Head and tail are on separate cache lines.
+///
+/// try_push / try_pop never block. push / pop spin with a backoff,
+/// then sleep until the queue is no longer full / empty.
+///
+/// capacity is rounded up to a power of two
+///
+template<typename T>
+class mpmc_queue{
+public:
+    typedef T value_type;
+
+    ///
+    /// \brief create a queue
+    /// \param capacity : maximum number of elements, at least 2
+    ///
+    inline explicit mpmc_queue(std::size_t capacity) :
+        _mask(_round_capacity(capacity) - 1),
+        _slots(new slot[_mask + 1]),
+        _head(0),
+        _tail(0),
+        _not_full(),
+        _not_empty(){
+        for(std::size_t i = 0; i <= _mask; ++i){
+            _slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    inline ~mpmc_queue(){
+        const std::size_t tail = _tail.value.load(std::memory_order_relaxed);
+        for(std::size_t pos = _head.value.load(std::memory_order_relaxed); pos != tail; ++pos){
+            _slots[pos & _mask].address()->~T();
+        }
+    }
+
+    /// push a copy of val if the queue is not full
+    inline bool try_push(const T & val){
+        return try_emplace(val);
+    }
+
+    /// push val if the queue is not full
+    inline bool try_push(T && val){
+        return try_emplace(std::move(val));
+    }
+
+    /// construct an element in place if the queue is not full
+    template<typename ... Args>
+    inline bool try_emplace(Args && ... args){
+        std::size_t pos = _tail.value.load(std::memory_order_relaxed);
+        slot* s;
+
+        while(1){
+            s = &_slots[pos & _mask];
+            const std::size_t seq = s->sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+
+            if(diff == 0){
+                if(_tail.value.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+                    break;
+                }
+            }else if(diff < 0){
+                // full
+                return false;
+            }else{
+                pos = _tail.value.load(std::memory_order_relaxed);
+            }
+        }
+
+        new (s->address()) T(std::forward<Args>(args)...);
+        s->sequence.store(pos + 1, std::memory_order_release);
+
+        _not_empty.notify_all();
+        return true;
+    }
+
+    /// pop an element into val if the queue is not empty
+    inline bool try_pop(T & val){
+        std::size_t pos = _head.value.load(std::memory_order_relaxed);
+        slot* s;
+
+        while(1){
+            s = &_slots[pos & _mask];
+            const std::size_t seq = s->sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+
+            if(diff == 0){
+                if(_head.value.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+                    break;
+                }
+            }else if(diff < 0){
+                // empty
+                return false;
+            }else{
+                pos = _head.value.load(std::memory_order_relaxed);
+            }
+        }
+
+        T* elem = s->address();
+        val = std::move(*elem);
+        elem->~T();
+        s->sequence.store(pos + _mask + 1, std::memory_order_release);
+
+        _not_full.notify_all();
+        return true;
+    }
+
+    /// push a copy of val, block while the queue is full
+    inline void push(const T & val){
+        _blocking(_not_full, [&](){ return try_push(val); });
+    }
+
+    /// push val, block while the queue is full
+    inline void push(T && val){
+        _blocking(_not_full, [&](){ return try_push(std::move(val)); });
+    }
+
+    /// pop an element, block while the queue is empty
+    inline void pop(T & val){
+        _blocking(_not_empty, [&](){ return try_pop(val); });
+    }
+
+    /// pop an element, block while the queue is empty
+    inline T pop(){
+        T val;
+        pop(val);
+        return val;
+    }
+
+    /// maximum number of elements
+    inline std::size_t capacity() const noexcept{
+        return _mask + 1;
+    }
+
+    /// number of elements, approximative if the queue is accessed concurrently
+    inline std::size_t size_approx() const noexcept{
+        const std::size_t head = _head.value.load(std::memory_order_relaxed);
+        const std::size_t tail = _tail.value.load(std::memory_order_relaxed);
+        return (tail > head) ? (tail - head) : (0);
+    }
+
+    inline bool empty_approx() const noexcept{
+        return (size_approx() == 0);
+    }
+
+private:
+    mpmc_queue(const mpmc_queue &) = delete;
+    mpmc_queue & operator=(const mpmc_queue &) = delete;
+
+    struct slot{
+        inline T* address() noexcept{
+            return reinterpret_cast<T*>(&storage);
+        }
+
+        std::atomic<std::size_t> sequence;
+        typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type storage;
+    };
+
+    struct padded_counter{
+        inline padded_counter(std::size_t v) : value(v) {}
+
+        char _pad_front[cache_line_size];
+        std::atomic<std::size_t> value;
+        char _pad_back[cache_line_size - sizeof(std::atomic<std::size_t>)];
+    };
+
+    static inline std::size_t _round_capacity(std::size_t capacity){
+        if(capacity > (std::numeric_limits<std::size_t>::max() >> 2)){
+            throw std::invalid_argument("mpmc_queue: capacity too large");
+        }
+        std::size_t res = 2;
+        while(res < capacity){
+            res <<= 1;
+        }
+        return res;
+    }
+
+    template<typename Operation>
+    inline void _blocking(details::queue_waiters & waiters, Operation op){
+        exponential_backoff backoff;
+        const bool spin = (details::is_uniprocessor() == false);
+        while(op() == false){
+            if(spin && backoff.saturated() == false){
+                backoff.pause();
+                continue;
+            }
+
+            const std::int32_t epoch = waiters.prepare_wait();
+            if(op()){
+                return;
+            }
+            waiters.wait(epoch);
+        }
+    }
+
+    const std::size_t _mask;
+    std::unique_ptr<slot[]> _slots;
+
+    padded_counter _head;
+    padded_counter _tail;
+
+    details::queue_waiters _not_full;
+    details::queue_waiters _not_empty;
+};
+
+
+} // thread
+
+} // hadoken
+
+#endif // _HADOKEN_MPMC_QUEUE_HPP_
@@ -0,0 +1,104 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_PADDED_HPP_
+#define _HADOKEN_PADDED_HPP_
+
+#include <type_traits>
+#include <utility>
+
+#include <hadoken/thread/cache_line.hpp>
+
+namespace hadoken {
+
+namespace thread{
+
+
+///
+/// \brief padded<T> holds a T alone on its cache lines
+///
+/// the value is surrounded by a cache line of padding on each side: it can not
+/// share a line with its neighbours whatever the alignment of the allocation.
+/// Use it for data written by different threads and stored side by side,
+/// e.g. std::vector<padded<std::atomic<int> > >, to prevent false sharing
+///
+template<typename T>
+class padded{
+public:
+    typedef T value_type;
+
+    inline padded() : value() {}
+
+    inline padded(const padded & other) : value(other.value) {}
+
+    inline padded & operator=(const padded & other){
+        value = other.value;
+        return *this;
+    }
+
+    /// construct the value from args
+    template<typename Arg, typename... Args, typename = typename std::enable_if<
+                 std::is_same<typename std::decay<Arg>::type, padded>::value == false>::type >
+    inline explicit padded(Arg && arg, Args &&... args) : value(std::forward<Arg>(arg), std::forward<Args>(args)...) {}
+
+    inline T & get() noexcept{
+        return value;
+    }
+
+    inline const T & get() const noexcept{
+        return value;
+    }
+
+    inline T & operator*() noexcept{
+        return value;
+    }
+
+    inline const T & operator*() const noexcept{
+        return value;
+    }
+
+    inline T* operator->() noexcept{
+        return &value;
+    }
+
+    inline const T* operator->() const noexcept{
+        return &value;
+    }
+
+private:
+    char _pad_front[cache_line_size];
+    T value;
+    char _pad_back[cache_line_size];
+};
+
+
+} // thread
+
+} // hadoken
+
+#endif // _HADOKEN_PADDED_HPP_
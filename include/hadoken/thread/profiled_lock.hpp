@@ -0,0 +1,469 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_PROFILED_LOCK_HPP_
+#define _HADOKEN_PROFILED_LOCK_HPP_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <hadoken/format/format.hpp>
+#include <hadoken/utility/singleton.hpp>
+
+///
+/// construction site of a profiled_lock: name, source file and line
+///
+/// \code
+///    hadoken::thread::profiled_lock<std::mutex> cache_lock(HADOKEN_LOCK_SITE("cache"));
+/// \endcode
+///
+#define HADOKEN_LOCK_SITE(name) name, __FILE__, __LINE__
+
+namespace hadoken {
+
+namespace thread{
+
+
+///
+/// \brief activity of all the profiled locks constructed at the same site
+///
+struct lock_site_statistics{
+    static constexpr std::size_t n_buckets = 32;
+
+    lock_site_statistics() :
+        name(), file(), line(0),
+        acquisitions(0), contended(0),
+        wait_time_ns(0), max_wait_ns(0),
+        hold_time_ns(0), hold_samples(0),
+        wait_histogram(), hold_histogram(){
+        wait_histogram.fill(0);
+        hold_histogram.fill(0);
+    }
+
+    std::string name;
+    std::string file;
+    int line;
+
+    /// number of lock acquisitions
+    std::uint64_t acquisitions;
+
+    /// number of acquisitions which had to wait for another owner
+    std::uint64_t contended;
+
+    /// total and maximum time waited by the contended acquisitions
+    std::uint64_t wait_time_ns;
+    std::uint64_t max_wait_ns;
+
+    /// total hold time of the sampled acquisitions, and their number
+    std::uint64_t hold_time_ns;
+    std::uint64_t hold_samples;
+
+    /// log2 buckets: histogram[i] counts the durations in [2^i, 2^(i+1)) ns, the last bucket is open
+    std::array<std::uint64_t, n_buckets> wait_histogram;
+    std::array<std::uint64_t, n_buckets> hold_histogram;
+};
+
+
+///
+/// \brief upper bound of the percentile p ( in [0, 1] ) of a log2 histogram, in ns
+///
+inline std::uint64_t histogram_percentile(const std::array<std::uint64_t, lock_site_statistics::n_buckets> & histogram, double p){
+    std::uint64_t total = 0;
+    for(std::uint64_t count : histogram){
+        total += count;
+    }
+    if(total == 0){
+        return 0;
+    }
+
+    const double target = p * static_cast<double>(total);
+    std::uint64_t cumulated = 0;
+    for(std::size_t i = 0; i < histogram.size(); ++i){
+        cumulated += histogram[i];
+        if(static_cast<double>(cumulated) >= target){
+            return (std::uint64_t(1) << (i + 1));
+        }
+    }
+    return (std::uint64_t(1) << histogram.size());
+}
+
+
+namespace details{
+
+typedef std::chrono::steady_clock lock_clock;
+
+inline std::uint64_t lock_elapsed_ns(const lock_clock::time_point & start, const lock_clock::time_point & end){
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+}
+
+inline std::size_t log2_bucket(std::uint64_t value){
+    std::size_t bucket = 0;
+    while(bucket < lock_site_statistics::n_buckets -1 && (value >> (bucket +1)) > 0){
+        bucket += 1;
+    }
+    return bucket;
+}
+
+
+// counters of a single lock
+//
+// only modified by the owner of the lock: a relaxed load and store, no atomic
+// read-modify-write on the fast path. Atomics so that the profiler can read them anytime
+class lock_counters{
+public:
+    inline lock_counters() : _acquisitions(0), _contended(0), _wait_ns(0), _max_wait_ns(0), _hold_ns(0), _hold_samples(0),
+        _wait_histogram(), _hold_histogram(){
+        reset();
+    }
+
+    // return the number of previous acquisitions
+    inline std::uint64_t on_acquire(){
+        return _increment(_acquisitions, 1);
+    }
+
+    inline void on_contended(std::uint64_t wait_ns){
+        _increment(_contended, 1);
+        _increment(_wait_ns, wait_ns);
+        _increment(_wait_histogram[log2_bucket(wait_ns)], 1);
+        if(wait_ns > _max_wait_ns.load(std::memory_order_relaxed)){
+            _max_wait_ns.store(wait_ns, std::memory_order_relaxed);
+        }
+    }
+
+    inline void on_release(std::uint64_t hold_ns){
+        _increment(_hold_samples, 1);
+        _increment(_hold_ns, hold_ns);
+        _increment(_hold_histogram[log2_bucket(hold_ns)], 1);
+    }
+
+    inline void accumulate(lock_site_statistics & stats) const{
+        stats.acquisitions += _acquisitions.load(std::memory_order_relaxed);
+        stats.contended += _contended.load(std::memory_order_relaxed);
+        stats.wait_time_ns += _wait_ns.load(std::memory_order_relaxed);
+        stats.max_wait_ns = std::max<std::uint64_t>(stats.max_wait_ns, _max_wait_ns.load(std::memory_order_relaxed));
+        stats.hold_time_ns += _hold_ns.load(std::memory_order_relaxed);
+        stats.hold_samples += _hold_samples.load(std::memory_order_relaxed);
+        for(std::size_t i = 0; i < lock_site_statistics::n_buckets; ++i){
+            stats.wait_histogram[i] += _wait_histogram[i].load(std::memory_order_relaxed);
+            stats.hold_histogram[i] += _hold_histogram[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    inline void reset(){
+        _acquisitions.store(0, std::memory_order_relaxed);
+        _contended.store(0, std::memory_order_relaxed);
+        _wait_ns.store(0, std::memory_order_relaxed);
+        _max_wait_ns.store(0, std::memory_order_relaxed);
+        _hold_ns.store(0, std::memory_order_relaxed);
+        _hold_samples.store(0, std::memory_order_relaxed);
+        for(std::size_t i = 0; i < lock_site_statistics::n_buckets; ++i){
+            _wait_histogram[i].store(0, std::memory_order_relaxed);
+            _hold_histogram[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    static inline std::uint64_t _increment(std::atomic<std::uint64_t> & counter, std::uint64_t value){
+        const std::uint64_t previous = counter.load(std::memory_order_relaxed);
+        counter.store(previous + value, std::memory_order_relaxed);
+        return previous;
+    }
+
+    std::atomic<std::uint64_t> _acquisitions;
+    std::atomic<std::uint64_t> _contended;
+    std::atomic<std::uint64_t> _wait_ns;
+    std::atomic<std::uint64_t> _max_wait_ns;
+    std::atomic<std::uint64_t> _hold_ns;
+    std::atomic<std::uint64_t> _hold_samples;
+    std::array<std::atomic<std::uint64_t>, lock_site_statistics::n_buckets> _wait_histogram;
+    std::array<std::atomic<std::uint64_t>, lock_site_statistics::n_buckets> _hold_histogram;
+};
+
+
+// live locks of a site and counters of the destroyed ones
+struct lock_site{
+    lock_site_statistics retired;
+    std::set<const lock_counters*> live;
+};
+
+} // details
+
+
+
+///
+/// \brief process-wide registry of the profiled locks
+///
+/// aggregates the counters of all the profiled_lock by construction site,
+/// including the locks already destroyed.
+///
+/// the report is printed on std::cerr at exit if dump_at_exit() has been called
+/// or if the environment variable HADOKEN_LOCK_PROFILE is set
+///
+class lock_profiler{
+public:
+    inline lock_profiler() : _lock(), _sites(), _dump_at_exit(std::getenv("HADOKEN_LOCK_PROFILE") != nullptr) {}
+
+    inline ~lock_profiler(){
+        if(_dump_at_exit){
+            dump(std::cerr);
+        }
+    }
+
+    /// registry of the process
+    static inline lock_profiler & instance(){
+        return singleton<lock_profiler>::instance();
+    }
+
+    /// statistics of each site, sorted by decreasing total wait time
+    inline std::vector<lock_site_statistics> statistics() const{
+        std::vector<lock_site_statistics> res;
+        {
+            std::lock_guard<std::mutex> l(_lock);
+            for(const auto & site : _sites){
+                res.push_back(_site_statistics(site.second));
+            }
+        }
+
+        std::stable_sort(res.begin(), res.end(), [](const lock_site_statistics & a, const lock_site_statistics & b){
+            return a.wait_time_ns > b.wait_time_ns;
+        });
+        return res;
+    }
+
+    /// statistics of the site name, file, line
+    inline lock_site_statistics statistics(const std::string & name, const std::string & file, int line) const{
+        std::lock_guard<std::mutex> l(_lock);
+        auto it = _sites.find(std::make_tuple(file, line, name));
+        if(it == _sites.end()){
+            return lock_site_statistics();
+        }
+        return _site_statistics(it->second);
+    }
+
+    /// print a report, one line per site
+    inline void dump(std::ostream & os) const{
+        const std::vector<lock_site_statistics> all_stats = statistics();
+
+        format::scat(os, "# hadoken lock profile: ", all_stats.size(), " sites\n");
+        for(const lock_site_statistics & s : all_stats){
+            const double contention = (s.acquisitions > 0) ? (100.0 * s.contended / s.acquisitions) : 0.0;
+            const double mean_hold = (s.hold_samples > 0) ? (double(s.hold_time_ns) / s.hold_samples) : 0.0;
+
+            format::scat(os, s.name, " (", s.file, ":", s.line, ")",
+                         " acquisitions=", s.acquisitions,
+                         " contended=", s.contended, " (", contention, "%)",
+                         " wait_total_ms=", s.wait_time_ns / 1.0e6,
+                         " wait_p50_ns<=", histogram_percentile(s.wait_histogram, 0.5),
+                         " wait_p99_ns<=", histogram_percentile(s.wait_histogram, 0.99),
+                         " wait_max_ns=", s.max_wait_ns,
+                         " hold_mean_ns=", mean_hold,
+                         " hold_p99_ns<=", histogram_percentile(s.hold_histogram, 0.99), "\n");
+        }
+    }
+
+    /// print the report on std::cerr at the exit of the process
+    inline void dump_at_exit(bool enable = true){
+        std::lock_guard<std::mutex> l(_lock);
+        _dump_at_exit = enable;
+    }
+
+    /// reset all the counters
+    inline void reset(){
+        std::lock_guard<std::mutex> l(_lock);
+        for(auto & site : _sites){
+            lock_site_statistics empty;
+            empty.name = site.second.retired.name;
+            empty.file = site.second.retired.file;
+            empty.line = site.second.retired.line;
+            site.second.retired = empty;
+
+            for(const details::lock_counters* counters : site.second.live){
+                const_cast<details::lock_counters*>(counters)->reset();
+            }
+        }
+    }
+
+    // used by profiled_lock
+    inline void register_lock(const char* name, const char* file, int line, const details::lock_counters* counters){
+        std::lock_guard<std::mutex> l(_lock);
+        auto key = std::make_tuple(std::string(file), line, std::string(name));
+        auto it = _sites.find(key);
+        if(it == _sites.end()){
+            it = _sites.insert(std::make_pair(key, details::lock_site())).first;
+            it->second.retired.name = name;
+            it->second.retired.file = file;
+            it->second.retired.line = line;
+        }
+        it->second.live.insert(counters);
+    }
+
+    inline void unregister_lock(const char* name, const char* file, int line, const details::lock_counters* counters){
+        std::lock_guard<std::mutex> l(_lock);
+        auto it = _sites.find(std::make_tuple(std::string(file), line, std::string(name)));
+        if(it != _sites.end()){
+            counters->accumulate(it->second.retired);
+            it->second.live.erase(counters);
+        }
+    }
+
+private:
+    lock_profiler(const lock_profiler &) = delete;
+    lock_profiler & operator=(const lock_profiler &) = delete;
+
+    static inline lock_site_statistics _site_statistics(const details::lock_site & site){
+        lock_site_statistics res = site.retired;
+        for(const details::lock_counters* counters : site.live){
+            counters->accumulate(res);
+        }
+        return res;
+    }
+
+    mutable std::mutex _lock;
+    std::map<std::tuple<std::string, int, std::string>, details::lock_site> _sites;
+    bool _dump_at_exit;
+};
+
+
+///
+/// \brief profiled_lock<Lock>: Lock decorator which records its activity
+///
+/// records the number of acquisitions, the contended acquisitions and their wait time,
+/// and the hold time, in the lock_profiler of the process under the construction site of the lock
+///
+/// the overhead stays low enough for production runs:
+/// - an uncontended acquisition is a try_lock() and a few counter updates, done under the
+///   lock without atomic read-modify-write
+/// - the clock is read only for the contended acquisitions, and to sample the hold time
+///   of one acquisition every hold_sample_period
+///
+/// Lock must be Lockable ( lock, try_lock, unlock ): std::mutex, spin_lock, ...
+///
+template<typename Lock>
+class profiled_lock{
+public:
+    ///
+    /// \brief profiled_lock
+    /// \param name name of the lock in the reports, use HADOKEN_LOCK_SITE(name) to add the source location
+    /// \param hold_sample_period sample the hold time of one uncontended acquisition every hold_sample_period
+    ///
+    inline explicit profiled_lock(const char* name = "unnamed_lock", const char* file = "", int line = 0,
+                                  std::uint64_t hold_sample_period = 64) :
+        _lock(), _counters(), _name(name), _file(file), _line(line),
+        _hold_sample_period(std::max<std::uint64_t>(hold_sample_period, 1)),
+        _acquired(), _sample_hold(false){
+        lock_profiler::instance().register_lock(_name, _file, _line, &_counters);
+    }
+
+    inline ~profiled_lock(){
+        lock_profiler::instance().unregister_lock(_name, _file, _line, &_counters);
+    }
+
+    inline void lock(){
+        if(_lock.try_lock()){
+            _on_acquire();
+            return;
+        }
+
+        const details::lock_clock::time_point start = details::lock_clock::now();
+        _lock.lock();
+        const details::lock_clock::time_point end = details::lock_clock::now();
+
+        _counters.on_acquire();
+        _counters.on_contended(details::lock_elapsed_ns(start, end));
+        _sample_hold = true;
+        _acquired = end;
+    }
+
+    inline bool try_lock(){
+        if(_lock.try_lock()){
+            _on_acquire();
+            return true;
+        }
+        return false;
+    }
+
+    inline void unlock(){
+        if(_sample_hold){
+            _counters.on_release(details::lock_elapsed_ns(_acquired, details::lock_clock::now()));
+            _sample_hold = false;
+        }
+        _lock.unlock();
+    }
+
+    /// decorated lock
+    inline Lock & underlying() noexcept{
+        return _lock;
+    }
+
+    /// statistics of the site of this lock
+    inline lock_site_statistics statistics() const{
+        return lock_profiler::instance().statistics(_name, _file, _line);
+    }
+
+private:
+    profiled_lock(const profiled_lock &) = delete;
+    profiled_lock & operator=(const profiled_lock &) = delete;
+
+    inline void _on_acquire(){
+        const std::uint64_t previous = _counters.on_acquire();
+        if(previous % _hold_sample_period == 0){
+            _sample_hold = true;
+            _acquired = details::lock_clock::now();
+        }
+    }
+
+    Lock _lock;
+    details::lock_counters _counters;
+    const char* _name;
+    const char* _file;
+    int _line;
+    const std::uint64_t _hold_sample_period;
+
+    // owner state, only accessed with the lock held
+    details::lock_clock::time_point _acquired;
+    bool _sample_hold;
+};
+
+
+} // thread
+
+} // hadoken
+
+#endif // _HADOKEN_PROFILED_LOCK_HPP_
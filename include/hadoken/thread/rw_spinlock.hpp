@@ -0,0 +1,114 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_RW_SPINLOCK_HPP_
+#define _HADOKEN_RW_SPINLOCK_HPP_
+
+#include <atomic>
+#include <cstdint>
+
+#include <hadoken/thread/backoff.hpp>
+
+namespace hadoken {
+
+namespace thread{
+
+///
+/// \brief reader-writer spin lock
+///
+/// any number of readers or a single writer. A waiting writer
+/// blocks the new readers, writers can not starve.
+///
+/// Lockable for the writers ( lock, try_lock, unlock ) and SharedLockable
+/// for the readers ( lock_shared, try_lock_shared, unlock_shared ):
+/// usable with std::lock_guard and boost::shared_lock
+///
+class rw_spin_lock{
+public:
+    inline rw_spin_lock() : _state(0) {}
+
+    inline void lock() noexcept{
+        exponential_backoff backoff;
+        while(1){
+            std::uint32_t state = _state.load(std::memory_order_relaxed);
+            if((state & ~writer_pending) == 0){
+                if(_state.compare_exchange_weak(state, writer, std::memory_order_acquire, std::memory_order_relaxed)){
+                    return;
+                }
+            }else if((state & writer_pending) == 0){
+                _state.fetch_or(writer_pending, std::memory_order_relaxed);
+            }
+            backoff.pause();
+        }
+    }
+
+    inline bool try_lock() noexcept{
+        std::uint32_t state = _state.load(std::memory_order_relaxed);
+        return ((state & ~writer_pending) == 0
+                && _state.compare_exchange_strong(state, writer, std::memory_order_acquire, std::memory_order_relaxed));
+    }
+
+    inline void unlock() noexcept{
+        _state.fetch_and(~writer, std::memory_order_release);
+    }
+
+    inline void lock_shared() noexcept{
+        exponential_backoff backoff;
+        while(try_lock_shared() == false){
+            backoff.pause();
+        }
+    }
+
+    inline bool try_lock_shared() noexcept{
+        std::uint32_t state = _state.load(std::memory_order_relaxed);
+        return ((state & (writer | writer_pending)) == 0
+                && _state.compare_exchange_strong(state, state + reader, std::memory_order_acquire, std::memory_order_relaxed));
+    }
+
+    inline void unlock_shared() noexcept{
+        _state.fetch_sub(reader, std::memory_order_release);
+    }
+
+private:
+    rw_spin_lock(const rw_spin_lock &) = delete;
+    rw_spin_lock & operator=(const rw_spin_lock&) = delete;
+
+    // state: bit 0 writer, bit 1 writer waiting, bits 2-31 number of readers
+    static constexpr std::uint32_t writer = 1;
+    static constexpr std::uint32_t writer_pending = 2;
+    static constexpr std::uint32_t reader = 4;
+
+    std::atomic<std::uint32_t> _state;
+};
+
+
+} // thread
+
+} // hadoken
+
+#endif // _HADOKEN_RW_SPINLOCK_HPP_
@@ -0,0 +1,153 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_SEMAPHORE_HPP_
+#define _HADOKEN_SEMAPHORE_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <assert.h>
+
+#include <hadoken/thread/futex.hpp>
+
+namespace hadoken {
+
+namespace thread{
+
+
+///
+/// \brief counting semaphore
+///
+/// ( C++20 std::counting_semaphore implementation )
+///
+/// acquire() decrements the counter, or blocks until it is positive.
+/// release() increments the counter and wakes up the blocked threads.
+/// Blocked threads spin briefly, then sleep on a futex
+///
+template<std::ptrdiff_t LeastMaxValue = std::numeric_limits<std::int32_t>::max()>
+class counting_semaphore{
+public:
+    static_assert(LeastMaxValue >= 0 && LeastMaxValue <= std::numeric_limits<std::int32_t>::max(), "invalid semaphore maximum value");
+
+    /// maximum value of the counter
+    static constexpr std::ptrdiff_t max() noexcept{
+        return LeastMaxValue;
+    }
+
+    ///
+    /// \brief construct a semaphore
+    /// \param desired : initial value of the counter
+    ///
+    inline explicit counting_semaphore(std::ptrdiff_t desired) :
+        _count(static_cast<std::int32_t>(desired)),
+        _waiters(0){
+        assert(desired >= 0 && desired <= max());
+    }
+
+    ~counting_semaphore() = default;
+
+    /// increment the counter by update
+    inline void release(std::ptrdiff_t update = 1){
+        assert(update >= 0 && _count.load() + update <= max());
+
+        _count.fetch_add(static_cast<std::int32_t>(update));
+        if(_waiters.load() > 0){
+            futex_wake(&_count, static_cast<std::int32_t>(update));
+        }
+    }
+
+    /// decrement the counter, block until it is positive
+    inline void acquire(){
+        if(details::spin_until([this](){ return try_acquire(); })){
+            return;
+        }
+
+        _waiters.fetch_add(1);
+        while(try_acquire() == false){
+            futex_wait(&_count, 0);
+        }
+        _waiters.fetch_sub(1);
+    }
+
+    /// decrement the counter if it is positive, without blocking
+    inline bool try_acquire() noexcept{
+        std::int32_t count = _count.load(std::memory_order_relaxed);
+        while(count > 0){
+            if(_count.compare_exchange_weak(count, count -1, std::memory_order_acquire, std::memory_order_relaxed)){
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// decrement the counter, block until it is positive or until the timeout expires
+    /// \return true if the counter has been decremented
+    template<typename Rep, typename Period>
+    inline bool try_acquire_for(const std::chrono::duration<Rep, Period> & timeout){
+        const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now()
+                + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+
+        if(details::spin_until([this](){ return try_acquire(); })){
+            return true;
+        }
+
+        bool res = false;
+        _waiters.fetch_add(1);
+        while( (res = try_acquire()) == false){
+            const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if(now >= deadline){
+                break;
+            }
+            futex_wait(&_count, 0, std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now));
+        }
+        _waiters.fetch_sub(1);
+        return res;
+    }
+
+private:
+    counting_semaphore(const counting_semaphore &) = delete;
+    counting_semaphore & operator=(const counting_semaphore &) = delete;
+
+    futex_word _count;
+    std::atomic<std::int32_t> _waiters;
+};
+
+
+///
+/// \brief binary semaphore, counter of 0 or 1
+///
+typedef counting_semaphore<1> binary_semaphore;
+
+
+} // thread
+
+} // hadoken
+
+#endif // _HADOKEN_SEMAPHORE_HPP_
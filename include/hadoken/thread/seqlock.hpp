@@ -0,0 +1,177 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_SEQLOCK_HPP_
+#define _HADOKEN_SEQLOCK_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include <hadoken/thread/backoff.hpp>
+
+namespace hadoken {
+
+namespace thread{
+
+
+///
+/// \brief seqlock<T>: small data, read often, written rarely
+///
+/// the readers never write to shared memory: they copy the value and retry if a
+/// writer modified it in the meantime, detected by a sequence number odd during the writes.
+/// The writers are serialized between them.
+///
+/// T must be trivially copyable, and small: a reader copies the whole value at each attempt.
+/// The value is stored as relaxed atomic words, the copy is race free
+///
+template<typename T>
+class seqlock{
+    static_assert(std::is_trivially_copyable<T>::value, "seqlock<T> requires a trivially copyable T");
+
+public:
+    typedef T value_type;
+
+    inline seqlock() : _seq(0){
+        _store_words(T());
+    }
+
+    inline explicit seqlock(const T & value) : _seq(0){
+        _store_words(value);
+    }
+
+    /// consistent copy of the value, retry while a writer is active
+    inline T load() const noexcept{
+        T res;
+        exponential_backoff backoff;
+        while(try_load(res) == false){
+            backoff.pause();
+        }
+        return res;
+    }
+
+    ///
+    /// \brief one attempt to read the value
+    /// \return false if a writer modified the value during the read, value undefined
+    ///
+    inline bool try_load(T & value) const noexcept{
+        const std::uint64_t seq_begin = _seq.load(std::memory_order_acquire);
+        if(seq_begin & 0x01){
+            return false;
+        }
+
+        std::uint64_t words[n_words];
+        for(std::size_t i = 0; i < n_words; ++i){
+            words[i] = _data[i].load(std::memory_order_relaxed);
+        }
+
+        // order the data loads before the sequence check
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(_seq.load(std::memory_order_relaxed) != seq_begin){
+            return false;
+        }
+
+        std::memcpy(&value, words, sizeof(T));
+        return true;
+    }
+
+    /// replace the value
+    inline void store(const T & value) noexcept{
+        const std::uint64_t seq = _lock_writer();
+        _store_words(value);
+        _seq.store(seq + 2, std::memory_order_release);
+    }
+
+    ///
+    /// \brief read-modify-write, fun(T &) modifies a copy of the current value
+    ///
+    /// the writers are excluded during fun, the readers retry until it finishes
+    ///
+    template<typename Function>
+    inline void update(Function fun){
+        const std::uint64_t seq = _lock_writer();
+        T value;
+        std::uint64_t words[n_words];
+        for(std::size_t i = 0; i < n_words; ++i){
+            words[i] = _data[i].load(std::memory_order_relaxed);
+        }
+        std::memcpy(&value, words, sizeof(T));
+
+        fun(value);
+
+        _store_words(value);
+        _seq.store(seq + 2, std::memory_order_release);
+    }
+
+    /// number of modifications since the construction
+    inline std::uint64_t version() const noexcept{
+        return _seq.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+    seqlock(const seqlock &) = delete;
+    seqlock & operator=(const seqlock &) = delete;
+
+    static constexpr std::size_t n_words = (sizeof(T) + sizeof(std::uint64_t) -1) / sizeof(std::uint64_t);
+
+    // make the sequence odd, return its previous even value
+    inline std::uint64_t _lock_writer() noexcept{
+        exponential_backoff backoff;
+        std::uint64_t seq = _seq.load(std::memory_order_relaxed);
+        while(true){
+            if((seq & 0x01) == 0 && _seq.compare_exchange_weak(seq, seq + 1, std::memory_order_relaxed)){
+                break;
+            }
+            backoff.pause();
+            seq = _seq.load(std::memory_order_relaxed);
+        }
+        // order the odd sequence before the data stores
+        std::atomic_thread_fence(std::memory_order_release);
+        return seq;
+    }
+
+    inline void _store_words(const T & value) noexcept{
+        std::uint64_t words[n_words] = {};
+        std::memcpy(words, &value, sizeof(T));
+        for(std::size_t i = 0; i < n_words; ++i){
+            _data[i].store(words[i], std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<std::uint64_t> _seq;
+    std::atomic<std::uint64_t> _data[n_words];
+};
+
+
+} // thread
+
+} // hadoken
+
+#endif // _HADOKEN_SEQLOCK_HPP_
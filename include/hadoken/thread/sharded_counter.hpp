@@ -0,0 +1,166 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_SHARDED_COUNTER_HPP_
+#define _HADOKEN_SHARDED_COUNTER_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include <hadoken/thread/padded.hpp>
+
+namespace hadoken {
+
+namespace thread{
+
+
+namespace details{
+
+// shard of the calling thread: its current cpu when available,
+// a per-thread round robin index otherwise
+inline std::size_t current_shard_hint(){
+#ifdef __linux__
+    const int cpu = sched_getcpu();
+    if(cpu >= 0){
+        return static_cast<std::size_t>(cpu);
+    }
+#endif
+    static std::atomic<std::size_t> next_index(0);
+    static thread_local std::size_t index = next_index.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+} // details
+
+
+///
+/// \brief counter for frequent concurrent updates and rare reads
+///
+/// a single std::atomic updated by all the cores moves its cache line from core to core
+/// at each increment. sharded_counter spreads the updates on padded slots, one per core:
+/// an update is an uncontended atomic add on the slot of the current cpu,
+/// a read sums all the slots.
+///
+/// a read concurrent to updates returns a value between the count before and after the updates
+///
+class sharded_counter{
+public:
+    typedef std::int64_t value_type;
+
+    ///
+    /// \brief sharded_counter
+    /// \param n_shards number of slots, default one per hardware thread
+    ///
+    inline explicit sharded_counter(std::size_t n_shards = std::thread::hardware_concurrency()) :
+        _mask(_round_shards(n_shards) -1),
+        _shards(new padded<std::atomic<value_type> >[_mask +1]){
+        reset();
+    }
+
+    inline void add(value_type n) noexcept{
+        _shards[details::current_shard_hint() & _mask]->fetch_add(n, std::memory_order_relaxed);
+    }
+
+    inline void sub(value_type n) noexcept{
+        add(-n);
+    }
+
+    inline sharded_counter & operator+=(value_type n) noexcept{
+        add(n);
+        return *this;
+    }
+
+    inline sharded_counter & operator-=(value_type n) noexcept{
+        add(-n);
+        return *this;
+    }
+
+    inline sharded_counter & operator++() noexcept{
+        add(1);
+        return *this;
+    }
+
+    inline sharded_counter & operator--() noexcept{
+        add(-1);
+        return *this;
+    }
+
+    /// sum of all the slots
+    inline value_type load() const noexcept{
+        value_type res = 0;
+        for(std::size_t i = 0; i <= _mask; ++i){
+            res += _shards[i]->load(std::memory_order_relaxed);
+        }
+        return res;
+    }
+
+    inline operator value_type() const noexcept{
+        return load();
+    }
+
+    /// set the counter to 0, not atomic with the concurrent updates
+    inline void reset() noexcept{
+        for(std::size_t i = 0; i <= _mask; ++i){
+            _shards[i]->store(0, std::memory_order_relaxed);
+        }
+    }
+
+    inline std::size_t number_of_shards() const noexcept{
+        return _mask +1;
+    }
+
+private:
+    sharded_counter(const sharded_counter &) = delete;
+    sharded_counter & operator=(const sharded_counter &) = delete;
+
+    static inline std::size_t _round_shards(std::size_t n_shards){
+        std::size_t res = 1;
+        while(res < std::max<std::size_t>(n_shards, 1)){
+            res <<= 1;
+        }
+        return res;
+    }
+
+    const std::size_t _mask;
+    std::unique_ptr<padded<std::atomic<value_type> >[]> _shards;
+};
+
+
+} // thread
+
+} // hadoken
+
+#endif // _HADOKEN_SHARDED_COUNTER_HPP_
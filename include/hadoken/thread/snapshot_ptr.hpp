@@ -0,0 +1,187 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_SNAPSHOT_PTR_HPP_
+#define _HADOKEN_SNAPSHOT_PTR_HPP_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include <hadoken/thread/epoch.hpp>
+
+namespace hadoken {
+
+namespace thread{
+
+
+///
+/// \brief snapshot_ptr<T>: RCU style pointer to read-mostly data
+///
+/// the readers access the current snapshot without lock and without writing to a
+/// shared cache line: no reference count, only a pin of their own epoch record.
+/// The writers publish a new snapshot, the previous one is deleted once the
+/// readers which could see it left their critical section.
+///
+/// a snapshot is immutable once published: modify a copy and publish it with update()
+///
+/// \code
+///    hadoken::thread::snapshot_ptr<config> current(config::load());
+///    // readers
+///    {
+///        auto snap = current.read();
+///        use(snap->threshold, snap->table);
+///    }
+///    // writer
+///    current.update([](config & c){ c.threshold = 42; });
+/// \endcode
+///
+template<typename T>
+class snapshot_ptr{
+public:
+    typedef T element_type;
+
+    ///
+    /// \brief read access to a snapshot, keeps it alive, RAII
+    ///
+    /// should be short lived: a snapshot retained prevents the reclamation of the domain
+    ///
+    class reader{
+    public:
+        inline reader(reader && other) noexcept : _guard(std::move(other._guard)), _ptr(other._ptr) {}
+
+        inline const T & operator*() const noexcept{
+            return *_ptr;
+        }
+
+        inline const T* operator->() const noexcept{
+            return _ptr;
+        }
+
+        inline const T* get() const noexcept{
+            return _ptr;
+        }
+
+        inline explicit operator bool() const noexcept{
+            return _ptr != nullptr;
+        }
+
+    private:
+        inline reader(epoch_domain::guard && guard, const T* ptr) : _guard(std::move(guard)), _ptr(ptr) {}
+
+        reader(const reader &) = delete;
+        reader & operator=(const reader &) = delete;
+
+        friend class snapshot_ptr;
+
+        epoch_domain::guard _guard;
+        const T* _ptr;
+    };
+
+    /// empty snapshot_ptr
+    inline explicit snapshot_ptr(epoch_domain & domain = epoch_domain::global_domain()) :
+        _domain(domain), _current(nullptr), _writer_lock() {}
+
+    /// snapshot_ptr initialized with value
+    inline explicit snapshot_ptr(std::unique_ptr<T> value, epoch_domain & domain = epoch_domain::global_domain()) :
+        _domain(domain), _current(value.release()), _writer_lock() {}
+
+    inline ~snapshot_ptr(){
+        delete _current.load(std::memory_order_acquire);
+    }
+
+    /// current snapshot, lock free
+    inline reader read() const{
+        epoch_domain::guard guard = _domain.pin();
+        const T* ptr = _current.load(std::memory_order_acquire);
+        return reader(std::move(guard), ptr);
+    }
+
+    /// copy of the current snapshot
+    inline std::unique_ptr<T> copy() const{
+        reader r = read();
+        return std::unique_ptr<T>( r ? new T(*r) : nullptr);
+    }
+
+    /// publish value as the new snapshot
+    inline void store(std::unique_ptr<T> value){
+        std::lock_guard<std::mutex> l(_writer_lock);
+        _publish(value.release());
+    }
+
+    inline void store(const T & value){
+        store(std::unique_ptr<T>(new T(value)));
+    }
+
+    ///
+    /// \brief copy-update-publish
+    ///
+    /// fun(T &) modifies a copy of the current snapshot, or a default constructed T
+    /// if empty. The writers are serialized: no concurrent update is lost
+    ///
+    template<typename Function>
+    inline void update(Function fun){
+        std::lock_guard<std::mutex> l(_writer_lock);
+        const T* current = _current.load(std::memory_order_relaxed);
+        std::unique_ptr<T> next(current != nullptr ? new T(*current) : new T());
+        fun(*next);
+        _publish(next.release());
+    }
+
+    /// remove the current snapshot
+    inline void reset(){
+        std::lock_guard<std::mutex> l(_writer_lock);
+        _publish(nullptr);
+    }
+
+private:
+    snapshot_ptr(const snapshot_ptr &) = delete;
+    snapshot_ptr & operator=(const snapshot_ptr &) = delete;
+
+    // called with the writer lock
+    inline void _publish(T* next){
+        T* previous = _current.exchange(next, std::memory_order_acq_rel);
+        if(previous != nullptr){
+            _domain.retire(previous);
+            // writers are rare: reclaim now rather than after the retire threshold of the domain
+            _domain.collect();
+        }
+    }
+
+    epoch_domain & _domain;
+    std::atomic<T*> _current;
+    std::mutex _writer_lock;
+};
+
+
+} // thread
+
+} // hadoken
+
+#endif // _HADOKEN_SNAPSHOT_PTR_HPP_
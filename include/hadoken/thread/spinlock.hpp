@@ -30,8 +30,12 @@
 #define _HADOKEN_SPINLOCK_HPP_
 
 #include <atomic>
+#include <cstdint>
 #include <thread>
 
+#include <hadoken/thread/backoff.hpp>
+#include <hadoken/thread/cache_line.hpp>
+
 namespace hadoken {
 
 namespace thread{
@@ -41,7 +45,7 @@ namespace thread{
 ///
 /// spinlock implementation
 ///
-/// follow the STL requirement for BasicLockable and
+/// follow the STL requirement for BasicLockable and Lockable and
 /// can consequently be used by STL/boost lock_guard and unique_lock
 ///
 class spin_lock{
@@ -64,6 +68,11 @@ public:
 	       }
     }
 
+    inline bool try_lock() noexcept{
+        bool expected = false;
+        return _lock.compare_exchange_strong(expected, true);
+    }
+
     inline void unlock() noexcept{
         _lock.store(false);
     }
@@ -76,6 +85,106 @@ private:
 };
 
 
+
+///
+/// \brief test and test-and-set spin lock with exponential backoff
+///
+/// waiting threads spin on a read-only load, with cpu_relax() and an exponential
+/// backoff, and only try to take the lock when it looks free.
+/// Scale better than spin_lock under contention, but is unfair.
+///
+/// BasicLockable and Lockable
+///
+class backoff_spin_lock{
+public:
+    inline backoff_spin_lock() : _lock(false) {}
+
+    inline void lock() noexcept {
+        exponential_backoff backoff;
+        while(_lock.exchange(true, std::memory_order_acquire)){
+            while(_lock.load(std::memory_order_relaxed)){
+                backoff.pause();
+            }
+        }
+    }
+
+    inline bool try_lock() noexcept{
+        return (_lock.load(std::memory_order_relaxed) == false
+                && _lock.exchange(true, std::memory_order_acquire) == false);
+    }
+
+    inline void unlock() noexcept{
+        _lock.store(false, std::memory_order_release);
+    }
+
+private:
+    backoff_spin_lock(const backoff_spin_lock &) = delete;
+    backoff_spin_lock & operator=(const backoff_spin_lock&) = delete;
+
+    std::atomic<bool> _lock;
+};
+
+
+///
+/// \brief ticket lock
+///
+/// FIFO spin lock: threads take a ticket and wait for their turn,
+/// with a backoff proportional to their position in the queue.
+/// Fair, but all the waiters spin on the same cache line and a preempted
+/// waiter blocks all the threads behind it: avoid it when the cpus are oversubscribed.
+///
+/// BasicLockable and Lockable
+///
+class ticket_lock{
+public:
+    inline ticket_lock() : _next(0), _serving(0) {}
+
+    inline void lock() noexcept {
+        const std::uint32_t ticket = _next.fetch_add(1, std::memory_order_relaxed);
+
+#ifndef HADOKEN_SPIN_NO_YIELD
+        std::uint32_t n_wait = 0;
+#endif
+        std::uint32_t serving;
+        while( (serving = _serving.load(std::memory_order_acquire)) != ticket){
+            const std::uint32_t position = ticket - serving;
+            for(std::uint32_t i = 0; i < position * spin_per_waiter; ++i){
+                cpu_relax();
+            }
+#ifndef HADOKEN_SPIN_NO_YIELD
+            // likely oversubscribed, let the owner run
+            if(++n_wait > max_wait_before_yield){
+                std::this_thread::yield();
+            }
+#endif
+        }
+    }
+
+    inline bool try_lock() noexcept{
+        // acquire: synchronize with the unlock() of the previous owner, nothing releases _next
+        std::uint32_t serving = _serving.load(std::memory_order_acquire);
+        std::uint32_t expected = serving;
+        return _next.compare_exchange_strong(expected, serving + 1, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    inline void unlock() noexcept{
+        _serving.store(_serving.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    ticket_lock(const ticket_lock &) = delete;
+    ticket_lock & operator=(const ticket_lock&) = delete;
+
+    static constexpr std::uint32_t spin_per_waiter = 32;
+    static constexpr std::uint32_t max_wait_before_yield = 16;
+
+    std::atomic<std::uint32_t> _next;
+    // keep the owner counter away from the ticket dispenser
+    char _pad[cache_line_size - sizeof(std::atomic<std::uint32_t>)];
+    std::atomic<std::uint32_t> _serving;
+};
+
+
 } // thread
 
 
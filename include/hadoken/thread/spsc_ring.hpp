@@ -0,0 +1,251 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_SPSC_RING_HPP_
+#define _HADOKEN_SPSC_RING_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include <hadoken/thread/cache_line.hpp>
+
+namespace hadoken {
+
+namespace thread{
+
+
+///
+/// \brief wait-free single-producer / single-consumer ring buffer
+///
+/// the producer and the consumer each keep a cached copy of the index of the other side,
+/// and only read the shared index when the cached one says that the ring is full / empty.
+///
+/// the slots are default constructed at creation and reused: elements are assigned on push
+/// and moved out on pop. reserve() / commit() and peek() / release() give direct access to the slots,
+/// large records can be written and read in place, and their buffers reused, without copy.
+///
+/// capacity is rounded up to a power of two
+///
+template<typename T>
+class spsc_ring{
+public:
+    typedef T value_type;
+
+    ///
+    /// \brief create a ring buffer
+    /// \param capacity : maximum number of elements, at least 2
+    ///
+    inline explicit spsc_ring(std::size_t capacity) :
+        _mask(_round_capacity(capacity) - 1),
+        _slots(new T[_mask + 1]),
+        _producer(),
+        _consumer(){
+    }
+
+    ~spsc_ring() = default;
+
+    // producer side
+
+    /// push val if the ring is not full
+    template<typename U>
+    inline bool try_push(U && val){
+        std::size_t n = 1;
+        T* slot = reserve(n);
+        if(n == 0){
+            return false;
+        }
+        *slot = std::forward<U>(val);
+        commit(1);
+        return true;
+    }
+
+    ///
+    /// \brief push up to n elements from first
+    /// \return number of elements pushed
+    ///
+    template<typename InputIterator>
+    inline std::size_t push_bulk(InputIterator first, std::size_t n){
+        std::size_t pushed = 0;
+        // at most two contiguous regions: before and after the wrap around
+        for(int region = 0; region < 2 && pushed < n; ++region){
+            std::size_t count = n - pushed;
+            T* slots = reserve(count);
+            for(std::size_t i = 0; i < count; ++i, ++first){
+                slots[i] = *first;
+            }
+            commit(count);
+            pushed += count;
+        }
+        return pushed;
+    }
+
+    ///
+    /// \brief reserve contiguous free slots to write in place
+    /// \param n : number of slots wanted, set to the number of slots available ( <= n )
+    /// \return pointer to the first slot
+    ///
+    inline T* reserve(std::size_t & n){
+        const std::size_t tail = _producer.tail.load(std::memory_order_relaxed);
+
+        if(_free_slots(tail, _producer.cached_head) < n){
+            _producer.cached_head = _consumer.head.load(std::memory_order_acquire);
+        }
+
+        const std::size_t contiguous = (_mask + 1) - (tail & _mask);
+        n = std::min(n, std::min(_free_slots(tail, _producer.cached_head), contiguous));
+        return &_slots[tail & _mask];
+    }
+
+    /// publish n slots written after reserve()
+    inline void commit(std::size_t n){
+        _producer.tail.store(_producer.tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+
+    // consumer side
+
+    /// pop an element into val if the ring is not empty
+    inline bool try_pop(T & val){
+        std::size_t n = 1;
+        T* slot = peek(n);
+        if(n == 0){
+            return false;
+        }
+        val = std::move(*slot);
+        release(1);
+        return true;
+    }
+
+    ///
+    /// \brief pop up to n elements into out
+    /// \return number of elements popped
+    ///
+    template<typename OutputIterator>
+    inline std::size_t pop_bulk(OutputIterator out, std::size_t n){
+        std::size_t popped = 0;
+        for(int region = 0; region < 2 && popped < n; ++region){
+            std::size_t count = n - popped;
+            T* slots = peek(count);
+            for(std::size_t i = 0; i < count; ++i, ++out){
+                *out = std::move(slots[i]);
+            }
+            release(count);
+            popped += count;
+        }
+        return popped;
+    }
+
+    ///
+    /// \brief access contiguous filled slots to read in place
+    /// \param n : number of slots wanted, set to the number of slots available ( <= n )
+    /// \return pointer to the first slot
+    ///
+    inline T* peek(std::size_t & n){
+        const std::size_t head = _consumer.head.load(std::memory_order_relaxed);
+
+        if(_consumer.cached_tail - head < n){
+            _consumer.cached_tail = _producer.tail.load(std::memory_order_acquire);
+        }
+
+        const std::size_t contiguous = (_mask + 1) - (head & _mask);
+        n = std::min(n, std::min(_consumer.cached_tail - head, contiguous));
+        return &_slots[head & _mask];
+    }
+
+    /// give back n slots read after peek() to the producer
+    inline void release(std::size_t n){
+        _consumer.head.store(_consumer.head.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+
+    /// maximum number of elements
+    inline std::size_t capacity() const noexcept{
+        return _mask + 1;
+    }
+
+    /// number of elements, approximative if the ring is accessed concurrently
+    inline std::size_t size_approx() const noexcept{
+        return _producer.tail.load(std::memory_order_acquire) - _consumer.head.load(std::memory_order_acquire);
+    }
+
+private:
+    spsc_ring(const spsc_ring &) = delete;
+    spsc_ring & operator=(const spsc_ring &) = delete;
+
+    inline std::size_t _free_slots(std::size_t tail, std::size_t head) const noexcept{
+        return (_mask + 1) - (tail - head);
+    }
+
+    static inline std::size_t _round_capacity(std::size_t capacity){
+        if(capacity > (std::numeric_limits<std::size_t>::max() >> 2)){
+            throw std::invalid_argument("spsc_ring: capacity too large");
+        }
+        std::size_t res = 2;
+        while(res < capacity){
+            res <<= 1;
+        }
+        return res;
+    }
+
+    // state written by the producer, on its own cache line
+    struct producer_state{
+        inline producer_state() : tail(0), cached_head(0) {}
+
+        char _pad_front[cache_line_size];
+        std::atomic<std::size_t> tail;
+        std::size_t cached_head;
+    };
+
+    // state written by the consumer, on its own cache line
+    struct consumer_state{
+        inline consumer_state() : head(0), cached_tail(0) {}
+
+        char _pad_front[cache_line_size];
+        std::atomic<std::size_t> head;
+        std::size_t cached_tail;
+        char _pad_back[cache_line_size];
+    };
+
+    const std::size_t _mask;
+    std::unique_ptr<T[]> _slots;
+
+    producer_state _producer;
+    consumer_state _consumer;
+};
+
+
+} // thread
+
+} // hadoken
+
+#endif // _HADOKEN_SPSC_RING_HPP_
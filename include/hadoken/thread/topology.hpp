@@ -0,0 +1,337 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#ifndef _HADOKEN_TOPOLOGY_HPP_
+#define _HADOKEN_TOPOLOGY_HPP_
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace hadoken {
+
+namespace thread{
+
+
+///
+/// \brief thread placement policy
+///
+/// - none : threads are not pinned, the OS scheduler is free to migrate them
+/// - compact : threads are pinned on consecutive hardware threads,
+///             filling a core, then a socket, then a NUMA node before moving to the next one
+/// - scatter : threads are distributed round-robin over the NUMA nodes and cores,
+///             hyper-threads siblings are used last
+///
+enum class affinity_policy{
+    none,
+    compact,
+    scatter
+};
+
+
+///
+/// \brief description of one logical CPU ( hardware thread )
+///
+struct cpu_info{
+    int cpu_id;
+    int core_id;
+    int package_id;
+    int numa_node;
+};
+
+
+namespace details{
+
+inline bool read_file_content(const std::string & path, std::string & content){
+    std::ifstream f(path.c_str());
+    if(!f.good()){
+        return false;
+    }
+    std::getline(f, content);
+    return true;
+}
+
+inline int read_int_file(const std::string & path, int default_value){
+    std::string content;
+    if(read_file_content(path, content) == false || content.empty()){
+        return default_value;
+    }
+    return std::atoi(content.c_str());
+}
+
+// parse linux cpulist format, e.g "0-3,8,10-11"
+inline std::vector<int> parse_cpu_list(const std::string & cpu_list){
+    std::vector<int> res;
+    std::istringstream ss(cpu_list);
+    std::string token;
+    while(std::getline(ss, token, ',')){
+        if(token.empty() || token[0] == '\n'){
+            continue;
+        }
+        const std::size_t pos = token.find('-');
+        if(pos == std::string::npos){
+            res.push_back(std::atoi(token.c_str()));
+        }else{
+            const int first = std::atoi(token.substr(0, pos).c_str());
+            const int last = std::atoi(token.substr(pos+1).c_str());
+            for(int i = first; i <= last; ++i){
+                res.push_back(i);
+            }
+        }
+    }
+    return res;
+}
+
+} // details
+
+
+///
+/// \brief CPU and NUMA topology of the machine
+///
+/// on Linux, the topology is extracted from /sys/devices/system/{cpu,node}
+/// and restricted to the cpuset of the current process ( sched_getaffinity )
+/// in order to respect any external binding ( MPI, numactl, taskset, slurm )
+///
+/// on other platforms, a flat topology of hardware_concurrency() cpus is assumed
+///
+class cpu_topology{
+public:
+    ///
+    /// \brief read the topology of the current machine
+    ///
+    inline cpu_topology() : _cpus(){
+        _load("/sys/devices/system", true);
+    }
+
+    ///
+    /// \brief read the topology from a sysfs-like directory tree
+    /// \param sysfs_root : root directory, containing cpu/ and node/
+    /// \param use_process_cpuset : restrict the cpus to the ones allowed for the current process
+    ///
+    inline cpu_topology(const std::string & sysfs_root, bool use_process_cpuset) : _cpus(){
+        _load(sysfs_root, use_process_cpuset);
+    }
+
+    ///
+    /// \brief list of the available logical cpus, ordered by cpu id
+    ///
+    inline const std::vector<cpu_info> & cpus() const noexcept{
+        return _cpus;
+    }
+
+    ///
+    /// \brief number of NUMA nodes with at least one available cpu
+    ///
+    inline std::size_t number_numa_nodes() const{
+        std::vector<int> nodes;
+        for(const auto & c : _cpus){
+            nodes.push_back(c.numa_node);
+        }
+        std::sort(nodes.begin(), nodes.end());
+        return static_cast<std::size_t>(std::distance(nodes.begin(), std::unique(nodes.begin(), nodes.end())));
+    }
+
+    ///
+    /// \brief compute the cpu placement of n_threads threads
+    /// \param policy : placement policy
+    /// \param n_threads : number of threads to place
+    /// \return vector of cpu_info, one per thread. If n_threads is bigger than the number
+    ///         of available cpus, the placement wraps around
+    ///
+    inline std::vector<cpu_info> placement(affinity_policy policy, std::size_t n_threads) const{
+        std::vector<cpu_info> ordered = (policy == affinity_policy::scatter) ? _scatter_order() : _compact_order();
+        std::vector<cpu_info> res;
+        res.reserve(n_threads);
+        for(std::size_t i = 0; i < n_threads && ordered.empty() == false; ++i){
+            res.push_back(ordered[i % ordered.size()]);
+        }
+        return res;
+    }
+
+
+private:
+    std::vector<cpu_info> _cpus;
+
+    inline void _load(const std::string & root, bool use_process_cpuset){
+        std::string online;
+        std::vector<int> cpu_ids;
+
+        if(details::read_file_content(root + "/cpu/online", online)){
+            cpu_ids = details::parse_cpu_list(online);
+        }
+
+        if(cpu_ids.empty()){
+            const int n_cpus = std::max<int>(1, static_cast<int>(std::thread::hardware_concurrency()));
+            for(int i = 0; i < n_cpus; ++i){
+                cpu_ids.push_back(i);
+            }
+        }
+
+#ifdef __linux__
+        if(use_process_cpuset){
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            if(sched_getaffinity(0, sizeof(cpu_set_t), &cpuset) == 0){
+                cpu_ids.erase(std::remove_if(cpu_ids.begin(), cpu_ids.end(), [&cpuset](int id){
+                    return (id < 0 || id >= CPU_SETSIZE || CPU_ISSET(id, &cpuset) == 0);
+                }), cpu_ids.end());
+            }
+        }
+#else
+        (void) use_process_cpuset;
+#endif
+
+        // numa node mapping, node directories do not exist on non-NUMA kernels
+        std::map<int, int> cpu_to_node;
+        std::string nodes_online;
+        if(details::read_file_content(root + "/node/online", nodes_online)){
+            for(int node : details::parse_cpu_list(nodes_online)){
+                std::string node_cpus;
+                std::ostringstream node_path;
+                node_path << root << "/node/node" << node << "/cpulist";
+                if(details::read_file_content(node_path.str(), node_cpus)){
+                    for(int cpu : details::parse_cpu_list(node_cpus)){
+                        cpu_to_node[cpu] = node;
+                    }
+                }
+            }
+        }
+
+        _cpus.clear();
+        for(int cpu : cpu_ids){
+            std::ostringstream topo_path;
+            topo_path << root << "/cpu/cpu" << cpu << "/topology/";
+
+            cpu_info info;
+            info.cpu_id = cpu;
+            info.core_id = details::read_int_file(topo_path.str() + "core_id", cpu);
+            info.package_id = details::read_int_file(topo_path.str() + "physical_package_id", 0);
+            auto it = cpu_to_node.find(cpu);
+            info.numa_node = (it != cpu_to_node.end()) ? (it->second) : 0;
+            _cpus.push_back(info);
+        }
+    }
+
+    // order: node, package, core, hyper-thread
+    inline std::vector<cpu_info> _compact_order() const{
+        std::vector<cpu_info> res(_cpus);
+        std::stable_sort(res.begin(), res.end(), [](const cpu_info & c1, const cpu_info & c2){
+            return std::make_tuple(c1.numa_node, c1.package_id, c1.core_id, c1.cpu_id)
+                    < std::make_tuple(c2.numa_node, c2.package_id, c2.core_id, c2.cpu_id);
+        });
+        return res;
+    }
+
+    // order: hyper-thread rank, core rank in the node, node
+    inline std::vector<cpu_info> _scatter_order() const{
+        std::vector<cpu_info> compact = _compact_order();
+
+        // rank of each cpu inside its core and rank of each core inside its node
+        std::vector<std::tuple<int, int, int, std::size_t> > keys;
+        std::map<std::tuple<int, int, int>, int> smt_rank;
+        std::map<int, std::map<std::pair<int, int>, int> > core_rank;
+
+        for(std::size_t i = 0; i < compact.size(); ++i){
+            const cpu_info & c = compact[i];
+            const int smt = smt_rank[std::make_tuple(c.numa_node, c.package_id, c.core_id)]++;
+            auto & node_cores = core_rank[c.numa_node];
+            auto core_it = node_cores.find(std::make_pair(c.package_id, c.core_id));
+            if(core_it == node_cores.end()){
+                const int rank = static_cast<int>(node_cores.size());
+                core_it = node_cores.insert(std::make_pair(std::make_pair(c.package_id, c.core_id), rank)).first;
+            }
+            keys.push_back(std::make_tuple(smt, core_it->second, c.numa_node, i));
+        }
+
+        std::sort(keys.begin(), keys.end());
+
+        std::vector<cpu_info> res;
+        res.reserve(compact.size());
+        for(const auto & k : keys){
+            res.push_back(compact[std::get<3>(k)]);
+        }
+        return res;
+    }
+};
+
+
+///
+/// \brief pin the calling thread to a single cpu
+/// \return true if success, false if not supported or failed
+///
+inline bool pin_current_thread(int cpu_id){
+#ifdef __linux__
+    if(cpu_id < 0 || cpu_id >= CPU_SETSIZE){
+        return false;
+    }
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu_id, &cpuset);
+    return (sched_setaffinity(0, sizeof(cpu_set_t), &cpuset) == 0);
+#else
+    (void) cpu_id;
+    return false;
+#endif
+}
+
+
+///
+/// \brief return the affinity policy specified by the HADOKEN_AFFINITY
+///        environment variable ( "none", "compact" or "scatter" ), none if unset
+///
+inline affinity_policy default_affinity_policy(){
+    const char* env = std::getenv("HADOKEN_AFFINITY");
+    if(env != nullptr){
+        const std::string policy(env);
+        if(policy == "compact"){
+            return affinity_policy::compact;
+        }
+        if(policy == "scatter"){
+            return affinity_policy::scatter;
+        }
+    }
+    return affinity_policy::none;
+}
+
+
+} // thread
+
+
+} //hadoken
+
+#endif // _HADOKEN_TOPOLOGY_HPP_
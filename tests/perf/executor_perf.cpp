@@ -31,6 +31,9 @@
 #include <mutex>
 #include <thread>
 #include <future>
+#include <vector>
+#include <algorithm>
+#include <atomic>
 
 #include <boost/test/floating_point_comparison.hpp>
 
@@ -43,6 +46,8 @@
 #include <hadoken/executor/thread_pool_executor.hpp>
 #include <hadoken/executor/simple_thread_executor.hpp>
 #include <hadoken/executor/system_executor.hpp>
+#include <hadoken/thread/latch.hpp>
+#include <hadoken/thread/spinlock.hpp>
 
 
 using namespace boost::chrono;
@@ -87,6 +92,76 @@ std::size_t executor_test(std::size_t n_exec, const std::string & executor_name)
 
 
 
+
+// measure the start latency of short probe tasks submitted while
+// the pool is saturated by a continuous load of bulk tasks
+void priority_latency_test(hadoken::task_priority bulk_priority, hadoken::task_priority probe_priority,
+                           const std::string & test_name){
+
+    typedef boost::chrono::steady_clock steady_cl;
+
+    const std::size_t n_probes = 500;
+    const microseconds bulk_duration(500), probe_interval(200);
+
+    hadoken::thread_pool_executor pool;
+    const std::size_t backlog = 4 * pool.size();
+
+    std::atomic<bool> running(true);
+    std::atomic<std::size_t> bulk_in_flight(0);
+
+    std::function<void (void)> bulk_task = [&](){
+        const steady_cl::time_point end = steady_cl::now() + bulk_duration;
+        while(steady_cl::now() < end){
+            // busy compute
+        }
+
+        if(running.load()){
+            pool.execute(bulk_task, bulk_priority);
+        }else{
+            bulk_in_flight.fetch_sub(1);
+        }
+    };
+
+    for(std::size_t i = 0; i < backlog; ++i){
+        bulk_in_flight.fetch_add(1);
+        pool.execute(bulk_task, bulk_priority);
+    }
+
+    std::vector<double> latencies;
+    latencies.reserve(n_probes);
+    hadoken::thread::spin_lock latencies_lock;
+    hadoken::thread::latch probes_done(n_probes);
+
+    for(std::size_t i = 0; i < n_probes; ++i){
+        const steady_cl::time_point submit = steady_cl::now();
+        pool.execute([&, submit](){
+            const double latency = double(duration_cast<microseconds>(steady_cl::now() - submit).count());
+            {
+                std::lock_guard<hadoken::thread::spin_lock> l(latencies_lock);
+                latencies.push_back(latency);
+            }
+            probes_done.count_down();
+        }, probe_priority);
+
+        std::this_thread::sleep_for(std::chrono::microseconds(probe_interval.count()));
+    }
+
+    probes_done.wait();
+    running.store(false);
+    while(bulk_in_flight.load() > 0){
+        std::this_thread::yield();
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+
+    std::cout << test_name << ": probe start latency (us) "
+              << " p50 " << latencies[latencies.size() / 2]
+              << " p99 " << latencies[(latencies.size() * 99) / 100]
+              << " max " << latencies.back() << std::endl;
+}
+
+
+
 int main(){
 
     const std::size_t n_exec = 20000;
@@ -100,6 +175,14 @@ int main(){
 
     junk += executor_test<hadoken::system_executor>(n_exec, "system_executor");
 
+    hadoken::format::scat(std::cout, "\ntest task latency on a saturated pool\n");
+
+    priority_latency_test(hadoken::task_priority::normal, hadoken::task_priority::normal, "no_priority");
+
+    priority_latency_test(hadoken::task_priority::low, hadoken::task_priority::normal, "bulk_low_probe_normal");
+
+    priority_latency_test(hadoken::task_priority::low, hadoken::task_priority::high, "bulk_low_probe_high");
+
 
     std::cout << "end junk " << junk << std::endl;
 
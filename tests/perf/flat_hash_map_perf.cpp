@@ -0,0 +1,117 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/chrono.hpp>
+
+#include <hadoken/containers/flat_hash_map.hpp>
+#include <hadoken/format/format.hpp>
+
+
+using namespace boost::chrono;
+
+typedef steady_clock::time_point tp;
+typedef steady_clock cl;
+
+
+// number of lookups per test
+const std::size_t n_lookups = 4000000;
+
+
+std::vector<std::uint64_t> random_keys(std::size_t n, std::uint64_t seed){
+    std::vector<std::uint64_t> res;
+    std::uint64_t state = seed;
+    for(std::size_t i = 0; i < n; ++i){
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        res.push_back(state >> 8);
+    }
+    return res;
+}
+
+
+double elapsed_ms(tp t1, tp t2){
+    return boost::chrono::duration_cast<microseconds>(t2 -t1).count() / 1000.0;
+}
+
+
+// build, lookups of present and absent keys, erase half of the keys
+template<typename Map>
+std::uint64_t map_test(std::size_t size, const std::string & name){
+    const std::vector<std::uint64_t> keys = random_keys(size, 1), absent = random_keys(size, 2);
+    std::uint64_t junk = 0;
+
+    tp t1 = cl::now();
+    Map map;
+    for(std::size_t i = 0; i < size; ++i){
+        map[keys[i]] = i;
+    }
+    tp t2 = cl::now();
+
+    for(std::size_t i = 0; i < n_lookups; ++i){
+        auto it = map.find(keys[(i * 7919) % size]);
+        junk += it->second;
+    }
+    tp t3 = cl::now();
+
+    for(std::size_t i = 0; i < n_lookups; ++i){
+        junk += (map.find(absent[(i * 7919) % size]) == map.end()) ? 1 : 0;
+    }
+    tp t4 = cl::now();
+
+    for(std::size_t i = 0; i < size; i += 2){
+        junk += map.erase(keys[i]);
+    }
+    tp t5 = cl::now();
+
+    hadoken::format::scat(std::cout, name, " size=", size,
+                          ": insert ", (elapsed_ms(t1, t2) * 1e6) / size, " ns",
+                          ", hit ", (elapsed_ms(t2, t3) * 1e6) / n_lookups, " ns",
+                          ", miss ", (elapsed_ms(t3, t4) * 1e6) / n_lookups, " ns",
+                          ", erase ", (elapsed_ms(t4, t5) * 1e6) / (size / 2), " ns\n");
+    return junk + map.size();
+}
+
+
+
+int main(){
+
+    std::uint64_t junk = 0;
+
+    for(std::size_t size : { 1000, 100000, 1000000, 8000000 }){
+        junk += map_test<std::unordered_map<std::uint64_t, std::uint64_t> >(size, "std::unordered_map");
+        junk += map_test<hadoken::containers::flat_hash_map<std::uint64_t, std::uint64_t> >(size, "hadoken::containers::flat_hash_map");
+        std::cout << "\n";
+    }
+
+    std::cout << "end junk " << junk << std::endl;
+
+}
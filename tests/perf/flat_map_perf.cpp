@@ -0,0 +1,117 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#include <iostream>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include <boost/chrono.hpp>
+
+#include <hadoken/containers/flat_map.hpp>
+#include <hadoken/format/format.hpp>
+
+
+using namespace boost::chrono;
+
+typedef steady_clock::time_point tp;
+typedef steady_clock cl;
+
+
+// number of lookups per test
+const std::size_t n_lookups = 4000000;
+
+
+std::vector<std::pair<std::uint64_t, std::uint64_t> > random_pairs(std::size_t n){
+    std::vector<std::pair<std::uint64_t, std::uint64_t> > res;
+    std::uint64_t state = 0x9E3779B97F4A7C15ULL;
+    for(std::size_t i = 0; i < n; ++i){
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        res.push_back(std::make_pair(state >> 16, i));
+    }
+    return res;
+}
+
+
+// lookups of random keys, half of them present
+template<typename Map>
+std::uint64_t lookup_test(const Map & map, const std::vector<std::pair<std::uint64_t, std::uint64_t> > & pairs, const std::string & name){
+    std::uint64_t junk = 0;
+    std::uint64_t state = 1;
+
+    tp t1 = cl::now();
+    for(std::size_t i = 0; i < n_lookups; ++i){
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        const std::uint64_t key = ((state >> 40) & 1) ? pairs[(state >> 33) % pairs.size()].first : (state >> 16);
+        auto it = map.find(key);
+        if(it != map.end()){
+            junk += it->second;
+        }
+    }
+    tp t2 = cl::now();
+
+    const double elapsed_ms = boost::chrono::duration_cast<microseconds>(t2 -t1).count() / 1000.0;
+    hadoken::format::scat(std::cout, name, " size=", pairs.size(), " : ", elapsed_ms, " ms ",
+                          (elapsed_ms * 1e6) / n_lookups, " ns/lookup\n");
+    return junk;
+}
+
+
+std::uint64_t build_test(const std::vector<std::pair<std::uint64_t, std::uint64_t> > & pairs){
+    tp t1 = cl::now();
+    std::map<std::uint64_t, std::uint64_t> map(pairs.begin(), pairs.end());
+    tp t2 = cl::now();
+    hadoken::containers::flat_map<std::uint64_t, std::uint64_t> fmap(pairs.begin(), pairs.end());
+    tp t3 = cl::now();
+
+    hadoken::format::scat(std::cout, "build size=", pairs.size(), " std::map ", boost::chrono::duration_cast<microseconds>(t2 -t1).count() / 1000.0,
+                          " ms, flat_map ", boost::chrono::duration_cast<microseconds>(t3 -t2).count() / 1000.0, " ms\n");
+    return map.size() + fmap.size();
+}
+
+
+
+int main(){
+
+    std::uint64_t junk = 0;
+
+    for(std::size_t size : { 16, 256, 4096, 65536, 1048576 }){
+        const std::vector<std::pair<std::uint64_t, std::uint64_t> > pairs = random_pairs(size);
+
+        std::map<std::uint64_t, std::uint64_t> map(pairs.begin(), pairs.end());
+        hadoken::containers::flat_map<std::uint64_t, std::uint64_t> fmap(pairs.begin(), pairs.end());
+
+        junk += lookup_test(map, pairs, "std::map");
+        junk += lookup_test(fmap, pairs, "hadoken::containers::flat_map");
+        junk += build_test(pairs);
+        std::cout << "\n";
+    }
+
+    std::cout << "end junk " << junk << std::endl;
+
+}
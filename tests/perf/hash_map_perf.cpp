@@ -0,0 +1,194 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#include <iostream>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <vector>
+#include <unordered_map>
+
+#include <boost/chrono.hpp>
+
+#include <hadoken/containers/concurrent_hash_map.hpp>
+#include <hadoken/format/format.hpp>
+
+
+using namespace boost::chrono;
+
+typedef steady_clock::time_point tp;
+typedef steady_clock cl;
+
+
+// total number of operations, shared by all threads
+const std::size_t total_ops = 2000000;
+const std::size_t n_keys = 100000;
+
+
+// reference: unordered_map protected by a mutex
+class mutex_hash_map{
+public:
+    bool find(std::size_t key, std::size_t & value){
+        std::lock_guard<std::mutex> l(_lock);
+        auto it = _map.find(key);
+        if(it == _map.end()){
+            return false;
+        }
+        value = it->second;
+        return true;
+    }
+
+    bool insert_or_assign(std::size_t key, std::size_t value){
+        std::lock_guard<std::mutex> l(_lock);
+        auto res = _map.insert(std::make_pair(key, value));
+        if(res.second == false){
+            res.first->second = value;
+        }
+        return res.second;
+    }
+
+private:
+    std::mutex _lock;
+    std::unordered_map<std::size_t, std::size_t> _map;
+};
+
+
+// each thread executes a mix of lookups and insert_or_assign
+// on a key space of n_keys, write_percent % of the operations are writes
+template<typename Map>
+std::size_t map_test(std::size_t n_thread, std::size_t write_percent, const std::string & map_name){
+
+    const std::size_t iter = total_ops / n_thread;
+    Map map;
+    std::atomic<std::size_t> hits(0);
+
+    tp t1, t2;
+
+    t1 = cl::now();
+
+    std::vector<std::future<void> > res;
+    for(std::size_t i =0; i < n_thread; ++i){
+        res.emplace_back(
+            std::async(std::launch::async, [&, i] {
+            std::size_t local_hits = 0, value = 0;
+            // cheap LCG, distinct sequence per thread
+            std::uint64_t state = 0x9E3779B97F4A7C15ULL * (i+1);
+            for(std::size_t j =0; j < iter; ++j){
+                state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+                const std::size_t key = static_cast<std::size_t>(state >> 33) % n_keys;
+                if( (state >> 20) % 100 < write_percent){
+                    map.insert_or_assign(key, j);
+                } else if(map.find(key, value)){
+                    local_hits += 1;
+                }
+            }
+            hits += local_hits;
+        }));
+    }
+
+    for(auto & f : res){
+        f.wait();
+    }
+
+    t2 = cl::now();
+
+    const double elapsed_ms = boost::chrono::duration_cast<microseconds>(t2 -t1).count() / 1000.0;
+    const double mops = (iter * n_thread) / (elapsed_ms * 1000.0);
+
+    hadoken::format::scat(std::cout, map_name, " threads=", n_thread, " writes=", write_percent,
+                          "%: ", elapsed_ms, " ms ", mops, " Mops/s\n");
+
+    return hits.load();
+}
+
+
+std::size_t bulk_build_test(){
+    std::vector<std::pair<std::size_t, std::size_t> > elems;
+    for(std::size_t i = 0; i < total_ops; ++i){
+        // scattered keys: sequential keys favour the identity std::hash of std::unordered_map
+        elems.emplace_back(i * 0x9E3779B97F4A7C15ULL, i);
+    }
+
+    tp t1, t2;
+    hadoken::containers::concurrent_hash_map<std::size_t, std::size_t> map;
+
+    t1 = cl::now();
+    map.bulk_insert(hadoken::parallel::par, elems.begin(), elems.end());
+    t2 = cl::now();
+
+    const double elapsed_ms = boost::chrono::duration_cast<microseconds>(t2 -t1).count() / 1000.0;
+    hadoken::format::scat(std::cout, "concurrent_hash_map bulk_insert(par) ", elems.size(), " elements: ", elapsed_ms, " ms\n");
+
+
+    std::unordered_map<std::size_t, std::size_t> ref;
+    t1 = cl::now();
+    ref.reserve(elems.size());
+    ref.insert(elems.begin(), elems.end());
+    t2 = cl::now();
+
+    const double ref_elapsed_ms = boost::chrono::duration_cast<microseconds>(t2 -t1).count() / 1000.0;
+    hadoken::format::scat(std::cout, "std::unordered_map insert(seq) ", elems.size(), " elements: ", ref_elapsed_ms, " ms\n\n");
+
+    return map.size() + ref.size();
+}
+
+
+template<typename Map>
+std::size_t map_sweep(const std::vector<std::size_t> & thread_counts, const std::string & map_name){
+    std::size_t junk = 0;
+    for(std::size_t write_percent : { 1, 10, 50 }){
+        for(std::size_t n_thread : thread_counts){
+            junk += map_test<Map>(n_thread, write_percent, map_name);
+        }
+    }
+    std::cout << "\n";
+    return junk;
+}
+
+
+
+int main(){
+
+    const std::size_t ncore = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    std::size_t junk=0;
+
+    hadoken::format::scat(std::cout, "test hash map with ", ncore, " cores\n");
+
+    const std::vector<std::size_t> thread_counts = { 1, 2, 4, 8, 16, 32, 64 };
+
+    junk += map_sweep<mutex_hash_map>(thread_counts, "mutex + std::unordered_map");
+
+    junk += map_sweep<hadoken::containers::concurrent_hash_map<std::size_t, std::size_t> >(thread_counts,
+                                                                                             "hadoken::containers::concurrent_hash_map");
+
+    junk += bulk_build_test();
+
+    std::cout << "end junk " << junk << std::endl;
+
+}
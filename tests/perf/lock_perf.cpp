@@ -28,6 +28,7 @@
 */
 
 
+#include <algorithm>
 #include <mutex>
 #include <thread>
 #include <future>
@@ -39,6 +40,11 @@
 #include <boost/chrono.hpp>
 
 #include <hadoken/thread/spinlock.hpp>
+#include <hadoken/thread/mcs_lock.hpp>
+#include <hadoken/thread/rw_spinlock.hpp>
+#include <hadoken/thread/padded.hpp>
+#include <hadoken/thread/sharded_counter.hpp>
+#include <hadoken/thread/profiled_lock.hpp>
 #include <hadoken/format/format.hpp>
 
 
@@ -48,30 +54,35 @@ typedef  system_clock::time_point tp;
 typedef  system_clock cl;
 
 
+// total number of critical sections executed, shared by all threads
+const std::size_t total_iter = 200000;
+
+
 template<typename LockType>
-std::size_t lock_test(std::size_t n_thread, const std::string & lock_name){
+std::size_t lock_test(std::size_t n_thread, std::size_t critical_length, const std::string & lock_name){
 
-	const std::size_t iter = 200000;
+    const std::size_t iter = total_iter / n_thread;
 
     tp t1, t2;
 
     t1 = cl::now();
 
-    const std::string msg = "hello world, ";
     std::vector<std::future<void> > res;
+    std::vector<double> shared_data(critical_length, 0.0);
     double a = 0.0, inc = 1.0;
     LockType lock;
 
-    using namespace hadoken::thread;
-
-
     for(std::size_t i =0; i < n_thread; ++i){
         res.emplace_back(
             std::async(std::launch::async, [&] {
             for(std::size_t j =0; j < iter; ++j){
                 std::lock_guard<LockType> guard(lock);
                 a += inc;
-				inc += 1.0;
+                inc += 1.0;
+                // critical section length: number of shared values updated
+                for(std::size_t k = 0; k < critical_length; ++k){
+                    shared_data[k] += a;
+                }
             }
         }));
     }
@@ -82,36 +93,164 @@ std::size_t lock_test(std::size_t n_thread, const std::string & lock_name){
 
     t2 = cl::now();
 
-    std::cout << lock_name << ": " << boost::chrono::duration_cast<milliseconds>(t2 -t1) << std::endl;
+    const double elapsed_ms = boost::chrono::duration_cast<microseconds>(t2 -t1).count() / 1000.0;
+    const double mops = (iter * n_thread) / (elapsed_ms * 1000.0);
+
+    hadoken::format::scat(std::cout, lock_name, " threads=", n_thread, " critical_length=", critical_length,
+                          ": ", elapsed_ms, " ms ", mops, " Mlock/s\n");
 
     return std::size_t(a);
 }
 
 
+template<typename LockType>
+std::size_t lock_sweep(const std::vector<std::size_t> & thread_counts, const std::vector<std::size_t> & critical_lengths,
+                       const std::string & lock_name){
+    std::size_t junk = 0;
+    for(std::size_t critical_length : critical_lengths){
+        for(std::size_t n_thread : thread_counts){
+            junk += lock_test<LockType>(n_thread, critical_length, lock_name);
+        }
+    }
+    std::cout << "\n";
+    return junk;
+}
+
+
+// counters incremented by all the threads, read once at the end
+
+struct atomic_counter{
+    atomic_counter(std::size_t) : value(0) {}
+    void add(std::size_t, std::int64_t n){ value.fetch_add(n, std::memory_order_relaxed); }
+    std::int64_t load() const { return value.load(); }
+
+    std::atomic<std::int64_t> value;
+};
+
+// one atomic per thread, side by side: false sharing
+template<typename Slot>
+struct per_thread_counter{
+    per_thread_counter(std::size_t n_thread) : slots(n_thread) {}
+    void add(std::size_t id, std::int64_t n){ (*slots[id]).fetch_add(n, std::memory_order_relaxed); }
+    std::int64_t load() const {
+        std::int64_t res = 0;
+        for(auto & s : slots){ res += (*s).load(); }
+        return res;
+    }
+
+    std::vector<Slot> slots;
+};
+
+struct unpadded_slot{
+    unpadded_slot() : value(0) {}
+    unpadded_slot(const unpadded_slot &) : value(0) {}
+    std::atomic<std::int64_t> & operator*(){ return value; }
+    const std::atomic<std::int64_t> & operator*() const { return value; }
+
+    std::atomic<std::int64_t> value;
+};
+
+typedef per_thread_counter<unpadded_slot> unpadded_counter;
+typedef per_thread_counter<hadoken::thread::padded<std::atomic<std::int64_t> > > padded_counter;
+
+struct sharded_counter{
+    sharded_counter(std::size_t) : value() {}
+    void add(std::size_t, std::int64_t n){ value.add(n); }
+    std::int64_t load() const { return value.load(); }
+
+    hadoken::thread::sharded_counter value;
+};
+
+
+template<typename Counter>
+std::size_t counter_test(std::size_t n_thread, const std::string & counter_name){
+
+    const std::size_t iter = (total_iter * 20) / n_thread;
+
+    tp t1, t2;
+
+    Counter counter(n_thread);
+
+    t1 = cl::now();
+
+    std::vector<std::future<void> > res;
+    for(std::size_t i =0; i < n_thread; ++i){
+        res.emplace_back(
+            std::async(std::launch::async, [&, i] {
+            for(std::size_t j =0; j < iter; ++j){
+                counter.add(i, 1);
+            }
+        }));
+    }
+
+    for(auto & f : res){
+        f.wait();
+    }
+
+    t2 = cl::now();
+
+    const double elapsed_ms = boost::chrono::duration_cast<microseconds>(t2 -t1).count() / 1000.0;
+    const double mops = (iter * n_thread) / (elapsed_ms * 1000.0);
+
+    hadoken::format::scat(std::cout, counter_name, " threads=", n_thread, ": ", elapsed_ms, " ms ", mops, " Mincr/s\n");
+
+    return std::size_t(counter.load());
+}
+
+
+template<typename Counter>
+std::size_t counter_sweep(const std::vector<std::size_t> & thread_counts, const std::string & counter_name){
+    std::size_t junk = 0;
+    for(std::size_t n_thread : thread_counts){
+        junk += counter_test<Counter>(n_thread, counter_name);
+    }
+    std::cout << "\n";
+    return junk;
+}
+
+
 
 int main(){
 
-	const std::size_t ncore = std::thread::hardware_concurrency();
+    const std::size_t ncore = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
     std::size_t junk=0;
 
-    hadoken::format::scat(std::cout, "test lock with ", ncore, " cores");
+    hadoken::format::scat(std::cout, "test lock with ", ncore, " cores\n");
+
+    std::vector<std::size_t> thread_counts = { 1, 2, ncore/2, ncore, 2*ncore };
+    std::sort(thread_counts.begin(), thread_counts.end());
+    thread_counts.erase(std::unique(thread_counts.begin(), thread_counts.end()), thread_counts.end());
+    thread_counts.erase(std::remove(thread_counts.begin(), thread_counts.end(), 0), thread_counts.end());
+
+    const std::vector<std::size_t> critical_lengths = { 0, 16, 256 };
+
+    junk += lock_sweep<std::mutex>(thread_counts, critical_lengths, "std::mutex");
+
+    junk += lock_sweep<hadoken::thread::profiled_lock<std::mutex> >(thread_counts, critical_lengths,
+                                                                    "hadoken::thread::profiled_lock<std::mutex>");
+
+    junk += lock_sweep<hadoken::thread::spin_lock>(thread_counts, critical_lengths, "hadoken::thread::spin_lock");
+
+    junk += lock_sweep<hadoken::thread::profiled_lock<hadoken::thread::spin_lock> >(thread_counts, critical_lengths,
+                                                                                   "hadoken::thread::profiled_lock<spin_lock>");
 
-    junk += lock_test<std::mutex>(1, "std::mutex_single");
+    junk += lock_sweep<hadoken::thread::backoff_spin_lock>(thread_counts, critical_lengths, "hadoken::thread::backoff_spin_lock");
 
-    junk += lock_test<hadoken::thread::spin_lock>(1, "hadoken::thread::spinlock_single");
+    junk += lock_sweep<hadoken::thread::ticket_lock>(thread_counts, critical_lengths, "hadoken::thread::ticket_lock");
 
-    junk += lock_test<std::mutex>(ncore/2, "std::mutex_thread=core/2");
+    junk += lock_sweep<hadoken::thread::mcs_lock>(thread_counts, critical_lengths, "hadoken::thread::mcs_lock");
 
-    junk += lock_test<hadoken::thread::spin_lock>(ncore/2, "hadoken::thread::spinlock_thread=core/2");
+    junk += lock_sweep<hadoken::thread::rw_spin_lock>(thread_counts, critical_lengths, "hadoken::thread::rw_spin_lock");
 
+    const std::vector<std::size_t> counter_thread_counts = { 1, 2, 4, 8, 16, 32, 64 };
 
-    junk += lock_test<std::mutex>(ncore, "std::mutex_thread=core");
+    junk += counter_sweep<atomic_counter>(counter_thread_counts, "std::atomic<int64_t>");
 
-    junk += lock_test<hadoken::thread::spin_lock>(ncore, "hadoken::thread::spinlock_thread=core");
+    junk += counter_sweep<unpadded_counter>(counter_thread_counts, "per-thread std::atomic<int64_t>, unpadded");
 
-    junk += lock_test<std::mutex>(2*ncore, "std::mutex_thread=2*core");
+    junk += counter_sweep<padded_counter>(counter_thread_counts, "per-thread hadoken::thread::padded<std::atomic<int64_t> >");
 
-    junk += lock_test<hadoken::thread::spin_lock>(2*ncore, "hadoken::thread::spinlock_thread=2*core");
+    junk += counter_sweep<sharded_counter>(counter_thread_counts, "hadoken::thread::sharded_counter");
 
    std::cout << "end junk " << junk << std::endl;
 
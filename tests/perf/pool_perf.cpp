@@ -0,0 +1,183 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ *
+ * Boost Software License - Version 1.0
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+*
+*/
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include <future>
+#include <vector>
+
+#include <boost/chrono.hpp>
+
+#include <hadoken/memory/object_pool.hpp>
+#include <hadoken/format/format.hpp>
+
+
+using namespace boost::chrono;
+
+typedef steady_clock::time_point tp;
+typedef steady_clock cl;
+
+
+// total number of allocations, shared by all threads
+const std::size_t total_ops = 4000000;
+
+// number of objects alive per thread
+const std::size_t window_size = 1024;
+
+
+// small node, typical of a tree or a task queue
+struct node{
+    node(std::size_t v) : left(nullptr), right(nullptr), value(v) {}
+
+    node* left;
+    node* right;
+    std::size_t value;
+};
+
+
+struct new_delete_allocator{
+    node* create(std::size_t v){
+        return new node(v);
+    }
+
+    void destroy(node* n){
+        delete n;
+    }
+};
+
+
+struct pool_allocator{
+    node* create(std::size_t v){
+        return pool.create(v);
+    }
+
+    void destroy(node* n){
+        pool.destroy(n);
+    }
+
+    hadoken::memory::object_pool<node> pool;
+};
+
+
+// each thread keeps a window of live objects, replaces a pseudo-random one at each step.
+// With cross_thread, the objects are freed by the next thread: the slots migrate between threads
+template<typename Allocator>
+std::size_t churn_test(std::size_t n_thread, bool cross_thread, const std::string & name){
+
+    const std::size_t iter = total_ops / n_thread;
+    Allocator alloc;
+    std::atomic<std::size_t> junk(0);
+
+    std::vector<std::vector<node*> > windows(n_thread);
+
+    tp t1, t2;
+
+    t1 = cl::now();
+
+    std::vector<std::future<void> > res;
+    for(std::size_t i =0; i < n_thread; ++i){
+        res.emplace_back(
+            std::async(std::launch::async, [&, i] {
+            std::vector<node*> & window = windows[i];
+            std::size_t local_junk = 0;
+            std::uint64_t state = 0x9E3779B97F4A7C15ULL * (i+1);
+            for(std::size_t j =0; j < window_size; ++j){
+                window.push_back(alloc.create(j));
+            }
+            for(std::size_t j =0; j < iter; ++j){
+                state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+                node* & slot = window[(state >> 33) % window_size];
+                local_junk += slot->value;
+                alloc.destroy(slot);
+                slot = alloc.create(j);
+            }
+            junk += local_junk;
+        }));
+    }
+
+    for(auto & f : res){
+        f.wait();
+    }
+    res.clear();
+
+    for(std::size_t i =0; i < n_thread; ++i){
+        res.emplace_back(
+            std::async(std::launch::async, [&, i] {
+            for(node* n : windows[cross_thread ? (i+1) % n_thread : i]){
+                alloc.destroy(n);
+            }
+        }));
+    }
+
+    for(auto & f : res){
+        f.wait();
+    }
+
+    t2 = cl::now();
+
+    const double elapsed_ms = boost::chrono::duration_cast<microseconds>(t2 -t1).count() / 1000.0;
+    const double mops = (iter * n_thread) / (elapsed_ms * 1000.0);
+
+    hadoken::format::scat(std::cout, name, " threads=", n_thread, (cross_thread ? " cross-thread free" : ""),
+                          ": ", elapsed_ms, " ms ", mops, " Mops/s\n");
+
+    return junk.load();
+}
+
+
+template<typename Allocator>
+std::size_t churn_sweep(const std::vector<std::size_t> & thread_counts, const std::string & name){
+    std::size_t junk = 0;
+    for(bool cross_thread : { false, true }){
+        for(std::size_t n_thread : thread_counts){
+            junk += churn_test<Allocator>(n_thread, cross_thread, name);
+        }
+    }
+    std::cout << "\n";
+    return junk;
+}
+
+
+
+int main(){
+
+    const std::size_t ncore = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    std::size_t junk=0;
+
+    hadoken::format::scat(std::cout, "test object pool with ", ncore, " cores\n");
+
+    const std::vector<std::size_t> thread_counts = { 1, 2, 4, 8, 16, 32 };
+
+    junk += churn_sweep<new_delete_allocator>(thread_counts, "new / delete");
+
+    junk += churn_sweep<pool_allocator>(thread_counts, "hadoken::memory::object_pool");
+
+    std::cout << "end junk " << junk << std::endl;
+
+}
@@ -0,0 +1,232 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ * 
+ * Boost Software License - Version 1.0 
+ * 
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ * 
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+* 
+*/
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+
+#include <boost/chrono.hpp>
+
+#include <hadoken/format/format.hpp>
+
+#include <hadoken/thread/mpmc_queue.hpp>
+#include <hadoken/thread/spsc_ring.hpp>
+
+
+using namespace boost::chrono;
+
+typedef steady_clock::time_point tp;
+typedef steady_clock cl;
+
+
+// reference: bounded queue protected by a mutex
+template<typename T>
+class mutex_queue{
+public:
+    mutex_queue(std::size_t capacity) : _capacity(capacity), _queue(), _lock(), _not_full(), _not_empty() {}
+
+    void push(const T & val){
+        {
+            std::unique_lock<std::mutex> l(_lock);
+            _not_full.wait(l, [this](){ return _queue.size() < _capacity; });
+            _queue.push_back(val);
+        }
+        _not_empty.notify_one();
+    }
+
+    void pop(T & val){
+        {
+            std::unique_lock<std::mutex> l(_lock);
+            _not_empty.wait(l, [this](){ return _queue.empty() == false; });
+            val = _queue.front();
+            _queue.pop_front();
+        }
+        _not_full.notify_one();
+    }
+
+private:
+    std::size_t _capacity;
+    std::deque<T> _queue;
+    std::mutex _lock;
+    std::condition_variable _not_full, _not_empty;
+};
+
+
+// n_thread producers and n_thread consumers exchange timestamps
+template<typename Queue>
+void queue_test(std::size_t n_thread, const std::string & queue_name){
+    const std::size_t n_items = 200000;
+    const std::size_t items_per_thread = n_items / n_thread;
+    const std::size_t capacity = 1024;
+
+    Queue queue(capacity);
+
+    const tp start = cl::now();
+
+    std::vector<std::thread> producers;
+    for(std::size_t i = 0; i < n_thread; ++i){
+        producers.emplace_back([&](){
+            for(std::size_t j = 0; j < items_per_thread; ++j){
+                queue.push(cl::now().time_since_epoch().count());
+            }
+        });
+    }
+
+    std::vector<std::vector<double> > latencies(n_thread);
+    std::vector<std::thread> consumers;
+    for(std::size_t i = 0; i < n_thread; ++i){
+        consumers.emplace_back([&, i](){
+            latencies[i].reserve(items_per_thread);
+            for(std::size_t j = 0; j < items_per_thread; ++j){
+                std::int64_t stamp;
+                queue.pop(stamp);
+                latencies[i].push_back(double(cl::now().time_since_epoch().count() - stamp) / 1000.0);
+            }
+        });
+    }
+
+    for(auto & t : producers){
+        t.join();
+    }
+    for(auto & t : consumers){
+        t.join();
+    }
+
+    const double elapsed_ms = double(duration_cast<microseconds>(cl::now() - start).count()) / 1000.0;
+
+    std::vector<double> all_latencies;
+    for(auto & l : latencies){
+        all_latencies.insert(all_latencies.end(), l.begin(), l.end());
+    }
+    std::sort(all_latencies.begin(), all_latencies.end());
+
+    hadoken::format::scat(std::cout, queue_name, " producers=consumers=", n_thread, ": ",
+                          (items_per_thread * n_thread) / (elapsed_ms * 1000.0), " Mitems/s",
+                          " latency (us) p50 ", all_latencies[all_latencies.size() / 2],
+                          " p99 ", all_latencies[(all_latencies.size() * 99) / 100], "\n");
+}
+
+
+
+struct record{
+    char data[256];
+};
+
+
+// stream of records between two threads, written and read in place in the ring
+void spsc_bandwidth_test(std::size_t batch, const std::string & test_name){
+    const std::size_t n_records = 1 << 22;
+    hadoken::thread::spsc_ring<record> ring(4096);
+
+    record source;
+    std::memset(source.data, 1, sizeof(source.data));
+
+    const tp start = cl::now();
+
+    std::thread producer([&](){
+        std::size_t i = 0;
+        while(i < n_records){
+            std::size_t n = std::min(batch, n_records - i);
+            record* slots = ring.reserve(n);
+            if(n == 0){
+                std::this_thread::yield();
+                continue;
+            }
+            for(std::size_t j = 0; j < n; ++j){
+                std::memcpy(slots[j].data, source.data, sizeof(source.data));
+            }
+            ring.commit(n);
+            i += n;
+        }
+    });
+
+    std::size_t checksum = 0, received = 0;
+    while(received < n_records){
+        std::size_t n = batch;
+        record* slots = ring.peek(n);
+        if(n == 0){
+            std::this_thread::yield();
+            continue;
+        }
+        for(std::size_t j = 0; j < n; ++j){
+            checksum += static_cast<std::size_t>(slots[j].data[j % sizeof(source.data)]);
+        }
+        ring.release(n);
+        received += n;
+    }
+    producer.join();
+
+    const double elapsed_s = double(duration_cast<microseconds>(cl::now() - start).count()) / 1e6;
+
+    hadoken::format::scat(std::cout, test_name, " batch=", batch, ": ",
+                          (double(n_records) * sizeof(record)) / elapsed_s / 1e9, " GB/s ",
+                          double(n_records) / elapsed_s / 1e6, " Mrecords/s (checksum ", checksum, ")\n");
+}
+
+
+// reference: single thread copy of the same volume
+void memcpy_bandwidth_test(){
+    const std::size_t n_records = 1 << 22, window = 4096;
+    std::vector<record> source(window), dest(window);
+
+    const tp start = cl::now();
+    for(std::size_t i = 0; i < n_records; i += window){
+        std::memcpy(dest.data(), source.data(), window * sizeof(record));
+    }
+    const double elapsed_s = double(duration_cast<microseconds>(cl::now() - start).count()) / 1e6;
+
+    hadoken::format::scat(std::cout, "memcpy reference: ", (double(n_records) * sizeof(record)) / elapsed_s / 1e9,
+                          " GB/s (", int(dest[window -1].data[0]), ")\n");
+}
+
+int main(){
+
+    const std::size_t ncore = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+
+    hadoken::format::scat(std::cout, "test queues with ", ncore, " cores\n\n");
+
+    for(std::size_t n_thread = 1; n_thread <= 64; n_thread *= 2){
+        queue_test<mutex_queue<std::int64_t> >(n_thread, "mutex_queue");
+        queue_test<hadoken::thread::mpmc_queue<std::int64_t> >(n_thread, "mpmc_queue");
+    }
+
+    std::cout << "\n";
+
+    memcpy_bandwidth_test();
+    for(std::size_t batch : { 1, 16, 256 }){
+        spsc_bandwidth_test(batch, "spsc_ring");
+    }
+
+}
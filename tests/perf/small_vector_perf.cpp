@@ -28,15 +28,16 @@
 */
 
 
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
 
-
-#include <boost/test/floating_point_comparison.hpp>
-
-
-#include <boost/random.hpp>
 #include <boost/chrono.hpp>
+#include <boost/container/small_vector.hpp>
 
 #include <hadoken/containers/small_vector.hpp>
+#include <hadoken/format/format.hpp>
 
 
 using namespace boost::chrono;
@@ -44,77 +45,148 @@ using namespace boost::chrono;
 typedef  system_clock::time_point tp;
 typedef  system_clock cl;
 
-constexpr std::size_t static_vec_size = 64;
-const std::size_t n_elems= 64;
+constexpr std::size_t static_vec_size = 16;
 
-std::size_t test_std_vector(std::size_t iter){
+typedef std::vector<std::size_t> std_vec;
+typedef hadoken::containers::small_vector<std::size_t, static_vec_size> hadoken_vec;
+typedef boost::container::small_vector<std::size_t, static_vec_size> boost_vec;
 
+typedef std::vector<std::string> std_str_vec;
+typedef hadoken::containers::small_vector<std::string, static_vec_size> hadoken_str_vec;
+typedef boost::container::small_vector<std::string, static_vec_size> boost_str_vec;
 
 
-    std::size_t res =0;
+void print_result(const std::string & test_name, const std::string & vec_name, std::size_t n_elems, tp t1, tp t2){
+    hadoken::format::scat(std::cout, test_name, " ", vec_name, " n_elems=", n_elems, ": ",
+                          boost::chrono::duration_cast<microseconds>(t2 -t1).count() / 1000.0, " ms\n");
+}
 
-    tp t1, t2;
 
-    t1 = cl::now();
+// build a vector of n_elems by push_back, iter times
+template<typename Vec>
+std::size_t test_push_back(std::size_t iter, std::size_t n_elems, const std::string & vec_name){
+    std::size_t res =0;
 
+    tp t1 = cl::now();
     for(std::size_t i =0; i < iter; ++i){
-        std::vector<std::size_t> v;
+        Vec v;
         for(std::size_t j = 0; j < n_elems; ++j){
             v.push_back(j);
         }
         res = std::accumulate(v.begin(), v.end(), res);
     }
+    tp t2 = cl::now();
 
-
-    t2 = cl::now();
-
-    std::cout << "vector: " << boost::chrono::duration_cast<milliseconds>(t2 -t1) << std::endl;
+    print_result("push_back", vec_name, n_elems, t1, t2);
     return res;
-
 }
 
 
-std::size_t test_small_vector(std::size_t iter){
+// copy construct then move construct a vector of n_elems
+template<typename Vec>
+std::size_t test_copy_move(std::size_t iter, std::size_t n_elems, const std::string & vec_name){
+    std::size_t res =0;
 
-    using namespace hadoken::containers;
+    Vec origin;
+    for(std::size_t j = 0; j < n_elems; ++j){
+        origin.push_back(j);
+    }
 
-    std::size_t res =0;
+    tp t1 = cl::now();
+    for(std::size_t i =0; i < iter; ++i){
+        Vec copy(origin);
+        copy[0] = i;
+        Vec moved(std::move(copy));
+        res += moved[0] + moved.size();
+    }
+    tp t2 = cl::now();
 
-    tp t1, t2;
+    print_result("copy_move", vec_name, n_elems, t1, t2);
+    return res;
+}
 
-    t1 = cl::now();
 
-    for(std::size_t i =0; i < iter; ++i){
-        small_vector<std::size_t, static_vec_size> v;
+// insert at the front and erase from the middle, relocation of the tail
+template<typename Vec>
+std::size_t test_insert_erase(std::size_t iter, std::size_t n_elems, const std::string & vec_name){
+    std::size_t res =0;
 
+    tp t1 = cl::now();
+    for(std::size_t i =0; i < iter; ++i){
+        Vec v;
         for(std::size_t j = 0; j < n_elems; ++j){
-            v.push_back(j);
+            v.insert(v.begin(), j);
+        }
+        while(v.empty() == false){
+            res += v[v.size() / 2];
+            v.erase(v.begin() + v.size() / 2);
         }
-        res = std::accumulate(v.begin(), v.end(), res);
     }
+    tp t2 = cl::now();
 
+    print_result("insert_erase", vec_name, n_elems, t1, t2);
+    return res;
+}
 
-    t2 = cl::now();
 
-    std::cout << "small_vector: " << boost::chrono::duration_cast<milliseconds>(t2 -t1) << std::endl;
-    return res;
+// push_back of non trivially relocatable elements
+template<typename Vec>
+std::size_t test_push_back_string(std::size_t iter, std::size_t n_elems, const std::string & vec_name){
+    std::size_t res =0;
+    const std::string content("hello world");
+
+    tp t1 = cl::now();
+    for(std::size_t i =0; i < iter; ++i){
+        Vec v;
+        for(std::size_t j = 0; j < n_elems; ++j){
+            v.push_back(content);
+        }
+        res += v.back().size() + v.size();
+    }
+    tp t2 = cl::now();
 
+    print_result("push_back_string", vec_name, n_elems, t1, t2);
+    return res;
 }
 
 
+template<typename Function>
+std::size_t run_sizes(const std::vector<std::size_t> & sizes, std::size_t total_elems, Function fun){
+    std::size_t junk = 0;
+    for(std::size_t n_elems : sizes){
+        junk += fun(std::max<std::size_t>(total_elems / n_elems, 1), n_elems);
+    }
+    std::cout << "\n";
+    return junk;
+}
+
 
 
 int main(){
 
-    const std::size_t n_exec = 1000000;
+    const std::size_t total_elems = 64000000;
     std::size_t junk=0;
 
-    std::cout << "generation of " << n_exec << "*" << n_elems  << " insertions" << std::endl;
+    const std::vector<std::size_t> sizes = { 8, 16, 64, 1024 };
+
+    hadoken::format::scat(std::cout, "small_vector inline capacity ", static_vec_size, ", ", total_elems, " elements per test\n\n");
+
+    junk += run_sizes(sizes, total_elems, [](std::size_t iter, std::size_t n){ return test_push_back<std_vec>(iter, n, "std::vector"); });
+    junk += run_sizes(sizes, total_elems, [](std::size_t iter, std::size_t n){ return test_push_back<boost_vec>(iter, n, "boost::container::small_vector"); });
+    junk += run_sizes(sizes, total_elems, [](std::size_t iter, std::size_t n){ return test_push_back<hadoken_vec>(iter, n, "hadoken::containers::small_vector"); });
 
-    junk += test_small_vector(n_exec);
+    junk += run_sizes(sizes, total_elems, [](std::size_t iter, std::size_t n){ return test_copy_move<std_vec>(iter, n, "std::vector"); });
+    junk += run_sizes(sizes, total_elems, [](std::size_t iter, std::size_t n){ return test_copy_move<boost_vec>(iter, n, "boost::container::small_vector"); });
+    junk += run_sizes(sizes, total_elems, [](std::size_t iter, std::size_t n){ return test_copy_move<hadoken_vec>(iter, n, "hadoken::containers::small_vector"); });
 
+    const std::vector<std::size_t> insert_sizes = { 8, 16, 64, 256 };
+    junk += run_sizes(insert_sizes, total_elems / 16, [](std::size_t iter, std::size_t n){ return test_insert_erase<std_vec>(iter, n, "std::vector"); });
+    junk += run_sizes(insert_sizes, total_elems / 16, [](std::size_t iter, std::size_t n){ return test_insert_erase<boost_vec>(iter, n, "boost::container::small_vector"); });
+    junk += run_sizes(insert_sizes, total_elems / 16, [](std::size_t iter, std::size_t n){ return test_insert_erase<hadoken_vec>(iter, n, "hadoken::containers::small_vector"); });
 
-    junk += test_std_vector(n_exec);
+    junk += run_sizes(sizes, total_elems / 8, [](std::size_t iter, std::size_t n){ return test_push_back_string<std_str_vec>(iter, n, "std::vector<std::string>"); });
+    junk += run_sizes(sizes, total_elems / 8, [](std::size_t iter, std::size_t n){ return test_push_back_string<boost_str_vec>(iter, n, "boost::container::small_vector<std::string>"); });
+    junk += run_sizes(sizes, total_elems / 8, [](std::size_t iter, std::size_t n){ return test_push_back_string<hadoken_str_vec>(iter, n, "hadoken::containers::small_vector<std::string>"); });
 
     std::cout << "end junk " << junk << std::endl;
 
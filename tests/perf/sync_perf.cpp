@@ -0,0 +1,401 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ * 
+ * Boost Software License - Version 1.0 
+ * 
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ * 
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+* 
+*/
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+
+#include <boost/chrono.hpp>
+
+#include <hadoken/format/format.hpp>
+
+#include <hadoken/executor/thread_pool_executor.hpp>
+#include <hadoken/thread/latch.hpp>
+#include <hadoken/thread/semaphore.hpp>
+#include <hadoken/thread/event.hpp>
+#include <hadoken/thread/barrier.hpp>
+#include <hadoken/thread/spinlock.hpp>
+#include <hadoken/thread/seqlock.hpp>
+#include <hadoken/thread/snapshot_ptr.hpp>
+
+
+using namespace boost::chrono;
+
+typedef steady_clock::time_point tp;
+typedef steady_clock cl;
+
+
+// previous latch implementation, condition variable polled every millisecond
+class condvar_latch{
+public:
+    condvar_latch(std::ptrdiff_t value) : _counter(value), _cond(), _lock() {}
+
+    void count_down(std::ptrdiff_t n = 1){
+        if(_counter.fetch_sub(n) - n <= 0){
+            _cond.notify_all();
+        }
+    }
+
+    void wait(){
+        while(_counter.load() > 0){
+            std::unique_lock<std::mutex> l(_lock);
+            _cond.wait_for(l, std::chrono::milliseconds(1));
+        }
+    }
+
+private:
+    std::atomic<std::ptrdiff_t> _counter;
+    std::condition_variable _cond;
+    std::mutex _lock;
+};
+
+
+void print_latencies(const std::string & test_name, std::vector<double> & latencies){
+    std::sort(latencies.begin(), latencies.end());
+
+    hadoken::format::scat(std::cout, test_name, ": latency (us) ",
+                          " p50 ", latencies[latencies.size() / 2],
+                          " p99 ", latencies[(latencies.size() * 99) / 100],
+                          " max ", latencies.back(), "\n");
+}
+
+
+// time between the last count_down() and the wake up of all the sleeping waiters
+template<typename Latch>
+void latch_wakeup_test(std::size_t n_waiters, const std::string & test_name){
+    const std::size_t n_iter = 200;
+    std::vector<double> latencies;
+
+    for(std::size_t i = 0; i < n_iter; ++i){
+        Latch latch(1);
+        std::vector<tp> wakeups(n_waiters);
+
+        std::vector<std::thread> waiters;
+        for(std::size_t w = 0; w < n_waiters; ++w){
+            waiters.emplace_back([&latch, &wakeups, w](){
+                latch.wait();
+                wakeups[w] = cl::now();
+            });
+        }
+
+        // let the waiters go to sleep
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+
+        const tp start = cl::now();
+        latch.count_down();
+
+        for(auto & t : waiters){
+            t.join();
+        }
+
+        const tp last = *std::max_element(wakeups.begin(), wakeups.end());
+        latencies.push_back(double(duration_cast<nanoseconds>(last - start).count()) / 1000.0);
+    }
+
+    print_latencies(test_name, latencies);
+}
+
+
+// fork-join on a thread pool: time to execute one empty task per worker and join
+template<typename Latch>
+void pool_join_test(hadoken::thread_pool_executor & pool, const std::string & test_name){
+    const std::size_t n_iter = 2000;
+    std::vector<double> latencies;
+
+    for(std::size_t i = 0; i < n_iter; ++i){
+        const tp start = cl::now();
+
+        Latch latch(pool.size());
+        for(std::size_t w = 0; w < pool.size(); ++w){
+            pool.execute_on(w, [&latch](){
+                latch.count_down();
+            });
+        }
+        latch.wait();
+
+        latencies.push_back(double(duration_cast<nanoseconds>(cl::now() - start).count()) / 1000.0);
+    }
+
+    print_latencies(test_name, latencies);
+}
+
+
+// round trip between two threads
+template<typename Signal>
+void ping_pong_test(const std::string & test_name){
+    const std::size_t n_iter = 20000;
+
+    Signal ping(0), pong(0);
+
+    std::thread player([&](){
+        for(std::size_t i = 0; i < n_iter; ++i){
+            ping.acquire();
+            pong.release();
+        }
+    });
+
+    const tp start = cl::now();
+    for(std::size_t i = 0; i < n_iter; ++i){
+        ping.release();
+        pong.acquire();
+    }
+    const tp end = cl::now();
+    player.join();
+
+    hadoken::format::scat(std::cout, test_name, ": round trip (us) ",
+                          double(duration_cast<nanoseconds>(end - start).count()) / 1000.0 / n_iter, "\n");
+}
+
+
+// persistent team of threads synchronized at each phase
+void barrier_phase_test(std::size_t n_thread, const std::string & test_name){
+    const std::size_t n_phase = 20000;
+
+    hadoken::thread::barrier<> sync(n_thread);
+
+    const tp start = cl::now();
+
+    std::vector<std::thread> team;
+    for(std::size_t i = 0; i < n_thread; ++i){
+        team.emplace_back([&](){
+            for(std::size_t p = 0; p < n_phase; ++p){
+                sync.arrive_and_wait();
+            }
+        });
+    }
+
+    for(auto & t : team){
+        t.join();
+    }
+
+    hadoken::format::scat(std::cout, test_name, ": phase duration (us) ",
+                          double(duration_cast<nanoseconds>(cl::now() - start).count()) / 1000.0 / n_phase, "\n");
+}
+
+
+// reference: mutex and condition variable semaphore
+class condvar_semaphore{
+public:
+    condvar_semaphore(std::ptrdiff_t value) : _count(value), _cond(), _lock() {}
+
+    void release(){
+        {
+            std::lock_guard<std::mutex> l(_lock);
+            _count += 1;
+        }
+        _cond.notify_one();
+    }
+
+    void acquire(){
+        std::unique_lock<std::mutex> l(_lock);
+        _cond.wait(l, [this](){ return _count > 0; });
+        _count -= 1;
+    }
+
+private:
+    std::ptrdiff_t _count;
+    std::condition_variable _cond;
+    std::mutex _lock;
+};
+
+
+// auto-reset event used as a binary semaphore
+class event_signal{
+public:
+    event_signal(std::ptrdiff_t) : _ev() {}
+
+    void release(){
+        _ev.set();
+    }
+
+    void acquire(){
+        _ev.wait();
+    }
+
+private:
+    hadoken::thread::auto_reset_event _ev;
+};
+
+
+
+// read-mostly configuration: every reader reads it, a writer updates it every millisecond
+
+struct config_value{
+    std::uint64_t threshold, window, seed, flags;
+};
+
+class spin_lock_config{
+public:
+    spin_lock_config() : _lock(), _value() {}
+
+    config_value read(){
+        std::lock_guard<hadoken::thread::spin_lock> l(_lock);
+        return _value;
+    }
+
+    void write(const config_value & v){
+        std::lock_guard<hadoken::thread::spin_lock> l(_lock);
+        _value = v;
+    }
+
+private:
+    hadoken::thread::spin_lock _lock;
+    config_value _value;
+};
+
+class seqlock_config{
+public:
+    config_value read(){
+        return _value.load();
+    }
+
+    void write(const config_value & v){
+        _value.store(v);
+    }
+
+private:
+    hadoken::thread::seqlock<config_value> _value;
+};
+
+class snapshot_config{
+public:
+    snapshot_config() : _value(std::unique_ptr<config_value>(new config_value())) {}
+
+    config_value read(){
+        auto snap = _value.read();
+        return *snap;
+    }
+
+    void write(const config_value & v){
+        _value.store(v);
+    }
+
+private:
+    hadoken::thread::snapshot_ptr<config_value> _value;
+};
+
+
+template<typename Config>
+void read_mostly_test(std::size_t n_reader, const std::string & test_name){
+    const std::size_t n_read = 2000000 / n_reader;
+
+    Config config;
+    std::atomic<bool> running(true);
+    std::atomic<std::uint64_t> junk(0);
+
+    std::thread writer([&](){
+        config_value v = { 0, 0, 0, 0 };
+        while(running.load()){
+            v.threshold += 1;
+            config.write(v);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    const tp start = cl::now();
+
+    std::vector<std::thread> readers;
+    for(std::size_t i = 0; i < n_reader; ++i){
+        readers.emplace_back([&](){
+            std::uint64_t local = 0;
+            for(std::size_t r = 0; r < n_read; ++r){
+                local += config.read().threshold;
+            }
+            junk += local;
+        });
+    }
+
+    for(auto & t : readers){
+        t.join();
+    }
+
+    const double elapsed_ms = double(duration_cast<microseconds>(cl::now() - start).count()) / 1000.0;
+    running = false;
+    writer.join();
+
+    hadoken::format::scat(std::cout, test_name, "_readers=", n_reader, ": ", elapsed_ms, " ms ",
+                          (n_read * n_reader) / (elapsed_ms * 1000.0), " Mreads/s\n");
+}
+
+
+
+int main(){
+
+    const std::size_t ncore = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+
+    hadoken::format::scat(std::cout, "test synchronization primitives with ", ncore, " cores\n\n");
+
+    std::vector<std::size_t> waiter_counts = { 1 };
+    if(ncore > 1){
+        waiter_counts.push_back(ncore);
+    }
+
+    for(std::size_t n_waiters : waiter_counts){
+        const std::string suffix = hadoken::format::scat("_waiters=", n_waiters);
+        latch_wakeup_test<condvar_latch>(n_waiters, "condvar_latch_wakeup" + suffix);
+        latch_wakeup_test<hadoken::thread::latch>(n_waiters, "futex_latch_wakeup" + suffix);
+    }
+
+    std::cout << "\n";
+
+    hadoken::thread_pool_executor pool(ncore, hadoken::thread::affinity_policy::none);
+    pool_join_test<condvar_latch>(pool, "condvar_latch_pool_join");
+    pool_join_test<hadoken::thread::latch>(pool, "futex_latch_pool_join");
+
+    std::cout << "\n";
+
+    for(std::size_t n_thread : waiter_counts){
+        barrier_phase_test(n_thread, hadoken::format::scat("barrier_threads=", n_thread));
+    }
+
+    std::cout << "\n";
+
+    ping_pong_test<condvar_semaphore>("condvar_semaphore_ping_pong");
+    ping_pong_test<hadoken::thread::binary_semaphore>("binary_semaphore_ping_pong");
+    ping_pong_test<event_signal>("auto_reset_event_ping_pong");
+
+
+    std::cout << "\n";
+
+    std::vector<std::size_t> reader_counts = { 1, 2, 4, 8, 16 };
+    for(std::size_t n_reader : reader_counts){
+        read_mostly_test<spin_lock_config>(n_reader, "spin_lock_config");
+    }
+    for(std::size_t n_reader : reader_counts){
+        read_mostly_test<seqlock_config>(n_reader, "seqlock_config");
+    }
+    for(std::size_t n_reader : reader_counts){
+        read_mostly_test<snapshot_config>(n_reader, "snapshot_ptr_config");
+    }
+
+}
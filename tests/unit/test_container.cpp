@@ -30,15 +30,32 @@
 #define BOOST_TEST_MODULE containerTests
 #define BOOST_TEST_MAIN
 
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <list>
 #include <map>
+#include <numeric>
+#include <set>
 #include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 #include <boost/mpl/list.hpp>
 
 
 #include <hadoken/containers/small_vector.hpp>
+#include <hadoken/containers/concurrent_hash_map.hpp>
+#include <hadoken/containers/flat_hash_map.hpp>
+#include <hadoken/containers/flat_map.hpp>
+#include <hadoken/containers/flat_set.hpp>
+#include <hadoken/memory/monotonic_arena.hpp>
+#include <hadoken/memory/object_pool.hpp>
+#include <hadoken/memory/scratch_arena.hpp>
 
 #include <hadoken/utility/range.hpp>
 
@@ -69,7 +86,7 @@ BOOST_AUTO_TEST_CASE_TEMPLATE( small_vector_test, T, small_vector_types )
 
     BOOST_CHECK_EQUAL(values.size(), 0);
     BOOST_CHECK_EQUAL(values.empty(), true);
-    BOOST_CHECK_EQUAL(values.capacity(), 0);
+    BOOST_CHECK_EQUAL(values.capacity(), small_size);
     BOOST_CHECK_EQUAL(values.data(), &(*values.begin()));
 
     const auto begin = values.begin();
@@ -94,8 +111,8 @@ BOOST_AUTO_TEST_CASE_TEMPLATE( small_vector_test, T, small_vector_types )
         }
 
         if(i < small_size){
-            //std::cout << " capa " <<  values.capacity() << " " << i << std::endl;
-            BOOST_CHECK_EQUAL(values.capacity(), 0);
+            // inline storage
+            BOOST_CHECK_EQUAL(values.capacity(), small_size);
         }else{
             BOOST_CHECK_LE(i, values.capacity());
         }
@@ -131,8 +148,8 @@ BOOST_AUTO_TEST_CASE( small_vector_test_unique_ptr)
         values.emplace_back(gen(i));
 
         if(i < small_size){
-            //std::cout << " capa " <<  values.capacity() << " " << i << std::endl;
-            BOOST_CHECK_EQUAL(values.capacity(), 0);
+            // inline storage
+            BOOST_CHECK_EQUAL(values.capacity(), small_size);
         }else{
             BOOST_CHECK_LE(i, values.capacity());
         }
@@ -151,6 +168,1004 @@ BOOST_AUTO_TEST_CASE( small_vector_test_unique_ptr)
 
 
 
+BOOST_AUTO_TEST_CASE_TEMPLATE( small_vector_api_test, T, small_vector_types )
+{
+    using namespace hadoken::containers;
+
+    constexpr std::size_t small_size = 8;
+
+    content_generator<T> gen;
+
+    typedef small_vector<T, small_size> vec_type;
+
+    // constructors
+    vec_type filled(5, gen(1));
+    BOOST_CHECK_EQUAL(filled.size(), 5);
+    BOOST_CHECK_EQUAL(filled.back(), gen(1));
+
+    vec_type init_list = { gen(0), gen(1), gen(2) };
+    BOOST_CHECK_EQUAL(init_list.size(), 3);
+    BOOST_CHECK_EQUAL(init_list[2], gen(2));
+
+    std::vector<T> reference;
+    for(std::size_t i = 0; i < 20; ++i){
+        reference.push_back(gen(i));
+    }
+
+    vec_type from_range(reference.begin(), reference.end());
+    BOOST_CHECK(std::equal(from_range.begin(), from_range.end(), reference.begin()));
+    BOOST_CHECK_GE(from_range.capacity(), reference.size());
+
+    vec_type value_init(3);
+    BOOST_CHECK_EQUAL(value_init.size(), 3);
+    BOOST_CHECK_EQUAL(value_init[0], T());
+
+    // copy and move, inline and on the heap
+    vec_type copy_small(init_list);
+    BOOST_CHECK(copy_small == init_list);
+    vec_type copy_large(from_range);
+    BOOST_CHECK(copy_large == from_range);
+
+    vec_type moved_small(std::move(copy_small));
+    BOOST_CHECK(moved_small == init_list);
+    BOOST_CHECK(copy_small.empty());
+
+    const T* heap_data = copy_large.data();
+    vec_type moved_large(std::move(copy_large));
+    BOOST_CHECK(moved_large == from_range);
+    // the heap buffer is stolen
+    BOOST_CHECK_EQUAL(moved_large.data(), heap_data);
+    BOOST_CHECK(copy_large.empty());
+    BOOST_CHECK_EQUAL(copy_large.capacity(), small_size);
+
+    copy_small = from_range;
+    BOOST_CHECK(copy_small == from_range);
+    copy_small = init_list;
+    BOOST_CHECK(copy_small == init_list);
+    copy_large = std::move(moved_large);
+    BOOST_CHECK(copy_large == from_range);
+    copy_large = std::move(moved_small);
+    BOOST_CHECK(copy_large == init_list);
+    copy_large = copy_large;
+    BOOST_CHECK(copy_large == init_list);
+
+    // insert
+    vec_type values;
+    std::vector<T> expected;
+    for(std::size_t i = 0; i < 40; ++i){
+        const std::size_t pos = (i * 7) % (values.size() + 1);
+        typename vec_type::iterator it = values.insert(values.begin() + pos, gen(i));
+        expected.insert(expected.begin() + pos, gen(i));
+        BOOST_CHECK_EQUAL(*it, gen(i));
+    }
+    BOOST_CHECK(std::equal(values.begin(), values.end(), expected.begin()));
+
+    values.insert(values.begin() + 3, 4, gen(100));
+    expected.insert(expected.begin() + 3, 4, gen(100));
+    values.insert(values.end(), reference.begin(), reference.begin() + 5);
+    expected.insert(expected.end(), reference.begin(), reference.begin() + 5);
+    values.insert(values.begin(), { gen(7), gen(8) });
+    expected.insert(expected.begin(), { gen(7), gen(8) });
+    values.emplace(values.begin() + 10, gen(9));
+    expected.emplace(expected.begin() + 10, gen(9));
+
+    // insert of an element of the vector itself
+    values.insert(values.begin(), values.back());
+    expected.insert(expected.begin(), expected.back());
+    values.push_back(values.front());
+    expected.push_back(expected.front());
+
+    BOOST_CHECK_EQUAL(values.size(), expected.size());
+    BOOST_CHECK(std::equal(values.begin(), values.end(), expected.begin()));
+
+    // erase
+    values.erase(values.begin() + 2);
+    expected.erase(expected.begin() + 2);
+    values.erase(values.begin() + 5, values.begin() + 15);
+    expected.erase(expected.begin() + 5, expected.begin() + 15);
+    values.pop_back();
+    expected.pop_back();
+    BOOST_CHECK_EQUAL(values.size(), expected.size());
+    BOOST_CHECK(std::equal(values.begin(), values.end(), expected.begin()));
+    BOOST_CHECK(std::equal(values.rbegin(), values.rend(), expected.rbegin()));
+
+    // resize and reserve
+    values.resize(4);
+    BOOST_CHECK_EQUAL(values.size(), 4);
+    values.resize(10, gen(3));
+    BOOST_CHECK_EQUAL(values.size(), 10);
+    BOOST_CHECK_EQUAL(values[9], gen(3));
+
+    const std::size_t capacity = values.capacity();
+    values.reserve(capacity + 100);
+    BOOST_CHECK_GE(values.capacity(), capacity + 100);
+    values.clear();
+    BOOST_CHECK(values.empty());
+    BOOST_CHECK_GE(values.capacity(), capacity + 100);
+
+    // swap in all the combinations of inline and heap storage
+    vec_type a(init_list), b(from_range), c(filled);
+    a.swap(b);
+    BOOST_CHECK(a == from_range);
+    BOOST_CHECK(b == init_list);
+    swap(b, c);
+    BOOST_CHECK(b == filled);
+    BOOST_CHECK(c == init_list);
+    vec_type d(from_range);
+    d.push_back(gen(50));
+    swap(a, d);
+    BOOST_CHECK(d == from_range);
+    BOOST_CHECK_EQUAL(a.back(), gen(50));
+
+    // comparisons
+    BOOST_CHECK(init_list != from_range);
+    BOOST_CHECK((init_list < from_range) == std::lexicographical_compare(init_list.begin(), init_list.end(),
+                                                                         from_range.begin(), from_range.end()));
+    BOOST_CHECK(init_list <= init_list);
+    BOOST_CHECK(init_list >= init_list);
+}
+
+
+namespace{
+
+// non trivial type, relocatable: memcpy is a valid move
+struct relocatable_handle{
+    relocatable_handle(int v = 0) : value(new int(v)) { live += 1; }
+    relocatable_handle(const relocatable_handle & other) : value(new int(*other.value)) { live += 1; }
+    relocatable_handle(relocatable_handle && other) : value(other.value) { other.value = nullptr; live += 1; moves += 1; }
+    relocatable_handle & operator=(relocatable_handle other) { std::swap(value, other.value); return *this; }
+    ~relocatable_handle() { delete value; live -= 1; }
+
+    int* value;
+
+    static int live;
+    static int moves;
+};
+
+int relocatable_handle::live = 0;
+int relocatable_handle::moves = 0;
+
+}
+
+namespace hadoken{ namespace containers{
+
+template<>
+struct is_trivially_relocatable<relocatable_handle> : public std::true_type {};
+
+} }
+
+
+BOOST_AUTO_TEST_CASE( small_vector_relocation_test )
+{
+    using namespace hadoken::containers;
+
+    BOOST_CHECK(is_trivially_relocatable<int>::value);
+    BOOST_CHECK(is_trivially_relocatable<std::string>::value == false);
+
+    {
+        small_vector<relocatable_handle, 4> values;
+        for(int i = 0; i < 100; ++i){
+            values.emplace_back(i);
+        }
+        values.insert(values.begin() + 10, relocatable_handle(-1));
+        values.erase(values.begin() + 20, values.begin() + 30);
+
+        // growth, insert and erase relocate with memcpy: only the explicit temporary is moved
+        BOOST_CHECK_EQUAL(relocatable_handle::moves, 2);
+        BOOST_CHECK_EQUAL(relocatable_handle::live, 91);
+        BOOST_CHECK_EQUAL(*values[10].value, -1);
+        BOOST_CHECK_EQUAL(*values[11].value, 10);
+        BOOST_CHECK_EQUAL(*values[20].value, 29);
+
+        small_vector<relocatable_handle, 4> small;
+        small.emplace_back(1);
+        small_vector<relocatable_handle, 4> moved(std::move(small));
+        BOOST_CHECK_EQUAL(*moved[0].value, 1);
+        BOOST_CHECK(small.empty());
+    }
+    BOOST_CHECK_EQUAL(relocatable_handle::live, 0);
+}
+
+
+
+namespace{
+
+struct allocation_stats{
+    allocation_stats() : n_allocations(0), n_deallocations(0), live_bytes(0) {}
+
+    std::size_t n_allocations, n_deallocations;
+    std::ptrdiff_t live_bytes;
+};
+
+// stateful allocator which counts its allocations
+template<typename T>
+struct counting_allocator{
+    typedef T value_type;
+
+    explicit counting_allocator(allocation_stats* s) : stats(s) {}
+
+    template<typename U>
+    counting_allocator(const counting_allocator<U> & other) : stats(other.stats) {}
+
+    T* allocate(std::size_t n){
+        stats->n_allocations += 1;
+        stats->live_bytes += static_cast<std::ptrdiff_t>(n * sizeof(T));
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n){
+        stats->n_deallocations += 1;
+        stats->live_bytes -= static_cast<std::ptrdiff_t>(n * sizeof(T));
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    allocation_stats* stats;
+};
+
+template<typename T, typename U>
+bool operator==(const counting_allocator<T> & a, const counting_allocator<U> & b){
+    return a.stats == b.stats;
+}
+
+template<typename T, typename U>
+bool operator!=(const counting_allocator<T> & a, const counting_allocator<U> & b){
+    return !(a == b);
+}
+
+// counting allocator which follows its container on copy assignment
+template<typename T>
+struct propagating_allocator : public counting_allocator<T>{
+    typedef std::true_type propagate_on_container_copy_assignment;
+
+    explicit propagating_allocator(allocation_stats* s) : counting_allocator<T>(s) {}
+
+    template<typename U>
+    propagating_allocator(const propagating_allocator<U> & other) : counting_allocator<T>(other) {}
+};
+
+}
+
+
+BOOST_AUTO_TEST_CASE( small_vector_allocator_test )
+{
+    using namespace hadoken::containers;
+
+    typedef counting_allocator<std::string> alloc_type;
+    typedef small_vector<std::string, 4, alloc_type> vec_type;
+
+    // the stateless default allocator costs nothing
+    BOOST_CHECK_EQUAL(sizeof(small_vector<int, 4>), sizeof(small_vector<int, 4, std::allocator<int> >));
+
+    allocation_stats stats, other_stats;
+
+    {
+        vec_type values{alloc_type(&stats)};
+        BOOST_CHECK(values.get_allocator() == alloc_type(&stats));
+
+        // no allocation while inline
+        for(int i = 0; i < 4; ++i){
+            values.push_back(std::to_string(i));
+        }
+        BOOST_CHECK_EQUAL(stats.n_allocations, 0);
+
+        for(int i = 4; i < 100; ++i){
+            values.push_back(std::to_string(i));
+        }
+        BOOST_CHECK_GT(stats.n_allocations, 0);
+
+        // copy keeps the allocator
+        vec_type copy(values);
+        BOOST_CHECK(copy.get_allocator() == values.get_allocator());
+        BOOST_CHECK(copy == values);
+
+        // move with an equal allocator steals the buffer
+        const std::size_t n_alloc = stats.n_allocations;
+        const std::string* data = copy.data();
+        vec_type moved(std::move(copy), alloc_type(&stats));
+        BOOST_CHECK_EQUAL(stats.n_allocations, n_alloc);
+        BOOST_CHECK_EQUAL(moved.data(), data);
+
+        // move with a different allocator moves the elements
+        vec_type other(std::move(moved), alloc_type(&other_stats));
+        BOOST_CHECK_EQUAL(other_stats.n_allocations, 1);
+        BOOST_CHECK(other == values);
+        BOOST_CHECK(moved.empty());
+
+        // shrink_to_fit on a spilled vector, larger than N
+        values.resize(10);
+        values.shrink_to_fit();
+        BOOST_CHECK_EQUAL(values.capacity(), 10);
+        BOOST_CHECK_EQUAL(values[9], "9");
+
+        // shrink_to_fit back to the inline storage
+        values.resize(3);
+        values.shrink_to_fit();
+        BOOST_CHECK_EQUAL(values.capacity(), 4);
+        BOOST_CHECK(static_cast<const void*>(values.data()) >= static_cast<const void*>(&values));
+        BOOST_CHECK(static_cast<const void*>(values.data()) < static_cast<const void*>(&values + 1));
+        BOOST_CHECK_EQUAL(values.size(), 3);
+        BOOST_CHECK_EQUAL(values[0], "0");
+        BOOST_CHECK_EQUAL(values[2], "2");
+
+        // no-op when already inline
+        const std::size_t n_dealloc = stats.n_deallocations;
+        values.shrink_to_fit();
+        BOOST_CHECK_EQUAL(stats.n_deallocations, n_dealloc);
+    }
+
+    // every buffer returned to the allocator which gave it
+    BOOST_CHECK_EQUAL(stats.n_allocations, stats.n_deallocations);
+    BOOST_CHECK_EQUAL(stats.live_bytes, 0);
+    BOOST_CHECK_EQUAL(other_stats.n_allocations, other_stats.n_deallocations);
+    BOOST_CHECK_EQUAL(other_stats.live_bytes, 0);
+}
+
+
+BOOST_AUTO_TEST_CASE( small_vector_inline_assign_test )
+{
+    using namespace hadoken::containers;
+
+    // move assignment from an inline source, then grow past N
+    {
+        small_vector<int, 4> a, b;
+        b.push_back(1);
+        b.push_back(2);
+        a = std::move(b);
+        BOOST_CHECK_EQUAL(a.size(), 2);
+        BOOST_CHECK_GE(a.capacity(), 4);
+        for(int i = 0; i < 20; ++i){
+            a.push_back(i);
+        }
+        BOOST_CHECK_EQUAL(a.size(), 22);
+        BOOST_CHECK_EQUAL(a[1], 2);
+        BOOST_CHECK_EQUAL(a[21], 19);
+    }
+
+    // same from a heap backed destination
+    {
+        small_vector<std::string, 4> a(10, "x"), b{ "a", "b", "c" };
+        a = std::move(b);
+        BOOST_CHECK_EQUAL(a.size(), 3);
+        for(int i = 0; i < 20; ++i){
+            a.push_back(std::to_string(i));
+        }
+        BOOST_CHECK_EQUAL(a.size(), 23);
+        BOOST_CHECK_EQUAL(a[2], "c");
+        BOOST_CHECK_EQUAL(a[22], "19");
+    }
+
+    // swap of two inline vectors, then grow both past N
+    {
+        small_vector<int, 4> a{ 1, 2, 3 }, b{ 4 };
+        a.swap(b);
+        BOOST_CHECK_EQUAL(a.size(), 1);
+        BOOST_CHECK_EQUAL(b.size(), 3);
+        for(int i = 0; i < 20; ++i){
+            a.push_back(i);
+            b.push_back(i);
+        }
+        BOOST_CHECK_EQUAL(a.size(), 21);
+        BOOST_CHECK_EQUAL(b.size(), 23);
+        BOOST_CHECK_EQUAL(a[0], 4);
+        BOOST_CHECK_EQUAL(b[2], 3);
+        BOOST_CHECK_EQUAL(b[22], 19);
+    }
+
+    // copy assignment with a propagating, different allocator
+    {
+        typedef propagating_allocator<int> alloc_type;
+        allocation_stats s1, s2;
+        {
+            small_vector<int, 4, alloc_type> a{alloc_type(&s1)}, b{alloc_type(&s2)};
+            a.push_back(7);
+            b.push_back(8);
+            b.push_back(9);
+            a = b;
+            for(int i = 0; i < 20; ++i){
+                a.push_back(i);
+            }
+            BOOST_CHECK_EQUAL(a.size(), 22);
+            BOOST_CHECK_EQUAL(a[0], 8);
+            BOOST_CHECK_EQUAL(a[21], 19);
+        }
+        BOOST_CHECK_EQUAL(s1.live_bytes, 0);
+        BOOST_CHECK_EQUAL(s2.live_bytes, 0);
+    }
+}
+
+
+
+BOOST_AUTO_TEST_CASE( flat_set_test )
+{
+    using namespace hadoken::containers;
+
+    flat_set<int> set{ 5, 1, 3, 3, 9, 1 };
+    BOOST_CHECK_EQUAL(set.size(), 4);
+    BOOST_CHECK(std::is_sorted(set.begin(), set.end()));
+    BOOST_CHECK(set.contains(3));
+    BOOST_CHECK(set.contains(4) == false);
+    BOOST_CHECK(set.find(4) == set.end());
+    BOOST_CHECK_EQUAL(*set.lower_bound(4), 5);
+    BOOST_CHECK_EQUAL(*set.upper_bound(5), 9);
+    BOOST_CHECK(set.lower_bound(10) == set.end());
+    BOOST_CHECK(set.upper_bound(0) == set.begin());
+    BOOST_CHECK_EQUAL(std::distance(set.equal_range(3).first, set.equal_range(3).second), 1);
+
+    BOOST_CHECK(set.insert(4).second);
+    BOOST_CHECK(set.insert(4).second == false);
+    BOOST_CHECK_EQUAL(set.erase(1), 1);
+    BOOST_CHECK_EQUAL(set.erase(1), 0);
+    BOOST_CHECK(set == flat_set<int>({ 3, 4, 5, 9 }));
+
+    // reverse order and sorted input
+    flat_set<int, std::greater<int> > rset(sorted_unique, set.rbegin(), set.rend());
+    BOOST_CHECK_EQUAL(*rset.begin(), 9);
+    BOOST_CHECK(rset.contains(4));
+
+    // random operations against std::set, bulk path beyond the parallel sort threshold
+    std::vector<int> input;
+    std::uint64_t state = 42;
+    for(int i = 0; i < 50000; ++i){
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        input.push_back(static_cast<int>((state >> 33) % 20000));
+    }
+
+    flat_set<int> big(input.begin(), input.end());
+    std::set<int> ref(input.begin(), input.end());
+    BOOST_CHECK_EQUAL(big.size(), ref.size());
+    BOOST_CHECK(std::equal(big.begin(), big.end(), ref.begin()));
+
+    big.insert(input.begin(), input.begin() + 100);
+    for(int i = -10; i < 20010; i += 7){
+        BOOST_CHECK_EQUAL(big.count(i), ref.count(i));
+        BOOST_CHECK_EQUAL(big.lower_bound(i) - big.begin(), std::distance(ref.begin(), ref.lower_bound(i)));
+        BOOST_CHECK_EQUAL(big.upper_bound(i) - big.begin(), std::distance(ref.begin(), ref.upper_bound(i)));
+    }
+
+    // equivalent elements: the first in input order is kept, as for successive insertions
+    typedef std::pair<int, int> tagged;
+    auto by_first = [](const tagged & a, const tagged & b){ return a.first < b.first; };
+    std::vector<tagged> tagged_input;
+    for(int i = 0; i < 50000; ++i){
+        tagged_input.emplace_back((i * 7919) % 1000, i);
+    }
+    flat_set<tagged, decltype(by_first)> first_wins(tagged_input.begin(), tagged_input.end(), by_first);
+    BOOST_CHECK_EQUAL(first_wins.size(), 1000);
+    std::map<int, int> first_seen;
+    for(const tagged & t : tagged_input){
+        first_seen.insert(t);
+    }
+    BOOST_CHECK(std::equal(first_wins.begin(), first_wins.end(), first_seen.begin(), [](const tagged & a, const std::pair<const int, int> & b){
+        return a.first == b.first && a.second == b.second;
+    }));
+
+    // new equivalent elements lose to the existing ones, and keep their input order
+    std::vector<tagged> more = { tagged(5000, 1), tagged(5000, 2), tagged(3, -1) };
+    first_wins.insert(more.begin(), more.end());
+    BOOST_CHECK_EQUAL(first_wins.find(tagged(5000, 0))->second, 1);
+    BOOST_CHECK_EQUAL(first_wins.find(tagged(3, 0))->second, first_seen[3]);
+}
+
+
+BOOST_AUTO_TEST_CASE( flat_map_test )
+{
+    using namespace hadoken::containers;
+
+    typedef flat_map<std::string, int> map_type;
+
+    // first of the equivalent keys wins, as for insert
+    map_type map{ { "b", 2 }, { "a", 1 }, { "c", 3 }, { "a", 10 } };
+    BOOST_CHECK_EQUAL(map.size(), 3);
+    BOOST_CHECK_EQUAL(map.at("a"), 1);
+    BOOST_CHECK_THROW(map.at("z"), std::out_of_range);
+    BOOST_CHECK(std::is_sorted(map.keys().begin(), map.keys().end()));
+    BOOST_CHECK_EQUAL(map.keys().size(), map.values().size());
+
+    // iteration through the proxy references
+    std::string concat;
+    for(auto kv : map){
+        concat += kv.first;
+        kv.second *= 2;
+    }
+    BOOST_CHECK_EQUAL(concat, "abc");
+    BOOST_CHECK_EQUAL(map.at("b"), 4);
+    BOOST_CHECK_EQUAL(map.find("c")->second, 6);
+    BOOST_CHECK_EQUAL((map.end() -1)->first, "c");
+    BOOST_CHECK_EQUAL(map.rbegin()->first, "c");
+
+    // modifications
+    BOOST_CHECK(map.insert(std::make_pair(std::string("d"), 4)).second);
+    BOOST_CHECK(map.insert(std::make_pair(std::string("d"), 5)).second == false);
+    BOOST_CHECK_EQUAL(map["d"], 4);
+    map["e"] += 5;
+    BOOST_CHECK_EQUAL(map.at("e"), 5);
+    BOOST_CHECK(map.try_emplace("e", 6).second == false);
+    BOOST_CHECK(map.insert_or_assign("e", 7).second == false);
+    BOOST_CHECK_EQUAL(map.at("e"), 7);
+    BOOST_CHECK(map.emplace("f", 8).second);
+    BOOST_CHECK_EQUAL(map.erase("a"), 1);
+    BOOST_CHECK_EQUAL(map.erase("a"), 0);
+    map_type::iterator it = map.erase(map.find("c"));
+    BOOST_CHECK_EQUAL(it->first, "d");
+    BOOST_CHECK_EQUAL(map.size(), 4);
+
+    map_type::const_iterator cit = map.lower_bound("bb");
+    BOOST_CHECK_EQUAL(cit->first, "d");
+    BOOST_CHECK(map.upper_bound("f") == map.end());
+    BOOST_CHECK(map.equal_range("x").first == map.equal_range("x").second);
+
+    // construction from separate arrays
+    flat_map<int, std::string> from_arrays(std::vector<int>{ 3, 1, 2 }, std::vector<std::string>{ "3", "1", "2" });
+    BOOST_CHECK_EQUAL(from_arrays.keys()[0], 1);
+    BOOST_CHECK_EQUAL(from_arrays.values()[0], "1");
+    BOOST_CHECK_EQUAL(from_arrays.values()[2], "3");
+    BOOST_CHECK_THROW((flat_map<int, int>(std::vector<int>(1, 1), std::vector<int>())), std::invalid_argument);
+
+    // random operations against std::map, bulk path beyond the parallel sort threshold
+    std::vector<std::pair<int, int> > input;
+    std::uint64_t state = 7;
+    for(int i = 0; i < 50000; ++i){
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        input.push_back(std::make_pair(static_cast<int>((state >> 33) % 20000), i));
+    }
+
+    flat_map<int, int> big(input.begin(), input.end());
+    std::map<int, int> ref(input.begin(), input.end());
+    BOOST_CHECK_EQUAL(big.size(), ref.size());
+    BOOST_CHECK(std::equal(big.keys().begin(), big.keys().end(), ref.begin(),
+                           [](int k, const std::pair<const int, int> & p){ return k == p.first; }));
+
+    // bulk insert: the existing elements win
+    std::vector<std::pair<int, int> > more;
+    for(int i = -100; i < 25000; i += 3){
+        more.push_back(std::make_pair(i, -1));
+    }
+    big.insert(more.begin(), more.end());
+    ref.insert(more.begin(), more.end());
+    BOOST_CHECK_EQUAL(big.size(), ref.size());
+
+    for(int i = -200; i < 25100; i += 5){
+        std::map<int, int>::const_iterator ref_it = ref.find(i);
+        flat_map<int, int>::const_iterator big_it = static_cast<const flat_map<int, int> &>(big).find(i);
+        BOOST_CHECK_EQUAL(big_it == big.cend(), ref_it == ref.end());
+        if(ref_it != ref.end() && big_it != big.cend()){
+            BOOST_CHECK_EQUAL(big_it->second, ref_it->second);
+        }
+    }
+}
+
+
+namespace{
+
+// hash and equal which accept a const char* key without building a std::string
+struct transparent_string_hash{
+    typedef void is_transparent;
+
+    std::size_t operator()(const std::string & s) const{
+        return (*this)(s.c_str());
+    }
+
+    std::size_t operator()(const char* s) const{
+        std::size_t h = 14695981039346656037ULL;
+        for(; *s != '\0'; ++s){
+            h = (h ^ static_cast<unsigned char>(*s)) * 1099511628211ULL;
+        }
+        return h;
+    }
+};
+
+struct transparent_string_equal{
+    typedef void is_transparent;
+
+    bool operator()(const std::string & a, const std::string & b) const{
+        return a == b;
+    }
+
+    bool operator()(const std::string & a, const char* b) const{
+        return a == b;
+    }
+};
+
+}
+
+
+BOOST_AUTO_TEST_CASE( flat_hash_map_test )
+{
+    using namespace hadoken::containers;
+
+    flat_hash_map<int, std::string> map;
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.find(1) == map.end());
+    BOOST_CHECK(map.begin() == map.end());
+    BOOST_CHECK_EQUAL(map.bucket_count(), 0);
+
+    BOOST_CHECK(map.insert(std::make_pair(1, std::string("one"))).second);
+    BOOST_CHECK(map.insert(std::make_pair(1, std::string("uno"))).second == false);
+    BOOST_CHECK(map.emplace(2, "two").second);
+    BOOST_CHECK(map.try_emplace(3, 3, 'c').second);
+    BOOST_CHECK(map.try_emplace(3, "x").second == false);
+    BOOST_CHECK_EQUAL(map.at(3), "ccc");
+    BOOST_CHECK_THROW(map.at(4), std::out_of_range);
+    map[4] = "four";
+    BOOST_CHECK(map.insert_or_assign(4, "quatre").second == false);
+    BOOST_CHECK_EQUAL(map[4], "quatre");
+    BOOST_CHECK_EQUAL(map.size(), 4);
+    BOOST_CHECK_EQUAL(std::distance(map.begin(), map.end()), 4);
+    BOOST_CHECK_EQUAL(map.find(1)->second, "one");
+    BOOST_CHECK(map.contains(2));
+    BOOST_CHECK_EQUAL(map.count(5), 0);
+
+    BOOST_CHECK_EQUAL(map.erase(2), 1);
+    BOOST_CHECK_EQUAL(map.erase(2), 0);
+    BOOST_CHECK(map.contains(2) == false);
+
+    flat_hash_map<int, std::string> copy(map);
+    BOOST_CHECK(copy == map);
+    flat_hash_map<int, std::string> moved(std::move(copy));
+    BOOST_CHECK(moved == map);
+    BOOST_CHECK(copy.empty());
+    moved[10] = "ten";
+    BOOST_CHECK(moved != map);
+    copy = moved;
+    BOOST_CHECK(copy == moved);
+
+    // reserve: no rehash up to the reserved size
+    flat_hash_map<std::size_t, std::size_t> reserved;
+    reserved.reserve(1000);
+    const std::size_t buckets = reserved.bucket_count();
+    BOOST_CHECK_GE(buckets * reserved.max_load_factor(), 1000);
+    for(std::size_t i = 0; i < 1000; ++i){
+        reserved[i] = i;
+    }
+    BOOST_CHECK_EQUAL(reserved.bucket_count(), buckets);
+    BOOST_CHECK_LE(reserved.load_factor(), reserved.max_load_factor());
+
+    // clear keeps the memory
+    reserved.clear();
+    BOOST_CHECK(reserved.empty());
+    BOOST_CHECK_EQUAL(reserved.bucket_count(), buckets);
+    BOOST_CHECK(reserved.find(1) == reserved.end());
+
+    // erase during iteration
+    for(std::size_t i = 0; i < 100; ++i){
+        reserved[i] = i;
+    }
+    for(auto it = reserved.begin(); it != reserved.end();){
+        it = (it->first % 2 == 0) ? reserved.erase(it) : std::next(it);
+    }
+    BOOST_CHECK_EQUAL(reserved.size(), 50);
+    BOOST_CHECK(reserved.contains(3) && reserved.contains(4) == false);
+
+    // heterogeneous lookup
+    flat_hash_map<std::string, int, transparent_string_hash, transparent_string_equal> names;
+    names["alice"] = 1;
+    names["bob"] = 2;
+    const char* key = "bob";
+    BOOST_CHECK_EQUAL(names.find(key)->second, 2);
+    BOOST_CHECK(names.contains("carol") == false);
+    BOOST_CHECK_EQUAL(names.count("alice"), 1);
+    BOOST_CHECK_EQUAL(names.erase("alice"), 1);
+    BOOST_CHECK_EQUAL(names.size(), 1);
+
+    // sizes beyond max_size() are rejected, the map is untouched
+    BOOST_CHECK_THROW(reserved.reserve(std::numeric_limits<std::size_t>::max()), std::length_error);
+    BOOST_CHECK_THROW(reserved.reserve(reserved.max_size() + 1), std::length_error);
+    BOOST_CHECK_THROW(reserved.rehash(std::numeric_limits<std::size_t>::max()), std::length_error);
+    BOOST_CHECK_EQUAL(reserved.size(), 50);
+    BOOST_CHECK(reserved.contains(3));
+}
+
+
+BOOST_AUTO_TEST_CASE( flat_hash_map_random_test )
+{
+    using namespace hadoken::containers;
+
+    // churn of inserts and erases against std::unordered_map: grows, tombstones, in place rehash
+    flat_hash_map<std::uint64_t, std::string> map;
+    std::unordered_map<std::uint64_t, std::string> ref;
+
+    std::uint64_t state = 3;
+    for(std::size_t i = 0; i < 200000; ++i){
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        const std::uint64_t key = (state >> 33) % 5000;
+        switch((state >> 20) % 4){
+            case 0:
+            case 1:
+                BOOST_REQUIRE_EQUAL(map.insert(std::make_pair(key, std::to_string(i))).second,
+                                    ref.insert(std::make_pair(key, std::to_string(i))).second);
+                break;
+            case 2:
+                BOOST_REQUIRE_EQUAL(map.erase(key), ref.erase(key));
+                break;
+            default:{
+                auto it = map.find(key);
+                auto ref_it = ref.find(key);
+                BOOST_REQUIRE_EQUAL(it == map.end(), ref_it == ref.end());
+                if(ref_it != ref.end()){
+                    BOOST_REQUIRE_EQUAL(it->second, ref_it->second);
+                }
+            }
+        }
+    }
+
+    BOOST_CHECK_EQUAL(map.size(), ref.size());
+    BOOST_CHECK_EQUAL(std::distance(map.begin(), map.end()), ref.size());
+    for(const auto & kv : ref){
+        BOOST_CHECK_EQUAL(map.at(kv.first), kv.second);
+    }
+    BOOST_CHECK_LE(map.bucket_count(), 16384);
+
+    // large table of trivially relocatable elements
+    flat_hash_map<std::uint64_t, std::uint64_t> big;
+    for(std::uint64_t i = 0; i < 100000; ++i){
+        big[i * 0x9E3779B97F4A7C15ULL] = i;
+    }
+    BOOST_CHECK_EQUAL(big.size(), 100000);
+    for(std::uint64_t i = 0; i < 100000; i += 7){
+        BOOST_CHECK_EQUAL(big.at(i * 0x9E3779B97F4A7C15ULL), i);
+    }
+    BOOST_CHECK(big.contains(1) == false);
+
+    // elements destroyed once
+    {
+        flat_hash_map<int, relocatable_handle> handles;
+        for(int i = 0; i < 1000; ++i){
+            handles.emplace(i, relocatable_handle(i));
+        }
+        for(int i = 0; i < 1000; i += 2){
+            handles.erase(i);
+        }
+        BOOST_CHECK_EQUAL(relocatable_handle::live, 500);
+        BOOST_CHECK_EQUAL(*handles.at(999).value, 999);
+    }
+    BOOST_CHECK_EQUAL(relocatable_handle::live, 0);
+}
+
+
+BOOST_AUTO_TEST_CASE( monotonic_arena_test )
+{
+    using namespace hadoken::memory;
+
+    monotonic_arena arena(256);
+    BOOST_CHECK_EQUAL(arena.capacity(), 0);
+
+    // bump allocation, aligned
+    char* c = static_cast<char*>(arena.allocate(1, 1));
+    double* d = static_cast<double*>(arena.allocate(sizeof(double), alignof(double)));
+    void* big_align = arena.allocate(8, 64);
+    BOOST_CHECK(c != nullptr);
+    BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(d) % alignof(double), 0);
+    BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(big_align) % 64, 0);
+    BOOST_CHECK(static_cast<void*>(c) < static_cast<void*>(d));
+
+    // chunk chaining, including an allocation bigger than a chunk
+    std::vector<int*> ptrs;
+    for(int i = 0; i < 1000; ++i){
+        int* p = static_cast<int*>(arena.allocate(sizeof(int), alignof(int)));
+        *p = i;
+        ptrs.push_back(p);
+    }
+    void* huge = arena.allocate(100000);
+    std::memset(huge, 0xff, 100000);
+    for(int i = 0; i < 1000; ++i){
+        BOOST_CHECK_EQUAL(*ptrs[i], i);
+    }
+
+    // reset keeps the chunks: no new reservation for the same workload
+    const std::size_t capacity = arena.capacity();
+    BOOST_CHECK_GE(capacity, 1000 * sizeof(int) + 100000);
+    for(int round = 0; round < 3; ++round){
+        arena.reset();
+        for(int i = 0; i < 1000; ++i){
+            arena.allocate(sizeof(int), alignof(int));
+        }
+        arena.allocate(100000);
+        BOOST_CHECK_EQUAL(arena.capacity(), capacity);
+    }
+
+    // rewind to a marker
+    arena.reset();
+    arena.allocate(16);
+    monotonic_arena::marker m = arena.mark();
+    void* first = arena.allocate(16);
+    arena.allocate(4096);
+    arena.rewind(m);
+    BOOST_CHECK_EQUAL(arena.allocate(16), first);
+
+    arena.release();
+    BOOST_CHECK_EQUAL(arena.capacity(), 0);
+
+    // initial buffer used before the heap
+    char buffer[512];
+    monotonic_arena buffer_arena(buffer, sizeof(buffer));
+    void* in_buffer = buffer_arena.allocate(64);
+    BOOST_CHECK(in_buffer >= static_cast<void*>(buffer) && in_buffer < static_cast<void*>(buffer + sizeof(buffer)));
+    BOOST_CHECK_EQUAL(buffer_arena.capacity(), sizeof(buffer));
+    buffer_arena.allocate(1024);
+    BOOST_CHECK_GT(buffer_arena.capacity(), sizeof(buffer));
+    buffer_arena.reset();
+    BOOST_CHECK_EQUAL(buffer_arena.allocate(64), in_buffer);
+}
+
+
+BOOST_AUTO_TEST_CASE( arena_allocator_test )
+{
+    using namespace hadoken::memory;
+    using namespace hadoken::containers;
+
+    monotonic_arena arena;
+
+    {
+        std::vector<std::string, arena_allocator<std::string> > values{arena_allocator<std::string>(arena)};
+        for(int i = 0; i < 1000; ++i){
+            values.push_back(std::to_string(i));
+        }
+        BOOST_CHECK_EQUAL(values[999], "999");
+
+        // rebind
+        std::list<int, arena_allocator<int> > l(values.get_allocator());
+        l.push_back(1);
+        l.push_back(2);
+        BOOST_CHECK_EQUAL(l.back(), 2);
+        BOOST_CHECK(l.get_allocator() == values.get_allocator());
+
+        // small_vector spills into the arena
+        small_vector<int, 4, arena_allocator<int> > small{arena_allocator<int>(arena)};
+        const std::size_t capacity = arena.capacity();
+        for(int i = 0; i < 4; ++i){
+            small.push_back(i);
+        }
+        BOOST_CHECK_EQUAL(arena.capacity(), capacity);
+        for(int i = 4; i < 10000; ++i){
+            small.push_back(i);
+        }
+        BOOST_CHECK_GT(arena.capacity(), capacity);
+        BOOST_CHECK_EQUAL(small[9999], 9999);
+    }
+
+    monotonic_arena other_arena;
+    BOOST_CHECK(arena_allocator<int>(arena) != arena_allocator<int>(other_arena));
+    BOOST_CHECK(arena_allocator<int>(arena) == arena_allocator<double>(arena));
+}
+
+
+BOOST_AUTO_TEST_CASE( scratch_arena_test )
+{
+    using namespace hadoken::memory;
+
+    monotonic_arena & arena = scratch_arena();
+    BOOST_CHECK_EQUAL(&arena, &scratch_arena());
+
+    void* first;
+    {
+        scratch_scope scope;
+        first = scope.arena().allocate(32);
+
+        {
+            scratch_scope nested;
+            std::vector<int, arena_allocator<int> > tmp(nested.allocator<int>());
+            tmp.resize(100000, 1);
+            BOOST_CHECK_EQUAL(std::accumulate(tmp.begin(), tmp.end(), 0), 100000);
+        }
+
+        // the nested scope memory is given back
+        BOOST_CHECK(scope.arena().mark().ptr == static_cast<char*>(first) + 32);
+    }
+
+    {
+        scratch_scope scope;
+        BOOST_CHECK_EQUAL(scope.arena().allocate(32), first);
+    }
+
+    // one scratch arena per thread
+    monotonic_arena* other = nullptr;
+    std::thread t([&other](){ other = &scratch_arena(); });
+    t.join();
+    BOOST_CHECK(other != &arena);
+}
+
+
+BOOST_AUTO_TEST_CASE( object_pool_test )
+{
+    using namespace hadoken::memory;
+
+    object_pool<std::string> pool(8);
+    BOOST_CHECK_EQUAL(pool.batch_size(), 8);
+    BOOST_CHECK_EQUAL(pool.capacity(), 0);
+
+    std::vector<std::string*> objs;
+    for(int i = 0; i < 1000; ++i){
+        objs.push_back(pool.create(std::to_string(i)));
+    }
+    BOOST_CHECK_EQUAL(*objs[999], "999");
+    BOOST_CHECK_EQUAL(std::set<std::string*>(objs.begin(), objs.end()).size(), 1000);
+    for(std::string* s : objs){
+        BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(s) % alignof(std::string), 0);
+    }
+
+    // the freed slots are reused: no growth for the same workload
+    const std::size_t capacity = pool.capacity();
+    BOOST_CHECK_GE(capacity, 1000);
+    for(int round = 0; round < 10; ++round){
+        for(std::string* s : objs){
+            pool.destroy(s);
+        }
+        for(std::size_t i = 0; i < objs.size(); ++i){
+            objs[i] = pool.create("x");
+        }
+    }
+    BOOST_CHECK_EQUAL(pool.capacity(), capacity);
+
+    for(std::string* s : objs){
+        pool.destroy(s);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE( object_pool_threads_test )
+{
+    using namespace hadoken::memory;
+
+    const std::size_t n_thread = 4, n_objs = 20000;
+
+    object_pool<std::size_t> pool(16);
+    std::atomic<std::size_t> errors(0);
+
+    // each thread allocates objects which are freed by the next thread, through the depot
+    std::vector<std::vector<std::size_t*> > allocated(n_thread);
+    std::vector<std::thread> threads;
+    for(std::size_t t = 0; t < n_thread; ++t){
+        threads.emplace_back([&, t](){
+            for(std::size_t i = 0; i < n_objs; ++i){
+                allocated[t].push_back(pool.create(t * n_objs + i));
+            }
+        });
+    }
+    for(auto & th : threads){
+        th.join();
+    }
+    threads.clear();
+
+    std::set<std::size_t*> unique_ptrs;
+    for(std::size_t t = 0; t < n_thread; ++t){
+        for(std::size_t i = 0; i < n_objs; ++i){
+            BOOST_CHECK_EQUAL(*allocated[t][i], t * n_objs + i);
+            unique_ptrs.insert(allocated[t][i]);
+        }
+    }
+    BOOST_CHECK_EQUAL(unique_ptrs.size(), n_thread * n_objs);
+
+    for(std::size_t t = 0; t < n_thread; ++t){
+        threads.emplace_back([&, t](){
+            for(std::size_t* p : allocated[(t+1) % n_thread]){
+                pool.destroy(p);
+            }
+            // churn
+            for(std::size_t round = 0; round < 10; ++round){
+                std::vector<std::size_t*> local;
+                for(std::size_t i = 0; i < 1000; ++i){
+                    local.push_back(pool.create(i));
+                }
+                for(std::size_t i = 0; i < local.size(); ++i){
+                    if(*local[i] != i){
+                        errors += 1;
+                    }
+                    pool.destroy(local[i]);
+                }
+            }
+        });
+    }
+    for(auto & th : threads){
+        th.join();
+    }
+
+    BOOST_CHECK_EQUAL(errors.load(), 0);
+
+    // the churn is served by the freed slots
+    BOOST_CHECK_LE(pool.capacity(), n_thread * n_objs + n_thread * pool.batch_size() * 4);
+}
+
+
 template<typename T, typename Mod, typename Check>
 void  test_check_range(T vec, size_t partition, const Mod & modifier, const Check & checker){
     using namespace hadoken;
@@ -200,3 +1215,146 @@ void  test_check_range(T vec, size_t partition, const Mod & modifier, const Chec
     }
 
 }
+
+
+
+BOOST_AUTO_TEST_CASE( concurrent_hash_map_simple_test )
+{
+    using namespace hadoken::containers;
+
+    concurrent_hash_map<std::string, int> map(4);
+
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.insert("hello", 1));
+    BOOST_CHECK(map.insert("world", 2));
+    BOOST_CHECK(map.insert("hello", 42) == false);
+
+    int value = 0;
+    BOOST_CHECK(map.find("hello", value));
+    BOOST_CHECK_EQUAL(value, 1);
+    BOOST_CHECK(map.find("nothing", value) == false);
+    BOOST_CHECK_EQUAL(map.count("world"), 1);
+
+    BOOST_CHECK(map.insert_or_assign("hello", 3) == false);
+    BOOST_CHECK(map.find("hello", value));
+    BOOST_CHECK_EQUAL(value, 3);
+
+    BOOST_CHECK(map.update("world", [](int & v){ v += 10; }));
+    BOOST_CHECK(map.update("nothing", [](int & v){ v += 10; }) == false);
+    BOOST_CHECK(map.visit("world", [&value](const int & v){ value = v; }));
+    BOOST_CHECK_EQUAL(value, 12);
+
+    BOOST_CHECK_EQUAL(map.size(), 2);
+    BOOST_CHECK_EQUAL(map.erase("hello"), 1);
+    BOOST_CHECK_EQUAL(map.erase("hello"), 0);
+    BOOST_CHECK(map.contains("hello") == false);
+    BOOST_CHECK_EQUAL(map.size(), 1);
+
+    // force several resize
+    const std::size_t initial_buckets = map.bucket_count();
+    for(int i = 0; i < 10000; ++i){
+        BOOST_CHECK(map.insert(std::to_string(i), i));
+    }
+    BOOST_CHECK_GT(map.bucket_count(), initial_buckets);
+    BOOST_CHECK_EQUAL(map.size(), 10001);
+
+    std::size_t sum = 0, n_elems = 0;
+    map.for_each([&](const std::string & , const int & v){
+        sum += static_cast<std::size_t>(v);
+        n_elems += 1;
+    });
+    BOOST_CHECK_EQUAL(n_elems, 10001);
+    BOOST_CHECK_EQUAL(sum, 12 + (9999 * 10000) / 2);
+
+    map.clear();
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.contains("world") == false);
+}
+
+
+BOOST_AUTO_TEST_CASE( concurrent_hash_map_concurrent_test )
+{
+    using namespace hadoken::containers;
+
+    const int n_threads = 8;
+    const int n_keys = 20000;
+
+    concurrent_hash_map<int, int> map(16);
+
+    // writers insert overlapping key ranges while readers check the values
+    // they find are always consistent with their keys
+    std::atomic<bool> running(true);
+    std::atomic<std::size_t> inserted(0), inconsistent(0);
+
+    std::vector<std::thread> readers;
+    for(int r = 0; r < 2; ++r){
+        readers.emplace_back([&](){
+            while(running.load()){
+                for(int k = 0; k < n_keys; k += 7){
+                    int value = 0;
+                    if(map.find(k, value) && value % n_keys != k){
+                        inconsistent += 1;
+                    }
+                }
+            }
+        });
+    }
+
+    std::vector<std::thread> writers;
+    for(int t = 0; t < n_threads; ++t){
+        writers.emplace_back([&, t](){
+            for(int i = 0; i < n_keys; ++i){
+                const int k = (i + t * (n_keys / n_threads)) % n_keys;
+                if(map.insert(k, k)){
+                    inserted += 1;
+                }
+                map.update(k, [n_keys](int & v){ v += n_keys; });
+                if(k % 3 == 0){
+                    map.erase(k);
+                }
+            }
+        });
+    }
+
+    for(auto & w : writers){
+        w.join();
+    }
+    running = false;
+    for(auto & r : readers){
+        r.join();
+    }
+
+    BOOST_CHECK_EQUAL(inconsistent.load(), 0);
+    BOOST_CHECK_GE(inserted.load(), std::size_t(n_keys));
+
+    std::size_t n_elems = 0;
+    map.for_each([&](const int & k, const int & v){
+        BOOST_CHECK_EQUAL(v % n_keys, k);
+        n_elems += 1;
+    });
+    BOOST_CHECK_EQUAL(n_elems, map.size());
+}
+
+
+BOOST_AUTO_TEST_CASE( concurrent_hash_map_bulk_insert_test )
+{
+    using namespace hadoken::containers;
+
+    std::vector<std::pair<int, double> > elems;
+    for(int i = 0; i < 100000; ++i){
+        elems.emplace_back(i % 50000, i * 0.5);
+    }
+
+    concurrent_hash_map<int, double> map;
+    map.bulk_insert(hadoken::parallel::par, elems.begin(), elems.end());
+
+    BOOST_CHECK_EQUAL(map.size(), 50000);
+    BOOST_CHECK_GE(map.bucket_count(), 50000);
+
+    for(int i = 0; i < 50000; ++i){
+        double value = -1;
+        BOOST_CHECK(map.find(i, value));
+        // one of the duplicates won the insertion
+        BOOST_CHECK(value == i * 0.5 || value == (i + 50000) * 0.5);
+    }
+}
@@ -0,0 +1,158 @@
+/**
+ * Copyright (c) 2016, Adrien Devresse <adrien.devresse@epfl.ch>
+ * 
+ * Boost Software License - Version 1.0 
+ * 
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ * 
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+* 
+*/
+
+#define BOOST_TEST_MODULE coroutineTests
+#define BOOST_TEST_MAIN
+
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <hadoken/executor/co_task.hpp>
+#include <hadoken/parallel/algorithm.hpp>
+
+
+namespace {
+
+hadoken::co_task<int> value_task(int v){
+    co_return v;
+}
+
+hadoken::co_task<int> sum_task(int n){
+    int res = 0;
+    for(int i = 1; i <= n; ++i){
+        res += co_await value_task(i);
+    }
+    co_return res;
+}
+
+hadoken::co_task<void> throwing_task(){
+    throw std::runtime_error("co_task error");
+    co_return;
+}
+
+}
+
+
+BOOST_AUTO_TEST_CASE( co_task_simple_test)
+{
+    BOOST_CHECK_EQUAL(hadoken::sync_wait(value_task(42)), 42);
+
+    // nested tasks
+    BOOST_CHECK_EQUAL(hadoken::sync_wait(sum_task(100)), 5050);
+
+    // exceptions are forwarded to the awaiter
+    BOOST_CHECK_THROW(hadoken::sync_wait(throwing_task()), std::runtime_error);
+
+    hadoken::co_task<int> t = value_task(1);
+    BOOST_CHECK(t.valid());
+    BOOST_CHECK(t.done() == false);
+}
+
+
+BOOST_AUTO_TEST_CASE( co_task_pool_test)
+{
+    hadoken::thread_pool_executor pool(2);
+
+    auto on_pool = [](hadoken::thread_pool_executor & p) -> hadoken::co_task<std::ptrdiff_t> {
+        co_await hadoken::schedule(p);
+        co_return p.current_worker_id();
+    };
+
+    const std::ptrdiff_t worker = hadoken::sync_wait(on_pool(pool));
+    BOOST_CHECK_GE(worker, 0);
+    BOOST_CHECK_LT(worker, 2);
+}
+
+
+BOOST_AUTO_TEST_CASE( co_task_many_in_flight_test)
+{
+    // many more suspended coroutines than threads
+    const std::size_t n_tasks = 20000;
+
+    hadoken::thread_pool_executor pool(2);
+    hadoken::scheduled_executor scheduler(pool);
+    hadoken::async_latch<> started(n_tasks, pool), done(n_tasks, pool);
+    std::atomic<std::size_t> counter(0);
+
+    auto worker = [&](std::size_t i) -> hadoken::co_task<void> {
+        started.count_down();
+        // all the tasks are in flight at the same time
+        co_await started.wait();
+        co_await hadoken::sleep_for(scheduler, std::chrono::milliseconds(1 + i % 10));
+        counter.fetch_add(1);
+        done.count_down();
+    };
+
+    for(std::size_t i = 0; i < n_tasks; ++i){
+        hadoken::spawn(pool, worker(i));
+    }
+
+    auto wait_all = [&]() -> hadoken::co_task<std::size_t> {
+        co_await done.wait();
+        co_return counter.load();
+    };
+
+    BOOST_CHECK_EQUAL(hadoken::sync_wait(wait_all()), n_tasks);
+}
+
+
+BOOST_AUTO_TEST_CASE( co_task_async_invoke_test)
+{
+    hadoken::thread_pool_executor pool(2);
+
+    std::vector<int> values(10000);
+    std::iota(values.begin(), values.end(), 0);
+
+    auto compute = [&]() -> hadoken::co_task<long> {
+        co_await hadoken::async_invoke(pool, [&](){
+            hadoken::parallel::for_each(hadoken::parallel::par, values.begin(), values.end(), [](int & v){
+                v *= 2;
+            });
+        });
+
+        long sum = co_await hadoken::async_invoke(pool, [&](){
+            return std::accumulate(values.begin(), values.end(), 0L);
+        });
+
+        co_return sum;
+    };
+
+    BOOST_CHECK_EQUAL(hadoken::sync_wait(compute()), 2L * 9999L * 10000L / 2L);
+
+    auto failing = [&]() -> hadoken::co_task<int> {
+        co_return co_await hadoken::async_invoke(pool, []() -> int { throw std::logic_error("fail"); });
+    };
+
+    BOOST_CHECK_THROW(hadoken::sync_wait(failing()), std::logic_error);
+}
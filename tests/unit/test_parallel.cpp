@@ -30,6 +30,7 @@
 #define BOOST_TEST_MODULE parallelTests
 #define BOOST_TEST_MAIN
 
+#include <atomic>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
@@ -43,6 +44,9 @@
 #include <boost/test/unit_test.hpp>
 
 #include <hadoken/parallel/algorithm.hpp>
+#include <hadoken/containers/numa_buffer.hpp>
+#include <hadoken/memory/scratch_arena.hpp>
+#include <hadoken/thread/combinable.hpp>
 
 //#include <parallel/algorithm>
 
@@ -152,6 +156,44 @@ BOOST_AUTO_TEST_CASE( parallel_for_each_nested)
 
 
 
+#ifdef HADOKEN_PARALLEL_USE_CXX11_THREAD
+
+BOOST_AUTO_TEST_CASE( parallel_cxx11_backend_test)
+{
+    using namespace hadoken;
+
+    system_executor sexec;
+    thread_pool_executor & pool = sexec.pool();
+    const std::size_t n_task = pool.size();
+
+    // slice i always runs on worker i, the caller has no slice
+    std::vector<std::ptrdiff_t> owner(n_task * 1000 + 7, -1);
+    parallel::for_range(parallel::par, owner.begin(), owner.end(), [&](std::vector<std::ptrdiff_t>::iterator first,
+                                                                       std::vector<std::ptrdiff_t>::iterator last){
+        std::fill(first, last, pool.current_worker_id());
+    });
+
+    range<std::vector<std::ptrdiff_t>::iterator> all(owner.begin(), owner.end());
+    for(std::size_t i = 0; i < n_task; ++i){
+        range<std::vector<std::ptrdiff_t>::iterator> slice = take_splice(all, i, n_task);
+        BOOST_CHECK(std::all_of(slice.begin(), slice.end(), [i](std::ptrdiff_t id){ return id == std::ptrdiff_t(i); }));
+    }
+
+    // called from a worker of the pool: its own slice is queued behind it
+    std::promise<std::size_t> nested_sum;
+    sexec.execute([&](){
+        std::vector<std::size_t> values(10000, 1);
+        parallel::for_each(parallel::par, values.begin(), values.end(), [](std::size_t & v){
+            v += 1;
+        });
+        nested_sum.set_value(std::accumulate(values.begin(), values.end(), std::size_t(0)));
+    });
+    BOOST_CHECK_EQUAL(nested_sum.get_future().get(), 20000);
+}
+
+#endif
+
+
 BOOST_AUTO_TEST_CASE( parallel_fill_test)
 {
 
@@ -671,3 +713,167 @@ BOOST_AUTO_TEST_CASE( parallel_inclusive_scan)
   
 
 }
+
+
+BOOST_AUTO_TEST_CASE( parallel_inclusive_scan_scratch)
+{
+
+    using namespace hadoken;
+
+    std::vector<int> values(10000, 1), res(values.size());
+
+    // the temporaries come from the scratch arena of the caller: no new chunk after the first call
+    parallel::inclusive_scan(parallel::par, values.begin(), values.end(), res.begin());
+    const std::size_t capacity = memory::scratch_arena().capacity();
+    const char* position = memory::scratch_arena().mark().ptr;
+
+    for(int i = 0; i < 10; ++i){
+        parallel::inclusive_scan(parallel::par, values.begin(), values.end(), res.begin());
+        BOOST_CHECK_EQUAL(res.back(), 10000);
+    }
+
+    BOOST_CHECK_EQUAL(memory::scratch_arena().capacity(), capacity);
+    BOOST_CHECK(memory::scratch_arena().mark().ptr == position);
+}
+
+
+
+BOOST_AUTO_TEST_CASE( parallel_uninitialized_fill_test)
+{
+
+    using namespace hadoken;
+
+    const std::size_t n = 100000;
+
+    std::allocator<std::string> alloc;
+    std::string* buffer = alloc.allocate(n);
+
+    parallel::first_touch(parallel::par, buffer, buffer + n);
+
+    parallel::uninitialized_fill(parallel::par, buffer, buffer + n, std::string("hello world"));
+
+    for(std::size_t i =0; i < n; ++i){
+        BOOST_CHECK_EQUAL(buffer[i], "hello world");
+        buffer[i].~basic_string();
+    }
+
+    parallel::uninitialized_fill(parallel::seq, buffer, buffer + n, std::string("hello"));
+
+    BOOST_CHECK_EQUAL(std::count(buffer, buffer + n, std::string("hello")), n);
+
+    for(std::size_t i =0; i < n; ++i){
+        buffer[i].~basic_string();
+    }
+
+    alloc.deallocate(buffer, n);
+}
+
+
+namespace{
+
+// count the live instances, the copy number throw_at throws
+struct throwing_copy{
+    throwing_copy() { ++live; }
+
+    throwing_copy(const throwing_copy &){
+        if(copies.fetch_add(1) == throw_at){
+            throw std::runtime_error("copy failure");
+        }
+        ++live;
+    }
+
+    ~throwing_copy(){
+        --live;
+    }
+
+    static std::atomic<long> live, copies;
+    static long throw_at;
+};
+
+std::atomic<long> throwing_copy::live(0), throwing_copy::copies(0);
+long throwing_copy::throw_at = 0;
+
+}
+
+
+BOOST_AUTO_TEST_CASE( numa_buffer_test)
+{
+
+    using namespace hadoken;
+    using namespace hadoken::containers;
+
+    const std::size_t n = 1 << 20;
+
+    numa_buffer<double> empty_buffer;
+    BOOST_CHECK(empty_buffer.empty());
+
+    numa_buffer<double> partitioned(parallel::par, n, 42.0);
+    BOOST_CHECK_EQUAL(partitioned.size(), n);
+    BOOST_CHECK(partitioned.placement() == numa_placement::partitioned);
+
+    numa_buffer<double> interleaved(parallel::par, n, 1.0, numa_placement::interleaved);
+    BOOST_CHECK(interleaved.placement() == numa_placement::interleaved);
+
+    parallel::for_range(parallel::par, partitioned.begin(), partitioned.end(), [&](double* first, double* last){
+        for(; first < last; ++first){
+            *first += interleaved[static_cast<std::size_t>(first - partitioned.data())];
+        }
+    });
+
+    BOOST_CHECK_EQUAL(parallel::count(parallel::par, partitioned.begin(), partitioned.end(), 43.0), n);
+
+    numa_buffer<double> moved(std::move(partitioned));
+    BOOST_CHECK(partitioned.empty());
+    BOOST_CHECK_EQUAL(moved.size(), n);
+    BOOST_CHECK_EQUAL(moved[n-1], 43.0);
+
+    numa_buffer<std::string> strings(parallel::seq, 1000, std::string("abc"));
+    BOOST_CHECK_EQUAL(strings[999], "abc");
+
+    // a throwing copy destroys everything constructed, on every slice
+    throwing_copy::live = 0;
+    throwing_copy::copies = 0;
+    throwing_copy::throw_at = 5000;
+    BOOST_CHECK_THROW((numa_buffer<throwing_copy>(parallel::par, 100000, throwing_copy())), std::runtime_error);
+    BOOST_CHECK_EQUAL(throwing_copy::live.load(), 0);
+    throwing_copy::copies = 0;
+    BOOST_CHECK_THROW((numa_buffer<throwing_copy>(parallel::seq, 100000, throwing_copy())), std::runtime_error);
+    BOOST_CHECK_EQUAL(throwing_copy::live.load(), 0);
+}
+
+
+
+BOOST_AUTO_TEST_CASE( combinable_for_range_test)
+{
+    using namespace hadoken;
+
+    const std::size_t n = 1 << 20;
+    std::vector<std::uint8_t> values(n);
+    for(std::size_t i = 0; i < n; ++i){
+        values[i] = static_cast<std::uint8_t>((i * 7) % 256);
+    }
+
+    // per-thread histograms, no indexing by thread number
+    thread::combinable<std::vector<std::size_t> > histograms(std::vector<std::size_t>(256, 0));
+
+    parallel::for_range(parallel::par, values.begin(), values.end(),
+                        [&](std::vector<std::uint8_t>::iterator first, std::vector<std::uint8_t>::iterator last){
+        std::vector<std::size_t> & histo = histograms.local();
+        for(; first != last; ++first){
+            histo[*first] += 1;
+        }
+    });
+
+    std::vector<std::size_t> total = histograms.combine([](const std::vector<std::size_t> & a, const std::vector<std::size_t> & b){
+        std::vector<std::size_t> res(a);
+        for(std::size_t i = 0; i < res.size(); ++i){
+            res[i] += b[i];
+        }
+        return res;
+    });
+
+    BOOST_CHECK_EQUAL(std::accumulate(total.begin(), total.end(), std::size_t(0)), n);
+    for(std::size_t i = 0; i < 256; ++i){
+        BOOST_CHECK_EQUAL(total[i], n / 256);
+    }
+}
@@ -30,18 +30,43 @@
 #define BOOST_TEST_MODULE containerTests
 #define BOOST_TEST_MAIN
 
+#include <deque>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 #include <functional>
 #include <future>
+#include <fstream>
+#include <cstdlib>
+#include <random>
+#include <numeric>
 
 #include <boost/test/unit_test.hpp>
 
 #include <hadoken/thread/spinlock.hpp>
+#include <hadoken/thread/mcs_lock.hpp>
+#include <hadoken/thread/rw_spinlock.hpp>
 #include <hadoken/thread/latch.hpp>
+#include <hadoken/thread/semaphore.hpp>
+#include <hadoken/thread/event.hpp>
+#include <hadoken/thread/barrier.hpp>
+#include <hadoken/thread/mpmc_queue.hpp>
+#include <hadoken/thread/spsc_ring.hpp>
+#include <hadoken/thread/epoch.hpp>
+#include <hadoken/thread/hazard_pointer.hpp>
+#include <hadoken/thread/enumerable_thread_specific.hpp>
+#include <hadoken/thread/combinable.hpp>
+#include <hadoken/thread/padded.hpp>
+#include <hadoken/thread/sharded_counter.hpp>
+#include <hadoken/thread/seqlock.hpp>
+#include <hadoken/thread/snapshot_ptr.hpp>
+#include <hadoken/thread/profiled_lock.hpp>
+#include <hadoken/thread/topology.hpp>
 #include <hadoken/executor/simple_thread_executor.hpp>
 #include <hadoken/executor/thread_pool_executor.hpp>
+#include <hadoken/executor/task_group.hpp>
+#include <hadoken/executor/scheduled_executor.hpp>
+#include <hadoken/executor/strand.hpp>
 
 
 BOOST_AUTO_TEST_CASE( spin_lock_simple_test)
@@ -89,6 +114,443 @@ BOOST_AUTO_TEST_CASE( spin_lock_simple_test)
 
 
 
+
+template<typename Lock>
+void lock_mutual_exclusion_test(){
+    const std::size_t n_thread = 8, n_iter = 2000;
+    Lock lock;
+    std::size_t counter = 0;
+    std::atomic<int> in_critical(0);
+    std::atomic<bool> overlap(false);
+
+    std::vector<std::future<void> > res;
+    for(std::size_t i =0; i < n_thread; ++i){
+        res.emplace_back(std::async(std::launch::async, [&] {
+            for(std::size_t j =0; j < n_iter; ++j){
+                std::lock_guard<Lock> guard(lock);
+                if(in_critical.fetch_add(1) != 0){
+                    overlap = true;
+                }
+                counter += 1;
+                in_critical.fetch_sub(1);
+            }
+        }));
+    }
+
+    for(auto & f : res){
+        f.wait();
+    }
+
+    BOOST_CHECK(overlap == false);
+    BOOST_CHECK_EQUAL(counter, n_thread * n_iter);
+
+    BOOST_CHECK(lock.try_lock());
+    BOOST_CHECK(lock.try_lock() == false);
+    lock.unlock();
+    BOOST_CHECK(lock.try_lock());
+    lock.unlock();
+
+    // ownership handed over through try_lock only: the new owner must see
+    // the writes of the previous one
+    std::vector<std::size_t> protected_data(64, 0);
+    res.clear();
+    for(std::size_t i =0; i < n_thread; ++i){
+        res.emplace_back(std::async(std::launch::async, [&] {
+            for(std::size_t j =0; j < n_iter; ){
+                if(lock.try_lock() == false){
+                    std::this_thread::yield();
+                    continue;
+                }
+                for(std::size_t & v : protected_data){
+                    v += 1;
+                }
+                lock.unlock();
+                ++j;
+            }
+        }));
+    }
+
+    for(auto & f : res){
+        f.wait();
+    }
+
+    BOOST_CHECK(std::all_of(protected_data.begin(), protected_data.end(), [&](std::size_t v){ return v == n_thread * n_iter; }));
+}
+
+
+BOOST_AUTO_TEST_CASE( lock_family_test)
+{
+    lock_mutual_exclusion_test<hadoken::thread::backoff_spin_lock>();
+    lock_mutual_exclusion_test<hadoken::thread::ticket_lock>();
+    lock_mutual_exclusion_test<hadoken::thread::mcs_lock>();
+    lock_mutual_exclusion_test<hadoken::thread::rw_spin_lock>();
+}
+
+
+BOOST_AUTO_TEST_CASE( mcs_lock_nested_test)
+{
+    // several mcs locks held at the same time by a thread
+    hadoken::thread::mcs_lock l1, l2;
+
+    l1.lock();
+    l2.lock();
+    BOOST_CHECK(l1.try_lock() == false);
+    l1.unlock();
+    BOOST_CHECK(l1.try_lock());
+    l2.unlock();
+    l1.unlock();
+}
+
+
+BOOST_AUTO_TEST_CASE( rw_spin_lock_test)
+{
+    hadoken::thread::rw_spin_lock lock;
+
+    // concurrent readers
+    BOOST_CHECK(lock.try_lock_shared());
+    BOOST_CHECK(lock.try_lock_shared());
+    BOOST_CHECK(lock.try_lock() == false);
+    lock.unlock_shared();
+    lock.unlock_shared();
+
+    // exclusive writer
+    BOOST_CHECK(lock.try_lock());
+    BOOST_CHECK(lock.try_lock_shared() == false);
+    lock.unlock();
+
+    // readers always see a consistent pair
+    std::pair<std::size_t, std::size_t> value(0, 0);
+    std::atomic<bool> inconsistent(false), stop(false);
+
+    std::vector<std::future<void> > readers;
+    for(std::size_t i =0; i < 4; ++i){
+        readers.emplace_back(std::async(std::launch::async, [&] {
+            while(stop == false){
+                lock.lock_shared();
+                if(value.first != value.second){
+                    inconsistent = true;
+                }
+                lock.unlock_shared();
+            }
+        }));
+    }
+
+    for(std::size_t i =0; i < 2000; ++i){
+        std::lock_guard<hadoken::thread::rw_spin_lock> guard(lock);
+        value.first += 1;
+        value.second += 1;
+    }
+    stop = true;
+
+    for(auto & f : readers){
+        f.wait();
+    }
+
+    BOOST_CHECK(inconsistent == false);
+    BOOST_CHECK_EQUAL(value.second, 2000);
+}
+
+BOOST_AUTO_TEST_CASE( mpmc_queue_simple_test)
+{
+    hadoken::thread::mpmc_queue<int> queue(5);
+
+    BOOST_CHECK_EQUAL(queue.capacity(), 8);
+    BOOST_CHECK(queue.empty_approx());
+
+    for(int i = 0; i < 8; ++i){
+        BOOST_CHECK(queue.try_push(i));
+    }
+    BOOST_CHECK(queue.try_push(8) == false);
+    BOOST_CHECK_EQUAL(queue.size_approx(), 8);
+
+    int val = -1;
+    for(int i = 0; i < 8; ++i){
+        BOOST_CHECK(queue.try_pop(val));
+        BOOST_CHECK_EQUAL(val, i);
+    }
+    BOOST_CHECK(queue.try_pop(val) == false);
+
+    // move only types, remaining elements destroyed with the queue
+    std::shared_ptr<int> witness = std::make_shared<int>(42);
+    {
+        hadoken::thread::mpmc_queue<std::unique_ptr<std::shared_ptr<int> > > q2(4);
+        BOOST_CHECK(q2.try_emplace(new std::shared_ptr<int>(witness)));
+        BOOST_CHECK(q2.try_push(std::unique_ptr<std::shared_ptr<int> >(new std::shared_ptr<int>(witness))));
+
+        std::unique_ptr<std::shared_ptr<int> > res;
+        BOOST_CHECK(q2.try_pop(res));
+        BOOST_CHECK_EQUAL(**res, 42);
+        BOOST_CHECK_EQUAL(witness.use_count(), 3);
+    }
+    BOOST_CHECK_EQUAL(witness.use_count(), 1);
+}
+
+
+BOOST_AUTO_TEST_CASE( mpmc_queue_concurrent_test)
+{
+    const std::size_t n_producers = 4, n_consumers = 4, n_items = 20000;
+
+    // small queue: producers and consumers block often
+    hadoken::thread::mpmc_queue<std::size_t> queue(16);
+
+    std::vector<std::future<void> > producers;
+    for(std::size_t i =0; i < n_producers; ++i){
+        producers.emplace_back(std::async(std::launch::async, [&, i] {
+            for(std::size_t j = i; j < n_items; j += n_producers){
+                queue.push(j);
+            }
+        }));
+    }
+
+    std::vector<std::future<std::pair<std::size_t, std::size_t> > > consumers;
+    for(std::size_t i =0; i < n_consumers; ++i){
+        consumers.emplace_back(std::async(std::launch::async, [&] {
+            std::pair<std::size_t, std::size_t> count_sum(0, 0);
+            for(std::size_t j = 0; j < n_items / n_consumers; ++j){
+                count_sum.first += 1;
+                count_sum.second += queue.pop();
+            }
+            return count_sum;
+        }));
+    }
+
+    std::size_t count = 0, sum = 0;
+    for(auto & f : consumers){
+        std::pair<std::size_t, std::size_t> count_sum = f.get();
+        count += count_sum.first;
+        sum += count_sum.second;
+    }
+
+    BOOST_CHECK_EQUAL(count, n_items);
+    BOOST_CHECK_EQUAL(sum, n_items * (n_items - 1) / 2);
+    BOOST_CHECK(queue.empty_approx());
+}
+
+BOOST_AUTO_TEST_CASE( spsc_ring_simple_test)
+{
+    hadoken::thread::spsc_ring<int> ring(6);
+    BOOST_CHECK_EQUAL(ring.capacity(), 8);
+
+    const std::vector<int> values = { 0, 1, 2, 3, 4, 5 };
+    BOOST_CHECK_EQUAL(ring.push_bulk(values.begin(), values.size()), 6);
+
+    std::vector<int> out(4, -1);
+    BOOST_CHECK_EQUAL(ring.pop_bulk(out.begin(), 4), 4);
+    BOOST_CHECK(std::equal(out.begin(), out.end(), values.begin()));
+
+    // wrap around: 2 elements left, 6 free slots, 4 contiguous
+    BOOST_CHECK_EQUAL(ring.push_bulk(values.begin(), values.size()), 6);
+    BOOST_CHECK_EQUAL(ring.size_approx(), 8);
+    BOOST_CHECK(ring.try_push(42) == false);
+
+    std::size_t n = 8;
+    int* slots = ring.peek(n);
+    BOOST_CHECK_EQUAL(n, 4);
+    BOOST_CHECK_EQUAL(slots[0], 4);
+    ring.release(n);
+
+    out.assign(8, -1);
+    BOOST_CHECK_EQUAL(ring.pop_bulk(out.begin(), 8), 4);
+    BOOST_CHECK_EQUAL(out[0], 2);
+    BOOST_CHECK_EQUAL(out[3], 5);
+
+    int val;
+    BOOST_CHECK(ring.try_pop(val) == false);
+}
+
+
+BOOST_AUTO_TEST_CASE( spsc_ring_concurrent_test)
+{
+    // records written in place, their buffers are reused
+    const std::size_t n_records = 100000;
+    hadoken::thread::spsc_ring<std::vector<std::size_t> > ring(64);
+
+    std::future<void> producer = std::async(std::launch::async, [&] {
+        std::size_t i = 0;
+        while(i < n_records){
+            std::size_t n = n_records - i;
+            std::vector<std::size_t>* records = ring.reserve(n);
+            for(std::size_t j = 0; j < n; ++j){
+                records[j].assign(4, i + j);
+            }
+            ring.commit(n);
+            i += n;
+        }
+    });
+
+    std::size_t received = 0;
+    bool ordered = true;
+    while(received < n_records){
+        std::size_t n = 16;
+        std::vector<std::size_t>* records = ring.peek(n);
+        for(std::size_t j = 0; j < n; ++j){
+            ordered = ordered && (records[j].size() == 4) && (records[j][3] == received + j);
+        }
+        ring.release(n);
+        received += n;
+    }
+    producer.wait();
+
+    BOOST_CHECK(ordered);
+    BOOST_CHECK_EQUAL(received, n_records);
+}
+
+namespace {
+
+std::atomic<std::ptrdiff_t> live_nodes(0);
+
+struct stack_node{
+    stack_node(std::size_t v) : value(v), next(nullptr) { live_nodes.fetch_add(1); }
+    ~stack_node(){ value = 0xdead; live_nodes.fetch_sub(1); }
+
+    std::size_t value;
+    stack_node* next;
+};
+
+// Treiber stack, popped nodes are freed by the reclamation domain
+struct epoch_stack{
+    epoch_stack(hadoken::thread::epoch_domain & d) : head(nullptr), domain(d) {}
+
+    void push(std::size_t v){
+        stack_node* n = new stack_node(v);
+        n->next = head.load();
+        while(head.compare_exchange_weak(n->next, n) == false){}
+    }
+
+    bool pop(std::size_t & v){
+        stack_node* n;
+        {
+            auto guard = domain.pin();
+            n = head.load();
+            while(n != nullptr && head.compare_exchange_weak(n, n->next) == false){}
+            if(n == nullptr){
+                return false;
+            }
+            v = n->value;
+        }
+        domain.retire(n);
+        return true;
+    }
+
+    std::atomic<stack_node*> head;
+    hadoken::thread::epoch_domain & domain;
+};
+
+struct hazard_stack{
+    hazard_stack(hadoken::thread::hazard_domain & d) : head(nullptr), domain(d) {}
+
+    void push(std::size_t v){
+        stack_node* n = new stack_node(v);
+        n->next = head.load();
+        while(head.compare_exchange_weak(n->next, n) == false){}
+    }
+
+    bool pop(std::size_t & v){
+        auto hp = domain.make_hazard_pointer();
+        stack_node* n;
+        while(1){
+            n = hp.protect(head);
+            if(n == nullptr){
+                return false;
+            }
+            if(head.compare_exchange_strong(n, n->next)){
+                break;
+            }
+        }
+        v = n->value;
+        hp.reset();
+        domain.retire(n);
+        return true;
+    }
+
+    std::atomic<stack_node*> head;
+    hadoken::thread::hazard_domain & domain;
+};
+
+
+template<typename Domain, typename Stack>
+void reclamation_stack_test(){
+    const std::size_t n_thread = 4, n_iter = 20000;
+
+    Domain domain;
+    Stack stack(domain);
+    std::atomic<bool> corrupted(false);
+
+    {
+        // workers register to the domain on their first use
+        hadoken::thread_pool_executor pool(n_thread);
+        hadoken::thread::latch done(n_thread);
+
+        for(std::size_t i = 0; i < n_thread; ++i){
+            pool.execute_on(i, [&, i](){
+                for(std::size_t j = 0; j < n_iter; ++j){
+                    stack.push(i * n_iter + j);
+                    std::size_t v;
+                    if(stack.pop(v) && v >= n_thread * n_iter){
+                        corrupted = true;
+                    }
+                }
+                done.count_down();
+            });
+        }
+        done.wait();
+    }
+
+    // workers exited, their retired nodes are orphans of the domain
+    std::size_t v;
+    while(stack.pop(v)){}
+    domain.collect();
+
+    BOOST_CHECK(corrupted == false);
+    BOOST_CHECK_EQUAL(live_nodes.load(), 0);
+}
+
+}
+
+
+BOOST_AUTO_TEST_CASE( epoch_reclamation_test)
+{
+    hadoken::thread::epoch_domain domain;
+
+    // retired objects are not freed while a thread is in a critical section
+    stack_node* n = new stack_node(1);
+    {
+        auto guard = domain.pin();
+        domain.retire(n);
+        domain.collect();
+        BOOST_CHECK_EQUAL(live_nodes.load(), 1);
+    }
+    domain.collect();
+    BOOST_CHECK_EQUAL(live_nodes.load(), 0);
+
+    reclamation_stack_test<hadoken::thread::epoch_domain, epoch_stack>();
+}
+
+
+BOOST_AUTO_TEST_CASE( hazard_pointer_reclamation_test)
+{
+    hadoken::thread::hazard_domain domain(2);
+
+    // a protected object is not freed
+    std::atomic<stack_node*> ptr(new stack_node(1));
+    {
+        auto hp = domain.make_hazard_pointer();
+        auto hp2 = domain.make_hazard_pointer();
+        BOOST_CHECK_THROW(domain.make_hazard_pointer(), std::length_error);
+
+        stack_node* n = hp.protect(ptr);
+        BOOST_CHECK_EQUAL(n->value, 1);
+        ptr.store(nullptr);
+        domain.retire(n);
+        domain.collect();
+        BOOST_CHECK_EQUAL(live_nodes.load(), 1);
+    }
+    domain.collect();
+    BOOST_CHECK_EQUAL(live_nodes.load(), 0);
+
+    reclamation_stack_test<hadoken::thread::hazard_domain, hazard_stack>();
+}
+
 BOOST_AUTO_TEST_CASE( executor_simple_thread_test)
 {
     hadoken::simple_thread_executor exec_thread;
@@ -202,3 +664,1177 @@ BOOST_AUTO_TEST_CASE( latch_test)
 
 
 }
+
+
+
+BOOST_AUTO_TEST_CASE( semaphore_test)
+{
+    hadoken::thread::counting_semaphore<> sem(2);
+
+    BOOST_CHECK(sem.try_acquire());
+    BOOST_CHECK(sem.try_acquire());
+    BOOST_CHECK(sem.try_acquire() == false);
+    BOOST_CHECK(sem.try_acquire_for(std::chrono::milliseconds(5)) == false);
+
+    // producer / consumers
+    const std::size_t n_items = 10000, n_consumers = 4;
+    std::atomic<std::size_t> consumed(0);
+
+    std::vector<std::future<void> > res;
+    for(std::size_t i =0; i < n_consumers; ++i){
+        res.emplace_back(std::async(std::launch::async, [&] {
+            for(std::size_t j =0; j < n_items / n_consumers; ++j){
+                sem.acquire();
+                consumed.fetch_add(1);
+            }
+        }));
+    }
+
+    for(std::size_t i =0; i < n_items; ++i){
+        sem.release();
+    }
+
+    for(auto & f : res){
+        f.wait();
+    }
+
+    BOOST_CHECK_EQUAL(consumed.load(), n_items);
+    BOOST_CHECK(sem.try_acquire() == false);
+
+    // ping-pong
+    hadoken::thread::binary_semaphore ping(0), pong(0);
+    std::size_t counter = 0;
+
+    std::future<void> player = std::async(std::launch::async, [&] {
+        for(std::size_t i =0; i < 1000; ++i){
+            ping.acquire();
+            counter += 1;
+            pong.release();
+        }
+    });
+
+    for(std::size_t i =0; i < 1000; ++i){
+        ping.release();
+        pong.acquire();
+    }
+    player.wait();
+
+    BOOST_CHECK_EQUAL(counter, 1000);
+}
+
+
+BOOST_AUTO_TEST_CASE( barrier_test)
+{
+    const std::size_t n_thread = 8, n_phase = 200;
+
+    std::size_t completed_phases = 0;
+    std::atomic<bool> inconsistent(false);
+    std::vector<std::size_t> values(n_thread, 0);
+
+    auto on_completion = [&]() {
+        // all the threads arrived, they all wrote the value of this iteration
+        for(std::size_t v : values){
+            if(v != completed_phases / 2){
+                inconsistent = true;
+            }
+        }
+        completed_phases += 1;
+    };
+
+    hadoken::thread::barrier<decltype(on_completion)> sync(n_thread, on_completion);
+
+    std::vector<std::future<void> > res;
+    for(std::size_t i =0; i < n_thread; ++i){
+        res.emplace_back(std::async(std::launch::async, [&, i] {
+            for(std::size_t p =0; p < n_phase; ++p){
+                values[i] = p;
+                sync.arrive_and_wait();
+                if(completed_phases != 2 * p + 1){
+                    inconsistent = true;
+                }
+                sync.arrive_and_wait();
+            }
+        }));
+    }
+
+    for(auto & f : res){
+        f.wait();
+    }
+
+    BOOST_CHECK(inconsistent == false);
+    BOOST_CHECK_EQUAL(completed_phases, 2 * n_phase);
+}
+
+
+BOOST_AUTO_TEST_CASE( barrier_drop_test)
+{
+    hadoken::thread::barrier<> sync(3);
+    std::atomic<std::size_t> counter(0);
+
+    // one thread leaves after the first phase, the two others continue
+    std::future<void> leaving = std::async(std::launch::async, [&] {
+        counter.fetch_add(1);
+        sync.arrive_and_drop();
+    });
+
+    std::future<void> staying = std::async(std::launch::async, [&] {
+        for(std::size_t p =0; p < 10; ++p){
+            counter.fetch_add(1);
+            sync.arrive_and_wait();
+        }
+    });
+
+    for(std::size_t p =0; p < 10; ++p){
+        counter.fetch_add(1);
+        auto token = sync.arrive();
+        sync.wait(std::move(token));
+    }
+
+    leaving.wait();
+    staying.wait();
+
+    BOOST_CHECK_EQUAL(counter.load(), 21);
+}
+
+BOOST_AUTO_TEST_CASE( auto_reset_event_test)
+{
+    hadoken::thread::auto_reset_event ev;
+
+    BOOST_CHECK(ev.try_wait() == false);
+    BOOST_CHECK(ev.wait_for(std::chrono::milliseconds(5)) == false);
+
+    // signals do not accumulate
+    ev.set();
+    ev.set();
+    BOOST_CHECK(ev.try_wait());
+    BOOST_CHECK(ev.try_wait() == false);
+
+    // each set wakes up one waiter
+    const std::size_t n_waiters = 4;
+    std::atomic<std::size_t> woken(0);
+
+    std::vector<std::future<void> > res;
+    for(std::size_t i =0; i < n_waiters; ++i){
+        res.emplace_back(std::async(std::launch::async, [&] {
+            ev.wait();
+            woken.fetch_add(1);
+        }));
+    }
+
+    for(std::size_t i =0; i < n_waiters; ++i){
+        const std::size_t expected = i + 1;
+        ev.set();
+        while(woken.load() < expected){
+            std::this_thread::yield();
+        }
+    }
+
+    for(auto & f : res){
+        f.wait();
+    }
+    BOOST_CHECK_EQUAL(woken.load(), n_waiters);
+}
+
+
+
+// create a fake sysfs tree: 2 NUMA nodes, 2 cores per node, 2 hyper-threads per core
+// cpu i and i+4 are siblings, node 0 = cpu 0,1,4,5
+static std::string create_fake_sysfs(){
+    char tmpl[] = "/tmp/hadoken_sysfs_XXXXXX";
+    const std::string root(mkdtemp(tmpl));
+
+    auto write_file = [](const std::string & path, const std::string & content){
+        std::ofstream f(path.c_str());
+        f << content << "\n";
+    };
+
+    BOOST_REQUIRE_EQUAL(std::system(("mkdir -p " + root + "/cpu " + root + "/node/node0 " + root + "/node/node1").c_str()), 0);
+    write_file(root + "/cpu/online", "0-7");
+    write_file(root + "/node/online", "0-1");
+    write_file(root + "/node/node0/cpulist", "0-1,4-5");
+    write_file(root + "/node/node1/cpulist", "2-3,6-7");
+
+    for(int cpu = 0; cpu < 8; ++cpu){
+        const std::string topo = root + "/cpu/cpu" + std::to_string(cpu) + "/topology";
+        BOOST_REQUIRE_EQUAL(std::system(("mkdir -p " + topo).c_str()), 0);
+        write_file(topo + "/core_id", std::to_string(cpu % 4));
+        write_file(topo + "/physical_package_id", std::to_string((cpu % 4) / 2));
+    }
+    return root;
+}
+
+
+BOOST_AUTO_TEST_CASE( topology_placement_test)
+{
+    using namespace hadoken::thread;
+
+    const std::string root = create_fake_sysfs();
+
+    cpu_topology topo(root, false);
+
+    BOOST_CHECK_EQUAL(topo.cpus().size(), 8);
+    BOOST_CHECK_EQUAL(topo.number_numa_nodes(), 2);
+    BOOST_CHECK_EQUAL(topo.cpus()[6].numa_node, 1);
+    BOOST_CHECK_EQUAL(topo.cpus()[6].core_id, 2);
+
+    // compact: siblings first, then cores of the same node
+    std::vector<cpu_info> compact = topo.placement(affinity_policy::compact, 8);
+    const int compact_expected[] = { 0, 4, 1, 5, 2, 6, 3, 7 };
+    for(std::size_t i = 0; i < 8; ++i){
+        BOOST_CHECK_EQUAL(compact[i].cpu_id, compact_expected[i]);
+    }
+
+    // scatter: alternate nodes, one thread per core, siblings last
+    std::vector<cpu_info> scatter = topo.placement(affinity_policy::scatter, 10);
+    const int scatter_expected[] = { 0, 2, 1, 3, 4, 6, 5, 7, 0, 2 };
+    for(std::size_t i = 0; i < 10; ++i){
+        BOOST_CHECK_EQUAL(scatter[i].cpu_id, scatter_expected[i]);
+    }
+
+    BOOST_CHECK_EQUAL(std::system(("rm -rf " + root).c_str()), 0);
+
+    // real machine, restricted to our cpuset
+    cpu_topology local_topo;
+    BOOST_CHECK(local_topo.cpus().size() >= 1);
+    BOOST_CHECK(local_topo.number_numa_nodes() >= 1);
+}
+
+
+BOOST_AUTO_TEST_CASE( executor_pool_affinity_test)
+{
+    using namespace hadoken;
+
+    thread_pool_executor pool(0, thread::affinity_policy::compact);
+
+    BOOST_CHECK(pool.size() >= 1);
+    BOOST_CHECK_EQUAL(pool.current_worker_id(), -1);
+
+    for(std::size_t i = 0; i < pool.size(); ++i){
+        BOOST_CHECK(pool.worker_cpu(i) >= 0);
+        BOOST_CHECK(pool.worker_numa_node(i) >= 0);
+
+        std::promise<std::ptrdiff_t> id_promise;
+        auto id_future = id_promise.get_future();
+        pool.execute_on(i, [&](){
+            id_promise.set_value(pool.current_worker_id());
+        });
+        BOOST_CHECK_EQUAL(id_future.get(), std::ptrdiff_t(i));
+    }
+
+    thread_pool_executor unpinned_pool(2, thread::affinity_policy::none);
+    BOOST_CHECK_EQUAL(unpinned_pool.size(), 2);
+    BOOST_CHECK_EQUAL(unpinned_pool.worker_cpu(0), -1);
+}
+
+
+
+static std::uint64_t recursive_fibonacci(hadoken::thread_pool_executor & pool, std::uint64_t n){
+    if(n < 2){
+        return n;
+    }
+
+    std::uint64_t a = 0, b = 0;
+    hadoken::task_group group(pool);
+    group.run([&](){ a = recursive_fibonacci(pool, n-1); });
+    group.run([&](){ b = recursive_fibonacci(pool, n-2); });
+    group.wait();
+    return a + b;
+}
+
+
+BOOST_AUTO_TEST_CASE( task_group_test)
+{
+    using namespace hadoken;
+
+    // small pool: nested waits must not deadlock
+    thread_pool_executor pool(2);
+
+    BOOST_CHECK_EQUAL(recursive_fibonacci(pool, 18), 2584);
+
+    // nested group executed from pool tasks
+    std::atomic<std::size_t> counter(0);
+    {
+        task_group outer(pool);
+        for(std::size_t i = 0; i < 16; ++i){
+            outer.run([&](){
+                task_group inner(pool);
+                for(std::size_t j = 0; j < 16; ++j){
+                    inner.run([&](){ counter.fetch_add(1); });
+                }
+                inner.wait();
+            });
+        }
+        outer.wait();
+    }
+    BOOST_CHECK_EQUAL(counter.load(), 16*16);
+
+    // exception propagation
+    task_group failing_group(pool);
+    failing_group.run([](){ throw std::runtime_error("task failure"); });
+    failing_group.run([&](){ counter.fetch_add(1); });
+    BOOST_CHECK_THROW(failing_group.wait(), std::runtime_error);
+    BOOST_CHECK_EQUAL(counter.load(), 16*16 +1);
+
+    // system pool
+    task_group system_group;
+    system_group.run([&](){ counter.fetch_add(1); });
+    system_group.wait();
+    BOOST_CHECK_EQUAL(counter.load(), 16*16 +2);
+}
+
+
+
+BOOST_AUTO_TEST_CASE( executor_pool_priority_test)
+{
+    using namespace hadoken;
+
+    thread_pool_executor pool(1);
+
+    std::promise<void> start_promise, blocked_promise;
+    std::shared_future<void> start(start_promise.get_future());
+    std::vector<std::string> order;
+    hadoken::thread::latch done(1 + 2 + 2 + 20);
+
+    // block the unique worker, to enqueue everything before execution
+    pool.execute([&](){
+        blocked_promise.set_value();
+        start.wait();
+        done.count_down();
+    });
+    blocked_promise.get_future().wait();
+
+    auto record = [&](const std::string & name){
+        return [&order, &done, name](){
+            order.push_back(name);
+            done.count_down();
+        };
+    };
+
+    pool.execute(record("low"), task_priority::low);
+    pool.execute(record("low"), task_priority::low);
+    pool.execute(record("normal"));
+    pool.execute(record("normal"));
+    for(std::size_t i = 0; i < 20; ++i){
+        pool.execute(record("high"), task_priority::high);
+    }
+
+    start_promise.set_value();
+    done.wait();
+
+    BOOST_REQUIRE_EQUAL(order.size(), 24);
+
+    // high priority tasks first
+    for(std::size_t i = 0; i < details::lane_starvation_limit; ++i){
+        BOOST_CHECK_EQUAL(order[i], "high");
+    }
+
+    // but lower priority lanes are not starved
+    const std::size_t first_normal = std::distance(order.begin(), std::find(order.begin(), order.end(), "normal"));
+    const std::size_t first_low = std::distance(order.begin(), std::find(order.begin(), order.end(), "low"));
+    const std::size_t last_high = std::distance(std::find(order.rbegin(), order.rend(), "high"), order.rend()) -1;
+
+    BOOST_CHECK_LT(first_normal, last_high);
+    BOOST_CHECK_LT(first_low, last_high);
+    BOOST_CHECK_LT(first_normal, first_low);
+}
+
+
+
+BOOST_AUTO_TEST_CASE( executor_pool_statistics_test)
+{
+    using namespace hadoken;
+
+    thread_pool_executor pool(2);
+
+    std::promise<void> start_promise, blocked_promise;
+    std::shared_future<void> start(start_promise.get_future());
+    const std::size_t n_tasks = 100;
+    hadoken::thread::latch done(n_tasks + 1);
+
+    // block worker 0 to accumulate tasks in its queue
+    pool.execute_on(0, [&](){
+        blocked_promise.set_value();
+        start.wait();
+        done.count_down();
+    });
+    blocked_promise.get_future().wait();
+
+    for(std::size_t i = 0; i < n_tasks; ++i){
+        pool.execute_on(0, [&](){ done.count_down(); });
+    }
+
+    // help from the main thread, then release the worker
+    BOOST_CHECK(pool.run_pending_task());
+    start_promise.set_value();
+    done.wait();
+
+    executor_statistics stats = pool.statistics();
+    BOOST_REQUIRE_EQUAL(stats.workers.size(), pool.size());
+
+    if(thread_pool_executor::has_statistics() == false){
+        BOOST_CHECK_EQUAL(stats.workers[0].tasks_executed, 0);
+        BOOST_CHECK_EQUAL(stats.workers[0].queue_depth_high_water, 0);
+        return;
+    }
+
+    std::uint64_t executed = 0, histogram_total = 0;
+    for(const worker_statistics & w : stats.workers){
+        executed += w.tasks_executed;
+        histogram_total += std::accumulate(w.latency_histogram.begin(), w.latency_histogram.end(), std::uint64_t(0));
+        BOOST_CHECK_EQUAL(w.tasks_stolen, 0);
+    }
+
+    // the task counter of a worker is updated before the task runs
+    BOOST_CHECK_EQUAL(executed, n_tasks + 1);
+    BOOST_CHECK_EQUAL(histogram_total, executed);
+    BOOST_CHECK_EQUAL(stats.workers[0].queue_depth_high_water, n_tasks);
+    BOOST_CHECK_GT(stats.workers[0].busy_time_ns, 0);
+
+    // a worker helping the pool from inside a task steals from the other queues
+    std::atomic<bool> inner_done(false);
+    std::promise<void> outer_done;
+    pool.execute_on(0, [&](){
+        pool.execute_on(1, [&](){ inner_done = true; });
+        while(inner_done == false){
+            if(pool.run_pending_task() == false){
+                std::this_thread::yield();
+            }
+        }
+        outer_done.set_value();
+    });
+    outer_done.get_future().wait();
+
+    stats = pool.statistics();
+    BOOST_CHECK_EQUAL(stats.workers[0].tasks_executed + stats.workers[1].tasks_executed, executed + 2);
+    BOOST_CHECK_LE(stats.workers[0].tasks_stolen, 1);
+    BOOST_CHECK_EQUAL(stats.workers[1].tasks_stolen, 0);
+}
+
+
+BOOST_AUTO_TEST_CASE( timing_wheel_test)
+{
+    using namespace hadoken::details;
+
+    const std::size_t n_timers = 20000;
+
+    timing_wheel wheel(1000);
+    std::vector<timer_node> nodes(n_timers);
+
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<std::uint64_t> exponent(0, 36);
+
+    for(auto & node : nodes){
+        node.expiry = 1001 + (rng() % (std::uint64_t(1) << exponent(rng)));
+        wheel.insert(&node);
+    }
+    BOOST_CHECK_EQUAL(wheel.size(), n_timers);
+
+    // remove one timer out of 4
+    for(std::size_t i = 0; i < n_timers; i += 4){
+        wheel.remove(&nodes[i]);
+    }
+    BOOST_CHECK_EQUAL(wheel.size(), n_timers - n_timers / 4);
+
+    std::vector<timer_node*> expired;
+    std::size_t n_expired = 0;
+    timing_wheel::tick_type previous = wheel.current();
+
+    // advance with growing steps, each timer must fire in the step containing its expiry
+    for(timing_wheel::tick_type step = 1; wheel.size() > 0; step = std::min<timing_wheel::tick_type>(step * 3, 1 << 30)){
+        const timing_wheel::tick_type next_event = wheel.next_event();
+        BOOST_CHECK_GT(next_event, wheel.current());
+
+        wheel.advance(wheel.current() + step, expired);
+
+        for(timer_node* node : expired){
+            BOOST_CHECK(node->linked() == false);
+            BOOST_CHECK_LE(node->expiry, wheel.current());
+            BOOST_CHECK_GT(node->expiry, previous);
+            BOOST_CHECK_GE(wheel.current(), next_event);
+        }
+        n_expired += expired.size();
+        expired.clear();
+        previous = wheel.current();
+    }
+
+    BOOST_CHECK_EQUAL(n_expired, n_timers - n_timers / 4);
+    BOOST_CHECK(wheel.next_event() == std::numeric_limits<timing_wheel::tick_type>::max());
+}
+
+
+BOOST_AUTO_TEST_CASE( timing_wheel_boundary_test)
+{
+    using namespace hadoken::details;
+
+    // expiries on slot boundaries of the upper levels, cascaded at their own tick
+    const timing_wheel::tick_type expiries[] = { 256, 512, 768, 65536, 65536 + 256, 3 * 65536 };
+    const std::size_t n_timers = sizeof(expiries) / sizeof(expiries[0]);
+
+    timing_wheel wheel(0);
+    std::vector<timer_node> nodes(n_timers);
+    for(std::size_t i = 0; i < n_timers; ++i){
+        nodes[i].expiry = expiries[i];
+        wheel.insert(&nodes[i]);
+    }
+
+    // tick by tick: each timer fires exactly at its expiry
+    std::vector<timer_node*> expired;
+    std::size_t n_expired = 0;
+    while(wheel.size() > 0){
+        wheel.advance(wheel.current() + 1, expired);
+        for(timer_node* node : expired){
+            BOOST_CHECK_EQUAL(node->expiry, wheel.current());
+        }
+        n_expired += expired.size();
+        expired.clear();
+    }
+    BOOST_CHECK_EQUAL(n_expired, n_timers);
+
+    // an already expired timer fires at the next tick
+    timer_node late;
+    late.expiry = wheel.current() - 10;
+    wheel.insert(&late);
+    wheel.advance(wheel.current() + 1, expired);
+    BOOST_REQUIRE_EQUAL(expired.size(), 1);
+    BOOST_CHECK(expired[0] == &late);
+}
+
+
+BOOST_AUTO_TEST_CASE( scheduled_executor_test)
+{
+    using namespace hadoken;
+    typedef scheduled_executor::clock_type clock_type;
+
+    thread_pool_executor pool(2);
+    scheduled_executor timers(pool);
+
+    // delayed execution, order of deadlines
+    // recorded by the workers, checked by the main thread: Boost.Test is not thread safe
+    std::vector<int> order;
+    std::vector<clock_type::duration> elapsed;
+    std::mutex order_lock;
+    hadoken::thread::latch done(3);
+
+    const clock_type::time_point start = clock_type::now();
+    auto record = [&](int id){
+        return [&, id](){
+            const clock_type::duration d = clock_type::now() - start;
+            std::lock_guard<std::mutex> l(order_lock);
+            order.push_back(id);
+            elapsed.push_back(d);
+            done.count_down();
+        };
+    };
+
+    timers.execute_after(std::chrono::milliseconds(30), record(3));
+    timers.execute_at(start + std::chrono::milliseconds(10), record(1));
+    timers.execute_after(std::chrono::milliseconds(20), record(2));
+
+    // cancellation
+    std::atomic<int> cancelled_runs(0);
+    timer_handle handle = timers.execute_after(std::chrono::milliseconds(15), [&](){ cancelled_runs += 1; });
+    BOOST_CHECK(handle.valid());
+    BOOST_CHECK(timers.cancel(handle));
+    BOOST_CHECK(timers.cancel(handle) == false);
+
+    done.wait();
+    std::unique_lock<std::mutex> order_guard(order_lock);
+    BOOST_REQUIRE_EQUAL(order.size(), 3);
+    for(std::size_t i = 0; i < order.size(); ++i){
+        BOOST_CHECK_EQUAL(order[i], int(i + 1));
+        BOOST_CHECK(elapsed[i] >= std::chrono::milliseconds(10 * order[i]));
+    }
+    order_guard.unlock();
+    BOOST_CHECK_EQUAL(cancelled_runs.load(), 0);
+
+    // periodic execution
+    std::atomic<int> periodic_runs(0);
+    timer_handle periodic = timers.execute_every(std::chrono::milliseconds(2), [&](){ periodic_runs += 1; });
+    while(periodic_runs.load() < 5){
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    BOOST_CHECK(timers.cancel(periodic));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    const int runs_after_cancel = periodic_runs.load();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    BOOST_CHECK_EQUAL(periodic_runs.load(), runs_after_cancel);
+
+    // many pending timers, half of them cancelled
+    const std::size_t n_timers = 100000;
+    std::atomic<std::size_t> fired(0);
+    hadoken::thread::latch all_fired(n_timers / 2);
+    std::vector<timer_handle> handles;
+    handles.reserve(n_timers);
+    for(std::size_t i = 0; i < n_timers; ++i){
+        handles.push_back(timers.execute_after(std::chrono::milliseconds(1000 + i % 50), [&](){
+            fired += 1;
+            all_fired.count_down();
+        }));
+    }
+    BOOST_CHECK_GE(timers.pending(), n_timers / 2);
+
+    std::size_t n_cancelled = 0;
+    for(std::size_t i = 0; i < n_timers; i += 2){
+        n_cancelled += timers.cancel(handles[i]) ? 1 : 0;
+    }
+    // all still pending: every cancellation succeeds, none of them can fire
+    BOOST_CHECK_EQUAL(n_cancelled, n_timers / 2);
+
+    all_fired.wait();
+    BOOST_CHECK_EQUAL(fired.load(), n_timers / 2);
+    BOOST_CHECK_EQUAL(timers.pending(), 0);
+}
+
+
+
+BOOST_AUTO_TEST_CASE( strand_test)
+{
+    using namespace hadoken;
+
+    thread_pool_executor pool(4);
+
+    const std::size_t n_strands = 1000, n_producers = 4, n_tasks = 50;
+
+    struct strand_data{
+        std::size_t counter = 0;
+        std::vector<std::size_t> last_seq = std::vector<std::size_t>(n_producers, 0);
+        bool order_error = false;
+        std::atomic<int> running{0};
+        bool overlap_error = false;
+    };
+
+    std::vector<std::unique_ptr<strand<thread_pool_executor> > > strands;
+    std::vector<strand_data> data(n_strands);
+    for(std::size_t i = 0; i < n_strands; ++i){
+        strands.emplace_back(new strand<thread_pool_executor>(pool));
+    }
+
+    hadoken::thread::latch done(n_strands * n_producers * n_tasks);
+
+    std::vector<std::future<void> > producers;
+    for(std::size_t p = 0; p < n_producers; ++p){
+        producers.emplace_back(std::async(std::launch::async, [&, p](){
+            for(std::size_t t = 1; t <= n_tasks; ++t){
+                for(std::size_t s = 0; s < n_strands; ++s){
+                    strand<thread_pool_executor> & my_strand = *strands[s];
+                    strand_data & d = data[s];
+                    my_strand.execute([&, p, t](){
+                        if(d.running.fetch_add(1) != 0){
+                            d.overlap_error = true;
+                        }
+                        if(my_strand.running_in_this_thread() == false || d.last_seq[p] +1 != t){
+                            d.order_error = true;
+                        }
+                        d.last_seq[p] = t;
+                        d.counter += 1;
+                        d.running.fetch_sub(1);
+                        done.count_down();
+                    });
+                }
+            }
+        }));
+    }
+
+    for(auto & f : producers){
+        f.wait();
+    }
+    done.wait();
+
+    for(auto & d : data){
+        BOOST_CHECK_EQUAL(d.counter, n_producers * n_tasks);
+        BOOST_CHECK(d.order_error == false);
+        BOOST_CHECK(d.overlap_error == false);
+    }
+    BOOST_CHECK(strands[0]->running_in_this_thread() == false);
+}
+
+
+namespace{
+
+// executor queuing its tasks, run by hand from the test
+struct manual_executor{
+    void execute(std::function<void (void)> task){
+        tasks.push_back(std::move(task));
+    }
+
+    std::deque<std::function<void (void)> > tasks;
+};
+
+}
+
+
+BOOST_AUTO_TEST_CASE( strand_exception_test)
+{
+    using namespace hadoken;
+
+    manual_executor exec;
+    strand<manual_executor> serial(exec);
+
+    std::vector<int> order;
+    serial.execute([&](){ order.push_back(1); });
+    serial.execute([&](){ throw std::runtime_error("task failure"); });
+    serial.execute([&](){ order.push_back(3); });
+
+    std::size_t n_errors = 0;
+    while(exec.tasks.empty() == false){
+        std::function<void (void)> task = std::move(exec.tasks.front());
+        exec.tasks.pop_front();
+        try{
+            task();
+        }catch(std::runtime_error &){
+            n_errors += 1;
+            BOOST_CHECK(serial.running_in_this_thread() == false);
+        }
+    }
+
+    BOOST_CHECK_EQUAL(n_errors, 1);
+    BOOST_REQUIRE_EQUAL(order.size(), 2);
+    BOOST_CHECK_EQUAL(order[1], 3);
+
+    // the strand is idle again and still schedules its tasks
+    serial.execute([&](){ order.push_back(4); });
+    BOOST_REQUIRE_EQUAL(exec.tasks.size(), 1);
+    exec.tasks.front()();
+    BOOST_CHECK_EQUAL(order.back(), 4);
+}
+
+
+BOOST_AUTO_TEST_CASE( strand_error_handler_test)
+{
+    using namespace hadoken;
+
+    thread_pool_executor pool(2);
+
+    const std::size_t n_tasks = 1000;
+
+    // the handler runs on the strand: no lock needed
+    std::size_t n_errors = 0;
+    std::vector<std::size_t> order;
+    hadoken::thread::latch done(1);
+
+    strand<thread_pool_executor> serial(pool, [&](std::exception_ptr e){
+        try{
+            std::rethrow_exception(e);
+        }catch(std::runtime_error &){
+            n_errors += 1;
+        }
+    });
+
+    for(std::size_t i = 0; i < n_tasks; ++i){
+        serial.execute([&, i](){
+            if(i % 10 == 0){
+                throw std::runtime_error("task failure");
+            }
+            order.push_back(i);
+        });
+    }
+    serial.execute([&](){ done.count_down(); });
+    done.wait();
+
+    BOOST_CHECK_EQUAL(n_errors, n_tasks / 10);
+    BOOST_CHECK_EQUAL(order.size(), n_tasks - n_tasks / 10);
+    BOOST_CHECK(std::is_sorted(order.begin(), order.end()));
+}
+
+
+
+BOOST_AUTO_TEST_CASE( enumerable_thread_specific_test)
+{
+    using namespace hadoken::thread;
+
+    const std::size_t n_thread = 16;
+    const std::size_t n_iter = 1000;
+
+    enumerable_thread_specific<std::vector<std::size_t> > scratch(std::vector<std::size_t>(4, 1));
+    BOOST_CHECK(scratch.empty());
+    BOOST_CHECK(scratch.begin() == scratch.end());
+
+    bool exists = true;
+    scratch.local(exists).push_back(0);
+    BOOST_CHECK(exists == false);
+    BOOST_CHECK_EQUAL(scratch.local(exists).size(), 5);
+    BOOST_CHECK(exists);
+
+    std::atomic<std::size_t> shared_instance(0);
+    std::vector<std::thread> threads;
+    // keep all the threads alive until each one has its instance:
+    // an exited thread can hand its instance over to a new one
+    latch all_started(n_thread);
+    for(std::size_t i = 0; i < n_thread; ++i){
+        threads.emplace_back([&, i](){
+            std::vector<std::size_t> & mine = scratch.local();
+            for(std::size_t j = 0; j < n_iter; ++j){
+                // always the same instance, never seen by another thread
+                if(&scratch.local() != &mine){
+                    shared_instance += 1;
+                }
+                mine[0] += i;
+            }
+            all_started.count_down_and_wait();
+        });
+    }
+    for(auto & t : threads){
+        t.join();
+    }
+
+    BOOST_CHECK_EQUAL(shared_instance.load(), 0);
+    BOOST_CHECK_EQUAL(scratch.size(), n_thread + 1);
+
+    std::size_t n_instances = 0, sum = 0;
+    for(const std::vector<std::size_t> & v : scratch){
+        n_instances += 1;
+        sum += v[0] - 1;
+        // no false sharing between instances
+        if(&v != &scratch.local()){
+            const char* other = reinterpret_cast<const char*>(&v);
+            const char* mine = reinterpret_cast<const char*>(&scratch.local());
+            BOOST_CHECK_GE(static_cast<std::size_t>(std::max(other, mine) - std::min(other, mine)), cache_line_size);
+        }
+    }
+    BOOST_CHECK_EQUAL(n_instances, n_thread + 1);
+    BOOST_CHECK_EQUAL(sum, n_iter * (n_thread * (n_thread - 1)) / 2);
+
+    scratch.clear();
+    BOOST_CHECK(scratch.empty());
+    BOOST_CHECK_EQUAL(scratch.local().size(), 4);
+}
+
+
+BOOST_AUTO_TEST_CASE( combinable_pool_test)
+{
+    using namespace hadoken::thread;
+
+    const std::size_t n_thread = 4;
+    const std::size_t n_task = 1000;
+
+    combinable<std::size_t> count([]{ return std::size_t(0); });
+    BOOST_CHECK_EQUAL(count.combine(std::plus<std::size_t>()), 0);
+
+    // workers of a pool, as used by the C++11 thread backend of for_range
+    {
+        hadoken::thread_pool_executor pool(n_thread);
+        hadoken::thread::latch done(n_thread * n_task);
+
+        for(std::size_t i = 0; i < n_thread * n_task; ++i){
+            pool.execute_on(i % n_thread, [&, i](){
+                count.local() += i;
+                done.count_down();
+            });
+        }
+        done.wait();
+    }
+    count.local() += 1;
+
+    std::size_t n_partials = 0;
+    count.combine_each([&](std::size_t){ n_partials += 1; });
+    BOOST_CHECK_EQUAL(n_partials, n_thread + 1);
+
+    const std::size_t n = n_thread * n_task;
+    BOOST_CHECK_EQUAL(count.combine(std::plus<std::size_t>()), (n * (n - 1)) / 2 + 1);
+
+    count.clear();
+    BOOST_CHECK_EQUAL(count.combine(std::plus<std::size_t>()), 0);
+}
+
+
+
+BOOST_AUTO_TEST_CASE( padded_test)
+{
+    using namespace hadoken::thread;
+
+    std::vector<padded<std::atomic<int> > > counters(4);
+    counters[1]->store(42);
+    BOOST_CHECK_EQUAL(counters[1]->load(), 42);
+    BOOST_CHECK_EQUAL(counters[0]->load(), 0);
+
+    // two neighbours never share a cache line
+    const char* first = reinterpret_cast<const char*>(&counters[0].get());
+    const char* second = reinterpret_cast<const char*>(&counters[1].get());
+    BOOST_CHECK_GE(static_cast<std::size_t>(second - first), cache_line_size + sizeof(std::atomic<int>));
+
+    padded<std::string> str(3, 'a');
+    padded<std::string> copy(str);
+    BOOST_CHECK_EQUAL(*copy, "aaa");
+    BOOST_CHECK_EQUAL(copy->size(), 3);
+}
+
+
+BOOST_AUTO_TEST_CASE( sharded_counter_test)
+{
+    using namespace hadoken::thread;
+
+    const std::size_t n_thread = 8;
+    const std::size_t n_iter = 100000;
+
+    sharded_counter counter;
+    BOOST_CHECK_EQUAL(counter.load(), 0);
+    BOOST_CHECK_GE(counter.number_of_shards(), 1);
+
+    sharded_counter wide(5);
+    BOOST_CHECK_EQUAL(wide.number_of_shards(), 8);
+
+    std::vector<std::thread> threads;
+    for(std::size_t i = 0; i < n_thread; ++i){
+        threads.emplace_back([&](){
+            for(std::size_t j = 0; j < n_iter; ++j){
+                ++counter;
+                wide += 2;
+                if(j % 2 == 0){
+                    --wide;
+                }
+            }
+        });
+    }
+    for(auto & t : threads){
+        t.join();
+    }
+
+    BOOST_CHECK_EQUAL(counter.load(), static_cast<sharded_counter::value_type>(n_thread * n_iter));
+    BOOST_CHECK_EQUAL(static_cast<sharded_counter::value_type>(wide), static_cast<sharded_counter::value_type>(n_thread * n_iter * 3 / 2));
+
+    counter.reset();
+    BOOST_CHECK_EQUAL(counter.load(), 0);
+}
+
+
+
+namespace{
+
+// value where all the fields must stay equal, a torn read breaks it
+struct triple_value{
+    std::uint64_t a, b, c;
+    std::uint32_t d;
+};
+
+struct snapshot_table{
+    snapshot_table() : version(0), entries(64, 0) {}
+
+    std::size_t version;
+    std::vector<std::size_t> entries;
+
+    static std::atomic<int> live;
+};
+
+std::atomic<int> snapshot_table::live(0);
+
+struct counted_table : public snapshot_table{
+    counted_table() : snapshot_table() { live += 1; }
+    counted_table(const counted_table & other) : snapshot_table(other) { live += 1; }
+    ~counted_table() { live -= 1; }
+};
+
+}
+
+
+BOOST_AUTO_TEST_CASE( seqlock_test)
+{
+    using namespace hadoken::thread;
+
+    const std::size_t n_reader = 4;
+    const std::uint64_t n_write = 20000;
+
+    triple_value init = { 0, 0, 0, 0 };
+    seqlock<triple_value> value(init);
+    BOOST_CHECK_EQUAL(value.load().a, 0);
+    BOOST_CHECK_EQUAL(value.version(), 0);
+
+    std::atomic<bool> running(true);
+    std::atomic<std::size_t> torn(0), reads(0);
+
+    std::vector<std::thread> readers;
+    for(std::size_t i = 0; i < n_reader; ++i){
+        readers.emplace_back([&](){
+            std::uint64_t last = 0;
+            while(running.load(std::memory_order_relaxed)){
+                const triple_value v = value.load();
+                if(v.a != v.b || v.b != v.c || v.d != static_cast<std::uint32_t>(v.a) || v.a < last){
+                    torn += 1;
+                }
+                last = v.a;
+                reads += 1;
+            }
+        });
+    }
+
+    // two writers, serialized by the seqlock
+    std::thread other_writer([&](){
+        for(std::uint64_t i = 0; i < n_write; ++i){
+            value.update([](triple_value & v){
+                v.a += 1; v.b += 1; v.c += 1; v.d += 1;
+            });
+        }
+    });
+    for(std::uint64_t i = 0; i < n_write; ++i){
+        value.update([](triple_value & v){
+            v.a += 1; v.b += 1; v.c += 1; v.d += 1;
+        });
+    }
+    other_writer.join();
+
+    running = false;
+    for(auto & r : readers){
+        r.join();
+    }
+
+    BOOST_CHECK_EQUAL(torn.load(), 0);
+    BOOST_CHECK_GT(reads.load(), 0);
+    BOOST_CHECK_EQUAL(value.load().c, 2 * n_write);
+    BOOST_CHECK_EQUAL(value.version(), 2 * n_write);
+
+    triple_value reset = { 7, 7, 7, 7 };
+    value.store(reset);
+    triple_value res;
+    BOOST_CHECK(value.try_load(res));
+    BOOST_CHECK_EQUAL(res.b, 7);
+}
+
+
+BOOST_AUTO_TEST_CASE( snapshot_ptr_test)
+{
+    using namespace hadoken::thread;
+
+    const std::size_t n_reader = 4;
+    const std::size_t n_update = 2000;
+
+    {
+        epoch_domain domain;
+        snapshot_ptr<counted_table> table(domain);
+        BOOST_CHECK(!table.read());
+
+        table.store(std::unique_ptr<counted_table>(new counted_table()));
+        BOOST_CHECK(table.read());
+        BOOST_CHECK_EQUAL(table.read()->entries.size(), 64);
+
+        std::atomic<bool> running(true);
+        std::atomic<std::size_t> inconsistent(0);
+
+        std::vector<std::thread> readers;
+        for(std::size_t i = 0; i < n_reader; ++i){
+            readers.emplace_back([&](){
+                std::size_t last_version = 0;
+                while(running.load(std::memory_order_relaxed)){
+                    auto snap = table.read();
+                    // a snapshot is never modified after its publication
+                    for(std::size_t e : snap->entries){
+                        if(e != snap->version){
+                            inconsistent += 1;
+                        }
+                    }
+                    if(snap->version < last_version){
+                        inconsistent += 1;
+                    }
+                    last_version = snap->version;
+                }
+            });
+        }
+
+        for(std::size_t i = 0; i < n_update; ++i){
+            table.update([](counted_table & t){
+                t.version += 1;
+                std::fill(t.entries.begin(), t.entries.end(), t.version);
+            });
+        }
+
+        running = false;
+        for(auto & r : readers){
+            r.join();
+        }
+
+        BOOST_CHECK_EQUAL(inconsistent.load(), 0);
+        BOOST_CHECK_EQUAL(table.read()->version, n_update);
+        BOOST_CHECK_EQUAL(table.copy()->entries[10], n_update);
+
+        table.reset();
+        BOOST_CHECK(!table.read());
+        domain.collect();
+
+        // no reader: each previous snapshot is freed at its update, not after many of them
+        table.store(std::unique_ptr<counted_table>(new counted_table()));
+        for(std::size_t i = 0; i < 3; ++i){
+            table.update([](counted_table & t){ t.version += 1; });
+            BOOST_CHECK_EQUAL(snapshot_table::live.load(), 1);
+        }
+
+        // a reader keeps its snapshot alive
+        {
+            auto snap = table.read();
+            table.update([](counted_table & t){ t.version += 1; });
+            BOOST_CHECK_EQUAL(snapshot_table::live.load(), 2);
+            BOOST_CHECK_EQUAL(snap->version, 3);
+        }
+        table.update([](counted_table & t){ t.version += 1; });
+        BOOST_CHECK_EQUAL(snapshot_table::live.load(), 1);
+    }
+
+    // the readers exited and the domain is destroyed: all the snapshots are freed
+    BOOST_CHECK_EQUAL(snapshot_table::live.load(), 0);
+}
+
+
+
+BOOST_AUTO_TEST_CASE( profiled_lock_test)
+{
+    using namespace hadoken::thread;
+
+    const std::size_t n_thread = 4;
+    const std::size_t n_iter = 20000;
+
+    std::size_t shared_value = 0;
+    lock_site_statistics stats;
+
+    {
+        profiled_lock<std::mutex> lock(HADOKEN_LOCK_SITE("profiled_lock_test_mutex"));
+
+        std::vector<std::thread> threads;
+        for(std::size_t i = 0; i < n_thread; ++i){
+            threads.emplace_back([&](){
+                for(std::size_t j = 0; j < n_iter; ++j){
+                    std::lock_guard<profiled_lock<std::mutex> > l(lock);
+                    shared_value += 1;
+                }
+            });
+        }
+        for(auto & t : threads){
+            t.join();
+        }
+
+        BOOST_CHECK(lock.try_lock());
+        lock.unlock();
+
+        stats = lock.statistics();
+    }
+
+    BOOST_CHECK_EQUAL(shared_value, n_thread * n_iter);
+    BOOST_CHECK_EQUAL(stats.name, "profiled_lock_test_mutex");
+    BOOST_CHECK_GT(stats.line, 0);
+    BOOST_CHECK_EQUAL(stats.acquisitions, n_thread * n_iter + 1);
+    BOOST_CHECK_LE(stats.contended, stats.acquisitions);
+    BOOST_CHECK_GE(stats.hold_samples, stats.contended + (stats.acquisitions - stats.contended) / 64);
+
+    std::uint64_t n_waits = 0;
+    for(std::uint64_t count : stats.wait_histogram){
+        n_waits += count;
+    }
+    BOOST_CHECK_EQUAL(n_waits, stats.contended);
+
+    // the locks constructed at the same site are aggregated, and survive their destruction
+    for(int i = 0; i < 3; ++i){
+        profiled_lock<spin_lock> lock("profiled_lock_test_spin", "site.cpp", 42, 1);
+        for(int j = 0; j < 10; ++j){
+            std::lock_guard<profiled_lock<spin_lock> > l(lock);
+        }
+    }
+
+    lock_site_statistics spin_stats = lock_profiler::instance().statistics("profiled_lock_test_spin", "site.cpp", 42);
+    BOOST_CHECK_EQUAL(spin_stats.acquisitions, 30);
+    BOOST_CHECK_EQUAL(spin_stats.contended, 0);
+    BOOST_CHECK_EQUAL(spin_stats.hold_samples, 30);
+
+    std::ostringstream report;
+    lock_profiler::instance().dump(report);
+    BOOST_CHECK(report.str().find("profiled_lock_test_spin (site.cpp:42) acquisitions=30") != std::string::npos);
+    BOOST_CHECK(report.str().find("profiled_lock_test_mutex") != std::string::npos);
+
+    lock_profiler::instance().reset();
+    BOOST_CHECK_EQUAL(lock_profiler::instance().statistics("profiled_lock_test_spin", "site.cpp", 42).acquisitions, 0);
+}